@@ -0,0 +1,92 @@
+/**
+ * @file
+ * Benchmark of overlapped OTP programming with AsyncDeviceData
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <glog/logging.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "async_device_data.h"
+#include "device_data.h"
+#include "simulated_flash_access.h"
+
+/*
+ * A station programs boards one after another. Preparing the payload of a board (fetching MAC
+ * addresses, formatting calibration data) is simulated by kPrepareTime of host work, and
+ * programming is done by the simulated device. Blocking DeviceData serialises both, the async
+ * front end lets the next payload be prepared while the current board is programmed.
+ */
+static const std::chrono::microseconds kPrepareTime(5000);
+
+static std::vector<uint8_t> PreparePayload(int board) {
+  std::this_thread::sleep_for(kPrepareTime);
+  /* register 0 version 1 followed by register 1 version 2 */
+  std::vector<uint8_t> data(37 + 12, 0x00);
+  data[0] = 0x01;
+  data[1] = board & 0xff;
+  data[37] = 0x02;
+  return data;
+}
+
+static double Milliseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static double RunBlocking(int boards) {
+  DeviceData device_data(std::unique_ptr<FlashAccess>(new SimulatedFlashAccess));
+  auto start = std::chrono::steady_clock::now();
+  for (int board = 0; board < boards; board++) {
+    device_data.Write(PreparePayload(board));
+    device_data.ReadField("SERIAL");
+  }
+  return Milliseconds(std::chrono::steady_clock::now() - start);
+}
+
+static double RunOverlapped(int boards) {
+  AsyncDeviceData device_data(std::unique_ptr<FlashAccess>(new SimulatedFlashAccess));
+  auto start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> payload = PreparePayload(0);
+  for (int board = 0; board < boards; board++) {
+    std::future<void> written = device_data.Write(payload);
+    std::future<std::vector<uint8_t>> serial = device_data.ReadField("SERIAL");
+    if (board + 1 < boards) {
+      payload = PreparePayload(board + 1);
+    }
+    written.get();
+    serial.get();
+  }
+  return Milliseconds(std::chrono::steady_clock::now() - start);
+}
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  int boards = argc > 1 ? atoi(argv[1]) : 50;
+
+  double blocking = RunBlocking(boards);
+  double overlapped = RunOverlapped(boards);
+  std::cout << boards << " boards" << std::endl;
+  std::cout << "blocking:   " << blocking << " ms (" << blocking / boards << " ms/board)"
+            << std::endl;
+  std::cout << "overlapped: " << overlapped << " ms (" << overlapped / boards << " ms/board)"
+            << std::endl;
+  std::cout << "speedup:    " << blocking / overlapped << "x" << std::endl;
+
+  google::ShutdownGoogleLogging();
+  return 0;
+}
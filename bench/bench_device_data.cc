@@ -0,0 +1,124 @@
+/**
+ * @file
+ * Benchmark of DeviceData over virtual and static dispatch backends
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <glog/logging.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "device_data.h"
+#include "memory_access.h"
+
+/*
+ * Batch image generation and audits run DeviceData over images held in memory, where the device
+ * access is a memcpy and the cost of the virtual FlashAccess calls shows. The same image is read
+ * through DeviceData over a FlashAccess subclass and through BasicDeviceData<MemoryAccess>.
+ */
+static const int kImageSize = 3 * 256;
+
+/**
+ * @brief FlashAccess over a memory buffer, dispatched virtually
+ */
+class MemoryFlashAccess : public FlashAccess {
+ public:
+  explicit MemoryFlashAccess(const std::vector<uint8_t> &image)
+      : FlashAccess("/dev/null"), image_(image) {}
+
+  void Write(const std::vector<uint8_t> &buf, const int offset) {
+    std::copy(buf.begin(), buf.end(), image_.begin() + offset);
+  }
+
+  std::vector<uint8_t> Read(const int size, const int offset) {
+    return std::vector<uint8_t>(image_.begin() + offset, image_.begin() + offset + size);
+  }
+
+  void ReadInto(uint8_t *buf, const int size, const int offset) {
+    memcpy(buf, image_.data() + offset, size);
+  }
+
+  std::vector<uint8_t> ReadSerial() {
+    return std::vector<uint8_t>(8, 0x42);
+  }
+
+ private:
+  std::vector<uint8_t> image_;
+};
+
+static std::vector<uint8_t> MakeImage() {
+  std::vector<uint8_t> image(kImageSize, 0xFF);
+  BasicDeviceData<MemoryAccess> device_data(
+      std::unique_ptr<MemoryAccess>(new MemoryAccess(image.data(), image.size())));
+  /* register 0 version 1 followed by register 1 version 2 */
+  std::vector<uint8_t> data(37 + 12, 0x00);
+  data[0] = 0x01;
+  data[1] = 0x42;
+  data[37] = 0x02;
+  data[38] = 0xfd;
+  device_data.Write(data);
+  return image;
+}
+
+static double Nanoseconds(std::chrono::steady_clock::duration duration, int iterations) {
+  return std::chrono::duration<double, std::nano>(duration).count() / iterations;
+}
+
+template <typename DeviceDataType>
+static void Run(const char *name, DeviceDataType *device_data, int iterations) {
+  int sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    sum += device_data->template Get<fields::DCXO>();
+  }
+  double get_dcxo = Nanoseconds(std::chrono::steady_clock::now() - start, iterations);
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    sum += device_data->template Get<fields::MAC_0>().octets[5];
+  }
+  double get_mac = Nanoseconds(std::chrono::steady_clock::now() - start, iterations);
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    sum += device_data->Read().size();
+  }
+  double read = Nanoseconds(std::chrono::steady_clock::now() - start, iterations);
+
+  std::cout << name << ": Get<DCXO> " << get_dcxo << " ns, Get<MAC_0> " << get_mac
+            << " ns, Read " << read << " ns (checksum " << sum << ")" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+  std::vector<uint8_t> image = MakeImage();
+
+  MemoryFlashAccess *flash_access = new MemoryFlashAccess(image);
+  DeviceData virtual_data((std::unique_ptr<FlashAccess>(flash_access)));
+  /* hold the device lock so inner locks only count nesting, as for MemoryAccess */
+  flash_access->Lock(false);
+  Run("virtual FlashAccess", &virtual_data, iterations);
+  flash_access->Unlock();
+
+  BasicDeviceData<MemoryAccess> static_data(
+      std::unique_ptr<MemoryAccess>(new MemoryAccess(image.data(), image.size())));
+  Run("static MemoryAccess", &static_data, iterations);
+
+  google::ShutdownGoogleLogging();
+  return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file
+ * Simulated OTP device for benchmarks
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef SIMULATEDFLASHACCESS_H_
+#define SIMULATEDFLASHACCESS_H_
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "flash_access.h"
+
+/**
+ * @brief In-memory OTP with the timing of a SPI NOR security register
+ *
+ * Reads cost read_latency, writes cost program_latency per started 256 byte page.
+ */
+class SimulatedFlashAccess : public FlashAccess {
+ public:
+  SimulatedFlashAccess() : FlashAccess("/dev/null"), read_latency(std::chrono::microseconds(50)),
+                           program_latency(std::chrono::microseconds(3000)),
+                           serial(8, 0x42), otp_(3 * 256, 0xFF) {}
+
+  void Write(const std::vector<uint8_t> &buf, const int offset) {
+    if (offset < 0 || offset + buf.size() > otp_.size()) {
+      throw std::runtime_error("simulated write out of range");
+    }
+    int pages = (offset % 256 + buf.size() + 255) / 256;
+    std::this_thread::sleep_for(program_latency * pages);
+    std::copy(buf.begin(), buf.end(), otp_.begin() + offset);
+  }
+
+  std::vector<uint8_t> Read(const int size, const int offset) {
+    if (offset < 0 || offset + size > static_cast<int>(otp_.size())) {
+      throw std::runtime_error("simulated read out of range");
+    }
+    std::this_thread::sleep_for(read_latency);
+    return std::vector<uint8_t>(otp_.begin() + offset, otp_.begin() + offset + size);
+  }
+
+  std::vector<uint8_t> ReadSerial() {
+    std::this_thread::sleep_for(read_latency);
+    return serial;
+  }
+
+  std::chrono::microseconds read_latency;
+  std::chrono::microseconds program_latency;
+  std::vector<uint8_t> serial;
+
+ private:
+  std::vector<uint8_t> otp_;
+};
+
+#endif  // SIMULATEDFLASHACCESS_H_
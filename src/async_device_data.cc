@@ -0,0 +1,57 @@
+/**
+ * @file
+ * AsyncDeviceData class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "async_device_data.h"
+#include <glog/logging.h>
+#include <utility>
+
+AsyncDeviceData::AsyncDeviceData(std::unique_ptr<FlashAccess> flash_access)
+    : device_data_(new DeviceData(std::move(flash_access))) {
+  DLOG(INFO) << "Initialising AsyncDeviceData";
+}
+
+AsyncDeviceData::~AsyncDeviceData() {
+  DLOG(INFO) << "Deinitialising AsyncDeviceData";
+}
+
+std::future<void> AsyncDeviceData::Write(const std::vector<uint8_t> &data) {
+  DeviceData *device_data = device_data_.get();
+  return io_worker_.Submit([device_data, data]() { device_data->Write(data); });
+}
+
+std::future<void> AsyncDeviceData::WriteField(const std::string &name,
+                                              const std::vector<uint8_t> &data) {
+  DeviceData *device_data = device_data_.get();
+  return io_worker_.Submit([device_data, name, data]() { device_data->WriteField(name, data); });
+}
+
+std::future<void> AsyncDeviceData::WriteFields(
+    const std::map<std::string, std::vector<uint8_t>> &values) {
+  DeviceData *device_data = device_data_.get();
+  return io_worker_.Submit([device_data, values]() { device_data->WriteFields(values); });
+}
+
+std::future<std::vector<uint8_t>> AsyncDeviceData::Read() {
+  DeviceData *device_data = device_data_.get();
+  return io_worker_.Submit([device_data]() { return device_data->Read(); });
+}
+
+std::future<std::vector<uint8_t>> AsyncDeviceData::ReadField(const std::string &name) {
+  DeviceData *device_data = device_data_.get();
+  return io_worker_.Submit([device_data, name]() { return device_data->ReadField(name); });
+}
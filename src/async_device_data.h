@@ -0,0 +1,82 @@
+/**
+ * @file
+ * AsyncDeviceData class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef ASYNCDEVICEDATA_H_
+#define ASYNCDEVICEDATA_H_
+
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "device_data.h"
+#include "io_worker.h"
+
+/**
+ * @brief Asynchronous front end of DeviceData
+ *
+ * Each operation (version read, register read-modify-write, CRC update) runs as a whole on the
+ * I/O thread of the device, so operations never interleave and the caller thread is free while
+ * the OTP is being programmed.
+ */
+class AsyncDeviceData {
+ public:
+  /**
+   * @brief Constructor
+   *
+   * @param[in] flash_access device to run the operations on, only accessed by the I/O thread
+   */
+  explicit AsyncDeviceData(std::unique_ptr<FlashAccess> flash_access);
+
+  /**
+   * @brief Destructor, completes all submitted operations
+   */
+  ~AsyncDeviceData();
+
+  /**
+   * @brief See DeviceData::Write
+   */
+  std::future<void> Write(const std::vector<uint8_t> &data);
+
+  /**
+   * @brief See DeviceData::WriteField
+   */
+  std::future<void> WriteField(const std::string &name, const std::vector<uint8_t> &data);
+
+  /**
+   * @brief See DeviceData::WriteFields
+   */
+  std::future<void> WriteFields(const std::map<std::string, std::vector<uint8_t>> &values);
+
+  /**
+   * @brief See DeviceData::Read
+   */
+  std::future<std::vector<uint8_t>> Read();
+
+  /**
+   * @brief See DeviceData::ReadField
+   */
+  std::future<std::vector<uint8_t>> ReadField(const std::string &name);
+
+ private:
+  /* declared before io_worker_ so the worker is joined before DeviceData is destroyed */
+  std::unique_ptr<DeviceData> device_data_;
+  IoWorker io_worker_;
+};
+
+#endif  // ASYNCDEVICEDATA_H_
@@ -0,0 +1,47 @@
+/**
+ * @file
+ * AsyncFlashAccess class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "async_flash_access.h"
+#include <glog/logging.h>
+#include <utility>
+
+AsyncFlashAccess::AsyncFlashAccess(std::unique_ptr<FlashAccess> flash_access)
+    : flash_access_(std::move(flash_access)) {
+  DLOG(INFO) << "Initialising AsyncFlashAccess";
+}
+
+AsyncFlashAccess::~AsyncFlashAccess() {
+  DLOG(INFO) << "Deinitialising AsyncFlashAccess";
+}
+
+std::future<void> AsyncFlashAccess::Write(const std::vector<uint8_t> &buf, const int offset) {
+  FlashAccess *flash_access = flash_access_.get();
+  return io_worker_.Submit([flash_access, buf, offset]() { flash_access->Write(buf, offset); });
+}
+
+std::future<std::vector<uint8_t>> AsyncFlashAccess::Read(const int size, const int offset) {
+  FlashAccess *flash_access = flash_access_.get();
+  return io_worker_.Submit([flash_access, size, offset]() {
+    return flash_access->Read(size, offset);
+  });
+}
+
+std::future<std::vector<uint8_t>> AsyncFlashAccess::ReadSerial() {
+  FlashAccess *flash_access = flash_access_.get();
+  return io_worker_.Submit([flash_access]() { return flash_access->ReadSerial(); });
+}
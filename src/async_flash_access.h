@@ -0,0 +1,80 @@
+/**
+ * @file
+ * AsyncFlashAccess class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef ASYNCFLASHACCESS_H_
+#define ASYNCFLASHACCESS_H_
+
+#include <future>
+#include <memory>
+#include <vector>
+#include "flash_access.h"
+#include "io_worker.h"
+
+/**
+ * @brief Asynchronous front end of a FlashAccess device
+ *
+ * Every operation is run by one I/O thread dedicated to the device, in submission order, so
+ * the caller can prepare the next payload while an OTP program is in flight. Errors thrown by
+ * the device are rethrown by the future's get().
+ */
+class AsyncFlashAccess {
+ public:
+  /**
+   * @brief Constructor
+   *
+   * @param[in] flash_access device to run the operations on, only accessed by the I/O thread
+   */
+  explicit AsyncFlashAccess(std::unique_ptr<FlashAccess> flash_access);
+
+  /**
+   * @brief Destructor, completes all submitted operations
+   */
+  ~AsyncFlashAccess();
+
+  /**
+   * @brief Write data to flash
+   *
+   * @param[in] buf chunk of data to be written
+   * @param[in] offset device offset
+   * returns future ready when data has been written
+   */
+  std::future<void> Write(const std::vector<uint8_t> &buf, const int offset);
+
+  /**
+   * @brief Read data from flash storage
+   *
+   * @param[in] size size of data to be read
+   * @param[in] offset device offset
+   * returns future receiving the read data
+   */
+  std::future<std::vector<uint8_t>> Read(const int size, const int offset);
+
+  /**
+   * @brief Read serial number
+   *
+   * returns future receiving the serial number
+   */
+  std::future<std::vector<uint8_t>> ReadSerial();
+
+ private:
+  /* declared before io_worker_ so the worker is joined before the device is destroyed */
+  std::unique_ptr<FlashAccess> flash_access_;
+  IoWorker io_worker_;
+};
+
+#endif  // ASYNCFLASHACCESS_H_
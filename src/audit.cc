@@ -0,0 +1,120 @@
+/**
+ * @file
+ * Offline verifier of OTP dump archives
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "audit.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "parallel_for.h"
+
+/* dumps a worker takes at a time, small enough to balance, large enough to amortise locking */
+static const size_t kAuditChunk = 256;
+
+const int AuditReport::kStatusCount;
+const size_t AuditReport::kMaxProblems;
+
+AuditReport::AuditReport() : dumps(0), unreadable(0), problem_count(0) {
+  memset(status, 0, sizeof(status));
+  memset(versions, 0, sizeof(versions));
+}
+
+void AuditReport::Merge(const AuditReport &other) {
+  dumps += other.dumps;
+  unreadable += other.unreadable;
+  for (int reg = 0; reg < 2; reg++) {
+    for (int i = 0; i < kStatusCount; i++) {
+      status[reg][i] += other.status[reg][i];
+    }
+    for (int i = 0; i < 256; i++) {
+      versions[reg][i] += other.versions[reg][i];
+    }
+  }
+  problem_count += other.problem_count;
+  for (const auto &problem : other.problems) {
+    if (problems.size() >= kMaxProblems) {
+      break;
+    }
+    problems.push_back(problem);
+  }
+}
+
+const char *RegisterStatusName(DeviceData::RegisterStatus status) {
+  switch (status) {
+    case DeviceData::kRegisterValid:
+      return "valid";
+    case DeviceData::kRegisterBlank:
+      return "blank";
+    case DeviceData::kRegisterUnknownVersion:
+      return "unknown version";
+    case DeviceData::kRegisterTruncated:
+      return "truncated";
+    case DeviceData::kRegisterCRCFailed:
+      return "CRC failed";
+  }
+  return "invalid";
+}
+
+static void AddProblem(AuditReport *report, const std::string &problem) {
+  report->problem_count++;
+  if (report->problems.size() < AuditReport::kMaxProblems) {
+    report->problems.push_back(problem);
+  }
+}
+
+AuditReport Audit(const DumpSet &dumps, int threads) {
+  if (threads <= 0) {
+    threads = DefaultThreads();
+  }
+  std::vector<AuditReport> reports(threads);
+
+  ParallelFor(dumps.Count(), threads, kAuditChunk, [&](int worker, size_t begin, size_t end) {
+    AuditReport *report = &reports[worker];
+    uint8_t buf[DumpSet::kDumpSize];
+    for (size_t index = begin; index < end; index++) {
+      report->dumps++;
+      const uint8_t *data;
+      int size = dumps.Get(index, buf, &data);
+      if (size < 0) {
+        report->unreadable++;
+        AddProblem(report, dumps.Name(index) + ": unreadable");
+        continue;
+      }
+
+      DeviceData::ImageCheck check = DeviceData::CheckImage(data, size);
+      for (int reg = 0; reg < 2; reg++) {
+        DeviceData::RegisterStatus status = check.status[reg];
+        report->status[reg][status]++;
+        if (status == DeviceData::kRegisterValid || status == DeviceData::kRegisterCRCFailed) {
+          report->versions[reg][check.version[reg]]++;
+        }
+        if (status != DeviceData::kRegisterValid) {
+          AddProblem(report, dumps.Name(index) + ": register " + std::to_string(reg) + " " +
+                     RegisterStatusName(status));
+        }
+      }
+    }
+  });
+
+  AuditReport total;
+  for (const auto &report : reports) {
+    total.Merge(report);
+  }
+  return total;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file
+ * Offline verifier of OTP dump archives
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef AUDIT_H_
+#define AUDIT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "device_data.h"
+#include "dump_set.h"
+
+/**
+ * @brief Counts of an archive audit
+ */
+struct AuditReport {
+  static const int kStatusCount = DeviceData::kRegisterCRCFailed + 1;
+  static const size_t kMaxProblems = 100;
+
+  AuditReport();
+
+  /**
+   * @brief Add counts of another report, problems are kept up to kMaxProblems
+   */
+  void Merge(const AuditReport &other);
+
+  uint64_t dumps;
+  /** dumps which could not be read */
+  uint64_t unreadable;
+  /** per register, number of dumps with each DeviceData::RegisterStatus */
+  uint64_t status[2][kStatusCount];
+  /** per register, number of dumps with each version (valid or CRC failed) */
+  uint64_t versions[2][256];
+  /** description of the first problems found, "<dump name>: <problem>" */
+  std::vector<std::string> problems;
+  /** total number of problems, including those not kept */
+  uint64_t problem_count;
+};
+
+/**
+ * @brief Check every dump of an archive with DeviceData layout selection and CRC check
+ *
+ * @param[in] dumps archive to check
+ * @param[in] threads number of worker threads, 0 for one per core
+ * returns merged report of all dumps
+ */
+AuditReport Audit(const DumpSet &dumps, int threads);
+
+/**
+ * @brief Human readable name of a register status
+ */
+const char *RegisterStatusName(DeviceData::RegisterStatus status);
+
+#endif  // AUDIT_H_
@@ -0,0 +1,155 @@
+/**
+ * @file
+ * Calibration backends
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "cal_backend.h"
+#include <glog/logging.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void RunCommand(const std::vector<std::string> &args, std::string *output) {
+  DLOG(INFO) << "Running " << args[0];
+  /* built before fork, the child of a threaded process must not allocate */
+  std::vector<char *> argv;
+  for (const auto &arg : args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(NULL);
+
+  /* close on exec, children of concurrent calls must not hold each other's pipe open */
+  int pipe_fd[2];
+  if (output && pipe2(pipe_fd, O_CLOEXEC) < 0) {
+    LOG(ERROR) << "pipe failed: " << strerror(errno);
+    throw std::runtime_error("Running calibration hook failed");
+  }
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    LOG(ERROR) << "fork failed: " << strerror(errno);
+    if (output) {
+      close(pipe_fd[0]);
+      close(pipe_fd[1]);
+    }
+    throw std::runtime_error("Running calibration hook failed");
+  }
+
+  if (pid == 0) {
+    if (output) {
+      dup2(pipe_fd[1], STDOUT_FILENO);
+    }
+    execv(argv[0], argv.data());
+    _exit(127);
+  }
+
+  if (output) {
+    close(pipe_fd[1]);
+    output->clear();
+    char buf[256];
+    ssize_t ret;
+    while ((ret = read(pipe_fd[0], buf, sizeof(buf))) > 0 || (ret < 0 && errno == EINTR)) {
+      if (ret > 0) {
+        output->append(buf, ret);
+      }
+    }
+    close(pipe_fd[0]);
+  }
+
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      LOG(ERROR) << "waitpid failed: " << strerror(errno);
+      throw std::runtime_error("Running calibration hook failed");
+    }
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    LOG(ERROR) << args[0] << " failed with status " << status;
+    throw std::runtime_error("Calibration hook failed: " + args[0]);
+  }
+}
+
+ScriptCalBackend::ScriptCalBackend(const std::string &hook_dir, const std::string &measure_command,
+                                   const std::string &frequency_command)
+    : hook_dir_(hook_dir), measure_command_(measure_command),
+      frequency_command_(frequency_command) {
+  DLOG(INFO) << "Initialising ScriptCalBackend";
+}
+
+ScriptCalBackend::~ScriptCalBackend() {
+  DLOG(INFO) << "Deinitialising ScriptCalBackend";
+}
+
+void ScriptCalBackend::Tune(const CalParams &params) {
+  std::string standard = WifiStandard(params.channel, params.data_rate_index);
+  if (standard.empty()) {
+    LOG(ERROR) << "No valid modulation could be determined";
+    throw std::runtime_error("No valid modulation could be determined");
+  }
+
+  std::vector<std::string> args = {hook_dir_ + "/tx_dut_settings.sh",
+                                   std::to_string(params.num_spatial_streams)};
+  if (params.num_spatial_streams == 1) {
+    args.push_back(std::to_string(params.antenna));
+  }
+  args.push_back(std::to_string(params.channel));
+  args.push_back(standard);
+  args.push_back(std::to_string(params.bandwidth));
+  args.push_back(std::to_string(params.data_rate_index));
+  RunCommand(args, NULL);
+}
+
+void ScriptCalBackend::SetPdOffset(int antenna, int channel, int offset) {
+  RunCommand({hook_dir_ + "/set_pd_offset.sh", std::to_string(antenna), std::to_string(channel),
+              std::to_string(offset)}, NULL);
+}
+
+void ScriptCalBackend::SetTxPower(int power) {
+  RunCommand({hook_dir_ + "/set_txpower.sh", std::to_string(power)}, NULL);
+}
+
+static double ParseMeasurement(const std::string &output) {
+  try {
+    return std::stod(output);
+  } catch (std::logic_error &e) {
+    LOG(ERROR) << "Invalid measurement: " << output;
+    throw std::runtime_error("Invalid measurement");
+  }
+}
+
+double ScriptCalBackend::MeasureTxPower(const CalParams &params) {
+  std::string output;
+  RunCommand({measure_command_, std::to_string(params.antenna), std::to_string(params.channel)},
+             &output);
+  return ParseMeasurement(output);
+}
+
+void ScriptCalBackend::SetDcxo(int8_t value) {
+  /* set_dcxo.sh takes the raw register value in hex (00 to FF) */
+  char hex[3];
+  snprintf(hex, sizeof(hex), "%02X", static_cast<uint8_t>(value));
+  RunCommand({hook_dir_ + "/set_dcxo.sh", hex}, NULL);
+}
+
+double ScriptCalBackend::MeasureFrequencyOffset() {
+  std::string output;
+  RunCommand({frequency_command_}, &output);
+  return ParseMeasurement(output);
+}
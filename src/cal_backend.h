@@ -0,0 +1,118 @@
+/**
+ * @file
+ * Calibration backends
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef CALBACKEND_H_
+#define CALBACKEND_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cal_params.h"
+
+/**
+ * @brief Abstract class driving the WiFi test hooks during calibration
+ */
+class CalBackend {
+ public:
+  virtual ~CalBackend() {}
+
+  /**
+   * @brief Retune radio to channel, bandwidth, data rate and antenna of params
+   *
+   * @param[in] params test parameters
+   */
+  virtual void Tune(const CalParams &params) = 0;
+
+  /**
+   * @brief Set power detector offset of antenna for channel
+   *
+   * @param[in] antenna antenna number
+   * @param[in] channel channel number
+   * @param[in] offset power detector offset
+   */
+  virtual void SetPdOffset(int antenna, int channel, int offset) = 0;
+
+  /**
+   * @brief Set transmit power
+   *
+   * @param[in] power transmit power in dBm
+   */
+  virtual void SetTxPower(int power) = 0;
+
+  /**
+   * @brief Measure transmit power for current settings
+   *
+   * @param[in] params test parameters in use
+   * returns measured power in dBm
+   */
+  virtual double MeasureTxPower(const CalParams &params) = 0;
+
+  /**
+   * @brief Set DCXO (crystal oscillator trim) value
+   *
+   * @param[in] value signed DCXO value as stored in register 1
+   */
+  virtual void SetDcxo(int8_t value) = 0;
+
+  /**
+   * @brief Measure carrier frequency offset for current DCXO value
+   *
+   * returns frequency offset (any unit, sign matters)
+   */
+  virtual double MeasureFrequencyOffset() = 0;
+};
+
+/**
+ * @brief CalBackend running the wifi_test hook scripts directly, without shell or parameter file
+ */
+class ScriptCalBackend final: public CalBackend {
+ public:
+  /**
+   * @brief Constructor
+   *
+   * @param[in] hook_dir directory containing the wifi_test hook scripts
+   * @param[in] measure_command command printing measured tx power in dBm for
+   *            "<antenna> <channel>" arguments
+   * @param[in] frequency_command command printing measured carrier frequency offset
+   */
+  ScriptCalBackend(const std::string &hook_dir, const std::string &measure_command,
+                   const std::string &frequency_command);
+  ~ScriptCalBackend();
+
+  void Tune(const CalParams &params);
+  void SetPdOffset(int antenna, int channel, int offset);
+  void SetTxPower(int power);
+  double MeasureTxPower(const CalParams &params);
+  void SetDcxo(int8_t value);
+  double MeasureFrequencyOffset();
+
+ private:
+  const std::string hook_dir_;
+  const std::string measure_command_;
+  const std::string frequency_command_;
+};
+
+/**
+ * @brief Run command with arguments and wait for it to finish
+ *
+ * @param[in] args program path followed by its arguments
+ * @param[out] output if not null, receives standard output of the command
+ */
+void RunCommand(const std::vector<std::string> &args, std::string *output);
+
+#endif  // CALBACKEND_H_
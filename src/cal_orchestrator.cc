@@ -0,0 +1,219 @@
+/**
+ * @file
+ * CalOrchestrator class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "cal_orchestrator.h"
+#include <glog/logging.h>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/* measurement threads, one per path, all measuring the same step when started */
+class PathWorkers {
+ public:
+  PathWorkers(const std::vector<CalBackend *> &paths, const std::vector<int> &antennas)
+      : paths_(paths), antennas_(antennas), results_(antennas.size()), generation_(0),
+        pending_(0), stop_(false) {
+    for (size_t path = 0; path < antennas_.size(); path++) {
+      threads_.push_back(std::thread(&PathWorkers::Worker, this, path));
+    }
+  }
+
+  ~PathWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (auto &thread : threads_) {
+      thread.join();
+    }
+  }
+
+  /* measure params on every path, path i with antenna i, and wait for all of them */
+  std::vector<double> Measure(const CalParams &params) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      params_ = params;
+      pending_ = threads_.size();
+      generation_++;
+    }
+    start_.notify_all();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    if (error_) {
+      std::exception_ptr error = error_;
+      error_ = nullptr;
+      std::rethrow_exception(error);
+    }
+    return results_;
+  }
+
+ private:
+  void Worker(size_t path) {
+    uint64_t seen = 0;
+    for (;;) {
+      CalParams params;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_) {
+          return;
+        }
+        seen = generation_;
+        params = params_;
+      }
+      params.antenna = antennas_[path];
+
+      double result = 0;
+      std::exception_ptr error;
+      try {
+        result = paths_[path]->MeasureTxPower(params);
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      results_[path] = result;
+      if (error && !error_) {
+        error_ = error;
+      }
+      if (--pending_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  const std::vector<CalBackend *> &paths_;
+  const std::vector<int> &antennas_;
+  std::vector<double> results_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  CalParams params_;
+  uint64_t generation_;
+  size_t pending_;
+  bool stop_;
+  std::exception_ptr error_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace
+
+CalOrchestrator::CalOrchestrator(const SweepPlan &plan, const std::vector<CalBackend *> &paths)
+    : antennas_(plan.antennas), paths_(paths), concurrent_(false) {
+  DLOG(INFO) << "Initialising CalOrchestrator";
+  if (paths_.empty()) {
+    LOG(ERROR) << "No measurement path";
+    throw std::runtime_error("No measurement path");
+  }
+
+  concurrent_ = antennas_.size() > 1 && paths_.size() >= antennas_.size();
+  if (!concurrent_) {
+    if (paths_.size() > 1) {
+      LOG(WARNING) << "Measurement paths unused, calibrating antennas serially";
+    }
+    sweep_.reset(new CalSweep(plan));
+    return;
+  }
+
+  for (size_t i = 0; i < antennas_.size(); i++) {
+    for (size_t j = 0; j < i; j++) {
+      if (antennas_[i] == antennas_[j]) {
+        LOG(ERROR) << "Antenna listed twice: " << antennas_[i];
+        throw std::runtime_error("Antenna listed twice: " + std::to_string(antennas_[i]));
+      }
+    }
+  }
+  /* validates antennas and the rest of the plan */
+  CalSweep full(plan);
+  /* both transmit chains on, the steps of the first antenna drive the radio for all */
+  SweepPlan driven(plan);
+  driven.num_spatial_streams = 2;
+  driven.antennas = {antennas_[0]};
+  sweep_.reset(new CalSweep(driven));
+}
+
+CalOrchestrator::~CalOrchestrator() {
+  DLOG(INFO) << "Deinitialising CalOrchestrator";
+}
+
+bool CalOrchestrator::Concurrent() const {
+  return concurrent_;
+}
+
+const CalSweep &CalOrchestrator::Sweep() const {
+  return *sweep_;
+}
+
+void CalOrchestrator::Run() {
+  if (!concurrent_) {
+    sweep_->Run(paths_[0]);
+    measurements_ = sweep_->Measurements();
+    return;
+  }
+  RunConcurrent();
+}
+
+void CalOrchestrator::RunConcurrent() {
+  measurements_.clear();
+  CalBackend *driver = paths_[0];
+  PathWorkers workers(paths_, antennas_);
+  int tuned_channel = -1;
+  for (const auto &step : sweep_->Steps()) {
+    const CalParams &params = step.params;
+    if (step.retune) {
+      driver->Tune(params);
+      /* measure with the uncorrected power detectors */
+      if (params.channel != tuned_channel) {
+        for (int antenna : antennas_) {
+          driver->SetPdOffset(antenna, params.channel, params.tx_power_offset);
+        }
+        tuned_channel = params.channel;
+      }
+    }
+    driver->SetTxPower(params.tx_power);
+
+    std::vector<double> results = workers.Measure(params);
+    for (size_t path = 0; path < antennas_.size(); path++) {
+      CalParams measured = params;
+      measured.antenna = antennas_[path];
+      measurements_.push_back(CalMeasurement{measured, results[path]});
+    }
+  }
+}
+
+const std::vector<CalMeasurement> &CalOrchestrator::Measurements() const {
+  return measurements_;
+}
+
+std::map<std::string, std::vector<uint8_t>> CalOrchestrator::PdOffsets() const {
+  return ComputePdOffsets(measurements_);
+}
+
+void CalOrchestrator::Commit(DeviceData *device_data) const {
+  /* offsets of every antenna live in register 1, which is programmed once */
+  device_data->WriteFields(PdOffsets());
+}
@@ -0,0 +1,96 @@
+/**
+ * @file
+ * CalOrchestrator class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef CALORCHESTRATOR_H_
+#define CALORCHESTRATOR_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "cal_backend.h"
+#include "cal_sweep.h"
+#include "device_data.h"
+
+/**
+ * @brief Calibration sweep measuring all antennas at once when each has its own measurement path
+ *
+ * With one measurement path per antenna of the plan, the radio is tuned with both transmit
+ * chains on (2 spatial streams) and every step is measured on all paths concurrently by one
+ * worker thread per path. Only the first path drives the radio (tune, PD offset, tx power);
+ * the driver state is changed while the workers are idle and stays fixed while they measure,
+ * so the steps and retunes of one antenna cover all of them. With fewer paths than antennas
+ * the plan runs serially as a CalSweep on the first path.
+ *
+ * Offsets of all antennas are committed with a single register 1 write either way.
+ */
+class CalOrchestrator {
+ public:
+  /**
+   * @brief Constructor
+   *
+   * @param[in] plan declared sweep
+   * @param[in] paths one backend per measurement path, path i measures antenna i of the plan,
+   *            the first one also drives the radio; not owned
+   */
+  CalOrchestrator(const SweepPlan &plan, const std::vector<CalBackend *> &paths);
+  ~CalOrchestrator();
+
+  /**
+   * @brief True if the antennas are measured concurrently
+   */
+  bool Concurrent() const;
+
+  /**
+   * @brief Sweep driving the radio, in concurrent mode its steps are those of the first antenna
+   */
+  const CalSweep &Sweep() const;
+
+  /**
+   * @brief Run all steps, measurements replace those of a previous run
+   */
+  void Run();
+
+  /**
+   * @brief Measurements of the last run, of all antennas
+   */
+  const std::vector<CalMeasurement> &Measurements() const;
+
+  /**
+   * @brief Power detector offsets of all antennas and bands, see CalSweep::PdOffsets
+   */
+  std::map<std::string, std::vector<uint8_t>> PdOffsets() const;
+
+  /**
+   * @brief Write power detector offsets of all antennas to OTP in a single write
+   *
+   * @param[in] device_data DeviceData to write to, register 1 must have layout version 2
+   */
+  void Commit(DeviceData *device_data) const;
+
+ private:
+  void RunConcurrent();
+
+  const std::vector<int> antennas_;
+  const std::vector<CalBackend *> paths_;
+  bool concurrent_;
+  std::unique_ptr<CalSweep> sweep_;
+  std::vector<CalMeasurement> measurements_;
+};
+
+#endif  // CALORCHESTRATOR_H_
@@ -0,0 +1,67 @@
+/**
+ * @file
+ * WiFi calibration parameters
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "cal_params.h"
+#include <string>
+
+static const char *kBandNames[] = {"B24", "B51", "B52", "B53", "B54"};
+
+int ChannelBand(int channel) {
+  if (channel >= 1 && channel <= 14) {
+    return kBand24;
+  }
+  /* 5G channels are 20MHz apart */
+  if (channel % 4 != 0 && channel < 149) {
+    return -1;
+  }
+  if (channel >= 36 && channel <= 48) {
+    return kBand51;
+  }
+  if (channel >= 52 && channel <= 64) {
+    return kBand52;
+  }
+  if (channel >= 100 && channel <= 144) {
+    return kBand53;
+  }
+  if (channel >= 149 && channel <= 165 && (channel - 149) % 4 == 0) {
+    return kBand54;
+  }
+  return -1;
+}
+
+std::string WifiStandard(int channel, int data_rate_index) {
+  /* 2.4G */
+  if (data_rate_index == 11 && channel < 30) {
+    return "11b";
+  } else if (data_rate_index == 54 && channel < 30) {
+    return "11g";
+  /* 5G */
+  } else if (data_rate_index == 54) {
+    return "11a";
+  } else if (data_rate_index == 9 || data_rate_index == 8) {
+    return "11ac";
+  /* Both */
+  } else if (data_rate_index == 7 || data_rate_index == 5) {
+    return "11n";
+  }
+  return "";
+}
+
+std::string PdOffsetField(int antenna, int band) {
+  return "PD_A" + std::to_string(antenna) + "_" + kBandNames[band];
+}
@@ -0,0 +1,78 @@
+/**
+ * @file
+ * WiFi calibration parameters
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef CALPARAMS_H_
+#define CALPARAMS_H_
+
+#include <string>
+
+/**
+ * @brief WiFi test parameters, same set wifi_cal.sh keeps in /tmp/wifi_param
+ */
+struct CalParams {
+  int num_spatial_streams = 1;
+  int antenna = 1;
+  int channel = 7;
+  int bandwidth = 20;
+  int data_rate_index = 54;
+  int tx_power = 20;
+  int tx_power_offset = 0;
+};
+
+/**
+ * @brief Frequency bands with their own power detector offset in register 1
+ */
+enum CalBand {
+  kBand24,
+  kBand51,
+  kBand52,
+  kBand53,
+  kBand54,
+  kBandCount,
+};
+
+/** antennas with their own power detector offsets in register 1 */
+static const int kCalAntennaCount = 2;
+
+/**
+ * @brief Get band of a WiFi channel
+ *
+ * @param[in] channel channel number (1 to 165)
+ * returns CalBand or -1 if channel is not a valid WiFi channel
+ */
+int ChannelBand(int channel);
+
+/**
+ * @brief Work out the WiFi standard from channel and data rate, as find_wifi_standard of
+ * wifi_cal.sh does for the current testing spec
+ *
+ * @param[in] channel channel number
+ * @param[in] data_rate_index data rate index
+ * returns standard e.g "11g" or empty string if no valid modulation could be determined
+ */
+std::string WifiStandard(int channel, int data_rate_index);
+
+/**
+ * @brief Get register 1 field name holding the power detector offset e.g PD_A1_B24
+ *
+ * @param[in] antenna antenna number (1, 2)
+ * @param[in] band CalBand
+ */
+std::string PdOffsetField(int antenna, int band);
+
+#endif  // CALPARAMS_H_
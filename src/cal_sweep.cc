@@ -0,0 +1,160 @@
+/**
+ * @file
+ * CalSweep class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "cal_sweep.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+static void CheckNotEmpty(const std::vector<int> &list, const std::string &name) {
+  if (list.empty()) {
+    LOG(ERROR) << "Sweep has no " << name;
+    throw std::runtime_error("Sweep has no " + name);
+  }
+}
+
+CalSweep::CalSweep(const SweepPlan &plan) {
+  DLOG(INFO) << "Initialising CalSweep";
+  CheckNotEmpty(plan.antennas, "antennas");
+  CheckNotEmpty(plan.channels, "channels");
+  CheckNotEmpty(plan.bandwidths, "bandwidths");
+  CheckNotEmpty(plan.data_rates, "data rates");
+  CheckNotEmpty(plan.tx_powers, "tx powers");
+
+  for (int antenna : plan.antennas) {
+    if (antenna < 1 || antenna > kCalAntennaCount) {
+      LOG(ERROR) << "Invalid antenna: " << antenna;
+      throw std::runtime_error("Invalid antenna: " + std::to_string(antenna));
+    }
+  }
+  for (int channel : plan.channels) {
+    if (ChannelBand(channel) < 0) {
+      LOG(ERROR) << "Invalid channel: " << channel;
+      throw std::runtime_error("Invalid channel: " + std::to_string(channel));
+    }
+  }
+
+  /* tx power is the innermost loop, so each tune point is visited exactly once */
+  CalParams params;
+  params.num_spatial_streams = plan.num_spatial_streams;
+  for (int antenna : plan.antennas) {
+    params.antenna = antenna;
+    for (int channel : plan.channels) {
+      params.channel = channel;
+      for (int bandwidth : plan.bandwidths) {
+        params.bandwidth = bandwidth;
+        for (int data_rate : plan.data_rates) {
+          params.data_rate_index = data_rate;
+          if (WifiStandard(channel, data_rate).empty()) {
+            LOG(WARNING) << "Skipping channel " << channel << " data rate " << data_rate;
+            continue;
+          }
+          bool retune = true;
+          for (int tx_power : plan.tx_powers) {
+            params.tx_power = tx_power;
+            steps_.push_back(CalStep{params, retune});
+            retune = false;
+          }
+        }
+      }
+    }
+  }
+
+  if (steps_.empty()) {
+    LOG(ERROR) << "Sweep has no valid step";
+    throw std::runtime_error("Sweep has no valid step");
+  }
+}
+
+CalSweep::~CalSweep() {
+  DLOG(INFO) << "Deinitialising CalSweep";
+}
+
+const std::vector<CalStep> &CalSweep::Steps() const {
+  return steps_;
+}
+
+int CalSweep::Retunes() const {
+  int retunes = 0;
+  for (const auto &step : steps_) {
+    if (step.retune) {
+      retunes++;
+    }
+  }
+  return retunes;
+}
+
+void CalSweep::Run(CalBackend *backend) {
+  measurements_.clear();
+  const CalParams *tuned = NULL;
+  for (const auto &step : steps_) {
+    const CalParams &params = step.params;
+    if (step.retune) {
+      backend->Tune(params);
+      /* measure with the uncorrected power detector */
+      if (!tuned || tuned->antenna != params.antenna || tuned->channel != params.channel) {
+        backend->SetPdOffset(params.antenna, params.channel, params.tx_power_offset);
+      }
+      tuned = &params;
+    }
+    backend->SetTxPower(params.tx_power);
+    measurements_.push_back(CalMeasurement{params, backend->MeasureTxPower(params)});
+  }
+}
+
+const std::vector<CalMeasurement> &CalSweep::Measurements() const {
+  return measurements_;
+}
+
+std::map<std::string, std::vector<uint8_t>> CalSweep::PdOffsets() const {
+  return ComputePdOffsets(measurements_);
+}
+
+void CalSweep::Commit(DeviceData *device_data) const {
+  /* all offsets live in register 1, which is programmed once */
+  device_data->WriteFields(PdOffsets());
+}
+
+std::map<std::string, std::vector<uint8_t>> ComputePdOffsets(
+    const std::vector<CalMeasurement> &measurements) {
+  if (measurements.empty()) {
+    LOG(ERROR) << "Sweep has not been run";
+    throw std::runtime_error("Sweep has not been run");
+  }
+
+  std::map<std::pair<int, int>, std::pair<double, int>> errors;
+  for (const auto &measurement : measurements) {
+    const CalParams &params = measurement.params;
+    auto &error = errors[std::make_pair(params.antenna, ChannelBand(params.channel))];
+    error.first += params.tx_power - measurement.measured_power;
+    error.second++;
+  }
+
+  std::map<std::string, std::vector<uint8_t>> offsets;
+  for (const auto &error : errors) {
+    long offset = std::lround(error.second.first / error.second.second);  // NOLINT(runtime/int)
+    offset = std::max(-128L, std::min(127L, offset));
+    offsets[PdOffsetField(error.first.first, error.first.second)] =
+        std::vector<uint8_t>(1, static_cast<uint8_t>(offset));
+  }
+  return offsets;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file
+ * CalSweep class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef CALSWEEP_H_
+#define CALSWEEP_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include "cal_backend.h"
+#include "cal_params.h"
+#include "device_data.h"
+
+/**
+ * @brief Declared calibration sweep, every combination of the lists is measured
+ */
+struct SweepPlan {
+  int num_spatial_streams = 1;
+  std::vector<int> antennas{1};
+  std::vector<int> channels;
+  std::vector<int> bandwidths{20};
+  std::vector<int> data_rates{54};
+  std::vector<int> tx_powers;
+};
+
+/**
+ * @brief One step of a sweep
+ */
+struct CalStep {
+  CalParams params;
+  /** radio has to be retuned before this step */
+  bool retune;
+};
+
+/**
+ * @brief Measurement taken at one step
+ */
+struct CalMeasurement {
+  CalParams params;
+  double measured_power;
+};
+
+/**
+ * @brief Calibration sweep engine
+ *
+ * Parameters are kept in memory and the steps are ordered so that every tune point (antenna,
+ * channel, bandwidth, data rate) is visited once, only tx power changes between its steps.
+ * Power detector offsets are computed from the measurements and committed in one write.
+ */
+class CalSweep {
+ public:
+  /**
+   * @brief Constructor
+   *
+   * Validates the plan and orders its steps
+   *
+   * @param[in] plan declared sweep
+   */
+  explicit CalSweep(const SweepPlan &plan);
+  ~CalSweep();
+
+  /**
+   * @brief Ordered steps of the sweep
+   */
+  const std::vector<CalStep> &Steps() const;
+
+  /**
+   * @brief Number of retune operations the sweep needs
+   */
+  int Retunes() const;
+
+  /**
+   * @brief Run all steps on backend, measurements replace those of a previous run
+   *
+   * @param[in] backend backend driving the test hooks
+   */
+  void Run(CalBackend *backend);
+
+  /**
+   * @brief Measurements of the last run
+   */
+  const std::vector<CalMeasurement> &Measurements() const;
+
+  /**
+   * @brief Power detector offsets (target - measured power, rounded) per antenna and band
+   *
+   * returns map of register 1 field name to field value
+   */
+  std::map<std::string, std::vector<uint8_t>> PdOffsets() const;
+
+  /**
+   * @brief Write power detector offsets to OTP in a single write
+   *
+   * @param[in] device_data DeviceData to write to, register 1 must have layout version 2
+   */
+  void Commit(DeviceData *device_data) const;
+
+ private:
+  std::vector<CalStep> steps_;
+  std::vector<CalMeasurement> measurements_;
+};
+
+/**
+ * @brief Power detector offsets (target - measured power, rounded) per antenna and band
+ *
+ * @param[in] measurements measurements of one or more sweeps
+ * returns map of register 1 field name to field value
+ */
+std::map<std::string, std::vector<uint8_t>> ComputePdOffsets(
+    const std::vector<CalMeasurement> &measurements);
+
+#endif  // CALSWEEP_H_
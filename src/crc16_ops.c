@@ -0,0 +1,102 @@
+/**
+ * @file
+ * CRC-16 update by delta, shift and combine
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "crc16_ops.h"
+#include "lib_crc.h"
+
+#define CRC16_BITS 16
+#define CRC16_POLY 0xA001
+
+/* multiply 16x16 GF(2) matrix (one column per input bit) by vector */
+static unsigned short gf2_times(const unsigned short *mat, unsigned short vec) {
+  unsigned short sum = 0;
+  while (vec) {
+    if (vec & 1) {
+      sum ^= *mat;
+    }
+    vec >>= 1;
+    mat++;
+  }
+  return sum;
+}
+
+static void gf2_square(unsigned short *square, const unsigned short *mat) {
+  int n;
+  for (n = 0; n < CRC16_BITS; n++) {
+    square[n] = gf2_times(mat, mat[n]);
+  }
+}
+
+unsigned short crc16_block(unsigned short crc, const unsigned char *data, size_t size) {
+  while (size--) {
+    crc = update_crc_16(crc, *data++);
+  }
+  return crc;
+}
+
+unsigned short crc16_shift(unsigned short crc, size_t len) {
+  unsigned short even[CRC16_BITS];
+  unsigned short odd[CRC16_BITS];
+  int n;
+
+  if (len == 0) {
+    return crc;
+  }
+
+  /* operator for one zero bit */
+  odd[0] = CRC16_POLY;
+  for (n = 1; n < CRC16_BITS; n++) {
+    odd[n] = 1 << (n - 1);
+  }
+  /* two and four zero bits */
+  gf2_square(even, odd);
+  gf2_square(odd, even);
+
+  /* apply len zero bytes, squaring the operator for each bit of len as in zlib's crc32_combine */
+  do {
+    gf2_square(even, odd);
+    if (len & 1) {
+      crc = gf2_times(even, crc);
+    }
+    len >>= 1;
+    if (len == 0) {
+      break;
+    }
+    gf2_square(odd, even);
+    if (len & 1) {
+      crc = gf2_times(odd, crc);
+    }
+    len >>= 1;
+  } while (len);
+  return crc;
+}
+
+unsigned short crc16_combine(unsigned short crc1, unsigned short crc2, size_t len2) {
+  return crc16_shift(crc1, len2) ^ crc2;
+}
+
+unsigned short crc16_update(unsigned short crc, size_t message_size, size_t offset,
+                            const unsigned char *old_data, const unsigned char *new_data,
+                            size_t size) {
+  unsigned short delta = 0;
+  size_t i;
+  for (i = 0; i < size; i++) {
+    delta = update_crc_16(delta, old_data[i] ^ new_data[i]);
+  }
+  return crc ^ crc16_shift(delta, message_size - offset - size);
+}
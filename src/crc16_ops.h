@@ -0,0 +1,87 @@
+/**
+ * @file
+ * CRC-16 update by delta, shift and combine
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef CRC16OPS_H_
+#define CRC16OPS_H_
+
+/*
+ * Operations on the CRC-16 of lib_crc's update_crc_16 (reflected polynomial 0xA001, initial value
+ * 0, no final xor). With initial value 0 the CRC is linear over GF(2), so the CRC of a message can
+ * be derived from the CRCs of its parts or of a change, without rereading the whole message.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Continue crc over size bytes of data
+ *
+ * @param[in] crc CRC of the preceding data, 0 to start
+ * @param[in] data data
+ * @param[in] size number of bytes
+ * returns CRC of the preceding data followed by data
+ */
+unsigned short crc16_block(unsigned short crc, const unsigned char *data, size_t size);
+
+/**
+ * @brief CRC of a message extended by len zero bytes
+ *
+ * Takes O(log(len)) time.
+ *
+ * @param[in] crc CRC of the message
+ * @param[in] len number of zero bytes appended
+ * returns CRC of the extended message
+ */
+unsigned short crc16_shift(unsigned short crc, size_t len);
+
+/**
+ * @brief CRC of two concatenated blocks A and B
+ *
+ * @param[in] crc1 CRC of A
+ * @param[in] crc2 CRC of B
+ * @param[in] len2 length of B
+ * returns CRC of A followed by B
+ */
+unsigned short crc16_combine(unsigned short crc1, unsigned short crc2, size_t len2);
+
+/**
+ * @brief CRC of a message after replacing some of its bytes
+ *
+ * Only the replaced bytes are read. The result is only valid if crc was valid for the old
+ * message.
+ *
+ * @param[in] crc CRC of the old message
+ * @param[in] message_size length of the message
+ * @param[in] offset offset of the replaced bytes in the message
+ * @param[in] old_data bytes being replaced
+ * @param[in] new_data replacement bytes
+ * @param[in] size number of replaced bytes
+ * returns CRC of the new message
+ */
+unsigned short crc16_update(unsigned short crc, size_t message_size, size_t offset,
+                            const unsigned char *old_data, const unsigned char *new_data,
+                            size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CRC16OPS_H_
@@ -0,0 +1,119 @@
+/**
+ * @file
+ * DcxoCalibrator class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "dcxo_cal.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+static const int kDcxoMin = INT8_MIN;
+static const int kDcxoMax = INT8_MAX;
+
+DcxoCalibrator::DcxoCalibrator(CalBackend *backend, double tolerance) : backend_(backend),
+    tolerance_(tolerance), best_(kDcxoMax + 1) {
+  DLOG(INFO) << "Initialising DcxoCalibrator";
+}
+
+DcxoCalibrator::~DcxoCalibrator() {
+  DLOG(INFO) << "Deinitialising DcxoCalibrator";
+}
+
+double DcxoCalibrator::Measure(int value) {
+  const auto it = measured_.find(value);
+  if (it != measured_.end()) {
+    return it->second;
+  }
+  backend_->SetDcxo(static_cast<int8_t>(value));
+  double offset = backend_->MeasureFrequencyOffset();
+  DLOG(INFO) << "DCXO " << value << " frequency offset " << offset;
+  measured_[value] = offset;
+  return offset;
+}
+
+int8_t DcxoCalibrator::Search() {
+  measured_.clear();
+
+  int lo = kDcxoMin;
+  int hi = kDcxoMax;
+  double f_lo = Measure(lo);
+  double f_hi = Measure(hi);
+
+  /* end already good enough or no zero crossing in range, best is the closest end */
+  if (std::fabs(f_lo) <= tolerance_ || std::fabs(f_hi) <= tolerance_ || (f_lo < 0) == (f_hi < 0)) {
+    if ((f_lo < 0) == (f_hi < 0)) {
+      LOG(WARNING) << "Frequency offset not bracketed by DCXO range";
+    }
+    best_ = std::fabs(f_lo) <= std::fabs(f_hi) ? lo : hi;
+    return static_cast<int8_t>(best_);
+  }
+
+  int side = 0;
+  while (hi - lo > 1) {
+    /* false position estimate of the zero crossing, kept strictly inside the bracket */
+    double estimate = lo - f_lo * (hi - lo) / (f_hi - f_lo);
+    int x = static_cast<int>(std::lround(estimate));
+    x = std::max(lo + 1, std::min(hi - 1, x));
+
+    double f_x = Measure(x);
+    if (std::fabs(f_x) <= tolerance_) {
+      lo = hi = x;
+      break;
+    }
+    if ((f_x < 0) == (f_lo < 0)) {
+      /* Anderson-Bjorck: scale down the end kept twice to avoid one-sided convergence */
+      if (side == -1) {
+        double m = 1 - f_x / f_lo;
+        f_hi *= m > 0 ? m : 0.5;
+      }
+      lo = x;
+      f_lo = f_x;
+      side = -1;
+    } else {
+      if (side == 1) {
+        double m = 1 - f_x / f_hi;
+        f_lo *= m > 0 ? m : 0.5;
+      }
+      hi = x;
+      f_hi = f_x;
+      side = 1;
+    }
+  }
+
+  /* pick best of the actual measurements at the bracket ends */
+  best_ = std::fabs(measured_[lo]) <= std::fabs(measured_[hi]) ? lo : hi;
+  LOG(INFO) << "DCXO " << best_ << " found with " << measured_.size() << " measurements";
+  return static_cast<int8_t>(best_);
+}
+
+int8_t DcxoCalibrator::Best() const {
+  return static_cast<int8_t>(best_);
+}
+
+int DcxoCalibrator::Measurements() const {
+  return measured_.size();
+}
+
+void DcxoCalibrator::Commit(DeviceData *device_data) const {
+  if (best_ > kDcxoMax) {
+    LOG(ERROR) << "DCXO search has not been run";
+    throw std::runtime_error("DCXO search has not been run");
+  }
+  device_data->WriteField("DCXO", std::vector<uint8_t>(1, static_cast<uint8_t>(best_)));
+}
@@ -0,0 +1,81 @@
+/**
+ * @file
+ * DcxoCalibrator class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef DCXOCAL_H_
+#define DCXOCAL_H_
+
+#include <cstdint>
+#include <map>
+#include "cal_backend.h"
+#include "device_data.h"
+
+/**
+ * @brief Search of the DCXO value giving the smallest carrier frequency offset
+ *
+ * Frequency offset is monotonic in the DCXO value, so the zero crossing is bracketed by the two
+ * ends of the signed char range and located by false position (Anderson-Bjorck variant), which
+ * for the near linear pulling curve of a crystal needs a handful of measurements, not a sweep.
+ */
+class DcxoCalibrator {
+ public:
+  /**
+   * @brief Constructor
+   *
+   * @param[in] backend measurement source
+   * @param[in] tolerance frequency offset considered good enough to stop the search early
+   */
+  explicit DcxoCalibrator(CalBackend *backend, double tolerance = 0);
+  ~DcxoCalibrator();
+
+  /**
+   * @brief Search DCXO value with the smallest absolute frequency offset
+   *
+   * returns best DCXO value
+   */
+  int8_t Search();
+
+  /**
+   * @brief DCXO value found by the last search
+   */
+  int8_t Best() const;
+
+  /**
+   * @brief Number of frequency measurements done by the last search
+   */
+  int Measurements() const;
+
+  /**
+   * @brief Write DCXO value found by the last search to OTP
+   *
+   * @param[in] device_data DeviceData to write to
+   */
+  void Commit(DeviceData *device_data) const;
+
+ private:
+  CalBackend *backend_;
+  const double tolerance_;
+  std::map<int, double> measured_;
+  int best_;
+
+  /**
+   * @brief Measure frequency offset for DCXO value, each value is measured once
+   */
+  double Measure(int value);
+};
+
+#endif  // DCXOCAL_H_
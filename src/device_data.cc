@@ -18,27 +18,32 @@
 
 #include "device_data.h"
 #include <glog/logging.h>
+#include <algorithm>
 #include <regex>
+#include <sstream>
 
-extern "C" {
-#include "lib_crc.h"
-}
-
+#include "crc16_ops.h"
+#include "trace.h"
 #include "vector_operations.h"
 
 static const int kCRCSize = 2;
 static const int versionSize = 1;
 static const int regVersionOffset[] = {2, 258};
+static const int kRecordRegister = 2;
+/* registers 0 and 1, kept by the register cache */
+static const int kCachedRegisters = 2;
+/* unchanged bytes between changed runs programmed anyway rather than starting a new program,
+ * a SPI page program command costs an opcode and 3 address bytes */
+static const int kMaxProgramGap = 4;
+
+static int16_t ComputeCRC(const uint8_t *ptr, int size) {
+  trace::Scope scope("crc", "device_data");
+  scope.Arg("size", size);
+  return crc16_block(0, ptr, size);
+}
 
 static std::vector<uint8_t> CalculateDataCRC(const std::vector<uint8_t> &data) {
-  int16_t crc_16 = 0;
-  const unsigned char *ptr = data.data();
-  int size = data.size();
-  while (size) {
-    crc_16 = update_crc_16(crc_16, *ptr);
-    ptr++;
-    size--;
-  }
+  int16_t crc_16 = ComputeCRC(data.data(), data.size());
   /* convert int16_t crc to crc vector */
   char crc_0 = (crc_16 >> 8) & 0xff;
   char crc_1 = crc_16 & 0xff;
@@ -57,6 +62,8 @@ static void AddDataCRC(std::vector<uint8_t> *data) {
 }
 
 static void CheckDataCRC(const std::vector<uint8_t> &data) {
+  trace::Scope scope("crc_verify", "device_data");
+  scope.Arg("size", data.size());
   /* ignore first 2 bytes which stores crc */
   std::vector<uint8_t> data_without_crc(data.begin() + kCRCSize, data.end());
   std::vector<uint8_t> crc = CalculateDataCRC(data_without_crc);
@@ -67,34 +74,141 @@ static void CheckDataCRC(const std::vector<uint8_t> &data) {
   }
 }
 
-static void ReplaceDataCRC(std::vector<uint8_t> *data) {
-  /* Erase old crc */
-  data->erase(data->begin(), data->begin() + kCRCSize);
+template <typename Access>
+BasicDeviceData<Access>::BasicDeviceData(std::unique_ptr<Access> flash_access) :
+    flash_access_(std::move(flash_access)), cache_enabled_(false) {
+  DLOG(INFO) << "Initialising DeviceData";
+}
 
-  AddDataCRC(data);
+template <typename Access>
+BasicDeviceData<Access>::~BasicDeviceData() {
+  DLOG(INFO) << "Deinitialising DeviceData";
 }
 
-DeviceData::DeviceData(std::unique_ptr<FlashAccess> flash_access) :
-    flash_access_(std::move(flash_access)) {
-  DLOG(INFO) << "Initialising DeviceData";
-  registers_.push_back(register0_);
-  registers_.push_back(register1_);
+template <typename Access>
+void BasicDeviceData<Access>::AddWriteHook(WriteHook *hook) {
+  write_hooks_.push_back(hook);
 }
 
-DeviceData::~DeviceData() {
-  DLOG(INFO) << "Deinitialising DeviceData";
+template <typename Access>
+void BasicDeviceData<Access>::EnableRegisterCache() {
+  cache_enabled_ = true;
+}
+
+template <typename Access>
+void BasicDeviceData<Access>::DropRegisterCache() {
+  register_cache_.clear();
+  record_store_.reset();
 }
 
-void DeviceData::ReadVersionFromOTP() {
+template <typename Access>
+void BasicDeviceData<Access>::ReadCachedInto(uint8_t *buf, const int size, const int offset) {
+  const int cache_size = kCachedRegisters * fields::kRegisterSize;
+  if (!cache_enabled_ || offset < 0 || offset + size > cache_size) {
+    flash_access_->ReadInto(buf, size, offset);
+    return;
+  }
+  if (register_cache_.empty()) {
+    std::vector<uint8_t> cache(cache_size);
+    flash_access_->ReadInto(cache.data(), cache_size, 0);
+    register_cache_.swap(cache);
+  }
+  std::copy(register_cache_.begin() + offset, register_cache_.begin() + offset + size, buf);
+}
+
+template <typename Access>
+std::vector<uint8_t> BasicDeviceData<Access>::ReadCached(const int size, const int offset) {
+  if (!cache_enabled_) {
+    return flash_access_->Read(size, offset);
+  }
+  std::vector<uint8_t> buf(size);
+  ReadCachedInto(buf.data(), size, offset);
+  return buf;
+}
+
+template <typename Access>
+void BasicDeviceData<Access>::ProgramRegister(RegisterName register_name,
+                                              const std::vector<uint8_t> &old_data,
+                                              const std::vector<uint8_t> &new_data,
+                                              const std::vector<std::pair<int, int>> &runs,
+                                              const std::set<std::string> &fields) {
+  for (WriteHook *hook : write_hooks_) {
+    hook->BeforeWrite(register_name, old_data, new_data, fields);
+  }
+  const int base = GetCRCOffset(register_name);
+  for (const auto &run : runs) {
+    flash_access_->Write(std::vector<uint8_t>(new_data.begin() + run.first,
+                                              new_data.begin() + run.second), base + run.first);
+  }
+  /* programming may only clear bits, the next read gets the real content */
+  register_cache_.clear();
+  for (WriteHook *hook : write_hooks_) {
+    hook->AfterWrite(register_name, old_data, new_data, fields);
+  }
+}
+
+const std::vector<DeviceLayouts::RegisterVersions> &DeviceLayouts::Layouts() {
+  static const std::vector<RegisterVersions> layouts{
+    {
+      {1, fields::Register0V1::Build<Layout>()},
+    },
+    {
+      {0, fields::Register1V0::Build<Layout>()},
+      {1, fields::Register1V1::Build<Layout>()},
+      {2, fields::Register1V2::Build<Layout>()},
+    },
+  };
+  return layouts;
+}
+
+DeviceLayouts::ImageCheck DeviceLayouts::CheckImage(const uint8_t *image, int size) {
+  ImageCheck check;
+  for (int i = 0; i < 2; i++) {
+    const int base = fields::RegisterBase(i);
+    check.version[i] = -1;
+    if (size < base + kCRCSize + versionSize) {
+      check.status[i] = kRegisterTruncated;
+      continue;
+    }
+    const uint8_t *reg = image + base;
+    check.version[i] = reg[kCRCSize];
+    if (reg[0] == 0xFF && reg[1] == 0xFF && reg[kCRCSize] == 0xFF) {
+      check.status[i] = kRegisterBlank;
+      continue;
+    }
+
+    const auto it = Layouts()[i].find(check.version[i]);
+    if (it == Layouts()[i].end()) {
+      check.status[i] = kRegisterUnknownVersion;
+      continue;
+    }
+    int reg_size = 0;
+    for (const auto &field : it->second) {
+      reg_size = reg_size + field.second.size;
+    }
+    if (size < base + reg_size) {
+      check.status[i] = kRegisterTruncated;
+      continue;
+    }
+    uint16_t crc = ComputeCRC(reg + kCRCSize, reg_size - kCRCSize);
+    check.status[i] = crc == fields::Codec<uint16_t>::Decode(reg) ? kRegisterValid
+                                                                  : kRegisterCRCFailed;
+  }
+  return check;
+}
+
+template <typename Access>
+void BasicDeviceData<Access>::ReadVersionFromOTP() {
   for (int i = register0; i != last; i++) {
-    std::vector<uint8_t> version = flash_access_->Read(versionSize, regVersionOffset[i]);
+    std::vector<uint8_t> version = ReadCached(versionSize, regVersionOffset[i]);
     reg_version_[i] = static_cast<int>(version[0]);
   }
   SelectRegLayout(register0);
   SelectRegLayout(register1);
 }
 
-void DeviceData::ReadVersionFromData(const std::vector<uint8_t> &data) {
+template <typename Access>
+void BasicDeviceData<Access>::ReadVersionFromData(const std::vector<uint8_t> &data) {
   reg_version_[0] = static_cast<int>(data[0]);
   SelectRegLayout(register0);
   int reg0_data_size = GetRegisterSize(register0) - kCRCSize;
@@ -108,9 +222,12 @@ void DeviceData::ReadVersionFromData(const std::vector<uint8_t> &data) {
   }
 }
 
-void DeviceData::SelectRegLayout(RegisterName register_name) {
-  const auto it = registers_[register_name].find(reg_version_[register_name]);
-  if (it != registers_[register_name].end()) {
+template <typename Access>
+void BasicDeviceData<Access>::SelectRegLayout(RegisterName register_name) {
+  trace::Scope scope("select_layout", "device_data");
+  scope.Arg("register", register_name).Arg("version", reg_version_[register_name]);
+  const auto it = Layouts()[register_name].find(reg_version_[register_name]);
+  if (it != Layouts()[register_name].end()) {
     register_data_fields_[register_name] = it->second;
   } else {
     LOG(ERROR) << "No valid reg version";
@@ -118,7 +235,8 @@ void DeviceData::SelectRegLayout(RegisterName register_name) {
   }
 }
 
-int DeviceData::GetRegisterSize(RegisterName register_name) {
+template <typename Access>
+int BasicDeviceData<Access>::GetRegisterSize(RegisterName register_name) {
   int size = 0;
   for (const auto &field : register_data_fields_[register_name]) {
     size = size + field.second.size;
@@ -127,7 +245,8 @@ int DeviceData::GetRegisterSize(RegisterName register_name) {
   return size;
 }
 
-int DeviceData::GetCRCOffset(RegisterName register_name) {
+template <typename Access>
+int BasicDeviceData<Access>::GetCRCOffset(RegisterName register_name) {
   if (register_name == register0) {
     return GetDataField(register_name, "CRC_REG0").offset;
   } else {
@@ -135,8 +254,9 @@ int DeviceData::GetCRCOffset(RegisterName register_name) {
   }
 }
 
-const DeviceData::DataField DeviceData::GetDataField(RegisterName register_name,
-                                                     const std::string &name) {
+template <typename Access>
+const DeviceLayouts::DataField BasicDeviceData<Access>::GetDataField(RegisterName register_name,
+                                                                     const std::string &name) {
   for (const auto &field : register_data_fields_[register_name]) {
     if (field.first == name) {
       return field.second;
@@ -147,8 +267,10 @@ const DeviceData::DataField DeviceData::GetDataField(RegisterName register_name,
   throw std::runtime_error(error);
 }
 
-void DeviceData::ParseData(const std::vector<uint8_t> &data, std::vector<uint8_t> *reg0_data,
-                           std::vector<uint8_t> *reg1_data) {
+template <typename Access>
+void BasicDeviceData<Access>::ParseData(const std::vector<uint8_t> &data,
+                                        std::vector<uint8_t> *reg0_data,
+                                        std::vector<uint8_t> *reg1_data) {
   int reg0_data_size = GetRegisterSize(register0) - kCRCSize;
   int reg1_data_size = GetRegisterSize(register1) - kCRCSize;
   int size = data.size();
@@ -165,7 +287,9 @@ void DeviceData::ParseData(const std::vector<uint8_t> &data, std::vector<uint8_t
   AddDataCRC(reg1_data);
 }
 
-void DeviceData::Write(const std::vector<uint8_t> &data) {
+template <typename Access>
+void BasicDeviceData<Access>::Write(const std::vector<uint8_t> &data) {
+  BasicGuard<Access> guard(flash_access_.get(), true);
   ReadVersionFromData(data);
 
   std::vector<uint8_t> reg0_data;
@@ -173,54 +297,219 @@ void DeviceData::Write(const std::vector<uint8_t> &data) {
 
   ParseData(data, &reg0_data, &reg1_data);
 
-  flash_access_->Write(reg0_data, GetCRCOffset(register0));
-  flash_access_->Write(reg1_data, GetCRCOffset(register1));
+  std::vector<uint8_t> old_data[2];
+  if (!write_hooks_.empty()) {
+    old_data[0] = ReadCached(reg0_data.size(), GetCRCOffset(register0));
+    old_data[1] = ReadCached(reg1_data.size(), GetCRCOffset(register1));
+  }
+  /* the whole content of both registers is written */
+  std::set<std::string> fields[2];
+  for (int i = register0; i != last; i++) {
+    for (const auto &field : register_data_fields_[i]) {
+      fields[i].insert(field.first);
+    }
+  }
+  ProgramRegister(register0, old_data[0], reg0_data, {{0, reg0_data.size()}}, fields[0]);
+  ProgramRegister(register1, old_data[1], reg1_data, {{0, reg1_data.size()}}, fields[1]);
 }
 
-const DeviceData::RegisterName DeviceData::GetRegisterName(const std::string &name) {
+template <typename Access>
+const typename BasicDeviceData<Access>::RegisterName BasicDeviceData<Access>::GetRegisterName(
+    const std::string &name) {
   for (int i = register0; i != last; i++) {
     if (register_data_fields_[i].end() != register_data_fields_[i].find(name)) {
-      return static_cast<DeviceData::RegisterName>(i);
+      return static_cast<RegisterName>(i);
     }
   }
   LOG(ERROR) << "Invalid data field: " << name;
   throw std::runtime_error("Invalid data field: " + name);
 }
 
-void DeviceData::WriteField(const std::string &name, const std::vector<uint8_t> &data) {
-  if (std::regex_match(name, std::regex("(VERSION_REG)(.*)"))) {
-    LOG(ERROR) << "Cannot modify register version";
-    throw std::runtime_error("Cannot modify register version");
+template <typename Access>
+void BasicDeviceData<Access>::WriteField(const std::string &name,
+                                         const std::vector<uint8_t> &data) {
+  WriteFields({{name, data}});
+}
+
+template <typename Access>
+void BasicDeviceData<Access>::WriteFields(
+    const std::map<std::string, std::vector<uint8_t>> &values) {
+  for (const auto &value : values) {
+    if (std::regex_match(value.first, std::regex("(VERSION_REG)(.*)"))) {
+      LOG(ERROR) << "Cannot modify register version";
+      throw std::runtime_error("Cannot modify register version");
+    }
   }
 
+  BasicGuard<Access> guard(flash_access_.get(), true);
   ReadVersionFromOTP();
-  DeviceData::RegisterName register_name = GetRegisterName(name);
-  DataField field = GetDataField(register_name, name);
-  int size = data.size();
-  if (size != field.size) {
-    LOG(ERROR) << "Invalid field size";
-    throw std::runtime_error("Invalid field size");
+
+  /* validate every field before touching OTP and group them by register */
+  std::map<RegisterName, std::vector<std::pair<DataField, const std::vector<uint8_t> *>>> updates;
+  std::map<RegisterName, std::set<std::string>> written;
+  for (const auto &value : values) {
+    RegisterName register_name = GetRegisterName(value.first);
+    DataField field = GetDataField(register_name, value.first);
+    int size = value.second.size();
+    if (size != field.size) {
+      LOG(ERROR) << "Invalid field size";
+      throw std::runtime_error("Invalid field size");
+    }
+    updates[register_name].push_back(std::make_pair(field, &value.second));
+    written[register_name].insert(value.first);
   }
 
-  std::vector<uint8_t> buf = flash_access_->Read(GetRegisterSize(register_name),
-                                                 GetCRCOffset(register_name));
+  for (const auto &update : updates) {
+    RegisterName register_name = update.first;
+    std::vector<uint8_t> old_data = ReadCached(GetRegisterSize(register_name),
+                                               GetCRCOffset(register_name));
+    std::vector<uint8_t> buf(old_data);
+
+    /*
+     * modify register data to update new value of fields, the stored CRC is trusted and
+     * updated by the changed bytes only instead of being recomputed over the whole register.
+     * CRC-16 is linear, so a stored CRC not matching the old data keeps the same mismatch and
+     * the register still fails its CRC check after the write rather than being made valid.
+     */
+    uint16_t crc = (old_data[0] << 8) | old_data[1];
+    for (const auto &field : update.second) {
+      int data_field_position = field.first.offset - GetCRCOffset(register_name);
+      crc = crc16_update(crc, buf.size() - kCRCSize, data_field_position - kCRCSize,
+                         buf.data() + data_field_position, field.second->data(),
+                         field.second->size());
+      vector_operations::replace(&buf, *field.second, data_field_position);
+    }
+    buf[0] = (crc >> 8) & 0xff;
+    buf[1] = crc & 0xff;
 
-  /* modify register data to update new value of field */
-  int data_field_position = field.offset - GetCRCOffset(register_name);
-  vector_operations::replace(&buf, data, data_field_position);
+    ProgramRegister(register_name, old_data, buf, {{0, buf.size()}}, written[register_name]);
+  }
+}
+
+static int LayoutSize(const DeviceLayouts::Layout &layout) {
+  int size = 0;
+  for (const auto &field : layout) {
+    size = size + field.second.size;
+  }
+  return size;
+}
 
-  ReplaceDataCRC(&buf);
+template <typename Access>
+int BasicDeviceData<Access>::UpgradeLayout(
+    int register_number, const std::map<std::string, std::vector<uint8_t>> &new_fields) {
+  if (register_number < register0 || register_number >= last) {
+    LOG(ERROR) << "Invalid register: " << register_number;
+    throw std::runtime_error("Invalid register: " + std::to_string(register_number));
+  }
+  RegisterName register_name = static_cast<RegisterName>(register_number);
+  BasicGuard<Access> guard(flash_access_.get(), true);
+  ReadVersionFromOTP();
+  const int version = reg_version_[register_name];
+  const auto next = Layouts()[register_name].find(version + 1);
+  if (next == Layouts()[register_name].end()) {
+    LOG(ERROR) << "No layout version " << version + 1 << " for register " << register_number;
+    throw std::runtime_error("No layout version " + std::to_string(version + 1) +
+                             " for register " + std::to_string(register_number));
+  }
+  const Layout &old_layout = register_data_fields_[register_name];
+  const Layout &new_layout = next->second;
+  const int base = GetCRCOffset(register_name);
+  const int old_size = LayoutSize(old_layout);
+  const int new_size = LayoutSize(new_layout);
+
+  for (const auto &field : new_fields) {
+    const auto it = new_layout.find(field.first);
+    if (it == new_layout.end() || old_layout.count(field.first)) {
+      LOG(ERROR) << "Not a new field of version " << version + 1 << ": " << field.first;
+      throw std::runtime_error("Not a new field of version " + std::to_string(version + 1) +
+                               ": " + field.first);
+    }
+    if (static_cast<int>(field.second.size()) != it->second.size) {
+      LOG(ERROR) << "Invalid field size";
+      throw std::runtime_error("Invalid field size");
+    }
+  }
 
-  flash_access_->Write(buf, GetCRCOffset(register_name));
+  /* current content of the span of both layouts, old register must be intact */
+  std::vector<uint8_t> old_data = ReadCached(std::max(old_size, new_size), base);
+  CheckDataCRC(std::vector<uint8_t>(old_data.begin(), old_data.begin() + old_size));
+
+  std::vector<uint8_t> new_data(old_data);
+  for (const auto &field : new_layout) {
+    const DataField &to = field.second;
+    const auto from = old_layout.find(field.first);
+    if (field.first == "VERSION_REG" + std::to_string(register_number)) {
+      new_data[to.offset - base] = version + 1;
+    } else if (from != old_layout.end()) {
+      std::copy(old_data.begin() + from->second.offset - base,
+                old_data.begin() + from->second.offset - base + from->second.size,
+                new_data.begin() + to.offset - base);
+    } else {
+      const auto value = new_fields.find(field.first);
+      std::vector<uint8_t> data = value != new_fields.end() ? value->second
+                                                            : std::vector<uint8_t>(to.size, 0);
+      std::copy(data.begin(), data.end(), new_data.begin() + to.offset - base);
+    }
+  }
+  std::vector<uint8_t> crc = CalculateDataCRC(
+      std::vector<uint8_t>(new_data.begin() + kCRCSize, new_data.begin() + new_size));
+  std::copy(crc.begin(), crc.end(), new_data.begin());
+
+  /* OTP bits can only be cleared, refuse before programming anything */
+  if (flash_access_->ClearOnlyProgramming()) {
+    for (int i = 0; i < new_size; i++) {
+      if ((old_data[i] & new_data[i]) != new_data[i]) {
+        std::stringstream error;
+        error << "Upgrade needs bits set at offset " << base + i << " (0x" << std::hex
+              << static_cast<int>(old_data[i]) << " to 0x" << static_cast<int>(new_data[i])
+              << ")";
+        LOG(ERROR) << error.str();
+        throw std::runtime_error(error.str());
+      }
+    }
+  }
+
+  /* program changed byte runs, joining runs separated by small gaps */
+  std::vector<std::pair<int, int>> runs;
+  int i = 0;
+  while (i < new_size) {
+    if (old_data[i] == new_data[i]) {
+      i++;
+      continue;
+    }
+    int start = i;
+    int end = i + 1;
+    for (int j = end; j < new_size && j - end <= kMaxProgramGap; j++) {
+      if (old_data[j] != new_data[j]) {
+        end = j + 1;
+      }
+    }
+    runs.push_back(std::make_pair(start, end));
+    i = end;
+  }
+  old_data.resize(old_size);
+  new_data.resize(new_size);
+  /* existing fields only move, the written fields are the ones new to this version */
+  std::set<std::string> fields;
+  for (const auto &field : new_fields) {
+    fields.insert(field.first);
+  }
+  ProgramRegister(register_name, old_data, new_data, runs, fields);
+
+  reg_version_[register_name] = version + 1;
+  SelectRegLayout(register_name);
+  return version + 1;
 }
 
-std::vector<uint8_t> DeviceData::Read() {
+template <typename Access>
+std::vector<uint8_t> BasicDeviceData<Access>::Read() {
+  BasicGuard<Access> guard(flash_access_.get(), false);
   ReadVersionFromOTP();
   std::vector<uint8_t> data[2];
   /* read data from 2 registers */
   for (int i = 0; i < 2; i++) {
-    DeviceData::RegisterName register_name = static_cast<DeviceData::RegisterName>(i);
-    data[i] = flash_access_->Read(GetRegisterSize(register_name), GetCRCOffset(register_name));
+    RegisterName register_name = static_cast<RegisterName>(i);
+    data[i] = ReadCached(GetRegisterSize(register_name), GetCRCOffset(register_name));
 
     /* check crc */
     CheckDataCRC(data[i]);
@@ -235,17 +524,19 @@ std::vector<uint8_t> DeviceData::Read() {
   return buf;
 }
 
-std::vector<uint8_t> DeviceData::ReadField(const std::string &name) {
+template <typename Access>
+std::vector<uint8_t> BasicDeviceData<Access>::ReadField(const std::string &name) {
   if (key_serial == name) {
     return flash_access_->ReadSerial();
   }
+  BasicGuard<Access> guard(flash_access_.get(), false);
   ReadVersionFromOTP();
-  DeviceData::RegisterName register_name = GetRegisterName(name);
+  RegisterName register_name = GetRegisterName(name);
   DataField field = GetDataField(register_name, name);
 
   /* read complete register into buf to check for crc and version */
-  std::vector<uint8_t> buf = flash_access_->Read(GetRegisterSize(register_name),
-                                                 GetCRCOffset(register_name));
+  std::vector<uint8_t> buf = ReadCached(GetRegisterSize(register_name),
+                                        GetCRCOffset(register_name));
   CheckDataCRC(buf);
 
   int data_field_position = field.offset - GetCRCOffset(register_name);
@@ -256,3 +547,128 @@ std::vector<uint8_t> DeviceData::ReadField(const std::string &name) {
 
   return data;
 }
+
+template <typename Access>
+void BasicDeviceData<Access>::ReadRegisterInto(RegisterName register_name, int min_version,
+                                               uint8_t *buf) {
+  BasicGuard<Access> guard(flash_access_.get(), false);
+  uint8_t version = 0;
+  ReadCachedInto(&version, versionSize, regVersionOffset[register_name]);
+
+  const int size = fields::LayoutSize(register_name, version);
+  if (size == 0 || version < min_version) {
+    LOG(ERROR) << "No valid reg version";
+    throw std::runtime_error("No valid reg version");
+  }
+
+  ReadCachedInto(buf, size, fields::RegisterBase(register_name));
+  trace::Scope scope("crc_verify", "device_data");
+  scope.Arg("size", size);
+  uint16_t crc = ComputeCRC(buf + kCRCSize, size - kCRCSize);
+  if (crc != fields::Codec<uint16_t>::Decode(buf)) {
+    LOG(ERROR) << "Data corrupted:CRC failed";
+    throw std::runtime_error("Data corrupted:CRC failed");
+  }
+}
+
+template <typename Access>
+std::map<std::string, std::vector<uint8_t>> BasicDeviceData<Access>::ReadRegisterFields(
+    int register_number) {
+  if (register_number < register0 || register_number >= last) {
+    LOG(ERROR) << "Invalid register: " << register_number;
+    throw std::runtime_error("Invalid register: " + std::to_string(register_number));
+  }
+  const int base = fields::RegisterBase(register_number);
+  uint8_t buf[fields::kRegisterSize];
+  {
+    BasicGuard<Access> guard(flash_access_.get(), false);
+    ReadCachedInto(buf, fields::kRegisterSize, base);
+  }
+
+  const auto it = Layouts()[register_number].find(buf[kCRCSize]);
+  if (it == Layouts()[register_number].end()) {
+    LOG(ERROR) << "No valid reg version";
+    throw std::runtime_error("No valid reg version");
+  }
+  const int size = LayoutSize(it->second);
+  uint16_t crc = ComputeCRC(buf + kCRCSize, size - kCRCSize);
+  if (crc != fields::Codec<uint16_t>::Decode(buf)) {
+    LOG(ERROR) << "Data corrupted:CRC failed";
+    throw std::runtime_error("Data corrupted:CRC failed");
+  }
+
+  std::map<std::string, std::vector<uint8_t>> values;
+  for (const auto &field : it->second) {
+    const uint8_t *value = buf + field.second.offset - base;
+    values[field.first].assign(value, value + field.second.size);
+  }
+  return values;
+}
+
+template <typename Access>
+RecordStore *BasicDeviceData<Access>::GetRecordStore() {
+  if (!record_store_) {
+    BasicGuard<Access> guard(flash_access_.get(), false);
+    std::unique_ptr<RecordStore> store(new RecordStore(fields::kRegisterSize));
+    store->Load(flash_access_->Read(fields::kRegisterSize,
+                                    fields::RegisterBase(kRecordRegister)));
+    record_store_ = std::move(store);
+  }
+  return record_store_.get();
+}
+
+template <typename Access>
+void BasicDeviceData<Access>::WriteRecord(uint32_t key, const std::vector<uint8_t> &value) {
+  BasicGuard<Access> guard(flash_access_.get(), true);
+  std::vector<uint8_t> record;
+  int offset = GetRecordStore()->Append(key, value, &record);
+  const int base = fields::RegisterBase(kRecordRegister);
+  /* another process may have appended since the index was loaded, never program over it */
+  std::vector<uint8_t> target = flash_access_->Read(record.size(), base + offset);
+  if (std::count(target.begin(), target.end(), 0xFF) != static_cast<int>(target.size())) {
+    record_store_.reset();
+    offset = GetRecordStore()->Append(key, value, &record);
+  }
+  try {
+    flash_access_->Write(record, base + offset);
+  } catch (std::runtime_error &e) {
+    /* index no longer matches the OTP content, rebuild it on next access */
+    record_store_.reset();
+    throw;
+  }
+}
+
+template <typename Access>
+std::vector<uint8_t> BasicDeviceData<Access>::ReadRecord(uint32_t key) {
+  std::vector<uint8_t> value;
+  if (!GetRecordStore()->Get(key, &value)) {
+    LOG(ERROR) << "No record for key: " << key;
+    throw std::runtime_error("No record for key: " + std::to_string(key));
+  }
+  return value;
+}
+
+template <typename Access>
+void BasicDeviceData<Access>::ForEachRecord(
+    const std::function<void(uint32_t, const std::vector<uint8_t> &)> &fn) {
+  GetRecordStore()->ForEach(fn);
+}
+
+template <typename Access>
+const int BasicDeviceData<Access>::kImageRegisters;
+
+template <typename Access>
+int BasicDeviceData<Access>::ReadImage(uint8_t *buf) {
+  BasicGuard<Access> guard(flash_access_.get(), false);
+  flash_access_->ReadInto(buf, kImageRegisters * fields::kRegisterSize, 0);
+  int locked = 0;
+  for (int i = 0; i < kImageRegisters; i++) {
+    if (flash_access_->Locked(fields::kRegisterSize, fields::RegisterBase(i))) {
+      locked |= 1 << i;
+    }
+  }
+  return locked;
+}
+
+template class BasicDeviceData<FlashAccess>;
+template class BasicDeviceData<MemoryAccess>;
@@ -20,26 +20,159 @@
 #ifndef DEVICEDATA_H_
 #define DEVICEDATA_H_
 
+#include <functional>
 #include <map>
+#include <set>
 #include <string>
 #include <memory>
+#include <utility>
 #include <vector>
+#include "device_fields.h"
 #include "flash_access.h"
+#include "memory_access.h"
+#include "record_store.h"
+
+/**
+ * @brief Observer of register 0 and register 1 programming, see DeviceData::AddWriteHook
+ *
+ * Register data starts at the register base and includes CRC and version. The written fields
+ * are the names of the fields given by the caller, whether or not their value changes.
+ */
+class WriteHook {
+ public:
+  virtual ~WriteHook() {}
+
+  /**
+   * @brief Called before a register is programmed, throwing aborts the write
+   *
+   * @param[in] register_number register number
+   * @param[in] old_data register content before the write
+   * @param[in] new_data register content to be programmed
+   * @param[in] fields names of the written fields
+   */
+  virtual void BeforeWrite(int register_number, const std::vector<uint8_t> &old_data,
+                           const std::vector<uint8_t> &new_data,
+                           const std::set<std::string> &fields) {}
+
+  /**
+   * @brief Called after a register has been programmed
+   *
+   * @param[in] register_number register number
+   * @param[in] old_data register content before the write
+   * @param[in] new_data programmed register content
+   * @param[in] fields names of the written fields
+   */
+  virtual void AfterWrite(int register_number, const std::vector<uint8_t> &old_data,
+                          const std::vector<uint8_t> &new_data,
+                          const std::set<std::string> &fields) {}
+};
+
+/**
+ * @brief Register layouts and device independent checks of OTP images
+ */
+class DeviceLayouts {
+ public:
+  /**
+   * @brief struct for storing size and offset for each field
+  */
+  struct DataField {
+    int size;
+    int offset;
+  };
+
+  typedef std::map<std::string, struct DataField> Layout;
+  typedef std::map<int, Layout> RegisterVersions;
+
+  /**
+   * @brief Layouts of register 0 and register 1 indexed by register, then version
+   *
+   * returns layouts shared by all instances
+   */
+  static const std::vector<RegisterVersions> &Layouts();
+
+  /**
+   * @brief Result of checking one register of an OTP image
+   */
+  enum RegisterStatus {
+    kRegisterValid,
+    kRegisterBlank,
+    kRegisterUnknownVersion,
+    kRegisterTruncated,
+    kRegisterCRCFailed,
+  };
+
+  /**
+   * @brief Result of checking register 0 and register 1 of an OTP image
+   */
+  struct ImageCheck {
+    int version[2];
+    RegisterStatus status[2];
+  };
+
+  /**
+   * @brief Check version and CRC of register 0 and register 1 of a raw OTP image
+   *
+   * Uses the same layout selection and CRC check as Read, without any device access.
+   *
+   * @param[in] image OTP image, register 0 at offset 0 and register 1 at offset 256
+   * @param[in] size size of image
+   * returns version and status of both registers
+   */
+  static ImageCheck CheckImage(const uint8_t *image, int size);
+};
 
 /**
  * @brief class for maintaining device data layout and performing read/write operations
+ *
+ * Every public operation holds the device lock for its whole duration, shared for reads and
+ * exclusive for writes, so other processes never see a half written register.
+ *
+ * Access is the device backend. DeviceData uses the virtual FlashAccess interface; a concrete
+ * backend class such as MemoryAccess gets its calls resolved at compile time and inlined.
+ * Access provides Read, ReadInto, Write, ReadSerial, ClearOnlyProgramming, Locked, Lock and
+ * Unlock as FlashAccess does. Member functions are instantiated in device_data.cc for FlashAccess
+ * and MemoryAccess.
+ *
+ * @tparam Access device backend
  */
-class DeviceData {
+template <typename Access>
+class BasicDeviceData : public DeviceLayouts {
  public:
   /**
    * @brief Constructor
    *
    * Creates an instance of DeviceData
-   * @param[in] flash_access unique pointer to FlashAccess implementation
+   * @param[in] flash_access unique pointer to the device backend
    *
    */
-  explicit DeviceData(std::unique_ptr<FlashAccess> flash_access);
-  ~DeviceData();
+  explicit BasicDeviceData(std::unique_ptr<Access> flash_access);
+  ~BasicDeviceData();
+
+  /**
+   * @brief Add observer of register writes, called in the order added
+   *
+   * Write, WriteField(s) and UpgradeLayout call every hook around programming a register. With
+   * a hook added, Write also reads the old register content.
+   *
+   * @param[in] hook write hook, not owned, must outlive this DeviceData
+   */
+  void AddWriteHook(WriteHook *hook);
+
+  /**
+   * @brief Keep registers 0 and 1 in memory between operations
+   *
+   * The first read of register 0 or 1 loads both with one device read, later operations use
+   * the copy until this instance programs them. Writes of other processes are not seen, so the
+   * caller holds the device lock while the copy is used and drops it with DropRegisterCache()
+   * before taking the lock again.
+   */
+  void EnableRegisterCache();
+
+  /**
+   * @brief Forget the copy of registers 0 and 1 and the register 2 record index, the next
+   *        access loads them again
+   */
+  void DropRegisterCache();
 
   /**
    * @brief Parse the data into reg0 data and reg1 data and write appropriately
@@ -56,6 +189,31 @@ class DeviceData {
    */
   void WriteField(const std::string &name, const std::vector<uint8_t> &data);
 
+  /**
+   * @brief Write several fields to OTP e.g PD offsets and DCXO
+   *
+   * All fields are validated before anything is written, then each register holding one of the
+   * fields is read, modified, CRC updated and programmed once.
+   *
+   * @param[in] values map of field name to field value to be written
+   */
+  void WriteFields(const std::map<std::string, std::vector<uint8_t>> &values);
+
+  /**
+   * @brief Upgrade register layout from its current version N to N+1 in place
+   *
+   * Existing field values are kept, new fields get the given values (0 if not given) and the CRC
+   * is recomputed. Only the byte runs that change are programmed. On a device which can only
+   * clear bits, the upgrade is refused before anything is written if a byte would need a bit
+   * set.
+   *
+   * @param[in] register_number register to upgrade, 0 or 1
+   * @param[in] new_fields values of fields added by version N+1
+   * returns new register version
+   */
+  int UpgradeLayout(int register_number,
+                    const std::map<std::string, std::vector<uint8_t>> &new_fields);
+
   /**
    * @brief Read device data from memory
    *
@@ -72,67 +230,88 @@ class DeviceData {
   std::vector<uint8_t> ReadField(const std::string &name);
 
   /**
-   * @brief struct for storing size and offset for each field
-  */
-  struct DataField {
-    int size;
-    int offset;
-  };
+   * @brief Read typed data field e.g Get<fields::DCXO>()
+   *
+   * Field register, offset and size are resolved at compile time, so no name lookup or
+   * allocation is done. Register CRC is verified as for ReadField.
+   *
+   * @tparam Field field descriptor from device_fields.h
+   * returns decoded field value
+   */
+  template <typename Field>
+  typename Field::value_type Get() {
+    uint8_t buf[fields::kRegisterSize];
+    ReadRegisterInto(static_cast<RegisterName>(Field::kRegister), Field::kVersion, buf);
+    return fields::Codec<typename Field::value_type>::Decode(
+        buf + Field::kOffset - fields::RegisterBase(Field::kRegister));
+  }
 
- private:
-  int reg_version_[3];
-  const std::string key_serial{"SERIAL"};
+  /**
+   * @brief Write typed data field e.g Set<fields::DCXO>(-3)
+   *
+   * @tparam Field field descriptor from device_fields.h
+   * @param[in] value field value to be written
+   */
+  template <typename Field>
+  void Set(const typename Field::value_type &value) {
+    std::vector<uint8_t> data(Field::kSize);
+    fields::Codec<typename Field::value_type>::Encode(value, data.data());
+    WriteField(Field::Name(), data);
+  }
 
-  typedef std::map<std::string, struct DataField> Layout;
-  typedef std::map<int, Layout> RegisterVersions;
+  /**
+   * @brief Append record to the key/value store in register 2
+   *
+   * Record supersedes any previous record with the same key, only erased bytes are programmed.
+   *
+   * @param[in] key record key
+   * @param[in] value record value
+   */
+  void WriteRecord(uint32_t key, const std::vector<uint8_t> &value);
 
-  Layout register_data_fields_[3];
+  /**
+   * @brief Read latest value of a record from the key/value store in register 2
+   *
+   * @param[in] key record key
+   * returns vector containing record value
+   */
+  std::vector<uint8_t> ReadRecord(uint32_t key);
 
-  const Layout register0_v1_data_fields_ {
-    {"CRC_REG0", {2, 0}},
-    {"VERSION_REG0", {1, 2}},
-    {"MAC_0", {6, 3}},
-    {"MAC_1", {6, 9}},
-    {"MAC_2", {6, 15}},
-    {"MAC_3", {6, 21}},
-    {"MAC_4", {6, 27}},
-    {"MAC_5", {6, 33}},
-  };
-  const RegisterVersions register0_{
-    {1, register0_v1_data_fields_},
-  };
+  /**
+   * @brief Iterate over latest value of every record in register 2, in key order
+   *
+   * @param[in] fn callback receiving key and value
+   */
+  void ForEachRecord(const std::function<void(uint32_t, const std::vector<uint8_t> &)> &fn);
 
-  const Layout register1_v0_data_fields_ {
-    {"CRC_REG1", {2, 256}},
-    {"VERSION_REG1", {1, 258}},
-  };
-  const Layout register1_v1_data_fields_ {
-    {"CRC_REG1", {2, 256}},
-    {"VERSION_REG1", {1, 258}},
-    {"DCXO", {1, 259}},
-  };
-  const Layout register1_v2_data_fields_ {
-    {"CRC_REG1", {2, 256}},
-    {"VERSION_REG1", {1, 258}},
-    {"DCXO", {1, 259}},
-    {"PD_A1_B24", {1, 260}},
-    {"PD_A1_B51", {1, 261}},
-    {"PD_A1_B52", {1, 262}},
-    {"PD_A1_B53", {1, 263}},
-    {"PD_A1_B54", {1, 264}},
-    {"PD_A2_B24", {1, 265}},
-    {"PD_A2_B51", {1, 266}},
-    {"PD_A2_B52", {1, 267}},
-    {"PD_A2_B53", {1, 268}},
-    {"PD_A2_B54", {1, 269}},
-  };
-  const RegisterVersions register1_{
-    {0, register1_v0_data_fields_},
-    {1, register1_v1_data_fields_},
-    {2, register1_v2_data_fields_},
-  };
+  /**
+   * @brief Read every field of a register in its current layout with a single device read
+   *
+   * Register version and CRC are verified as for ReadField.
+   *
+   * @param[in] register_number register number, 0 or 1
+   * returns map of field name to raw value, CRC and version included
+   */
+  std::map<std::string, std::vector<uint8_t>> ReadRegisterFields(int register_number);
+
+  /** number of registers in a raw image, see ReadImage */
+  static const int kImageRegisters = 3;
+
+  /**
+   * @brief Read raw registers 0 to 2, CRCs included, and their OTP lock state under one lock
+   *
+   * Registers are not checked, blank or corrupted ones are returned as they are.
+   *
+   * @param[out] buf buffer of kImageRegisters * fields::kRegisterSize bytes
+   * returns lock state, bit n set if register n is locked
+   */
+  int ReadImage(uint8_t *buf);
 
-  std::vector<RegisterVersions> registers_;
+ private:
+  int reg_version_[3];
+  const std::string key_serial{"SERIAL"};
+
+  Layout register_data_fields_[3];
 
   enum RegisterName {
     register0,
@@ -140,7 +319,35 @@ class DeviceData {
     last,
   };
 
-  std::unique_ptr<FlashAccess> flash_access_;
+  std::unique_ptr<Access> flash_access_;
+  bool cache_enabled_;
+  std::vector<uint8_t> register_cache_;
+  std::unique_ptr<RecordStore> record_store_;
+  std::vector<WriteHook *> write_hooks_;
+
+  /**
+   * @brief Program register data at offset, calling write hooks around it
+   *
+   * @param[in] register_name register being programmed
+   * @param[in] old_data register content before the write (may be empty without hooks)
+   * @param[in] new_data register content after the write
+   * @param[in] runs (start, end) byte ranges of new_data to program
+   * @param[in] fields names of the written fields, passed to the write hooks
+   */
+  void ProgramRegister(RegisterName register_name, const std::vector<uint8_t> &old_data,
+                       const std::vector<uint8_t> &new_data,
+                       const std::vector<std::pair<int, int>> &runs,
+                       const std::set<std::string> &fields);
+
+  /**
+   * @brief Read from device, registers 0 and 1 through the register cache if enabled
+   *
+   * @param[out] buf buffer of at least size bytes
+   * @param[in] size size of data to be read
+   * @param[in] offset device offset
+   */
+  void ReadCachedInto(uint8_t *buf, const int size, const int offset);
+  std::vector<uint8_t> ReadCached(const int size, const int offset);
 
   /**
    * @brief read register0 and register1 version from OTP
@@ -192,7 +399,7 @@ class DeviceData {
    * @param[in] register_name enum specifying which register map to use
    * @param[in] name  name of data field
    */
-  const DeviceData::DataField GetDataField(RegisterName register_name, const std::string &name);
+  const DataField GetDataField(RegisterName register_name, const std::string &name);
 
   /**
   * @brief Get RegisterName in which the field is defined, from field name
@@ -200,7 +407,31 @@ class DeviceData {
   * @param[in] name  name of data field
   * returns RegisterName enum specifying register map
   */
-  const DeviceData::RegisterName GetRegisterName(const std::string &name);
+  const RegisterName GetRegisterName(const std::string &name);
+
+  /**
+   * @brief Read complete register into buffer and validate its version and CRC
+   *
+   * @param[in] register_name enum specifying which register to read
+   * @param[in] min_version minimum register version the caller needs
+   * @param[out] buf buffer of kRegisterSize bytes receiving the register (including CRC)
+   */
+  void ReadRegisterInto(RegisterName register_name, int min_version, uint8_t *buf);
+
+  /**
+   * @brief Read register 2 and build record index, if not already done
+   *
+   * returns record store of register 2
+   */
+  RecordStore *GetRecordStore();
 };
 
+/**
+ * @brief DeviceData over any FlashAccess implementation, dispatching virtually
+ */
+typedef BasicDeviceData<FlashAccess> DeviceData;
+
+extern template class BasicDeviceData<FlashAccess>;
+extern template class BasicDeviceData<MemoryAccess>;
+
 #endif  // DEVICEDATA_H_
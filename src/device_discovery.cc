@@ -0,0 +1,216 @@
+/**
+ * @file
+ * MTD/OTP device discovery
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#include "device_discovery.h"
+#include <glog/logging.h>
+#include <mtd/mtd-user.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "device_fields.h"
+
+const char kDiscoveryCachePath[] = "/var/run/proddata.device";
+
+/* user OTP must hold registers 0 to 2 */
+static const uint32_t kMinUserOTPSize = 3 * fields::kRegisterSize;
+static const char kPartitionName[] = "proddata";
+
+static bool ReadFile(const std::string &path, std::string *content) {
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  std::stringstream stream;
+  stream << file.rdbuf();
+  *content = stream.str();
+  return true;
+}
+
+static std::string Trim(const std::string &value) {
+  size_t end = value.find_last_not_of(" \n");
+  return end == std::string::npos ? "" : value.substr(0, end + 1);
+}
+
+/* FNV-1a, stable across builds unlike std::hash */
+static std::string Key(const std::string &content) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : content) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  char key[17];
+  snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));  // NOLINT
+  return key;
+}
+
+static const char *BackendName(DiscoveredDevice::Backend backend) {
+  return backend == DiscoveredDevice::kUserOTP ? "userotp" : "mtd";
+}
+
+DeviceDiscovery::DeviceDiscovery(const std::string &root, const std::string &cache_path,
+                                 const Prober &prober)
+    : root_(root), cache_path_(cache_path), prober_(prober) {
+}
+
+std::vector<DeviceDiscovery::MtdPartition> DeviceDiscovery::ParseProcMtd(
+    const std::string &content) {
+  /* e.g: mtd1: 01000000 00010000 "spi32766.0" */
+  std::vector<MtdPartition> partitions;
+  std::stringstream stream(content);
+  std::string line;
+  while (std::getline(stream, line)) {
+    MtdPartition partition;
+    char name[64];
+    if (sscanf(line.c_str(), "mtd%d: %*x %*x \"%63[^\"]\"", &partition.index, name) == 2) {
+      partition.name = name;
+      partitions.push_back(partition);
+    }
+  }
+  return partitions;
+}
+
+std::vector<OtpRegion> DeviceDiscovery::ProbeUserOTP(const std::string &device) {
+  std::vector<OtpRegion> regions;
+  int fd = open(device.c_str(), O_RDONLY);
+  if (fd < 0) {
+    DLOG(INFO) << "Can't open " << device << ": " << strerror(errno);
+    return regions;
+  }
+  int mode = MTD_OTP_USER;
+  int count = 0;
+  if (ioctl(fd, OTPSELECT, &mode) < 0 || ioctl(fd, OTPGETREGIONCOUNT, &count) < 0 ||
+      count <= 0) {
+    close(fd);
+    return regions;
+  }
+  std::vector<otp_info> info(count);
+  if (ioctl(fd, OTPGETREGIONINFO, info.data()) < 0) {
+    DLOG(INFO) << "OTPGETREGIONINFO failed on " << device << ": " << strerror(errno);
+    count = 0;
+  }
+  close(fd);
+  for (int i = 0; i < count; i++) {
+    regions.push_back(OtpRegion{info[i].start, info[i].length, info[i].locked != 0});
+  }
+  return regions;
+}
+
+DiscoveredDevice DeviceDiscovery::Scan(const std::vector<MtdPartition> &partitions) {
+  const std::string sys_mtd = root_ + "/sys/class/mtd/mtd";
+  const MtdPartition *fallback = NULL;
+  for (const auto &partition : partitions) {
+    const std::string sys = sys_mtd + std::to_string(partition.index);
+    std::string type;
+    std::string flags;
+    if (!ReadFile(sys + "/type", &type) || !ReadFile(sys + "/flags", &flags)) {
+      continue;
+    }
+    if (!(std::strtoul(flags.c_str(), NULL, 0) & MTD_WRITEABLE)) {
+      DLOG(INFO) << "mtd" << partition.index << " is read only";
+      continue;
+    }
+    if (!fallback && partition.name == kPartitionName) {
+      fallback = &partition;
+    }
+    if (Trim(type) != "nor") {
+      continue;
+    }
+
+    const std::string device = root_ + "/dev/mtd" + std::to_string(partition.index);
+    uint32_t size = 0;
+    for (const auto &region : prober_(device)) {
+      size += region.length;
+    }
+    if (size >= kMinUserOTPSize) {
+      return DiscoveredDevice{device, DiscoveredDevice::kUserOTP};
+    }
+  }
+  if (fallback) {
+    return DiscoveredDevice{root_ + "/dev/mtd" + std::to_string(fallback->index),
+                            DiscoveredDevice::kMTD};
+  }
+  LOG(ERROR) << "No device with user OTP or " << kPartitionName << " partition found";
+  throw std::runtime_error("No production data device found");
+}
+
+bool DeviceDiscovery::ReadCache(const std::string &key, DiscoveredDevice *device) const {
+  std::string content;
+  if (cache_path_.empty() || !ReadFile(cache_path_, &content)) {
+    return false;
+  }
+  /* "<key> <backend> <device>" */
+  std::stringstream stream(content);
+  std::string cached_key;
+  std::string backend;
+  std::string path;
+  if (!(stream >> cached_key >> backend >> path) || cached_key != key ||
+      access(path.c_str(), F_OK) < 0) {
+    return false;
+  }
+  if (backend == BackendName(DiscoveredDevice::kUserOTP)) {
+    device->backend = DiscoveredDevice::kUserOTP;
+  } else if (backend == BackendName(DiscoveredDevice::kMTD)) {
+    device->backend = DiscoveredDevice::kMTD;
+  } else {
+    return false;
+  }
+  device->path = path;
+  return true;
+}
+
+void DeviceDiscovery::WriteCache(const std::string &key, const DiscoveredDevice &device) const {
+  if (cache_path_.empty()) {
+    return;
+  }
+  /* write and rename, concurrent readers see the old or the new entry */
+  const std::string temp = cache_path_ + "." + std::to_string(getpid());
+  {
+    std::ofstream file(temp);
+    file << key << " " << BackendName(device.backend) << " " << device.path << std::endl;
+    if (!file) {
+      LOG(WARNING) << "Can't write discovery cache " << temp;
+      unlink(temp.c_str());
+      return;
+    }
+  }
+  if (rename(temp.c_str(), cache_path_.c_str()) < 0) {
+    LOG(WARNING) << "Can't write discovery cache " << cache_path_ << ": " << strerror(errno);
+    unlink(temp.c_str());
+  }
+}
+
+DiscoveredDevice DeviceDiscovery::Discover() {
+  std::string proc_mtd;
+  if (!ReadFile(root_ + "/proc/mtd", &proc_mtd)) {
+    LOG(ERROR) << "Can't read " << root_ << "/proc/mtd";
+    throw std::runtime_error("No production data device found");
+  }
+  const std::string key = Key(proc_mtd);
+  DiscoveredDevice device;
+  if (ReadCache(key, &device)) {
+    DLOG(INFO) << "Using cached device " << device.path;
+    return device;
+  }
+  device = Scan(ParseProcMtd(proc_mtd));
+  LOG(INFO) << "Discovered " << BackendName(device.backend) << " device " << device.path;
+  WriteCache(key, device);
+  return device;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file
+ * MTD/OTP device discovery
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#ifndef DEVICEDISCOVERY_H_
+#define DEVICEDISCOVERY_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief User OTP region of a device, as reported by OTPGETREGIONINFO
+ */
+struct OtpRegion {
+  uint32_t start;
+  uint32_t length;
+  bool locked;
+};
+
+/**
+ * @brief Device holding the production data and the FlashAccess backend to use for it
+ */
+struct DiscoveredDevice {
+  enum Backend {
+    kUserOTP,
+    kMTD,
+  };
+
+  std::string path;
+  Backend backend;
+};
+
+/**
+ * @brief Find the device holding the production data
+ *
+ * MTD devices are listed from /proc/mtd, their type, name and flags are read from sysfs. The
+ * first writable NOR device whose user OTP covers registers 0 to 2 is used with UserOTPAccess.
+ * Without user OTP, a writable partition named "proddata" is used with MTDAccess.
+ *
+ * The result is cached in a small file keyed by the content of /proc/mtd, later invocations
+ * on the same flash layout skip sysfs and probing.
+ */
+class DeviceDiscovery {
+ public:
+  /**
+   * @brief Returns the user OTP regions of a device node, empty without user OTP support
+   */
+  typedef std::function<std::vector<OtpRegion>(const std::string &device)> Prober;
+
+  /**
+   * @brief Constructor
+   *
+   * @param[in] root root of the proc, sys and dev trees, empty for the running system
+   * @param[in] cache_path discovery cache file, empty to disable caching
+   * @param[in] prober user OTP prober, ProbeUserOTP by default
+   */
+  DeviceDiscovery(const std::string &root, const std::string &cache_path,
+                  const Prober &prober = ProbeUserOTP);
+
+  /**
+   * @brief Find the device, from cache if its key matches
+   *
+   * returns device and backend
+   */
+  DiscoveredDevice Discover();
+
+  /**
+   * @brief Probe user OTP regions through OTPSELECT, OTPGETREGIONCOUNT and OTPGETREGIONINFO
+   *
+   * @param[in] device device node
+   * returns user OTP regions, empty if the device has none or can't be opened
+   */
+  static std::vector<OtpRegion> ProbeUserOTP(const std::string &device);
+
+ private:
+  struct MtdPartition {
+    int index;
+    std::string name;
+  };
+
+  /**
+   * @brief Parse /proc/mtd content
+   */
+  static std::vector<MtdPartition> ParseProcMtd(const std::string &content);
+
+  /**
+   * @brief Find device without cache
+   */
+  DiscoveredDevice Scan(const std::vector<MtdPartition> &partitions);
+
+  bool ReadCache(const std::string &key, DiscoveredDevice *device) const;
+  void WriteCache(const std::string &key, const DiscoveredDevice &device) const;
+
+  const std::string root_;
+  const std::string cache_path_;
+  const Prober prober_;
+};
+
+/**
+ * @brief Default discovery cache file
+ */
+extern const char kDiscoveryCachePath[];
+
+#endif  // DEVICEDISCOVERY_H_
@@ -0,0 +1,268 @@
+/**
+ * @file
+ * Compile time descriptors of OTP data fields
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef DEVICEFIELDS_H_
+#define DEVICEFIELDS_H_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace fields {
+
+/** size of one security register in bytes */
+static const int kRegisterSize = 256;
+
+/**
+ * @brief offset of the first byte of a security register
+ *
+ * @param[in] reg register index
+ */
+constexpr int RegisterBase(int reg) {
+  return reg * kRegisterSize;
+}
+
+/**
+ * @brief 6 byte MAC address as stored in register 0
+ */
+struct MacAddress {
+  std::array<uint8_t, 6> octets;
+
+  bool operator==(const MacAddress &other) const {
+    return octets == other.octets;
+  }
+  bool operator!=(const MacAddress &other) const {
+    return octets != other.octets;
+  }
+};
+
+/**
+ * @brief Descriptor of one data field
+ *
+ * @tparam T value type of the field
+ * @tparam Register security register holding the field
+ * @tparam Offset absolute OTP offset of the field
+ * @tparam Size size of the field in bytes
+ * @tparam Version first register layout version defining the field
+ */
+template <typename T, int Register, int Offset, int Size, int Version>
+struct Field {
+  typedef T value_type;
+  static constexpr int kRegister = Register;
+  static constexpr int kOffset = Offset;
+  static constexpr int kSize = Size;
+  static constexpr int kVersion = Version;
+
+  static_assert(sizeof(T) == Size, "field size does not match its value type");
+  static_assert(Offset >= RegisterBase(Register) &&
+                Offset + Size <= RegisterBase(Register) + kRegisterSize,
+                "field does not fit in its security register");
+};
+
+struct CRC_REG0 : Field<uint16_t, 0, 0, 2, 0> {
+  static const char *Name() { return "CRC_REG0"; }
+};
+struct VERSION_REG0 : Field<uint8_t, 0, 2, 1, 0> {
+  static const char *Name() { return "VERSION_REG0"; }
+};
+struct MAC_0 : Field<MacAddress, 0, 3, 6, 1> {
+  static const char *Name() { return "MAC_0"; }
+};
+struct MAC_1 : Field<MacAddress, 0, 9, 6, 1> {
+  static const char *Name() { return "MAC_1"; }
+};
+struct MAC_2 : Field<MacAddress, 0, 15, 6, 1> {
+  static const char *Name() { return "MAC_2"; }
+};
+struct MAC_3 : Field<MacAddress, 0, 21, 6, 1> {
+  static const char *Name() { return "MAC_3"; }
+};
+struct MAC_4 : Field<MacAddress, 0, 27, 6, 1> {
+  static const char *Name() { return "MAC_4"; }
+};
+struct MAC_5 : Field<MacAddress, 0, 33, 6, 1> {
+  static const char *Name() { return "MAC_5"; }
+};
+
+struct CRC_REG1 : Field<uint16_t, 1, 256, 2, 0> {
+  static const char *Name() { return "CRC_REG1"; }
+};
+struct VERSION_REG1 : Field<uint8_t, 1, 258, 1, 0> {
+  static const char *Name() { return "VERSION_REG1"; }
+};
+struct DCXO : Field<int8_t, 1, 259, 1, 1> {
+  static const char *Name() { return "DCXO"; }
+};
+struct PD_A1_B24 : Field<int8_t, 1, 260, 1, 2> {
+  static const char *Name() { return "PD_A1_B24"; }
+};
+struct PD_A1_B51 : Field<int8_t, 1, 261, 1, 2> {
+  static const char *Name() { return "PD_A1_B51"; }
+};
+struct PD_A1_B52 : Field<int8_t, 1, 262, 1, 2> {
+  static const char *Name() { return "PD_A1_B52"; }
+};
+struct PD_A1_B53 : Field<int8_t, 1, 263, 1, 2> {
+  static const char *Name() { return "PD_A1_B53"; }
+};
+struct PD_A1_B54 : Field<int8_t, 1, 264, 1, 2> {
+  static const char *Name() { return "PD_A1_B54"; }
+};
+struct PD_A2_B24 : Field<int8_t, 1, 265, 1, 2> {
+  static const char *Name() { return "PD_A2_B24"; }
+};
+struct PD_A2_B51 : Field<int8_t, 1, 266, 1, 2> {
+  static const char *Name() { return "PD_A2_B51"; }
+};
+struct PD_A2_B52 : Field<int8_t, 1, 267, 1, 2> {
+  static const char *Name() { return "PD_A2_B52"; }
+};
+struct PD_A2_B53 : Field<int8_t, 1, 268, 1, 2> {
+  static const char *Name() { return "PD_A2_B53"; }
+};
+struct PD_A2_B54 : Field<int8_t, 1, 269, 1, 2> {
+  static const char *Name() { return "PD_A2_B54"; }
+};
+
+/**
+ * @brief Register layout made of field descriptors
+ *
+ * Fields have to be listed in offset order. Layouts are checked at compile time: all fields must
+ * belong to the same register, be defined in this layout version and be contiguous, starting with
+ * the CRC of the register.
+ *
+ * @tparam Version layout version
+ * @tparam Fields field descriptors
+ */
+template <int Version, typename... Fields>
+struct LayoutOf;
+
+template <int Version, typename Last>
+struct LayoutOf<Version, Last> {
+  static_assert(Last::kVersion <= Version, "field is not part of this layout version");
+  static constexpr int kRegister = Last::kRegister;
+  static constexpr int kEnd = Last::kOffset + Last::kSize;
+  static constexpr int kSize = kEnd - RegisterBase(kRegister);
+
+  template <typename Map>
+  static void Add(Map *layout) {
+    (*layout)[Last::Name()] = typename Map::mapped_type{Last::kSize, Last::kOffset};
+  }
+};
+
+template <int Version, typename First, typename Next, typename... Rest>
+struct LayoutOf<Version, First, Next, Rest...> {
+  static_assert(First::kVersion <= Version, "field is not part of this layout version");
+  static_assert(First::kRegister == Next::kRegister, "layout spans several registers");
+  static_assert(First::kOffset + First::kSize == Next::kOffset, "layout fields must be contiguous");
+  static constexpr int kRegister = First::kRegister;
+  static constexpr int kEnd = LayoutOf<Version, Next, Rest...>::kEnd;
+  /** bytes covered by the layout, CRC included */
+  static constexpr int kSize = kEnd - RegisterBase(kRegister);
+
+  template <typename Map>
+  static void Add(Map *layout) {
+    (*layout)[First::Name()] = typename Map::mapped_type{First::kSize, First::kOffset};
+    LayoutOf<Version, Next, Rest...>::Add(layout);
+  }
+
+  /**
+   * @brief Build runtime layout map (name -> size, offset) from the descriptors
+   */
+  template <typename Map>
+  static Map Build() {
+    static_assert(First::kOffset == RegisterBase(First::kRegister),
+                  "layout must start at the beginning of the register");
+    Map layout;
+    Add(&layout);
+    return layout;
+  }
+};
+
+typedef LayoutOf<1, CRC_REG0, VERSION_REG0, MAC_0, MAC_1, MAC_2, MAC_3, MAC_4, MAC_5> Register0V1;
+
+typedef LayoutOf<0, CRC_REG1, VERSION_REG1> Register1V0;
+typedef LayoutOf<1, CRC_REG1, VERSION_REG1, DCXO> Register1V1;
+typedef LayoutOf<2, CRC_REG1, VERSION_REG1, DCXO, PD_A1_B24, PD_A1_B51, PD_A1_B52, PD_A1_B53,
+                 PD_A1_B54, PD_A2_B24, PD_A2_B51, PD_A2_B52, PD_A2_B53, PD_A2_B54> Register1V2;
+
+/** number of layout versions per register, bound of kLayoutSizes */
+static const int kLayoutVersions = 3;
+
+/** layout size by register and version, 0 where the version is not defined */
+constexpr int kLayoutSizes[][kLayoutVersions] = {
+  {0, Register0V1::kSize, 0},
+  {Register1V0::kSize, Register1V1::kSize, Register1V2::kSize},
+};
+
+/**
+ * @brief size of a register layout version, CRC included
+ *
+ * @param[in] reg register index
+ * @param[in] version layout version as read from the register
+ * returns layout size in bytes, 0 if the version is not defined
+ */
+constexpr int LayoutSize(int reg, int version) {
+  return version >= 0 && version < kLayoutVersions ? kLayoutSizes[reg][version] : 0;
+}
+
+/**
+ * @brief Conversion between raw OTP bytes and field value types
+ */
+template <typename T>
+struct Codec;
+
+template <>
+struct Codec<uint8_t> {
+  static uint8_t Decode(const uint8_t *raw) { return raw[0]; }
+  static void Encode(uint8_t value, uint8_t *raw) { raw[0] = value; }
+};
+
+template <>
+struct Codec<int8_t> {
+  static int8_t Decode(const uint8_t *raw) { return static_cast<int8_t>(raw[0]); }
+  static void Encode(int8_t value, uint8_t *raw) { raw[0] = static_cast<uint8_t>(value); }
+};
+
+/* CRC is stored most significant byte first */
+template <>
+struct Codec<uint16_t> {
+  static uint16_t Decode(const uint8_t *raw) {
+    return static_cast<uint16_t>((raw[0] << 8) | raw[1]);
+  }
+  static void Encode(uint16_t value, uint8_t *raw) {
+    raw[0] = (value >> 8) & 0xff;
+    raw[1] = value & 0xff;
+  }
+};
+
+template <>
+struct Codec<MacAddress> {
+  static MacAddress Decode(const uint8_t *raw) {
+    MacAddress mac;
+    memcpy(mac.octets.data(), raw, mac.octets.size());
+    return mac;
+  }
+  static void Encode(const MacAddress &value, uint8_t *raw) {
+    memcpy(raw, value.octets.data(), value.octets.size());
+  }
+};
+
+}  // namespace fields
+
+#endif  // DEVICEFIELDS_H_
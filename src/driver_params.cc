@@ -0,0 +1,74 @@
+/**
+ * @file
+ * WiFi driver calibration parameters
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#include "driver_params.h"
+#include <glog/logging.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cctype>
+#include <cstdio>
+#include <stdexcept>
+
+const char kDriverParamsPath[] = "/proc/uccp420/params";
+
+static bool IsDriverParam(const std::string &name) {
+  return name.compare(0, 4, "CRC_") != 0 && name.compare(0, 8, "VERSION_") != 0;
+}
+
+std::string FormatDriverParams(const std::map<std::string, std::vector<uint8_t>> &fields) {
+  std::string params;
+  for (const auto &field : fields) {
+    if (!IsDriverParam(field.first)) {
+      continue;
+    }
+    for (char c : field.first) {
+      params += static_cast<char>(std::tolower(c));
+    }
+    params += '=';
+    if (field.second.size() == 1) {
+      params += std::to_string(static_cast<int8_t>(field.second[0]));
+    } else {
+      for (uint8_t byte : field.second) {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02X", byte);
+        params += hex;
+      }
+    }
+    params += '\n';
+  }
+  return params;
+}
+
+void WriteDriverParams(const std::string &path, const std::string &params) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    LOG(ERROR) << "Can't open " << path << ": " << strerror(errno);
+    throw std::runtime_error("Can't open driver parameters: " + path);
+  }
+  /* the driver parses one write at a time, so everything goes in a single one */
+  ssize_t ret;
+  do {
+    ret = write(fd, params.data(), params.size());
+  } while (ret < 0 && errno == EINTR);
+  int error = errno;
+  close(fd);
+  if (ret != static_cast<ssize_t>(params.size())) {
+    LOG(ERROR) << "Writing " << path << " failed: "
+               << (ret < 0 ? strerror(error) : "short write");
+    throw std::runtime_error("Writing driver parameters failed: " + path);
+  }
+}
@@ -0,0 +1,51 @@
+/**
+ * @file
+ * WiFi driver calibration parameters
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#ifndef DRIVERPARAMS_H_
+#define DRIVERPARAMS_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Default parameter file of the uccp420 WiFi driver
+ */
+extern const char kDriverParamsPath[];
+
+/**
+ * @brief Format calibration fields as uccp420 driver parameters
+ *
+ * One "<name>=<value>" line per field, name is the lower case field name, e.g "dcxo=-3" or
+ * "pd_a1_b24=2". Single byte fields are signed decimal, longer fields hex. CRC and version
+ * fields are skipped.
+ *
+ * @param[in] fields map of field name to raw value, as read from OTP
+ * returns parameter text
+ */
+std::string FormatDriverParams(const std::map<std::string, std::vector<uint8_t>> &fields);
+
+/**
+ * @brief Write parameter text to the driver with a single write
+ *
+ * @param[in] path driver parameter file, or any file for testing
+ * @param[in] params parameter text
+ */
+void WriteDriverParams(const std::string &path, const std::string &params);
+
+#endif  // DRIVERPARAMS_H_
@@ -0,0 +1,131 @@
+/**
+ * @file
+ * DumpSet class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "dump_set.h"
+#include <glog/logging.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+const int DumpSet::kDumpSize;
+
+static_assert(DumpSet::kDumpSize == ExportPack::kImageSize,
+              "export records must hold a complete dump");
+
+DumpSet::DumpSet(const std::string &path) : path_(path) {
+  DLOG(INFO) << "Initialising DumpSet";
+  struct stat st;
+  if (stat(path.c_str(), &st) < 0) {
+    LOG(ERROR) << "Can't access " << path << ": " << strerror(errno);
+    throw std::runtime_error("Can't access dumps: " + path);
+  }
+
+  if (!S_ISDIR(st.st_mode)) {
+    packfile_.reset(new MappedFile(path));
+    if (ExportPack::IsPackfile(packfile_->Data(), packfile_->Size())) {
+      packfile_.reset();
+      export_pack_.reset(new ExportPack(path));
+      return;
+    }
+    if (packfile_->Size() % kDumpSize != 0) {
+      LOG(ERROR) << "Packfile size " << packfile_->Size() << " is not a multiple of " << kDumpSize;
+      throw std::runtime_error("Invalid packfile: " + path);
+    }
+    return;
+  }
+
+  DIR *dir = opendir(path.c_str());
+  if (!dir) {
+    LOG(ERROR) << "Can't open " << path << ": " << strerror(errno);
+    throw std::runtime_error("Can't access dumps: " + path);
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] != '.') {
+      files_.push_back(entry->d_name);
+    }
+  }
+  closedir(dir);
+  /* stable order for reports */
+  std::sort(files_.begin(), files_.end());
+}
+
+DumpSet::~DumpSet() {
+  DLOG(INFO) << "Deinitialising DumpSet";
+}
+
+size_t DumpSet::Count() const {
+  if (export_pack_) {
+    return export_pack_->Count();
+  }
+  return packfile_ ? packfile_->Size() / kDumpSize : files_.size();
+}
+
+std::string DumpSet::Name(size_t index) const {
+  if (export_pack_) {
+    std::string serial;
+    char hex[3];
+    for (uint8_t byte : export_pack_->Serial(index)) {
+      snprintf(hex, sizeof(hex), "%02X", byte);
+      serial += hex;
+    }
+    return path_ + "#" + std::to_string(index) + ":" + serial;
+  }
+  return packfile_ ? path_ + "#" + std::to_string(index) : files_[index];
+}
+
+int DumpSet::Get(size_t index, uint8_t *buf, const uint8_t **data) const {
+  if (export_pack_) {
+    try {
+      *data = export_pack_->Image(index);
+    } catch (std::runtime_error &e) {
+      return -1;
+    }
+    return kDumpSize;
+  }
+  if (packfile_) {
+    *data = packfile_->Data() + index * kDumpSize;
+    return kDumpSize;
+  }
+
+  int fd = open((path_ + "/" + files_[index]).c_str(), O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  int size = 0;
+  int ret = 0;
+  while (size < kDumpSize &&
+         ((ret = read(fd, buf + size, kDumpSize - size)) > 0 || (ret < 0 && errno == EINTR))) {
+    if (ret > 0) {
+      size += ret;
+    }
+  }
+  close(fd);
+  if (ret < 0) {
+    return -1;
+  }
+  *data = buf;
+  return size;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file
+ * DumpSet class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef DUMPSET_H_
+#define DUMPSET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "device_fields.h"
+#include "export_pack.h"
+#include "mapped_file.h"
+
+/**
+ * @brief Archive of raw OTP dumps, either a directory with one dump per file or a packfile
+ *
+ * A dump is the user OTP image: register 0 at offset 0, register 1 at offset 256 and optionally
+ * register 2 at offset 512. A packfile is the concatenation of kDumpSize byte dumps or an
+ * ExportPack, either is memory mapped; dump files of a directory are read with a single read
+ * each.
+ */
+class DumpSet {
+ public:
+  /** size of a complete dump, registers 0 to 2 */
+  static const int kDumpSize = 3 * fields::kRegisterSize;
+
+  /**
+   * @brief Constructor
+   *
+   * @param[in] path directory of dump files or packfile
+   */
+  explicit DumpSet(const std::string &path);
+  ~DumpSet();
+
+  /**
+   * @brief Number of dumps
+   */
+  size_t Count() const;
+
+  /**
+   * @brief Name of dump for reports, file name or packfile name with dump index
+   *
+   * @param[in] index dump index
+   */
+  std::string Name(size_t index) const;
+
+  /**
+   * @brief Get dump contents, thread safe
+   *
+   * @param[in] index dump index
+   * @param[in] buf buffer of kDumpSize bytes, used if the dump is not memory mapped
+   * @param[out] data receives start of the dump
+   * returns size of dump, -1 if the dump could not be read
+   */
+  int Get(size_t index, uint8_t *buf, const uint8_t **data) const;
+
+ private:
+  const std::string path_;
+  std::unique_ptr<MappedFile> packfile_;
+  std::unique_ptr<ExportPack> export_pack_;
+  std::vector<std::string> files_;
+};
+
+#endif  // DUMPSET_H_
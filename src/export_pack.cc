@@ -0,0 +1,324 @@
+/**
+ * @file
+ * Binary export records and packfiles
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "export_pack.h"
+#include <glog/logging.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "crc16_ops.h"
+#include "device_fields.h"
+#include "parallel_crc.h"
+#include "parallel_for.h"
+
+const int ExportPack::kImageSize;
+const int ExportPack::kHeaderSize;
+const int ExportPack::kRecordSize;
+const int ExportPack::kMaxSerialSize;
+
+static_assert(ExportPack::kImageSize == 3 * fields::kRegisterSize,
+              "export image must hold registers 0 to 2");
+
+static const uint8_t kRecordMagic[] = {'P', 'D', 'X', 'R'};
+static const uint8_t kPackMagic[] = {'P', 'D', 'X', 'P'};
+static const int kFormatVersion = 1;
+static const size_t kPackHeaderSize = 32;
+static const size_t kIndexEntrySize = 32;
+/* CRC field at end of the record header */
+static const size_t kRecordCRCOffset = ExportPack::kHeaderSize - 2;
+static const size_t kPackCRCOffset = kPackHeaderSize - 2;
+/* records buffered by Build before writing */
+static const size_t kWriteBatch = 1024;
+
+static void PutBE(uint64_t value, int bytes, uint8_t *out) {
+  for (int i = bytes - 1; i >= 0; i--) {
+    *out++ = (value >> (8 * i)) & 0xFF;
+  }
+}
+
+static uint64_t GetBE(const uint8_t *ptr, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value = (value << 8) | ptr[i];
+  }
+  return value;
+}
+
+/* CRC of the record with its CRC field left out */
+static uint16_t RecordCRC(const uint8_t *data) {
+  uint16_t crc = crc16_block(0, data, kRecordCRCOffset);
+  return crc16_block(crc, data + ExportPack::kHeaderSize, ExportPack::kImageSize);
+}
+
+static void WriteFully(int fd, const void *buf, size_t size, off_t offset) {
+  const uint8_t *ptr = static_cast<const uint8_t *>(buf);
+  while (size) {
+    ssize_t ret = pwrite(fd, ptr, size, offset);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      LOG(ERROR) << "Packfile write failed: " << strerror(errno);
+      throw std::runtime_error("Packfile write failed");
+    }
+    ptr += ret;
+    size -= ret;
+    offset += ret;
+  }
+}
+
+std::vector<uint8_t> ExportPack::Encode(const ExportRecord &record) {
+  if (record.serial.size() > kMaxSerialSize || record.image.size() != kImageSize) {
+    LOG(ERROR) << "Invalid export record";
+    throw std::runtime_error("Invalid export record");
+  }
+  std::vector<uint8_t> out(kRecordSize, 0);
+  memcpy(&out[0], kRecordMagic, sizeof(kRecordMagic));
+  PutBE(kFormatVersion, 2, &out[4]);
+  PutBE(kHeaderSize, 2, &out[6]);
+  PutBE(kRecordSize, 4, &out[8]);
+  PutBE(record.timestamp_us, 8, &out[12]);
+  out[20] = record.serial.size();
+  std::copy(record.serial.begin(), record.serial.end(), &out[21]);
+  out[37] = record.locked;
+  out[38] = kImageSize / fields::kRegisterSize;
+  PutBE(fields::kRegisterSize, 2, &out[40]);
+  std::copy(record.image.begin(), record.image.end(), &out[kHeaderSize]);
+  PutBE(RecordCRC(out.data()), 2, &out[kRecordCRCOffset]);
+  return out;
+}
+
+bool ExportPack::Decode(const uint8_t *data, size_t size, ExportRecord *record) {
+  if (size < static_cast<size_t>(kRecordSize) ||
+      memcmp(data, kRecordMagic, sizeof(kRecordMagic)) || GetBE(data + 4, 2) != kFormatVersion ||
+      GetBE(data + 6, 2) != kHeaderSize || GetBE(data + 8, 4) != kRecordSize ||
+      data[20] > kMaxSerialSize || data[38] != kImageSize / fields::kRegisterSize ||
+      GetBE(data + 40, 2) != fields::kRegisterSize ||
+      RecordCRC(data) != GetBE(data + kRecordCRCOffset, 2)) {
+    return false;
+  }
+  if (record) {
+    record->timestamp_us = GetBE(data + 12, 8);
+    record->serial.assign(data + 21, data + 21 + data[20]);
+    record->locked = data[37];
+    record->image.assign(data + kHeaderSize, data + kRecordSize);
+  }
+  return true;
+}
+
+bool ExportPack::IsPackfile(const uint8_t *data, size_t size) {
+  return size >= kPackHeaderSize && !memcmp(data, kPackMagic, sizeof(kPackMagic));
+}
+
+ExportPack::ExportPack(const std::string &path)
+    : path_(path), file_(new MappedFile(path)), count_(0), index_(NULL) {
+  DLOG(INFO) << "Initialising ExportPack";
+  const uint8_t *data = file_->Data();
+  const size_t size = file_->Size();
+  if (!IsPackfile(data, size) || GetBE(data + 4, 2) != kFormatVersion ||
+      GetBE(data + 6, 2) != kPackHeaderSize || GetBE(data + 24, 4) != kRecordSize) {
+    LOG(ERROR) << path << " is not a packfile";
+    throw std::runtime_error("Invalid packfile: " + path);
+  }
+  count_ = GetBE(data + 8, 8);
+  uint64_t index_offset = GetBE(data + 16, 8);
+  if (index_offset < kPackHeaderSize || index_offset > size ||
+      count_ > (size - index_offset) / kIndexEntrySize ||
+      index_offset + count_ * kIndexEntrySize != size) {
+    LOG(ERROR) << "Packfile " << path << " truncated";
+    throw std::runtime_error("Invalid packfile: " + path);
+  }
+  index_ = data + index_offset;
+  if (ParallelCrc16(index_, count_ * kIndexEntrySize, 0) != GetBE(data + kPackCRCOffset, 2)) {
+    LOG(ERROR) << "Packfile " << path << " index corrupted";
+    throw std::runtime_error("Invalid packfile: " + path);
+  }
+}
+
+ExportPack::~ExportPack() {
+  DLOG(INFO) << "Deinitialising ExportPack";
+}
+
+const uint8_t *ExportPack::Record(size_t index) const {
+  uint64_t offset = index < count_ ? GetBE(index_ + index * kIndexEntrySize + 24, 8) : 0;
+  if (offset < kPackHeaderSize ||
+      offset + kRecordSize > static_cast<uint64_t>(index_ - file_->Data())) {
+    LOG(ERROR) << "Invalid record " << index << " of " << path_;
+    throw std::runtime_error("Invalid packfile: " + path_);
+  }
+  return file_->Data() + offset;
+}
+
+std::vector<uint8_t> ExportPack::Serial(size_t index) const {
+  const uint8_t *record = Record(index);
+  return std::vector<uint8_t>(record + 21, record + 21 + std::min<int>(record[20],
+                                                                       kMaxSerialSize));
+}
+
+bool ExportPack::Get(size_t index, ExportRecord *record) const {
+  return Decode(Record(index), kRecordSize, record);
+}
+
+std::vector<size_t> ExportPack::Find(const std::vector<uint8_t> &serial) const {
+  std::vector<size_t> found;
+  if (serial.size() > kMaxSerialSize) {
+    return found;
+  }
+  uint8_t key[kMaxSerialSize] = {};
+  std::copy(serial.begin(), serial.end(), key);
+
+  /* first index entry not less than key */
+  size_t low = 0;
+  size_t high = count_;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (memcmp(index_ + middle * kIndexEntrySize, key, kMaxSerialSize) < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  for (; low < count_ && !memcmp(index_ + low * kIndexEntrySize, key, kMaxSerialSize); low++) {
+    /* zero padding makes serials differing in trailing zero bytes collide */
+    if (Serial(low) == serial) {
+      found.push_back(low);
+    }
+  }
+  return found;
+}
+
+std::vector<size_t> ExportPack::Verify(int threads) const {
+  std::vector<std::vector<size_t>> corrupted(threads ? threads : DefaultThreads());
+  ParallelFor(count_, corrupted.size(), 4096, [&](int worker, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      bool valid = false;
+      try {
+        valid = Decode(Record(i), kRecordSize, NULL);
+      } catch (std::runtime_error &e) {
+      }
+      if (!valid) {
+        corrupted[worker].push_back(i);
+      }
+    }
+  });
+  std::vector<size_t> all;
+  for (const auto &list : corrupted) {
+    all.insert(all.end(), list.begin(), list.end());
+  }
+  std::sort(all.begin(), all.end());
+  return all;
+}
+
+ExportPack::BuildStats ExportPack::Build(const std::vector<std::string> &inputs,
+                                         const std::string &path, int threads) {
+  const std::string tmp_path = path + ".tmp";
+  int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    LOG(ERROR) << "Can't create " << tmp_path << ": " << strerror(errno);
+    throw std::runtime_error("Can't create packfile: " + path);
+  }
+
+  BuildStats stats = {0, 0};
+  std::vector<uint8_t> index;
+  try {
+    std::vector<uint8_t> batch;
+    batch.reserve(kWriteBatch * kRecordSize);
+    uint64_t offset = kPackHeaderSize;
+    for (const auto &input : inputs) {
+      MappedFile file(input);
+      const uint8_t *data = file.Data();
+      size_t size = file.Size();
+      size_t position = 0;
+      if (IsPackfile(data, size)) {
+        /* records of a packfile lie between its header and its index */
+        position = kPackHeaderSize;
+        size = std::min<uint64_t>(GetBE(data + 16, 8), size);
+      }
+      while (position < size) {
+        if (!Decode(data + position, size - position, NULL)) {
+          /* resynchronise on the next record magic */
+          const void *next = memmem(data + position + 1, size - position - 1, kRecordMagic,
+                                    sizeof(kRecordMagic));
+          size_t skip = (next ? static_cast<const uint8_t *>(next) : data + size) -
+                        (data + position);
+          stats.skipped_bytes += skip;
+          position += skip;
+          continue;
+        }
+        const uint8_t *record = data + position;
+        uint8_t entry[kIndexEntrySize] = {};
+        memcpy(entry, record + 21, record[20]);
+        memcpy(entry + kMaxSerialSize, record + 12, 8);
+        PutBE(offset, 8, entry + 24);
+        index.insert(index.end(), entry, entry + kIndexEntrySize);
+
+        batch.insert(batch.end(), record, record + kRecordSize);
+        if (batch.size() == kWriteBatch * kRecordSize) {
+          WriteFully(fd, batch.data(), batch.size(), offset + kRecordSize - batch.size());
+          batch.clear();
+        }
+        offset += kRecordSize;
+        position += kRecordSize;
+        stats.records++;
+      }
+    }
+    WriteFully(fd, batch.data(), batch.size(), offset - batch.size());
+
+    /* entries compare as bytes: serial, then big endian timestamp and offset */
+    std::vector<const uint8_t *> entries(stats.records);
+    for (size_t i = 0; i < stats.records; i++) {
+      entries[i] = &index[i * kIndexEntrySize];
+    }
+    std::sort(entries.begin(), entries.end(), [](const uint8_t *a, const uint8_t *b) {
+      return memcmp(a, b, kIndexEntrySize) < 0;
+    });
+    std::vector<uint8_t> sorted(index.size());
+    for (size_t i = 0; i < stats.records; i++) {
+      memcpy(&sorted[i * kIndexEntrySize], entries[i], kIndexEntrySize);
+    }
+    WriteFully(fd, sorted.data(), sorted.size(), offset);
+
+    uint8_t header[kPackHeaderSize] = {};
+    memcpy(header, kPackMagic, sizeof(kPackMagic));
+    PutBE(kFormatVersion, 2, header + 4);
+    PutBE(kPackHeaderSize, 2, header + 6);
+    PutBE(stats.records, 8, header + 8);
+    PutBE(offset, 8, header + 16);
+    PutBE(kRecordSize, 4, header + 24);
+    PutBE(ParallelCrc16(sorted.data(), sorted.size(), threads), 2, header + kPackCRCOffset);
+    WriteFully(fd, header, sizeof(header), 0);
+    if (fsync(fd) < 0) {
+      LOG(ERROR) << "fsync of " << tmp_path << " failed: " << strerror(errno);
+      throw std::runtime_error("Packfile write failed");
+    }
+  } catch (std::runtime_error &e) {
+    close(fd);
+    unlink(tmp_path.c_str());
+    throw;
+  }
+  close(fd);
+  if (rename(tmp_path.c_str(), path.c_str()) < 0) {
+    LOG(ERROR) << "Can't rename " << tmp_path << ": " << strerror(errno);
+    unlink(tmp_path.c_str());
+    throw std::runtime_error("Can't create packfile: " + path);
+  }
+  return stats;
+}
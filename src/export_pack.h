@@ -0,0 +1,180 @@
+/**
+ * @file
+ * Binary export records and packfiles
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef EXPORTPACK_H_
+#define EXPORTPACK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+
+/**
+ * @brief Snapshot of one board for fleet collection
+ */
+struct ExportRecord {
+  /** microseconds since the epoch */
+  uint64_t timestamp_us;
+  /** serial number, up to ExportPack::kMaxSerialSize bytes */
+  std::vector<uint8_t> serial;
+  /** OTP lock state, bit n set if register n is locked */
+  uint8_t locked;
+  /** registers 0 to 2 as on the device, CRCs included, ExportPack::kImageSize bytes */
+  std::vector<uint8_t> image;
+};
+
+/**
+ * @brief Fixed size binary export records and packfiles indexing them
+ *
+ * Record format, 832 bytes, big endian: "PDXR", format version (2), header size (2), record
+ * size (4), timestamp in microseconds (8), serial length (1), serial zero padded (16), lock
+ * state (1), register count (1), reserved (1), register size (2), reserved (20), CRC-16 of
+ * all other bytes of the record (2), then registers 0 to 2 (768) as on the device.
+ *
+ * Records concatenate: a collector appends the records of its boards to one file. A packfile
+ * holds many records with an index for random access without parsing: a 32 byte header
+ * ("PDXP", format version (2), header size (2), record count (8), index offset (8), record
+ * size (4), reserved (2), CRC-16 of the index (2)), the records, and the index of one
+ * 32 byte entry per record (serial zero padded (16), timestamp (8), record offset (8)) sorted
+ * by serial and timestamp. Record number n of a packfile is index entry n.
+ */
+class ExportPack {
+ public:
+  static const int kImageSize = 768;
+  static const int kHeaderSize = 64;
+  static const int kRecordSize = kHeaderSize + kImageSize;
+  static const int kMaxSerialSize = 16;
+
+  /**
+   * @brief Counts of a packfile build
+   */
+  struct BuildStats {
+    size_t records;
+    /** bytes of the inputs that are not valid records, skipped */
+    size_t skipped_bytes;
+  };
+
+  /**
+   * @brief Constructor, maps the packfile and checks its header and index
+   *
+   * @param[in] path packfile
+   */
+  explicit ExportPack(const std::string &path);
+  ~ExportPack();
+
+  ExportPack(const ExportPack &) = delete;
+  ExportPack &operator=(const ExportPack &) = delete;
+
+  /**
+   * @brief Number of records
+   */
+  size_t Count() const { return count_; }
+
+  /**
+   * @brief Encoded record, kRecordSize bytes in the mapping
+   *
+   * @param[in] index record number
+   */
+  const uint8_t *Record(size_t index) const;
+
+  /**
+   * @brief Registers 0 to 2 of record, kImageSize bytes in the mapping, not checked
+   *
+   * @param[in] index record number
+   */
+  const uint8_t *Image(size_t index) const { return Record(index) + kHeaderSize; }
+
+  /**
+   * @brief Serial number of record
+   *
+   * @param[in] index record number
+   */
+  std::vector<uint8_t> Serial(size_t index) const;
+
+  /**
+   * @brief Decode record, checking its CRC
+   *
+   * @param[in] index record number
+   * @param[out] record decoded record
+   * returns false on corrupted record
+   */
+  bool Get(size_t index, ExportRecord *record) const;
+
+  /**
+   * @brief Record numbers of a board, oldest first, by binary search of the index
+   *
+   * @param[in] serial serial number
+   */
+  std::vector<size_t> Find(const std::vector<uint8_t> &serial) const;
+
+  /**
+   * @brief Check the CRC of every record
+   *
+   * @param[in] threads number of worker threads, 0 for one per core
+   * returns record numbers of corrupted records
+   */
+  std::vector<size_t> Verify(int threads) const;
+
+  /**
+   * @brief Encode record
+   *
+   * @param[in] record record, image of kImageSize bytes
+   * returns kRecordSize bytes
+   */
+  static std::vector<uint8_t> Encode(const ExportRecord &record);
+
+  /**
+   * @brief Decode record at start of data
+   *
+   * @param[in] data record data
+   * @param[in] size bytes available
+   * @param[out] record decoded record, may be NULL to only check the record
+   * returns false on truncated or corrupted record
+   */
+  static bool Decode(const uint8_t *data, size_t size, ExportRecord *record);
+
+  /**
+   * @brief Whether data starts with a packfile header
+   */
+  static bool IsPackfile(const uint8_t *data, size_t size);
+
+  /**
+   * @brief Write packfile of all records of the inputs
+   *
+   * Inputs are files of concatenated records or packfiles. Corrupted data between records is
+   * skipped up to the next valid record. The packfile is written to "<path>.tmp" and renamed
+   * when complete.
+   *
+   * @param[in] inputs input files
+   * @param[in] path packfile to write
+   * @param[in] threads number of worker threads for the index CRC, 0 for one per core
+   * returns counts of the build
+   */
+  static BuildStats Build(const std::vector<std::string> &inputs, const std::string &path,
+                          int threads);
+
+ private:
+  const std::string path_;
+  std::unique_ptr<MappedFile> file_;
+  size_t count_;
+  const uint8_t *index_;
+};
+
+#endif  // EXPORTPACK_H_
@@ -0,0 +1,59 @@
+/**
+ * @file
+ * FileLock class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef FILELOCK_H_
+#define FILELOCK_H_
+
+#include <glog/logging.h>
+#include <sys/file.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief flock() of an open file for the scope of the instance, retried when interrupted
+ */
+class FileLock {
+ public:
+  /**
+   * @brief Constructor, waits for the lock
+   *
+   * @param[in] fd open file
+   * @param[in] operation LOCK_SH or LOCK_EX
+   * @param[in] name what the file holds, for the error
+   */
+  FileLock(int fd, int operation, const std::string &name) : fd_(fd) {
+    while (flock(fd_, operation) < 0) {
+      if (errno != EINTR) {
+        LOG(ERROR) << "flock failed: " << strerror(errno);
+        throw std::runtime_error("Locking " + name + " failed");
+      }
+    }
+  }
+  ~FileLock() {
+    flock(fd_, LOCK_UN);
+  }
+  FileLock(const FileLock &) = delete;
+  FileLock &operator=(const FileLock &) = delete;
+
+ private:
+  int fd_;
+};
+
+#endif  // FILELOCK_H_
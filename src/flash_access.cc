@@ -20,11 +20,17 @@
 #include <glog/logging.h>
 #include <mtd/mtd-user.h>
 #include <fcntl.h>
+#include <sys/file.h>
 #include <sys/ioctl.h>
+#include <algorithm>
 #include <stdexcept>
+#include "file_lock.h"
+#include "trace.h"
 
-FlashAccess::FlashAccess(const std::string &device_name) {
-  fd_ = open(device_name.c_str(), O_RDWR);
+FlashAccess::FlashAccess(const std::string &device_name, bool read_only)
+    : lock_depth_(0), lock_exclusive_(false) {
+  trace::Scope scope("open", "flash");
+  fd_ = open(device_name.c_str(), read_only ? O_RDONLY : O_RDWR);
   if (fd_ < 0) {
     DLOG(ERROR) << "Can't open device: " << strerror(errno);
     throw std::runtime_error("FlashAccess Initialization failed");
@@ -35,14 +41,109 @@ FlashAccess::~FlashAccess() {
   close(fd_);
 }
 
+/* open file description lock of the first byte, the actual reader/writer lock */
+static int SetLock(int fd, short type) {  // NOLINT(runtime/int)
+  struct flock lock = {};
+  lock.l_type = type;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = 0;
+  lock.l_len = 1;
+  int ret;
+  do {
+    ret = fcntl(fd, F_OFD_SETLKW, &lock);
+  } while (ret < 0 && errno == EINTR);
+  return ret;
+}
+
+void FlashAccess::Lock(bool exclusive) {
+  if (lock_depth_ > 0) {
+    if (exclusive && !lock_exclusive_) {
+      LOG(ERROR) << "Cannot upgrade shared device lock to exclusive";
+      throw std::runtime_error("Cannot upgrade shared device lock to exclusive");
+    }
+    lock_depth_++;
+    return;
+  }
+
+  trace::Scope scope("lock", "flash");
+  scope.Arg("exclusive", exclusive);
+  /*
+   * Shared locks alone would starve a writer while readers keep overlapping. Everybody passes
+   * the turnstile to queue for the range lock, a waiting writer holds it and so keeps new
+   * readers out until the current ones are done.
+   */
+  int ret;
+  int error;
+  {
+    /* flock() on the whole device, serialises lock acquisition only */
+    FileLock turnstile(fd_, LOCK_EX, "device");
+    ret = SetLock(fd_, exclusive ? F_WRLCK : F_RDLCK);
+    error = errno;
+  }
+  if (ret < 0) {
+    LOG(ERROR) << "Locking device failed: " << strerror(error);
+    throw std::runtime_error("Locking device failed");
+  }
+  lock_depth_ = 1;
+  lock_exclusive_ = exclusive;
+}
+
+void FlashAccess::Unlock() {
+  if (lock_depth_ == 0) {
+    return;
+  }
+  if (--lock_depth_ == 0) {
+    SetLock(fd_, F_UNLCK);
+  }
+}
+
+bool FlashAccess::ClearOnlyProgramming() const {
+  return true;
+}
+
+bool FlashAccess::Locked(const int size, const int offset) {
+  Guard guard(this, false);
+  int val = MTD_OTP_USER;
+  int count = 0;
+  trace::Scope scope("otpinfo", "flash");
+  if (ioctl(fd_, OTPSELECT, &val) < 0 || ioctl(fd_, OTPGETREGIONCOUNT, &count) < 0) {
+    DLOG(ERROR) << "ioctl failed and returned error: " << strerror(errno);
+    throw std::runtime_error("User OTP region info failed");
+  }
+  std::vector<otp_info> info(std::max(count, 0));
+  if (count > 0 && ioctl(fd_, OTPGETREGIONINFO, info.data()) < 0) {
+    DLOG(ERROR) << "ioctl failed and returned error: " << strerror(errno);
+    throw std::runtime_error("User OTP region info failed");
+  }
+
+  /* locked if every region overlapping the range is */
+  bool overlapped = false;
+  for (const auto &region : info) {
+    if (region.start < static_cast<uint32_t>(offset + size) &&
+        region.start + region.length > static_cast<uint32_t>(offset)) {
+      if (!region.locked) {
+        return false;
+      }
+      overlapped = true;
+    }
+  }
+  return overlapped;
+}
+
 std::vector<uint8_t> FlashAccess::ReadSerial() {
   DLOG(INFO) << "Reading serial number";
+  /* the OTP area selected by OTPSELECT belongs to this open file, reading shares the lock */
+  Guard guard(this, false);
   const int size = 8;
   std::vector<uint8_t> buf(size);
   int val = MTD_OTP_FACTORY;
-  if (ioctl(fd_, OTPSELECT, &val) < 0) {
-    DLOG(ERROR) << "ioctl failed and returned error: " << strerror(errno);
-    throw std::runtime_error("Factory OTP access failed");
+  {
+    trace::Scope scope("otpselect", "flash");
+    scope.Arg("mode", val);
+    if (ioctl(fd_, OTPSELECT, &val) < 0) {
+      DLOG(ERROR) << "ioctl failed and returned error: " << strerror(errno);
+      throw std::runtime_error("Factory OTP access failed");
+    }
   }
 
   if (lseek(fd_, 0, SEEK_SET) < 0) {
@@ -50,6 +151,8 @@ std::vector<uint8_t> FlashAccess::ReadSerial() {
     throw std::runtime_error("read serial: lseek failed");
   }
 
+  trace::Scope scope("read", "flash");
+  scope.Arg("size", size).Arg("offset", 0);
   int ret = read(fd_, buf.data(), buf.size());
   if (ret < 0) {
     DLOG(ERROR) << "read serial num failed:" << strerror(errno);
@@ -58,3 +161,7 @@ std::vector<uint8_t> FlashAccess::ReadSerial() {
   return buf;
 }
 
+void FlashAccess::ReadInto(uint8_t *buf, const int size, const int offset) {
+  std::vector<uint8_t> data = Read(size, offset);
+  std::copy(data.begin(), data.end(), buf);
+}
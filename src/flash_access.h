@@ -22,14 +22,62 @@
 #include <string>
 #include <vector>
 
+/**
+ * @brief Scoped Lock() / Unlock() of a device backend, FlashAccess or MemoryAccess
+ */
+template <typename Access>
+class BasicGuard {
+ public:
+  BasicGuard(Access *access, bool exclusive) : access_(access) {
+    access_->Lock(exclusive);
+  }
+  ~BasicGuard() {
+    access_->Unlock();
+  }
+  BasicGuard(const BasicGuard &) = delete;
+  BasicGuard &operator=(const BasicGuard &) = delete;
+
+ private:
+  Access *access_;
+};
+
 /**
  * @brief Abstract class for flash access
  */
 class FlashAccess {
  public:
-  explicit FlashAccess(const std::string &device_name);
+  /**
+   * @brief Constructor
+   *
+   * @param[in] device_name device node to open
+   * @param[in] read_only open the device O_RDONLY, writes then fail
+   */
+  explicit FlashAccess(const std::string &device_name, bool read_only = false);
   virtual ~FlashAccess();
 
+  /**
+   * @brief Take advisory lock on the device shared between processes
+   *
+   * Readers take a shared lock, writes an exclusive one. OTPSELECT selects the OTP area of
+   * this open file only, so reads of any area share the lock. An exclusive lock needs the
+   * device opened for writing. Locks nest, only the outermost Lock() and
+   * Unlock() touch the device. Upgrading a held shared lock to exclusive is refused, as two
+   * upgrading readers would deadlock.
+   *
+   * @param[in] exclusive exclusive lock instead of shared
+   */
+  void Lock(bool exclusive);
+
+  /**
+   * @brief Release lock taken by Lock()
+   */
+  void Unlock();
+
+  /**
+   * @brief Scoped Lock() / Unlock()
+   */
+  typedef BasicGuard<FlashAccess> Guard;
+
   /**
    * @brief Write data to flash
    *
@@ -48,6 +96,17 @@ class FlashAccess {
    */
   virtual std::vector<uint8_t> Read(const int size, const int offset) = 0;
 
+  /**
+   * @brief Read data from flash storage into caller provided buffer
+   *
+   * Default implementation goes through Read(), implementations override it to avoid allocation.
+   *
+   * @param[out] buf buffer of at least size bytes
+   * @param[in] size size of data to be read
+   * @param[in] offset device offset
+   */
+  virtual void ReadInto(uint8_t *buf, const int size, const int offset);
+
   /**
    * @brief Read serial number
    *
@@ -55,8 +114,29 @@ class FlashAccess {
    */
   virtual std::vector<uint8_t> ReadSerial();
 
+  /**
+   * @brief Whether programming can only clear bits (1 to 0), as for OTP
+   *
+   * Devices which erase before programming return false.
+   */
+  virtual bool ClearOnlyProgramming() const;
+
+  /**
+   * @brief Whether a range lies in locked user OTP, which can't be programmed any more
+   *
+   * Devices without OTP locking return false.
+   *
+   * @param[in] size size of range
+   * @param[in] offset device offset
+   */
+  virtual bool Locked(const int size, const int offset);
+
  protected:
   int fd_;
+
+ private:
+  int lock_depth_;
+  bool lock_exclusive_;
 };
 
 #endif  // FLASHACCESS_H_
@@ -0,0 +1,205 @@
+/**
+ * @file
+ * Fleet calibration statistics over OTP dump archives
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "fleet_stats.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "device_data.h"
+#include "parallel_for.h"
+
+/* dumps decoded into columns before the histogram pass, bounds per worker memory */
+static const size_t kBatchSize = 4096;
+
+uint64_t FieldHistogram::Count() const {
+  uint64_t count = 0;
+  for (int i = 0; i < 256; i++) {
+    count += bins[i];
+  }
+  return count;
+}
+
+double FieldHistogram::Mean() const {
+  uint64_t count = Count();
+  if (!count) {
+    return 0;
+  }
+  int64_t sum = 0;
+  for (int i = 0; i < 256; i++) {
+    sum += static_cast<int64_t>(bins[i]) * (i - 128);
+  }
+  return static_cast<double>(sum) / count;
+}
+
+double FieldHistogram::Variance() const {
+  uint64_t count = Count();
+  if (!count) {
+    return 0;
+  }
+  double mean = Mean();
+  double sum = 0;
+  for (int i = 0; i < 256; i++) {
+    double delta = (i - 128) - mean;
+    sum += bins[i] * delta * delta;
+  }
+  return sum / count;
+}
+
+int FieldHistogram::Percentile(double percent) const {
+  uint64_t count = Count();
+  if (!count) {
+    return 0;
+  }
+  uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percent / 100 * count)));
+  uint64_t cumulative = 0;
+  for (int i = 0; i < 256; i++) {
+    cumulative += bins[i];
+    if (cumulative >= rank) {
+      return i - 128;
+    }
+  }
+  return 127;
+}
+
+/*
+ * Add a column of signed bytes to a histogram. Four partial histograms break the dependency
+ * between consecutive increments of the same bin, which otherwise serialises the loop.
+ */
+static void HistogramKernel(const int8_t *column, size_t size, uint64_t *bins) {
+  uint32_t partial[4][256];
+  memset(partial, 0, sizeof(partial));
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    partial[0][column[i] + 128]++;
+    partial[1][column[i + 1] + 128]++;
+    partial[2][column[i + 2] + 128]++;
+    partial[3][column[i + 3] + 128]++;
+  }
+  for (; i < size; i++) {
+    partial[0][column[i] + 128]++;
+  }
+  for (int bin = 0; bin < 256; bin++) {
+    bins[bin] += partial[0][bin] + partial[1][bin] + partial[2][bin] + partial[3][bin];
+  }
+}
+
+namespace {
+
+/* columns of one layout version being filled by a worker */
+struct ColumnBatch {
+  FleetGroup group;
+  std::vector<std::vector<int8_t>> columns;
+  size_t size;
+
+  void Flush() {
+    for (size_t f = 0; f < columns.size(); f++) {
+      HistogramKernel(columns[f].data(), size, group.fields[f].bins);
+    }
+    group.units += size;
+    size = 0;
+  }
+};
+
+/* fields of register 1 layout version, without CRC and version */
+std::vector<FieldHistogram> LayoutFields(const DeviceData::Layout &layout) {
+  std::vector<FieldHistogram> fields;
+  for (const auto &field : layout) {
+    if (field.second.size != 1 || field.first == "VERSION_REG1") {
+      continue;
+    }
+    FieldHistogram histogram;
+    histogram.name = field.first;
+    histogram.offset = field.second.offset;
+    memset(histogram.bins, 0, sizeof(histogram.bins));
+    fields.push_back(histogram);
+  }
+  return fields;
+}
+
+}  // namespace
+
+FleetStats::FleetStats() : skipped_(0) {}
+
+void FleetStats::Add(const std::string &lot, const DumpSet &dumps, int threads) {
+  if (threads <= 0) {
+    threads = DefaultThreads();
+  }
+  const DeviceData::RegisterVersions &versions = DeviceData::Layouts()[1];
+  std::vector<std::map<int, ColumnBatch>> batches(threads);
+  std::vector<uint64_t> skipped(threads, 0);
+
+  ParallelFor(dumps.Count(), threads, kBatchSize, [&](int worker, size_t begin, size_t end) {
+    std::map<int, ColumnBatch> &worker_batches = batches[worker];
+    uint8_t buf[DumpSet::kDumpSize];
+    for (size_t index = begin; index < end; index++) {
+      const uint8_t *data;
+      int size = dumps.Get(index, buf, &data);
+      if (size < 0 || DeviceData::CheckImage(data, size).status[1] != DeviceData::kRegisterValid) {
+        skipped[worker]++;
+        continue;
+      }
+
+      int version = data[fields::RegisterBase(1) + 2];
+      auto it = worker_batches.find(version);
+      if (it == worker_batches.end()) {
+        ColumnBatch batch;
+        batch.group.lot = lot;
+        batch.group.version = version;
+        batch.group.units = 0;
+        batch.group.fields = LayoutFields(versions.at(version));
+        batch.columns.assign(batch.group.fields.size(), std::vector<int8_t>(kBatchSize));
+        batch.size = 0;
+        it = worker_batches.insert(std::make_pair(version, batch)).first;
+      }
+
+      /* transpose the dump into the field columns */
+      ColumnBatch &batch = it->second;
+      for (size_t f = 0; f < batch.columns.size(); f++) {
+        batch.columns[f][batch.size] = static_cast<int8_t>(data[batch.group.fields[f].offset]);
+      }
+      if (++batch.size == kBatchSize) {
+        batch.Flush();
+      }
+    }
+  });
+
+  for (int worker = 0; worker < threads; worker++) {
+    skipped_ += skipped[worker];
+    for (auto &entry : batches[worker]) {
+      ColumnBatch &batch = entry.second;
+      batch.Flush();
+      auto key = std::make_pair(lot, entry.first);
+      auto it = groups_.find(key);
+      if (it == groups_.end()) {
+        groups_[key] = batch.group;
+        continue;
+      }
+      it->second.units += batch.group.units;
+      for (size_t f = 0; f < batch.group.fields.size(); f++) {
+        for (int bin = 0; bin < 256; bin++) {
+          it->second.fields[f].bins[bin] += batch.group.fields[f].bins[bin];
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,97 @@
+/**
+ * @file
+ * Fleet calibration statistics over OTP dump archives
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef FLEETSTATS_H_
+#define FLEETSTATS_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "dump_set.h"
+
+/**
+ * @brief Distribution of one single byte register 1 field, exact for the 256 possible values
+ */
+struct FieldHistogram {
+  std::string name;
+  int offset;
+  /** bins[value + 128] counts units with the signed field value */
+  uint64_t bins[256];
+
+  uint64_t Count() const;
+  double Mean() const;
+  double Variance() const;
+  /**
+   * @brief Nearest rank percentile
+   *
+   * @param[in] percent percentile in 0-100
+   * returns field value, 0 if no unit was counted
+   */
+  int Percentile(double percent) const;
+};
+
+/**
+ * @brief Distributions of the register 1 fields for one build lot and layout version
+ */
+struct FleetGroup {
+  std::string lot;
+  int version;
+  uint64_t units;
+  std::vector<FieldHistogram> fields;
+};
+
+/**
+ * @brief Per lot and register 1 layout version distributions of calibration fields
+ *
+ * Dumps are decoded in batches into one column per field of the active layout (taken from
+ * DeviceData::Layouts(), so new versions are picked up without change), and every column is
+ * folded into a 256 bin histogram. Mean, variance and percentiles are exact functions of the
+ * histograms, so memory stays bounded by threads x batch size whatever the input size.
+ * Fields are single bytes interpreted as signed (DCXO, PD offsets), wider fields are skipped.
+ */
+class FleetStats {
+ public:
+  FleetStats();
+
+  /**
+   * @brief Add every dump with a valid register 1 to the distributions of lot
+   *
+   * @param[in] lot build lot of the dumps
+   * @param[in] dumps archive of dumps
+   * @param[in] threads number of worker threads, 0 for one per core
+   */
+  void Add(const std::string &lot, const DumpSet &dumps, int threads);
+
+  /**
+   * @brief Distributions by (lot, version)
+   */
+  const std::map<std::pair<std::string, int>, FleetGroup> &Groups() const { return groups_; }
+
+  /**
+   * @brief Number of dumps skipped because register 1 was not valid
+   */
+  uint64_t Skipped() const { return skipped_; }
+
+ private:
+  std::map<std::pair<std::string, int>, FleetGroup> groups_;
+  uint64_t skipped_;
+};
+
+#endif  // FLEETSTATS_H_
@@ -0,0 +1,70 @@
+/**
+ * @file
+ * IoWorker class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef IOWORKER_H_
+#define IOWORKER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+/**
+ * @brief Dedicated thread running submitted tasks one at a time, in submission order
+ */
+class IoWorker {
+ public:
+  IoWorker();
+
+  /**
+   * @brief Destructor, runs the tasks still queued and joins the thread
+   */
+  ~IoWorker();
+
+  /**
+   * @brief Queue task for the worker thread
+   *
+   * @param[in] task callable taking no arguments
+   * returns future receiving the result of the task, or the exception it threw
+   */
+  template <typename Task>
+  std::future<typename std::result_of<Task()>::type> Submit(Task task) {
+    typedef typename std::result_of<Task()>::type Result;
+    std::shared_ptr<std::packaged_task<Result()>> packaged =
+        std::make_shared<std::packaged_task<Result()>>(task);
+    std::future<Result> result = packaged->get_future();
+    Enqueue([packaged]() { (*packaged)(); });
+    return result;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopping_;
+  std::thread thread_;
+
+  void Enqueue(std::function<void()> task);
+  void Run();
+};
+
+#endif  // IOWORKER_H_
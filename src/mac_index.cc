@@ -0,0 +1,538 @@
+/**
+ * @file
+ * Persistent MAC address uniqueness index
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "mac_index.h"
+#include <glog/logging.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include "file_lock.h"
+#include "mapped_file.h"
+
+static const uint8_t kMagic[] = {'P', 'M', 'A', 'C'};
+static const uint32_t kFormatVersion = 1;
+/* header gets a page of its own, Bloom filter and slots start page aligned */
+static const size_t kHeaderSize = 4096;
+static const uint64_t kInitialCapacity = 1024;
+/* Bloom filter of 8 bits per slot and 4 hashes, about 1% false positives at 70% load */
+static const int kBloomHashes = 4;
+static const size_t kSerialSize = 8;
+static const size_t kMacSize = 6;
+
+struct MacIndexHeader {
+  uint8_t magic[4];
+  uint32_t version;
+  uint64_t capacity;
+  uint64_t count;
+};
+
+struct MacIndexSlot {
+  uint8_t mac[kMacSize];
+  uint8_t used;
+  uint8_t serial_size;
+  uint8_t serial[kSerialSize];
+};
+
+static_assert(sizeof(MacIndexSlot) == 16, "MAC index slot must be 16 bytes");
+
+static size_t IndexFileSize(uint64_t capacity) {
+  return kHeaderSize + capacity + capacity * sizeof(MacIndexSlot);
+}
+
+/* table is grown before it gets more than 70% full */
+static bool Fits(uint64_t entries, uint64_t capacity) {
+  return entries * 10 <= capacity * 7;
+}
+
+static uint64_t MacValue(const uint8_t *mac) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < kMacSize; i++) {
+    value = (value << 8) | mac[i];
+  }
+  return value;
+}
+
+static std::string MacString(uint64_t mac) {
+  char text[18];
+  snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X",
+           static_cast<int>((mac >> 40) & 0xFF), static_cast<int>((mac >> 32) & 0xFF),
+           static_cast<int>((mac >> 24) & 0xFF), static_cast<int>((mac >> 16) & 0xFF),
+           static_cast<int>((mac >> 8) & 0xFF), static_cast<int>(mac & 0xFF));
+  return text;
+}
+
+static std::string SerialString(const std::vector<uint8_t> &serial) {
+  std::string text;
+  for (uint8_t byte : serial) {
+    char hex[3];
+    snprintf(hex, sizeof(hex), "%02X", byte);
+    text += hex;
+  }
+  return text.empty() ? "(unknown)" : text;
+}
+
+/* MurmurHash3 finaliser, MAC addresses of one vendor only differ in the low bytes */
+static uint64_t Hash(uint64_t mac) {
+  mac ^= mac >> 33;
+  mac *= 0xff51afd7ed558ccdULL;
+  mac ^= mac >> 33;
+  mac *= 0xc4ceb9fe1a85ec53ULL;
+  mac ^= mac >> 33;
+  return mac;
+}
+
+/* slot index and second Bloom hash use the other half of the hash than the first Bloom bit */
+static uint64_t Swapped(uint64_t hash) {
+  return (hash << 32) | (hash >> 32);
+}
+
+static bool BloomTest(const uint8_t *bloom, uint64_t capacity, uint64_t hash) {
+  const uint64_t mask = capacity * 8 - 1;
+  const uint64_t step = Swapped(hash) | 1;
+  for (int i = 0; i < kBloomHashes; i++) {
+    uint64_t bit = (hash + i * step) & mask;
+    if (!(bloom[bit >> 3] & (1 << (bit & 7)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void BloomSet(uint8_t *bloom, uint64_t capacity, uint64_t hash) {
+  const uint64_t mask = capacity * 8 - 1;
+  const uint64_t step = Swapped(hash) | 1;
+  for (int i = 0; i < kBloomHashes; i++) {
+    uint64_t bit = (hash + i * step) & mask;
+    bloom[bit >> 3] |= 1 << (bit & 7);
+  }
+}
+
+/**
+ * @brief Create an empty index file of capacity slots
+ *
+ * returns open file descriptor
+ */
+static int CreateIndexFile(const std::string &path, uint64_t capacity) {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    LOG(ERROR) << "Can't create " << path << ": " << strerror(errno);
+    throw std::runtime_error("Can't create MAC index: " + path);
+  }
+  MacIndexHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kFormatVersion;
+  header.capacity = capacity;
+  header.count = 0;
+  /* ftruncate leaves the Bloom filter and slots zero, i.e empty */
+  if (ftruncate(fd, IndexFileSize(capacity)) < 0 ||
+      pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+    LOG(ERROR) << "Can't initialise " << path << ": " << strerror(errno);
+    close(fd);
+    unlink(path.c_str());
+    throw std::runtime_error("Can't create MAC index: " + path);
+  }
+  return fd;
+}
+
+MacIndex::MacIndex(const std::string &path, const std::vector<uint8_t> &serial)
+    : path_(path), serial_(serial), fd_(-1), lock_fd_(-1), inode_(0), map_(NULL), map_size_(0),
+      header_(NULL), bloom_(NULL), slots_(NULL) {
+  if (serial.size() > kSerialSize) {
+    LOG(ERROR) << "Serial number too long: " << serial.size() << " bytes";
+    throw std::runtime_error("Serial number too long");
+  }
+  lock_fd_ = open((path + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+  if (lock_fd_ < 0) {
+    LOG(ERROR) << "Can't open " << path << ".lock: " << strerror(errno);
+    throw std::runtime_error("Can't open MAC index: " + path);
+  }
+
+  try {
+    FileLock lock(lock_fd_, LOCK_EX, "MAC index");
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0 || st.st_size == 0) {
+      close(CreateIndexFile(path, kInitialCapacity));
+    }
+  } catch (std::runtime_error &e) {
+    close(lock_fd_);
+    throw;
+  }
+}
+
+MacIndex::~MacIndex() {
+  Unmap();
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  close(lock_fd_);
+}
+
+void MacIndex::Map() {
+  struct stat st;
+  if (fstat(fd_, &st) < 0) {
+    LOG(ERROR) << "fstat failed: " << strerror(errno);
+    throw std::runtime_error("MAC index fstat failed");
+  }
+  if (static_cast<size_t>(st.st_size) < kHeaderSize) {
+    LOG(ERROR) << path_ << " is not a MAC index";
+    throw std::runtime_error("Invalid MAC index: " + path_);
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    LOG(ERROR) << "mmap failed: " << strerror(errno);
+    throw std::runtime_error("Can't map MAC index: " + path_);
+  }
+  map_ = static_cast<uint8_t *>(map);
+  map_size_ = st.st_size;
+  inode_ = st.st_ino;
+  header_ = reinterpret_cast<MacIndexHeader *>(map_);
+  const uint64_t capacity = header_->capacity;
+  if (memcmp(header_->magic, kMagic, sizeof(kMagic)) || header_->version != kFormatVersion ||
+      capacity == 0 || (capacity & (capacity - 1)) || IndexFileSize(capacity) != map_size_) {
+    LOG(ERROR) << path_ << " is not a MAC index of version " << kFormatVersion;
+    Unmap();
+    throw std::runtime_error("Invalid MAC index: " + path_);
+  }
+  bloom_ = map_ + kHeaderSize;
+  slots_ = reinterpret_cast<MacIndexSlot *>(bloom_ + capacity);
+}
+
+void MacIndex::Unmap() {
+  if (map_) {
+    munmap(map_, map_size_);
+  }
+  map_ = NULL;
+  map_size_ = 0;
+  header_ = NULL;
+  bloom_ = NULL;
+  slots_ = NULL;
+}
+
+void MacIndex::Remap() {
+  struct stat st;
+  if (map_ && stat(path_.c_str(), &st) == 0 && st.st_ino == inode_) {
+    return;
+  }
+  /* first use, or another process grew the index into a new file */
+  Unmap();
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  fd_ = open(path_.c_str(), O_RDWR);
+  if (fd_ < 0) {
+    LOG(ERROR) << "Can't open " << path_ << ": " << strerror(errno);
+    throw std::runtime_error("Can't open MAC index: " + path_);
+  }
+  Map();
+}
+
+MacIndexSlot *MacIndex::Probe(uint64_t mac, uint64_t hash) const {
+  const uint64_t mask = header_->capacity - 1;
+  uint8_t key[kMacSize];
+  for (size_t i = 0; i < kMacSize; i++) {
+    key[i] = mac >> (8 * (kMacSize - 1 - i));
+  }
+  for (uint64_t i = Swapped(hash) & mask;; i = (i + 1) & mask) {
+    MacIndexSlot *slot = &slots_[i];
+    if (!slot->used || !memcmp(slot->mac, key, kMacSize)) {
+      return slot;
+    }
+  }
+}
+
+MacIndexSlot *MacIndex::Insert(uint64_t mac, const std::vector<uint8_t> &serial, bool *added) {
+  const uint64_t hash = Hash(mac);
+  MacIndexSlot *slot = Probe(mac, hash);
+  *added = !slot->used;
+  if (*added) {
+    for (size_t i = 0; i < kMacSize; i++) {
+      slot->mac[i] = mac >> (8 * (kMacSize - 1 - i));
+    }
+    slot->serial_size = serial.size();
+    std::copy(serial.begin(), serial.end(), slot->serial);
+    slot->used = 1;
+    BloomSet(bloom_, header_->capacity, hash);
+    header_->count++;
+  }
+  return slot;
+}
+
+void MacIndex::Grow(uint64_t entries) {
+  uint64_t capacity = header_->capacity;
+  if (Fits(entries, capacity)) {
+    return;
+  }
+  while (!Fits(entries, capacity)) {
+    capacity *= 2;
+  }
+  LOG(INFO) << "Growing MAC index to " << capacity << " slots";
+
+  const std::string temp = path_ + "." + std::to_string(getpid());
+  int old_fd = fd_;
+  uint8_t *old_map = map_;
+  size_t old_map_size = map_size_;
+  const MacIndexSlot *old_slots = slots_;
+  const uint64_t old_capacity = header_->capacity;
+
+  fd_ = CreateIndexFile(temp, capacity);
+  try {
+    Map();
+    for (uint64_t i = 0; i < old_capacity; i++) {
+      const MacIndexSlot &old_slot = old_slots[i];
+      if (old_slot.used) {
+        bool added;
+        Insert(MacValue(old_slot.mac), std::vector<uint8_t>(old_slot.serial, old_slot.serial +
+                                                            old_slot.serial_size), &added);
+      }
+    }
+    Sync();
+    /* other processes holding the old file remap when they see the new inode */
+    if (rename(temp.c_str(), path_.c_str()) < 0) {
+      LOG(ERROR) << "Can't rename " << temp << " to " << path_ << ": " << strerror(errno);
+      throw std::runtime_error("Growing MAC index failed: " + path_);
+    }
+  } catch (std::runtime_error &e) {
+    Unmap();
+    close(fd_);
+    unlink(temp.c_str());
+    fd_ = old_fd;
+    Map();
+    throw;
+  }
+  munmap(old_map, old_map_size);
+  close(old_fd);
+}
+
+void MacIndex::Sync() {
+  if (msync(map_, map_size_, MS_SYNC) < 0) {
+    LOG(ERROR) << "msync failed: " << strerror(errno);
+    throw std::runtime_error("MAC index sync failed: " + path_);
+  }
+}
+
+bool MacIndex::Find(const std::vector<uint8_t> &mac, std::vector<uint8_t> *serial) {
+  if (mac.size() != kMacSize) {
+    LOG(ERROR) << "Invalid MAC address size: " << mac.size();
+    throw std::runtime_error("Invalid MAC address");
+  }
+  const uint64_t value = MacValue(mac.data());
+  const uint64_t hash = Hash(value);
+  FileLock lock(lock_fd_, LOCK_SH, "MAC index");
+  Remap();
+  bool found = false;
+  if (BloomTest(bloom_, header_->capacity, hash)) {
+    const MacIndexSlot *slot = Probe(value, hash);
+    found = slot->used;
+    if (found && serial) {
+      serial->assign(slot->serial, slot->serial + slot->serial_size);
+    }
+  }
+  return found;
+}
+
+void MacIndex::Reserve(const std::vector<std::vector<uint8_t>> &macs) {
+  std::vector<uint64_t> values;
+  for (const auto &mac : macs) {
+    if (mac.size() != kMacSize) {
+      LOG(ERROR) << "Invalid MAC address size: " << mac.size();
+      throw std::runtime_error("Invalid MAC address");
+    }
+    uint64_t value = MacValue(mac.data());
+    if (std::find(values.begin(), values.end(), value) != values.end()) {
+      LOG(ERROR) << "MAC " << MacString(value) << " given twice for board "
+                 << SerialString(serial_);
+      throw std::runtime_error("Duplicate MAC address");
+    }
+    values.push_back(value);
+  }
+
+  FileLock lock(lock_fd_, LOCK_EX, "MAC index");
+  Remap();
+  for (uint64_t value : values) {
+    const uint64_t hash = Hash(value);
+    if (!BloomTest(bloom_, header_->capacity, hash)) {
+      continue;
+    }
+    const MacIndexSlot *slot = Probe(value, hash);
+    if (slot->used && std::vector<uint8_t>(slot->serial, slot->serial + slot->serial_size) !=
+                      serial_) {
+      LOG(ERROR) << "MAC " << MacString(value) << " already written to board "
+                 << SerialString(std::vector<uint8_t>(slot->serial,
+                                                      slot->serial + slot->serial_size));
+      throw std::runtime_error("Duplicate MAC address");
+    }
+  }
+  Grow(header_->count + values.size());
+  bool changed = false;
+  for (uint64_t value : values) {
+    bool added;
+    Insert(value, serial_, &added);
+    changed |= added;
+  }
+  if (changed) {
+    Sync();
+  }
+}
+
+void MacIndex::BeforeWrite(int register_number, const std::vector<uint8_t> &old_data,
+                           const std::vector<uint8_t> &new_data,
+                           const std::set<std::string> &fields) {
+  const int kVersionOffset = 2;
+  if (register_number != 0 || new_data.size() <= kVersionOffset) {
+    return;
+  }
+  const auto &versions = DeviceLayouts::Layouts()[0];
+  const auto layout = versions.find(new_data[kVersionOffset]);
+  if (layout == versions.end()) {
+    return;
+  }
+
+  std::vector<std::vector<uint8_t>> macs;
+  for (const auto &field : layout->second) {
+    if (field.first.compare(0, 4, "MAC_") != 0) {
+      continue;
+    }
+    const size_t offset = field.second.offset - fields::RegisterBase(0);
+    const size_t size = field.second.size;
+    if (offset + size > new_data.size()) {
+      continue;
+    }
+    std::vector<uint8_t> mac(new_data.begin() + offset, new_data.begin() + offset + size);
+    if (offset + size <= old_data.size() &&
+        std::equal(mac.begin(), mac.end(), old_data.begin() + offset)) {
+      continue;
+    }
+    if (std::all_of(mac.begin(), mac.end(), [](uint8_t byte) { return byte == 0x00; }) ||
+        std::all_of(mac.begin(), mac.end(), [](uint8_t byte) { return byte == 0xFF; })) {
+      continue;
+    }
+    macs.push_back(mac);
+  }
+  if (!macs.empty()) {
+    Reserve(macs);
+  }
+}
+
+static int HexDigit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+/**
+ * @brief Parse "<mac> [<serial>]" line of a bulk load file
+ *
+ * returns false if the line is not valid
+ */
+static bool ParseMacLine(const char *ptr, const char *end, uint64_t *mac,
+                         std::vector<uint8_t> *serial) {
+  while (ptr < end && isspace(*ptr)) {
+    ptr++;
+  }
+  *mac = 0;
+  for (size_t i = 0; i < kMacSize; i++) {
+    if (i > 0 && ptr < end && (*ptr == ':' || *ptr == '-')) {
+      ptr++;
+    }
+    if (end - ptr < 2 || HexDigit(ptr[0]) < 0 || HexDigit(ptr[1]) < 0) {
+      return false;
+    }
+    *mac = (*mac << 8) | (HexDigit(ptr[0]) << 4) | HexDigit(ptr[1]);
+    ptr += 2;
+  }
+  while (ptr < end && isspace(*ptr)) {
+    ptr++;
+  }
+  serial->clear();
+  while (end - ptr >= 2 && HexDigit(ptr[0]) >= 0 && HexDigit(ptr[1]) >= 0) {
+    serial->push_back((HexDigit(ptr[0]) << 4) | HexDigit(ptr[1]));
+    ptr += 2;
+  }
+  while (ptr < end && isspace(*ptr)) {
+    ptr++;
+  }
+  return ptr == end && serial->size() <= kSerialSize;
+}
+
+MacIndex::LoadStats MacIndex::BulkLoad(const std::string &path) {
+  MappedFile input(path);
+  const char *data = reinterpret_cast<const char *>(input.Data());
+  const char *end = data + input.Size();
+  uint64_t lines = 0;
+  for (const char *ptr = data; ptr < end; lines++) {
+    const char *eol = static_cast<const char *>(memchr(ptr, '\n', end - ptr));
+    ptr = eol ? eol + 1 : end;
+  }
+
+  LoadStats stats = {0, 0, 0, 0};
+  FileLock lock(lock_fd_, LOCK_EX, "MAC index");
+  Remap();
+  /* one rebuild for the whole file instead of doubling along the way */
+  Grow(header_->count + lines);
+  std::vector<uint8_t> serial;
+  serial.reserve(kSerialSize);
+  for (const char *ptr = data; ptr < end;) {
+    const char *eol = static_cast<const char *>(memchr(ptr, '\n', end - ptr));
+    const char *line_end = eol ? eol : end;
+    uint64_t mac;
+    if (ptr == line_end) {
+      /* empty line */
+    } else if (!ParseMacLine(ptr, line_end, &mac, &serial)) {
+      stats.invalid++;
+    } else {
+      bool added;
+      const MacIndexSlot *slot = Insert(mac, serial, &added);
+      if (added) {
+        stats.added++;
+      } else if (std::vector<uint8_t>(slot->serial, slot->serial + slot->serial_size) ==
+                 serial) {
+        stats.existing++;
+      } else {
+        LOG(WARNING) << "MAC " << MacString(mac) << " of board " << SerialString(serial)
+                     << " already in index for board "
+                     << SerialString(std::vector<uint8_t>(slot->serial,
+                                                          slot->serial + slot->serial_size));
+        stats.conflicts++;
+      }
+    }
+    ptr = eol ? eol + 1 : end;
+  }
+  Sync();
+  return stats;
+}
+
+uint64_t MacIndex::Size() {
+  FileLock lock(lock_fd_, LOCK_SH, "MAC index");
+  Remap();
+  uint64_t count = header_->count;
+  return count;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file
+ * Persistent MAC address uniqueness index
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef MACINDEX_H_
+#define MACINDEX_H_
+
+#include <sys/types.h>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+#include "device_data.h"
+
+struct MacIndexHeader;
+struct MacIndexSlot;
+
+/**
+ * @brief On-disk index of every MAC address written, with the serial number of its board
+ *
+ * The index is a memory mapped open addressing hash table (linear probing) with a Bloom filter
+ * in front of it, so a lookup costs a few bit tests and, for addresses in the index, one probe
+ * sequence. As write hook, MacIndex checks the MAC fields of register 0 before programming and
+ * refuses the write if an address belongs to another board. Addresses are recorded before
+ * programming, so a failed write leaves them reserved for the board.
+ *
+ * Concurrent stations on one host share the index through a lock on the "<index>.lock" side
+ * file, shared for lookups and exclusive for inserts. The table grows by rebuilding it into a
+ * new file which replaces the index, other processes remap it when they next take the lock.
+ *
+ * File layout (host byte order): header page with magic "PMAC", format version, capacity and
+ * number of entries, then one Bloom filter byte per slot, then capacity 16 byte slots holding
+ * MAC, used flag, serial length and serial number.
+ */
+class MacIndex : public WriteHook {
+ public:
+  /**
+   * @brief Result of a bulk load
+   */
+  struct LoadStats {
+    /** addresses added to the index */
+    uint64_t added;
+    /** addresses already in the index for the same board */
+    uint64_t existing;
+    /** addresses already in the index for another board, the index keeps the first one */
+    uint64_t conflicts;
+    /** lines which are not a MAC address, optionally followed by a serial number */
+    uint64_t invalid;
+  };
+
+  /**
+   * @brief Constructor, opens or creates the index
+   *
+   * @param[in] path index file
+   * @param[in] serial serial number of the board written by this process, up to 8 bytes
+   */
+  MacIndex(const std::string &path, const std::vector<uint8_t> &serial);
+  ~MacIndex();
+
+  MacIndex(const MacIndex &) = delete;
+  MacIndex &operator=(const MacIndex &) = delete;
+
+  /**
+   * @brief Look up MAC address
+   *
+   * @param[in] mac MAC address (6 bytes)
+   * @param[out] serial serial number of the board holding the address, may be NULL
+   * returns true if the address is in the index
+   */
+  bool Find(const std::vector<uint8_t> &mac, std::vector<uint8_t> *serial);
+
+  /**
+   * @brief Record MAC addresses for this board, all or none
+   *
+   * Addresses already recorded for this board are accepted again, so a board can be
+   * rewritten. Nothing is recorded if any address belongs to another board.
+   *
+   * @param[in] macs MAC addresses (6 bytes each)
+   */
+  void Reserve(const std::vector<std::vector<uint8_t>> &macs);
+
+  /**
+   * @brief Reserve changed MAC fields of register 0 before it is programmed
+   *
+   * Fields which are all 0x00 or all 0xFF are not addresses yet and are skipped.
+   */
+  void BeforeWrite(int register_number, const std::vector<uint8_t> &old_data,
+                   const std::vector<uint8_t> &new_data, const std::set<std::string> &fields);
+
+  /**
+   * @brief Add historical MAC addresses from a text file
+   *
+   * One address per line, 12 hex digits with or without ':' separators, optionally followed
+   * by white space and the hex serial number of its board. The file is mapped and parsed in
+   * place, the table is grown once to fit all lines and the whole load holds the lock and
+   * syncs once.
+   *
+   * @param[in] path text file
+   * returns counts of added, existing, conflicting and invalid lines
+   */
+  LoadStats BulkLoad(const std::string &path);
+
+  /**
+   * @brief Number of addresses in the index
+   */
+  uint64_t Size();
+
+ private:
+  /**
+   * @brief Map the index again if another process replaced it, side file lock held
+   */
+  void Remap();
+  void Map();
+  void Unmap();
+
+  /**
+   * @brief Slot holding mac, or the empty slot ending its probe sequence
+   */
+  MacIndexSlot *Probe(uint64_t mac, uint64_t hash) const;
+
+  /**
+   * @brief Insert mac into the mapped table, which must have a free slot
+   *
+   * returns slot of mac, existing or new
+   */
+  MacIndexSlot *Insert(uint64_t mac, const std::vector<uint8_t> &serial, bool *added);
+
+  /**
+   * @brief Rebuild the table with room for entries, if it does not already have it
+   *
+   * @param[in] entries number of entries the table must hold
+   */
+  void Grow(uint64_t entries);
+
+  /**
+   * @brief Flush mapped changes to disk
+   */
+  void Sync();
+
+  const std::string path_;
+  const std::vector<uint8_t> serial_;
+  int fd_;
+  int lock_fd_;
+  ino_t inode_;
+  uint8_t *map_;
+  size_t map_size_;
+  MacIndexHeader *header_;
+  uint8_t *bloom_;
+  MacIndexSlot *slots_;
+};
+
+#endif  // MACINDEX_H_
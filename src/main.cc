@@ -17,12 +17,35 @@
  */
 
 #include <glog/logging.h>
+#include <chrono>
+#include <fstream>
 #include <string>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include "audit.h"
+#include "cal_backend.h"
+#include "cal_sweep.h"
+#include "dcxo_cal.h"
+#include "device_discovery.h"
+#include "driver_params.h"
+#include "dump_set.h"
+#include "export_pack.h"
+#include "fleet_stats.h"
+#include "mac_index.h"
+#include "manifest_validator.h"
 #include "proddata.h"
+#include "rx_stats.h"
+#include "spc_monitor.h"
+#include "trace.h"
+#include "tx_power_lut_reader.h"
 #include "flash_access.h"
+#include "mtd_access.h"
 #include "userotp_access.h"
+#include "write_log.h"
 
 static void PrintData(const std::vector<uint8_t> &data) {
   int size = data.size();
@@ -32,48 +55,916 @@ static void PrintData(const std::vector<uint8_t> &data) {
   std::cout << std::endl;
 }
 
+/* user OTP device given with --device, discovered when NULL */
+static const char *device_path = NULL;
+
+/* write log given with --write-log and --write-log-delay, MAC index given with --mac-index */
+static std::string write_log;
+static int write_log_delay = WriteLog::kDefaultMaxDelayMs;
+static std::string mac_index;
+
+/* SPC state file given with --spc, charts of the station given with --station or host name */
+static const char *spc_state = NULL;
+static const char *spc_station = NULL;
+
+/* observers of register programming given as options, every command writing registers uses it */
+static void EnableWriteHooks(Proddata *proddata) {
+  if (!write_log.empty()) {
+    proddata->EnableWriteLog(write_log, write_log_delay);
+  }
+  if (!mac_index.empty()) {
+    proddata->EnableMacIndex(mac_index);
+  }
+  if (!spc_state) {
+    return;
+  }
+  std::string station;
+  if (spc_station) {
+    station = spc_station;
+  } else {
+    char host[256] = {};
+    gethostname(host, sizeof(host) - 1);
+    station = host;
+  }
+  proddata->EnableSpc(spc_state, station);
+}
+
+static std::unique_ptr<FlashAccess> OpenDevice(bool read_only = false) {
+  if (device_path) {
+    return std::unique_ptr<FlashAccess>(new UserOTPAccess(device_path, read_only));
+  }
+  DeviceDiscovery discovery("", kDiscoveryCachePath);
+  DiscoveredDevice device = discovery.Discover();
+  if (device.backend == DiscoveredDevice::kMTD) {
+    return std::unique_ptr<FlashAccess>(new MTDAccess(device.path, read_only));
+  }
+  return std::unique_ptr<FlashAccess>(new UserOTPAccess(device.path, read_only));
+}
+
+static int ParseInt(const std::string &value) {
+  size_t end = 0;
+  int result = 0;
+  try {
+    result = std::stoi(value, &end);
+  } catch (std::logic_error &e) {
+    end = 0;
+  }
+  if (end == 0 || end != value.size()) {
+    LOG(ERROR) << "Invalid number: " << value;
+    throw std::runtime_error("Invalid number: " + value);
+  }
+  return result;
+}
+
+static std::vector<int> ParseList(const std::string &list) {
+  std::vector<int> values;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    values.push_back(ParseInt(item));
+  }
+  return values;
+}
+
+static void PrintSweep(const CalSweep &sweep) {
+  for (const auto &step : sweep.Steps()) {
+    const CalParams &params = step.params;
+    std::cout << std::dec << (step.retune ? "tune " : "     ") << "antenna=" << params.antenna
+              << " ch=" << params.channel << " bw=" << params.bandwidth << " rate="
+              << params.data_rate_index << " power=" << params.tx_power << std::endl;
+  }
+  std::cout << sweep.Steps().size() << " steps, " << sweep.Retunes() << " retunes" << std::endl;
+}
+
+static void PrintRxAggregate(const RxAggregate &aggregate) {
+  std::cout << std::dec << "frames=" << aggregate.frames << " errors=" << aggregate.errors
+            << " per=" << aggregate.per << " rssi=" << aggregate.rssi << " samples="
+            << aggregate.samples << " dropped=" << aggregate.dropped << std::endl;
+}
+
+static int CalCommand(int argc, char* argv[]) {
+  SweepPlan plan;
+  std::string hook_dir = "/usr/bin/wifi_test";
+  std::string measure_command = "/usr/bin/wifi_test/measure_txpower.sh";
+  /* measurement path of the second antenna, antennas are calibrated concurrently if given */
+  std::string second_measure_command;
+  std::string frequency_command = "/usr/bin/wifi_test/measure_freq_offset.sh";
+  std::string rx_stats = "/proc/uccp420/phy_stats";
+  int rate = 10;
+  int duration = 1;
+  bool dry_run = false;
+  for (int i = 3; i < argc; i++) {
+    std::string option = argv[i];
+    if (option == "--dry-run") {
+      dry_run = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << option << std::endl;
+      return -1;
+    }
+    std::string value = argv[++i];
+    if (option == "--antennas") {
+      plan.antennas = ParseList(value);
+    } else if (option == "--channels") {
+      plan.channels = ParseList(value);
+    } else if (option == "--bandwidths") {
+      plan.bandwidths = ParseList(value);
+    } else if (option == "--rates") {
+      plan.data_rates = ParseList(value);
+    } else if (option == "--powers") {
+      plan.tx_powers = ParseList(value);
+    } else if (option == "--streams") {
+      plan.num_spatial_streams = ParseInt(value);
+    } else if (option == "--hooks") {
+      hook_dir = value;
+    } else if (option == "--measure") {
+      measure_command = value;
+    } else if (option == "--measure2") {
+      second_measure_command = value;
+    } else if (option == "--measure-freq") {
+      frequency_command = value;
+    } else if (option == "--rx-stats") {
+      rx_stats = value;
+    } else if (option == "--rx-rate") {
+      rate = ParseInt(value);
+    } else if (option == "--duration") {
+      duration = ParseInt(value);
+    } else {
+      std::cerr << "Invalid cal option: " << option << std::endl;
+      return -1;
+    }
+  }
+
+  ScriptCalBackend backend(hook_dir, measure_command, frequency_command);
+  if (!strcmp(argv[2], "sweep")) {
+    std::vector<CalBackend *> paths{&backend};
+    std::unique_ptr<ScriptCalBackend> second_path;
+    if (!second_measure_command.empty()) {
+      second_path.reset(new ScriptCalBackend(hook_dir, second_measure_command,
+                                             frequency_command));
+      paths.push_back(second_path.get());
+    }
+    CalOrchestrator orchestrator(plan, paths);
+    if (dry_run) {
+      PrintSweep(orchestrator.Sweep());
+      if (orchestrator.Concurrent()) {
+        std::cout << "antennas measured concurrently at every step" << std::endl;
+      }
+      return 0;
+    }
+
+    Proddata proddata(OpenDevice());
+    EnableWriteHooks(&proddata);
+    proddata.RunCalSweep(&orchestrator);
+    for (const auto &offset : orchestrator.PdOffsets()) {
+      std::cout << offset.first << " " << std::dec << static_cast<int>(
+          static_cast<int8_t>(offset.second[0])) << std::endl;
+    }
+  } else if (!strcmp(argv[2], "dcxo")) {
+    Proddata proddata(OpenDevice());
+    EnableWriteHooks(&proddata);
+    DcxoCalibrator calibrator(&backend);
+    proddata.RunDcxoCal(&calibrator);
+    std::cout << "DCXO " << std::dec << static_cast<int>(calibrator.Best()) << std::endl;
+  } else if (!strcmp(argv[2], "rx")) {
+    RxStatsSampler sampler(rx_stats, rate);
+    sampler.Start(rate);
+    for (int second = 0; second < duration; second++) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      PrintRxAggregate(sampler.Aggregate());
+    }
+    sampler.Stop();
+  } else {
+    std::cerr << "Invalid cal command" << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+static int AuditCommand(int argc, char* argv[]) {
+  int threads = 0;
+  for (int i = 3; i < argc; i++) {
+    std::string option = argv[i];
+    if (option == "--threads" && i + 1 < argc) {
+      threads = ParseInt(argv[++i]);
+    } else {
+      std::cerr << "Invalid audit option: " << option << std::endl;
+      return -1;
+    }
+  }
+
+  DumpSet dumps(argv[2]);
+  AuditReport report = Audit(dumps, threads);
+  std::cout << std::dec << "dumps " << report.dumps << std::endl;
+  std::cout << "unreadable " << report.unreadable << std::endl;
+  for (int reg = 0; reg < 2; reg++) {
+    for (int i = 0; i < AuditReport::kStatusCount; i++) {
+      std::cout << "register " << reg << " "
+                << RegisterStatusName(static_cast<DeviceData::RegisterStatus>(i)) << " "
+                << report.status[reg][i] << std::endl;
+    }
+    for (int version = 0; version < 256; version++) {
+      if (report.versions[reg][version]) {
+        std::cout << "register " << reg << " version " << version << " "
+                  << report.versions[reg][version] << std::endl;
+      }
+    }
+  }
+  for (const auto &problem : report.problems) {
+    std::cout << problem << std::endl;
+  }
+  if (report.problem_count > report.problems.size()) {
+    std::cout << "... " << report.problem_count - report.problems.size() << " more problems"
+              << std::endl;
+  }
+  return report.problem_count ? -1 : 0;
+}
+
+static int ValidateCommand(int argc, char* argv[]) {
+  int threads = 0;
+  ManifestValidator validator;
+  for (int i = 3; i < argc; i++) {
+    std::string option = argv[i];
+    if (option == "--threads" && i + 1 < argc) {
+      threads = ParseInt(argv[++i]);
+    } else if (option == "--range" && i + 1 < argc) {
+      /* "<field>=<min>,<max>" */
+      std::string range = argv[++i];
+      size_t separator = range.find('=');
+      std::vector<int> limits;
+      if (separator != std::string::npos) {
+        limits = ParseList(range.substr(separator + 1));
+      }
+      if (limits.size() != 2) {
+        std::cerr << "Invalid range: " << range << std::endl;
+        return -1;
+      }
+      validator.SetRange(range.substr(0, separator), limits[0], limits[1]);
+    } else if (option == "--oui" && i + 1 < argc) {
+      std::string oui = argv[++i];
+      if (oui.size() != 6 || HexPrefixLength(oui.c_str(), oui.size()) != oui.size()) {
+        std::cerr << "Invalid OUI: " << oui << std::endl;
+        return -1;
+      }
+      validator.AddOui(FormatString(oui));
+    } else {
+      std::cerr << "Invalid validate option: " << option << std::endl;
+      return -1;
+    }
+  }
+
+  ManifestReport report = validator.ValidateFile(argv[2], threads);
+  for (const auto &problem : report.problems) {
+    std::cout << argv[2] << ":" << problem.line << ":";
+    if (problem.column) {
+      std::cout << problem.column << ":";
+    }
+    std::cout << " " << problem.message << std::endl;
+  }
+  if (report.problem_count > report.problems.size()) {
+    std::cout << "... " << report.problem_count - report.problems.size() << " more problems"
+              << std::endl;
+  }
+  std::cout << "rows " << report.rows << ", invalid " << report.invalid_rows << std::endl;
+  return report.problem_count ? -1 : 0;
+}
+
+static int SpcCommand(int argc, char* argv[]) {
+  std::vector<SpcStats> charts = SpcMonitor::Read(argv[2]);
+  std::cout << std::dec << "station,version,field,count,mean,stddev,target,sigma,ewma,"
+            << "cusum_high,cusum_low" << std::endl;
+  for (const auto &chart : charts) {
+    std::cout << chart.station << "," << chart.version << "," << chart.field << ","
+              << chart.count << "," << chart.mean << "," << chart.stddev << "," << chart.target
+              << "," << chart.sigma << "," << chart.ewma << "," << chart.cusum_high << ","
+              << chart.cusum_low << std::endl;
+  }
+  return 0;
+}
+
+static std::string Hex(const std::vector<uint8_t> &data) {
+  std::stringstream stream;
+  for (uint8_t byte : data) {
+    stream << std::setw(2) << std::setfill('0') << std::hex << static_cast<int>(byte);
+  }
+  return stream.str();
+}
+
+static int LogCommand(int argc, char* argv[]) {
+  WriteLogIndex log(argv[2]);
+  auto print = [](const WriteLogRecord &record) {
+    std::cout << std::dec << record.timestamp_us << " " << Hex(record.serial) << " "
+              << std::dec << record.register_number << " " << Hex(record.old_data) << " "
+              << Hex(record.new_data) << std::endl;
+  };
+  if (argc > 3) {
+    for (const auto &record : log.Find(FormatString(argv[3]))) {
+      print(record);
+    }
+  } else {
+    log.ForEach(print);
+  }
+  if (log.Corrupted()) {
+    std::cerr << log.Corrupted() << " corrupted records skipped" << std::endl;
+  }
+  return 0;
+}
+
+static int MacIndexCommand(int argc, char* argv[]) {
+  MacIndex index(argv[3], std::vector<uint8_t>());
+  if (!strcmp(argv[2], "load")) {
+    MacIndex::LoadStats stats = index.BulkLoad(argv[4]);
+    std::cout << "added " << stats.added << ", existing " << stats.existing << ", conflicts "
+              << stats.conflicts << ", invalid " << stats.invalid << std::endl;
+    return stats.conflicts ? 1 : 0;
+  }
+  std::vector<uint8_t> serial;
+  if (!index.Find(FormatString(argv[4]), &serial)) {
+    std::cerr << "MAC not in index" << std::endl;
+    return 1;
+  }
+  std::cout << Hex(serial) << std::endl;
+  return 0;
+}
+
+static int PackCommand(int argc, char* argv[]) {
+  int threads = 0;
+  std::vector<std::string> paths;
+  for (int i = 3; i < argc; i++) {
+    std::string option = argv[i];
+    if (option == "--threads" && i + 1 < argc) {
+      threads = ParseInt(argv[++i]);
+    } else if (option.compare(0, 2, "--") == 0) {
+      std::cerr << "Invalid pack option: " << option << std::endl;
+      return -1;
+    } else {
+      paths.push_back(option);
+    }
+  }
+
+  std::cout << std::dec;
+  if (!strcmp(argv[2], "build") && paths.size() >= 2) {
+    std::vector<std::string> inputs(paths.begin() + 1, paths.end());
+    ExportPack::BuildStats stats = ExportPack::Build(inputs, paths[0], threads);
+    std::cout << "records " << stats.records << ", skipped bytes " << stats.skipped_bytes
+              << std::endl;
+    return 0;
+  } else if (!strcmp(argv[2], "verify") && paths.size() == 1) {
+    ExportPack pack(paths[0]);
+    std::vector<size_t> corrupted = pack.Verify(threads);
+    for (size_t index : corrupted) {
+      std::cout << paths[0] << "#" << index << ": corrupted" << std::endl;
+    }
+    std::cout << "records " << pack.Count() << ", corrupted " << corrupted.size() << std::endl;
+    return corrupted.empty() ? 0 : 1;
+  } else if (!strcmp(argv[2], "find") && paths.size() == 2) {
+    ExportPack pack(paths[0]);
+    std::vector<size_t> found = pack.Find(FormatString(paths[1]));
+    ExportRecord record;
+    for (size_t index : found) {
+      if (!pack.Get(index, &record)) {
+        std::cerr << paths[0] << "#" << index << ": corrupted" << std::endl;
+        continue;
+      }
+      std::cout << std::dec << record.timestamp_us << " " << Hex(record.serial) << " "
+                << static_cast<int>(record.locked) << " " << Hex(record.image) << std::endl;
+    }
+    if (found.empty()) {
+      std::cerr << "Serial not in packfile" << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+  std::cerr << "Invalid pack command" << std::endl;
+  return -1;
+}
+
+static int StatsCommand(int argc, char* argv[]) {
+  int threads = 0;
+  bool histogram = false;
+  std::vector<std::string> inputs;
+  for (int i = 2; i < argc; i++) {
+    std::string option = argv[i];
+    if (option == "--threads" && i + 1 < argc) {
+      threads = ParseInt(argv[++i]);
+    } else if (option == "--histogram") {
+      histogram = true;
+    } else if (option.compare(0, 2, "--") == 0) {
+      std::cerr << "Invalid stats option: " << option << std::endl;
+      return -1;
+    } else {
+      inputs.push_back(option);
+    }
+  }
+  if (inputs.empty()) {
+    std::cerr << "Specify directory or packfile of OTP dumps" << std::endl;
+    return -1;
+  }
+
+  FleetStats stats;
+  for (const auto &input : inputs) {
+    /* "<lot>=<path>", lot defaults to the path */
+    size_t separator = input.find('=');
+    std::string lot = separator == std::string::npos ? input : input.substr(0, separator);
+    std::string path = separator == std::string::npos ? input : input.substr(separator + 1);
+    stats.Add(lot, DumpSet(path), threads);
+  }
+
+  std::cout << std::dec;
+  if (histogram) {
+    std::cout << "lot,version,field,value,units" << std::endl;
+  } else {
+    std::cout << "lot,version,field,units,mean,variance,min,p5,p50,p95,max" << std::endl;
+  }
+  for (const auto &entry : stats.Groups()) {
+    const FleetGroup &group = entry.second;
+    for (const auto &field : group.fields) {
+      std::string prefix = group.lot + "," + std::to_string(group.version) + "," + field.name + ",";
+      if (histogram) {
+        for (int bin = 0; bin < 256; bin++) {
+          if (field.bins[bin]) {
+            std::cout << prefix << bin - 128 << "," << field.bins[bin] << std::endl;
+          }
+        }
+        continue;
+      }
+      std::cout << prefix << group.units << "," << field.Mean() << "," << field.Variance() << ","
+                << field.Percentile(0) << "," << field.Percentile(5) << ","
+                << field.Percentile(50) << "," << field.Percentile(95) << ","
+                << field.Percentile(100) << std::endl;
+    }
+  }
+  if (stats.Skipped()) {
+    std::cerr << stats.Skipped() << " dumps skipped, register 1 not valid" << std::endl;
+  }
+  return 0;
+}
+
 static void usage() {
-  std::string mesg = "Usage: proddata write <data>             Write complete calibration data \n"
-                     "       proddata write <field> <value>    Write single data field only \n"
-                     "       proddata read                     Read calibration data \n"
-                     "       proddata read <field>             Read data field \n";
+  std::string mesg =
+      "Usage: proddata [<options>] <command>\n"
+      "Options: --device=<mtd device>              User OTP device (default from /proc/mtd)\n"
+      "         --trace=<file>                     Write Chrome trace JSON of the command to file\n"
+      "         --write-log=<file>                 Log every register write to file\n"
+      "         --write-log-delay=<ms>             Longest wait to share the log sync (default 5)\n"
+      "         --mac-index=<file>                 Refuse writes of MACs given to other boards\n"
+      "         --spc=<file>                       Chart calibration written, alarm on drift\n"
+      "         --station=<name>                   Station of the SPC charts (default host name)\n"
+      "       proddata write <data>                Write complete calibration data\n"
+      "       proddata write <field> <value>       Write single data field only\n"
+      "       proddata write <field> <value> ...   Write several fields, one write per register\n"
+      "       proddata read                        Read calibration data\n"
+      "       proddata read <field>                Read data field\n"
+      "       proddata upgrade <reg> [<field> <value> ...]\n"
+      "                                            Upgrade register layout to next version\n"
+      "       proddata record write <key> <value>  Append record to register 2\n"
+      "       proddata record read [<key>]         Read record(s) of register 2\n"
+      "       proddata export --binary [<file>]    Write binary record of the board to stdout\n"
+      "                                            or append it to file\n"
+      "       proddata apply-cal [<file>]          Write register 1 calibration to WiFi driver\n"
+      "                                            (default /proc/uccp420/params)\n"
+      "       proddata txpower-lut <file> [--interpolate]\n"
+      "                                            Write per-channel TX power table blob\n"
+      "       proddata cal sweep <cal options>     Run calibration sweep, write PD offsets\n"
+      "       proddata cal dcxo [<cal options>]    Search DCXO value and write it\n"
+      "       proddata cal rx [<cal options>]      Print rolling RX PER and RSSI every second\n"
+      "       proddata audit <dir|packfile> [--threads <n>]\n"
+      "                                            Check versions and CRCs of archived dumps\n"
+      "       proddata stats [<lot>=]<dir|packfile> ... [--threads <n>] [--histogram]\n"
+      "                                            CSV distributions of register 1 fields\n"
+      "       proddata validate <manifest> [--threads <n>] [--range <field>=<min>,<max>]...\n"
+      "                [--oui <hex>]...\n"
+      "                                            Check write payloads of a manifest offline\n"
+      "       proddata spc <file>                  CSV of the SPC charts of all stations\n"
+      "       proddata log <file> [<serial>]       Print write log records, of one board only\n"
+      "       proddata stream [--binary]           Run commands from stdin on one open device\n"
+      "       proddata pack build <packfile> <file> ... [--threads <n>]\n"
+      "                                            Index export records of files in a packfile\n"
+      "       proddata pack verify <packfile> [--threads <n>]\n"
+      "                                            Check CRCs of every packfile record\n"
+      "       proddata pack find <packfile> <serial>\n"
+      "                                            Print records of a board\n"
+      "       proddata mac-index load <index> <file>\n"
+      "                                            Add \"<mac> [<serial>]\" lines to MAC index\n"
+      "       proddata mac-index find <index> <mac>\n"
+      "                                            Print serial number of board holding MAC\n"
+      "Cal options: --antennas <list> --channels <list> --bandwidths <list>\n"
+      "             --rates <list> --powers <list> [--streams <n>] [--hooks <dir>]\n"
+      "             [--measure <command>] [--measure2 <command>] [--measure-freq <command>]\n"
+      "             [--dry-run]\n"
+      "             [--rx-stats <file>] [--rx-rate <polls per second>] [--duration <seconds>]\n"
+      "             lists are comma separated e.g --channels 1,6,11\n";
   std::cerr << mesg;
 }
 
+/**
+ * @brief Whether a device command only reads, it then shares the device lock
+ *
+ * @param[in] argc argument count, argv[1] is the command
+ * @param[in] argv arguments
+ */
+static bool ReadOnlyCommand(int argc, char* argv[]) {
+  return !strcmp(argv[1], "read") || !strcmp(argv[1], "export") ||
+         (!strcmp(argv[1], "record") && argc > 2 && !strcmp(argv[2], "read")) ||
+         !strcmp(argv[1], "apply-cal") || !strcmp(argv[1], "txpower-lut");
+}
+
+/**
+ * @brief Run a command on the open device, e.g "read DCXO"
+ *
+ * @param[in] proddata open device
+ * @param[in] argc argument count, argv[1] is the command
+ * @param[in] argv arguments, NULL terminated
+ * returns 0 on success, -1 on invalid command (error printed to stderr)
+ */
+static int DeviceCommand(Proddata *proddata, int argc, char* argv[]) {
+  if (!strcmp(argv[1], "write")) {
+    if (argv[2] == NULL) {
+      std::cerr << "Specify data to be written to OTP" << std::endl;
+      return -1;
+    } else if (argv[3] == NULL) {
+      proddata->Write(argv[2]);
+    } else if (argc % 2 != 0) {
+      std::cerr << "Specify value for every field" << std::endl;
+      return -1;
+    } else {
+      std::map<std::string, std::string> fields;
+      for (int i = 2; i < argc; i += 2) {
+        if (!fields.insert(std::make_pair(argv[i], argv[i + 1])).second) {
+          std::cerr << "Field given twice: " << argv[i] << std::endl;
+          return -1;
+        }
+      }
+      proddata->WriteFields(fields);
+    }
+  } else if (!strcmp(argv[1], "read")) {
+    std::vector<uint8_t> data;
+    if (argv[2] == NULL) {
+      data = proddata->Read();
+    } else {
+      data = proddata->ReadField(argv[2]);
+    }
+    PrintData(data);
+  } else if (!strcmp(argv[1], "export")) {
+    if (argc < 3 || argc > 4 || strcmp(argv[2], "--binary")) {
+      std::cerr << "Specify --binary and optionally a file to append the record to" << std::endl;
+      usage();
+      return -1;
+    }
+    std::vector<uint8_t> record = ExportPack::Encode(proddata->Export());
+    if (argc == 4) {
+      std::ofstream file(argv[3], std::ios::binary | std::ios::app);
+      file.write(reinterpret_cast<const char *>(record.data()), record.size());
+      if (!file.flush()) {
+        LOG(ERROR) << "Can't append export record to " << argv[3];
+        throw std::runtime_error(std::string("Can't write export record: ") + argv[3]);
+      }
+    } else {
+      std::cout.write(reinterpret_cast<const char *>(record.data()), record.size());
+      std::cout.flush();
+    }
+  } else if (!strcmp(argv[1], "apply-cal")) {
+    if (argc > 3) {
+      std::cerr << "Invalid apply-cal command" << std::endl;
+      usage();
+      return -1;
+    }
+    proddata->ApplyCal(argc == 3 ? argv[2] : kDriverParamsPath);
+  } else if (!strcmp(argv[1], "txpower-lut")) {
+    if (argc < 3 || argc > 4 || (argc == 4 && strcmp(argv[3], "--interpolate"))) {
+      std::cerr << "Invalid txpower-lut command" << std::endl;
+      usage();
+      return -1;
+    }
+    proddata->WriteTxPowerLut(argv[2], argc == 4 ? TX_POWER_LUT_LINEAR : TX_POWER_LUT_BAND_STEP);
+  } else if (!strcmp(argv[1], "upgrade")) {
+    if (argc < 3 || argc % 2 == 0) {
+      std::cerr << "Specify register and a value for every new field" << std::endl;
+      usage();
+      return -1;
+    }
+    std::map<std::string, std::string> fields;
+    for (int i = 3; i < argc; i += 2) {
+      fields[argv[i]] = argv[i + 1];
+    }
+    int version = proddata->UpgradeLayout(argv[2], fields);
+    std::cout << "register " << argv[2] << " version " << std::dec << version << std::endl;
+  } else if (!strcmp(argv[1], "record")) {
+    if (argc > 2 && !strcmp(argv[2], "write") && argc == 5) {
+      proddata->WriteRecord(argv[3], argv[4]);
+    } else if (argc > 2 && !strcmp(argv[2], "read") && argc == 4) {
+      PrintData(proddata->ReadRecord(argv[3]));
+    } else if (argc > 2 && !strcmp(argv[2], "read") && argc == 3) {
+      for (const auto &record : proddata->ReadRecords()) {
+        std::cout << std::dec << record.first << " ";
+        PrintData(record.second);
+      }
+    } else {
+      std::cerr << "Invalid record command" << std::endl;
+      usage();
+      return -1;
+    }
+  } else {
+    std::cerr << "Invalid command" << std::endl;
+    usage();
+    return -1;
+  }
+  return 0;
+}
+
+/* longest command accepted by stream mode */
+static const uint32_t kMaxStreamRequest = 65536;
+
+static bool ReadFully(void *buf, size_t size) {
+  std::cin.read(static_cast<char *>(buf), size);
+  return static_cast<size_t>(std::cin.gcount()) == size;
+}
+
+/**
+ * @brief Read next stream request, a line or a length prefixed frame
+ *
+ * returns false at end of input
+ */
+static bool ReadStreamRequest(bool binary, std::string *request) {
+  if (!binary) {
+    return static_cast<bool>(std::getline(std::cin, *request));
+  }
+  uint8_t length[4];
+  if (!ReadFully(length, sizeof(length))) {
+    return false;
+  }
+  uint32_t size = (length[0] << 24) | (length[1] << 16) | (length[2] << 8) | length[3];
+  if (size > kMaxStreamRequest) {
+    LOG(ERROR) << "Stream request of " << size << " bytes too long";
+    throw std::runtime_error("Stream request too long");
+  }
+  request->resize(size);
+  if (!ReadFully(&(*request)[0], size)) {
+    LOG(ERROR) << "Truncated stream request";
+    throw std::runtime_error("Truncated stream request");
+  }
+  return true;
+}
+
+static void WriteStreamResponse(bool binary, bool ok, const std::string &text) {
+  if (binary) {
+    uint32_t size = text.size();
+    const char header[] = {static_cast<char>(ok ? 0 : 1), static_cast<char>(size >> 24),
+                           static_cast<char>(size >> 16), static_cast<char>(size >> 8),
+                           static_cast<char>(size)};
+    std::cout.write(header, sizeof(header));
+    std::cout.write(text.data(), text.size());
+  } else if (ok) {
+    std::cout << text << "OK" << std::endl;
+  } else {
+    std::cout << "ERROR " << text << std::endl;
+  }
+  std::cout.flush();
+}
+
+/**
+ * @brief Run device commands read from stdin until end of input or "quit"
+ *
+ * Requests are command lines as given to proddata, e.g "read DCXO", one per line or with
+ * binary, each prefixed by its length (4 bytes, big endian). A line response is the command
+ * output followed by "OK", or "ERROR <message>". A binary response is a status byte (0 ok,
+ * 1 error), the length of the text (4 bytes, big endian) and the output or error message.
+ *
+ * Each command holds the device lock, shared or exclusive as in a single invocation, only while
+ * it runs, so other proddata processes get the device between commands. Registers and
+ * records kept in memory are dropped when the lock is taken again.
+ *
+ * @param[in] proddata open device, kept for the whole stream
+ * @param[in] flash_access device of proddata
+ * @param[in] binary length prefixed requests and responses
+ * returns 0 at end of input
+ */
+static int StreamCommand(Proddata *proddata, FlashAccess *flash_access, bool binary) {
+  std::string request;
+  while (ReadStreamRequest(binary, &request)) {
+    std::vector<std::string> args;
+    std::istringstream words(request);
+    for (std::string word; words >> word;) {
+      args.push_back(word);
+    }
+    if (args.empty()) {
+      continue;
+    }
+    if (args[0] == "quit") {
+      break;
+    }
+
+    std::vector<char *> argv(1, const_cast<char *>("proddata"));
+    for (auto &arg : args) {
+      argv.push_back(&arg[0]);
+    }
+    argv.push_back(NULL);
+
+    /* output and usage errors of the command are collected for the response */
+    std::ostringstream output;
+    std::ostringstream errors;
+    std::streambuf *cout_buf = std::cout.rdbuf(output.rdbuf());
+    std::streambuf *cerr_buf = std::cerr.rdbuf(errors.rdbuf());
+    int ret;
+    std::string message;
+    try {
+      FlashAccess::Guard guard(flash_access, !ReadOnlyCommand(argv.size() - 1, argv.data()));
+      proddata->DropRegisterCache();
+      ret = DeviceCommand(proddata, argv.size() - 1, argv.data());
+      message = errors.str().substr(0, errors.str().find('\n'));
+    } catch (std::exception &e) {
+      ret = -1;
+      message = e.what();
+    }
+    std::cout.rdbuf(cout_buf);
+    std::cerr.rdbuf(cerr_buf);
+    WriteStreamResponse(binary, ret == 0, ret == 0 ? output.str() : message);
+  }
+  return 0;
+}
+
+/**
+ * @brief Writes the recorded trace events when main returns, if --trace was given
+ */
+class TraceWriter {
+ public:
+  ~TraceWriter() {
+    if (!path.empty() && trace::Tracer::WriteJson(path)) {
+      std::cerr << "Trace written to " << path << std::endl;
+    }
+  }
+
+  std::string path;
+};
+
 int main(int argc, char* argv[]) {
   google::InitGoogleLogging(argv[0]);
 
+  TraceWriter trace_writer;
+  const std::string trace_option = "--trace=";
+  const std::string device_option = "--device=";
+  const std::string write_log_option = "--write-log=";
+  const std::string write_log_delay_option = "--write-log-delay=";
+  const std::string mac_index_option = "--mac-index=";
+  const std::string spc_option = "--spc=";
+  const std::string station_option = "--station=";
+  while (argc > 1 && !strncmp(argv[1], "--", 2)) {
+    std::string option = argv[1];
+    if (!option.compare(0, device_option.size(), device_option)) {
+      device_path = argv[1] + device_option.size();
+    } else if (!option.compare(0, trace_option.size(), trace_option)) {
+      trace_writer.path = option.substr(trace_option.size());
+      trace::Tracer::Enable();
+    } else if (!option.compare(0, write_log_option.size(), write_log_option)) {
+      write_log = option.substr(write_log_option.size());
+    } else if (!option.compare(0, mac_index_option.size(), mac_index_option)) {
+      mac_index = option.substr(mac_index_option.size());
+    } else if (!option.compare(0, spc_option.size(), spc_option)) {
+      spc_state = argv[1] + spc_option.size();
+    } else if (!option.compare(0, station_option.size(), station_option)) {
+      spc_station = argv[1] + station_option.size();
+    } else if (!option.compare(0, write_log_delay_option.size(), write_log_delay_option)) {
+      try {
+        write_log_delay = ParseInt(option.substr(write_log_delay_option.size()));
+      } catch (std::runtime_error &e) {
+        return -1;
+      }
+    } else {
+      std::cerr << "Invalid option: " << option << std::endl;
+      usage();
+      return -1;
+    }
+    /* drop the option so the command is argv[1] again */
+    argv[1] = argv[0];
+    argv++;
+    argc--;
+  }
+
   if (argc < 2) {
     usage();
     return -1;
   }
 
   try {
-    // TODO(Sagar): Make FlashAccess implemetation and harcoded device name configurable
-    std::unique_ptr<FlashAccess> flash_access(new UserOTPAccess("/dev/mtd1"));
-    Proddata proddata(std::move(flash_access));
+    if (!strcmp(argv[1], "audit")) {
+      int ret = -1;
+      if (argc > 2) {
+        ret = AuditCommand(argc, argv);
+      } else {
+        std::cerr << "Specify directory or packfile of OTP dumps" << std::endl;
+        usage();
+      }
+      google::ShutdownGoogleLogging();
+      return ret;
+    }
 
-    if (!strcmp(argv[1], "write")) {
-      if (argv[2] == NULL) {
-        std::cerr << "Specify data to be written to OTP" << std::endl;
-        return -1;
-      } else if (argv[3] == NULL) {
-        proddata.Write(argv[2]);
+    if (!strcmp(argv[1], "validate")) {
+      int ret = -1;
+      if (argc > 2) {
+        ret = ValidateCommand(argc, argv);
+      } else {
+        std::cerr << "Specify manifest file" << std::endl;
+        usage();
+      }
+      google::ShutdownGoogleLogging();
+      return ret;
+    }
+
+    if (!strcmp(argv[1], "spc")) {
+      int ret = -1;
+      if (argc == 3) {
+        ret = SpcCommand(argc, argv);
       } else {
-        proddata.WriteField(argv[2], argv[3]);
+        std::cerr << "Specify SPC state file" << std::endl;
+        usage();
       }
-    } else if (!strcmp(argv[1], "read")) {
-      std::vector<uint8_t> data;
-      if (argv[2] == NULL) {
-        data = proddata.Read();
+      google::ShutdownGoogleLogging();
+      return ret;
+    }
+
+    if (!strcmp(argv[1], "log")) {
+      int ret = -1;
+      if (argc == 3 || argc == 4) {
+        ret = LogCommand(argc, argv);
       } else {
-        data = proddata.ReadField(argv[2]);
+        std::cerr << "Specify write log and optionally a serial number" << std::endl;
+        usage();
       }
-      PrintData(data);
-    } else {
-      std::cerr << "Invalid command" << std::endl;
-      usage();
-      return -1;
+      google::ShutdownGoogleLogging();
+      return ret;
+    }
+
+    if (!strcmp(argv[1], "pack")) {
+      int ret = -1;
+      if (argc >= 3) {
+        ret = PackCommand(argc, argv);
+      }
+      if (ret < 0) {
+        if (argc < 3) {
+          std::cerr << "Invalid pack command" << std::endl;
+        }
+        usage();
+      }
+      google::ShutdownGoogleLogging();
+      return ret;
+    }
+
+    if (!strcmp(argv[1], "mac-index")) {
+      int ret = -1;
+      if (argc == 5 && (!strcmp(argv[2], "load") || !strcmp(argv[2], "find"))) {
+        ret = MacIndexCommand(argc, argv);
+      } else {
+        std::cerr << "Invalid mac-index command" << std::endl;
+        usage();
+      }
+      google::ShutdownGoogleLogging();
+      return ret;
+    }
+
+    if (!strcmp(argv[1], "stats")) {
+      int ret = StatsCommand(argc, argv);
+      google::ShutdownGoogleLogging();
+      return ret;
+    }
+
+    if (!strcmp(argv[1], "cal")) {
+      int ret = -1;
+      if (argc > 2) {
+        ret = CalCommand(argc, argv);
+      } else {
+        std::cerr << "Invalid cal command" << std::endl;
+        usage();
+      }
+      google::ShutdownGoogleLogging();
+      return ret;
+    }
+
+    if (!strcmp(argv[1], "stream")) {
+      if (argc > 3 || (argc == 3 && strcmp(argv[2], "--binary"))) {
+        std::cerr << "Invalid stream command" << std::endl;
+        usage();
+        return -1;
+      }
+      std::unique_ptr<FlashAccess> device = OpenDevice();
+      FlashAccess *flash_access = device.get();
+      Proddata proddata(std::move(device));
+      proddata.EnableRegisterCache();
+      EnableWriteHooks(&proddata);
+      int ret = StreamCommand(&proddata, flash_access, argc == 3);
+      google::ShutdownGoogleLogging();
+      return ret;
+    }
+
+    /* read only commands do not need write access and only share the device lock */
+    Proddata proddata(OpenDevice(ReadOnlyCommand(argc, argv)));
+    if (!strcmp(argv[1], "write") || !strcmp(argv[1], "upgrade")) {
+      EnableWriteHooks(&proddata);
+    }
+
+    int ret = DeviceCommand(&proddata, argc, argv);
+    if (ret) {
+      return ret;
     }
   } catch (std::runtime_error &e) {
     google::ShutdownGoogleLogging();
@@ -0,0 +1,349 @@
+/**
+ * @file
+ * ManifestValidator class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "manifest_validator.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "device_data.h"
+#include "device_fields.h"
+#include "mapped_file.h"
+#include "parallel_for.h"
+
+/* manifest bytes per chunk, a chunk validates the lines starting in it */
+static const size_t kManifestChunk = 1 << 20;
+static const int kCRCSize = 2;
+static const int kVersionCount = 256;
+
+const size_t ManifestReport::kMaxProblems;
+
+ManifestReport::ManifestReport() : rows(0), invalid_rows(0), problem_count(0) {
+}
+
+size_t HexPrefixLength(const char *text, size_t size) {
+  size_t i = 0;
+#ifdef __SSE2__
+  /* characters >= 0x80 compare as negative and fail both ranges */
+  const __m128i digit_low = _mm_set1_epi8('0' - 1);
+  const __m128i digit_high = _mm_set1_epi8('9' + 1);
+  const __m128i alpha_low = _mm_set1_epi8('a' - 1);
+  const __m128i alpha_high = _mm_set1_epi8('f' + 1);
+  const __m128i lower_case = _mm_set1_epi8(0x20);
+  for (; i + 16 <= size; i += 16) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, digit_low), _mm_cmplt_epi8(c, digit_high));
+    __m128i lower = _mm_or_si128(c, lower_case);
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, alpha_low),
+                                  _mm_cmplt_epi8(lower, alpha_high));
+    int mask = _mm_movemask_epi8(_mm_or_si128(digit, alpha));
+    if (mask != 0xFFFF) {
+      return i + __builtin_ctz(~mask);
+    }
+  }
+#endif
+  for (; i < size; i++) {
+    char c = text[i];
+    if (!((c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f'))) {
+      break;
+    }
+  }
+  return i;
+}
+
+static int HexValue(char c) {
+  return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+/* byte of the payload, line is known to hold hex digits only */
+static uint8_t PayloadByte(const char *line, size_t index) {
+  return (HexValue(line[2 * index]) << 4) | HexValue(line[2 * index + 1]);
+}
+
+template <typename Field>
+static ManifestValidator::Rule RangeRule() {
+  static_assert(std::is_same<typename Field::value_type, int8_t>::value,
+                "range rules need a signed byte field");
+  return {Field::Name(), ManifestValidator::Rule::kRange, INT8_MIN, INT8_MAX};
+}
+
+template <typename Field>
+static ManifestValidator::Rule MacRule() {
+  static_assert(std::is_same<typename Field::value_type, fields::MacAddress>::value,
+                "MAC rules need a MAC address field");
+  return {Field::Name(), ManifestValidator::Rule::kMac, 0, 0};
+}
+
+ManifestValidator::ManifestValidator() : rules_{
+    RangeRule<fields::DCXO>(),
+    RangeRule<fields::PD_A1_B24>(), RangeRule<fields::PD_A1_B51>(),
+    RangeRule<fields::PD_A1_B52>(), RangeRule<fields::PD_A1_B53>(),
+    RangeRule<fields::PD_A1_B54>(), RangeRule<fields::PD_A2_B24>(),
+    RangeRule<fields::PD_A2_B51>(), RangeRule<fields::PD_A2_B52>(),
+    RangeRule<fields::PD_A2_B53>(), RangeRule<fields::PD_A2_B54>(),
+    MacRule<fields::MAC_0>(), MacRule<fields::MAC_1>(), MacRule<fields::MAC_2>(),
+    MacRule<fields::MAC_3>(), MacRule<fields::MAC_4>(), MacRule<fields::MAC_5>()} {
+}
+
+void ManifestValidator::SetRange(const std::string &field, int min, int max) {
+  if (min > max || min < INT8_MIN || max > INT8_MAX) {
+    LOG(ERROR) << "Invalid range of " << field << ": " << min << " to " << max;
+    throw std::runtime_error("Invalid range of " + field);
+  }
+  for (auto &rule : rules_) {
+    if (rule.kind == Rule::kRange && rule.field == field) {
+      rule.min = min;
+      rule.max = max;
+      return;
+    }
+  }
+  LOG(ERROR) << "No range constraint for field: " << field;
+  throw std::runtime_error("No range constraint for field: " + field);
+}
+
+void ManifestValidator::AddOui(const std::vector<uint8_t> &oui) {
+  if (oui.size() != 3) {
+    LOG(ERROR) << "Invalid OUI size: " << oui.size();
+    throw std::runtime_error("Invalid OUI");
+  }
+  ouis_.push_back((oui[0] << 16) | (oui[1] << 8) | oui[2]);
+}
+
+namespace {
+
+/* rule at the byte position of its field in the payload part of one register */
+struct PlacedRule {
+  const ManifestValidator::Rule *rule;
+  size_t position;
+};
+
+/* per register and version: payload bytes (0 for unknown versions) and rules of the layout */
+struct LayoutPlans {
+  size_t size[2][kVersionCount];
+  std::vector<PlacedRule> rules[2][kVersionCount];
+};
+
+void BuildPlans(const std::vector<ManifestValidator::Rule> &rules, LayoutPlans *plans) {
+  memset(plans->size, 0, sizeof(plans->size));
+  for (int reg = 0; reg < 2; reg++) {
+    for (const auto &version : DeviceLayouts::Layouts()[reg]) {
+      size_t size = 0;
+      for (const auto &field : version.second) {
+        size = size + field.second.size;
+      }
+      plans->size[reg][version.first] = size - kCRCSize;
+      for (const auto &rule : rules) {
+        const auto it = version.second.find(rule.field);
+        if (it != version.second.end()) {
+          size_t position = it->second.offset - fields::RegisterBase(reg) - kCRCSize;
+          plans->rules[reg][version.first].push_back({&rule, position});
+        }
+      }
+    }
+  }
+}
+
+void AddProblem(ManifestReport *report, uint64_t line, size_t column,
+                const std::string &message) {
+  report->problem_count++;
+  if (report->problems.size() < ManifestReport::kMaxProblems) {
+    report->problems.push_back({line, column, message});
+  }
+}
+
+std::string MacString(const uint8_t *mac) {
+  char text[18];
+  snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3],
+           mac[4], mac[5]);
+  return text;
+}
+
+/* check one payload of a register against the rules of its layout, returns problems found */
+int CheckRules(const std::vector<PlacedRule> &rules, const std::vector<uint32_t> &ouis,
+               const char *line, size_t base, uint64_t line_number, ManifestReport *report) {
+  int problems = 0;
+  for (const auto &placed : rules) {
+    const ManifestValidator::Rule &rule = *placed.rule;
+    size_t position = base + placed.position;
+    size_t column = 2 * position + 1;
+    if (rule.kind == ManifestValidator::Rule::kRange) {
+      int value = static_cast<int8_t>(PayloadByte(line, position));
+      if (value < rule.min || value > rule.max) {
+        AddProblem(report, line_number, column, rule.field + " " + std::to_string(value) +
+                   " outside " + std::to_string(rule.min) + " to " + std::to_string(rule.max));
+        problems++;
+      }
+      continue;
+    }
+
+    uint8_t mac[6];
+    bool zero = true;
+    for (int i = 0; i < 6; i++) {
+      mac[i] = PayloadByte(line, position + i);
+      zero = zero && mac[i] == 0;
+    }
+    std::string problem;
+    if (zero) {
+      problem = "is all zero";
+    } else if (mac[0] & 0x01) {
+      problem = "is not unicast";
+    } else if (!ouis.empty()) {
+      uint32_t oui = (mac[0] << 16) | (mac[1] << 8) | mac[2];
+      bool allowed = false;
+      for (uint32_t allowed_oui : ouis) {
+        allowed = allowed || allowed_oui == oui;
+      }
+      if (!allowed) {
+        problem = "has no allowed OUI";
+      }
+    }
+    if (!problem.empty()) {
+      AddProblem(report, line_number, column, rule.field + " " + MacString(mac) + " " + problem);
+      problems++;
+    }
+  }
+  return problems;
+}
+
+/* validate one payload line (without line end), returns number of problems found */
+int CheckLine(const LayoutPlans &plans, const std::vector<uint32_t> &ouis, const char *line,
+              size_t length, uint64_t line_number, ManifestReport *report) {
+  size_t hex = HexPrefixLength(line, length);
+  if (hex != length) {
+    char c = line[hex];
+    char shown[8];
+    if (c >= 0x20 && c < 0x7f) {
+      snprintf(shown, sizeof(shown), "'%c'", c);
+    } else {
+      snprintf(shown, sizeof(shown), "0x%02X", static_cast<uint8_t>(c));
+    }
+    AddProblem(report, line_number, hex + 1, std::string("invalid hex digit ") + shown);
+    return 1;
+  }
+  if (length % 2 != 0) {
+    AddProblem(report, line_number, 0,
+               "odd number of hex digits (" + std::to_string(length) + ")");
+    return 1;
+  }
+
+  /* same version and size checks as DeviceData::ReadVersionFromData and ParseData */
+  size_t size = length / 2;
+  int version0 = PayloadByte(line, 0);
+  size_t size0 = plans.size[0][version0];
+  if (size0 == 0) {
+    AddProblem(report, line_number, 1, "unknown VERSION_REG0 " + std::to_string(version0));
+    return 1;
+  }
+  if (size <= size0) {
+    AddProblem(report, line_number, 0, "size " + std::to_string(size) +
+               " bytes, no register 1 data after " + std::to_string(size0) +
+               " bytes of VERSION_REG0 " + std::to_string(version0));
+    return 1;
+  }
+  int version1 = PayloadByte(line, size0);
+  size_t size1 = plans.size[1][version1];
+  if (size1 == 0) {
+    AddProblem(report, line_number, 2 * size0 + 1,
+               "unknown VERSION_REG1 " + std::to_string(version1));
+    return 1;
+  }
+  if (size != size0 + size1) {
+    AddProblem(report, line_number, 0, "size " + std::to_string(size) + " bytes, expected " +
+               std::to_string(size0 + size1) + " for VERSION_REG0 " +
+               std::to_string(version0) + " and VERSION_REG1 " + std::to_string(version1));
+    return 1;
+  }
+
+  return CheckRules(plans.rules[0][version0], ouis, line, 0, line_number, report) +
+         CheckRules(plans.rules[1][version1], ouis, line, size0, line_number, report);
+}
+
+}  // namespace
+
+ManifestReport ManifestValidator::Validate(const char *data, size_t size, int threads) const {
+  if (threads <= 0) {
+    threads = DefaultThreads();
+  }
+  std::unique_ptr<LayoutPlans> plans(new LayoutPlans);
+  BuildPlans(rules_, plans.get());
+
+  size_t chunks = (size + kManifestChunk - 1) / kManifestChunk;
+  std::vector<ManifestReport> reports(chunks);
+  /* lines starting in each chunk, to turn chunk line numbers into file line numbers */
+  std::vector<uint64_t> lines(chunks, 0);
+
+  ParallelFor(chunks, threads, 1, [&](int worker, size_t begin, size_t end) {
+    for (size_t chunk = begin; chunk < end; chunk++) {
+      ManifestReport *report = &reports[chunk];
+      size_t chunk_end = std::min(size, (chunk + 1) * kManifestChunk);
+      const char *line = data + chunk * kManifestChunk;
+      if (chunk > 0) {
+        /* the line running into this chunk belongs to the previous one */
+        const char *newline = static_cast<const char *>(
+            memchr(line - 1, '\n', data + size - (line - 1)));
+        line = newline ? newline + 1 : data + size;
+      }
+      while (line < data + chunk_end) {
+        const char *newline = static_cast<const char *>(memchr(line, '\n', data + size - line));
+        const char *line_end = newline ? newline : data + size;
+        uint64_t line_number = ++lines[chunk];
+        size_t length = line_end - line;
+        if (length && line[length - 1] == '\r') {
+          length--;
+        }
+        if (length && line[0] != '#') {
+          report->rows++;
+          if (CheckLine(*plans, ouis_, line, length, line_number, report)) {
+            report->invalid_rows++;
+          }
+        }
+        line = newline ? newline + 1 : data + size;
+      }
+    }
+  });
+
+  ManifestReport total;
+  uint64_t line_offset = 0;
+  for (size_t chunk = 0; chunk < chunks; chunk++) {
+    const ManifestReport &report = reports[chunk];
+    total.rows += report.rows;
+    total.invalid_rows += report.invalid_rows;
+    total.problem_count += report.problem_count;
+    for (const auto &problem : report.problems) {
+      if (total.problems.size() >= ManifestReport::kMaxProblems) {
+        break;
+      }
+      total.problems.push_back({problem.line + line_offset, problem.column, problem.message});
+    }
+    line_offset += lines[chunk];
+  }
+  return total;
+}
+
+ManifestReport ManifestValidator::ValidateFile(const std::string &path, int threads) const {
+  MappedFile manifest(path);
+  return Validate(reinterpret_cast<const char *>(manifest.Data()), manifest.Size(), threads);
+}
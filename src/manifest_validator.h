@@ -0,0 +1,138 @@
+/**
+ * @file
+ * ManifestValidator class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef MANIFESTVALIDATOR_H_
+#define MANIFESTVALIDATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Problem found in a manifest, located by line and column
+ */
+struct ManifestProblem {
+  /** line number, counting from 1 */
+  uint64_t line;
+  /** column of the offending hex digit counting from 1, 0 if the whole line is concerned */
+  size_t column;
+  std::string message;
+};
+
+/**
+ * @brief Result of validating a manifest
+ */
+struct ManifestReport {
+  static const size_t kMaxProblems = 100;
+
+  ManifestReport();
+
+  /** payload lines, i.e lines other than blank lines and '#' comments */
+  uint64_t rows;
+  /** payload lines with at least one problem */
+  uint64_t invalid_rows;
+  /** first problems in file order */
+  std::vector<ManifestProblem> problems;
+  /** total number of problems, including those not kept */
+  uint64_t problem_count;
+};
+
+/**
+ * @brief Check provisioning manifests without touching a device
+ *
+ * A manifest holds one "proddata write <data>" payload per line: register 0 data followed by
+ * register 1 data, without CRCs, as hex digits. Every line is checked as Write would check it
+ * (hex digits, even length, known VERSION_REG0/VERSION_REG1 and the data size of their layouts)
+ * and then against per-field constraints: value ranges of the signed register 1 fields and
+ * unicast/OUI rules of the MAC addresses. Constraints are declared on the field descriptors of
+ * device_fields.h and apply to every layout version containing the field.
+ *
+ * Large manifests are memory mapped and validated in chunks on worker threads.
+ */
+class ManifestValidator {
+ public:
+  /**
+   * @brief Constructor, DCXO and PD offsets may take any value, MACs must be unicast
+   */
+  ManifestValidator();
+
+  /**
+   * @brief Limit the values of a signed field
+   *
+   * @param[in] field field name, e.g DCXO
+   * @param[in] min smallest allowed value
+   * @param[in] max largest allowed value
+   */
+  void SetRange(const std::string &field, int min, int max);
+
+  /**
+   * @brief Allow an OUI, once any is added MAC addresses must start with one of them
+   *
+   * @param[in] oui first 3 octets of the MAC addresses
+   */
+  void AddOui(const std::vector<uint8_t> &oui);
+
+  /**
+   * @brief Validate manifest held in memory
+   *
+   * @param[in] data manifest text
+   * @param[in] size size of manifest
+   * @param[in] threads number of worker threads, 0 for one per core
+   * returns report, problems in file order
+   */
+  ManifestReport Validate(const char *data, size_t size, int threads) const;
+
+  /**
+   * @brief Validate manifest file
+   *
+   * @param[in] path manifest file
+   * @param[in] threads number of worker threads, 0 for one per core
+   */
+  ManifestReport ValidateFile(const std::string &path, int threads) const;
+
+  /**
+   * @brief Constraint of one field
+   */
+  struct Rule {
+    enum Kind {
+      kRange,
+      kMac,
+    };
+    std::string field;
+    Kind kind;
+    int min;
+    int max;
+  };
+
+ private:
+  std::vector<Rule> rules_;
+  std::vector<uint32_t> ouis_;
+};
+
+/**
+ * @brief Length of the leading run of hex digits (0-9, a-f, A-F), 16 characters at a time
+ *        with SSE2 where available
+ *
+ * @param[in] text characters
+ * @param[in] size number of characters
+ * returns index of the first character that is not a hex digit, size if all are
+ */
+size_t HexPrefixLength(const char *text, size_t size);
+
+#endif  // MANIFESTVALIDATOR_H_
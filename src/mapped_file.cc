@@ -0,0 +1,59 @@
+/**
+ * @file
+ * MappedFile class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "mapped_file.h"
+#include <glog/logging.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <stdexcept>
+
+MappedFile::MappedFile(const std::string &path) : data_(NULL), size_(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Can't open " << path << ": " << strerror(errno);
+    throw std::runtime_error("Can't open file: " + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    LOG(ERROR) << "fstat failed: " << strerror(errno);
+    close(fd);
+    throw std::runtime_error("Can't open file: " + path);
+  }
+  size_ = st.st_size;
+  if (size_ > 0) {
+    void *data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      LOG(ERROR) << "mmap failed: " << strerror(errno);
+      close(fd);
+      throw std::runtime_error("Can't map file: " + path);
+    }
+    /* input is scanned front to back once */
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const uint8_t *>(data);
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(const_cast<uint8_t *>(data_), size_);
+  }
+}
@@ -0,0 +1,57 @@
+/**
+ * @file
+ * MappedFile class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Read-only memory mapping of a complete file
+ */
+class MappedFile {
+ public:
+  /**
+   * @brief Constructor, maps the file
+   *
+   * @param[in] path file to map
+   */
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /**
+   * @brief Start of mapped file, NULL for an empty file
+   */
+  const uint8_t *Data() const { return data_; }
+
+  /**
+   * @brief Size of mapped file
+   */
+  size_t Size() const { return size_; }
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+};
+
+#endif  // MAPPEDFILE_H_
@@ -0,0 +1,106 @@
+/**
+ * @file
+ * In-memory device backend
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef MEMORYACCESS_H_
+#define MEMORYACCESS_H_
+
+#include <glog/logging.h>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Device backend over a caller owned buffer, e.g. a mapped OTP image
+ *
+ * Provides the FlashAccess operations without virtual functions, for use as
+ * BasicDeviceData<MemoryAccess>. The buffer is not locked, callers sharing it between threads
+ * serialise access themselves.
+ */
+class MemoryAccess final {
+ public:
+  /**
+   * @brief Constructor for a writable buffer
+   *
+   * @param[in] data buffer, not owned, must outlive this MemoryAccess
+   * @param[in] size size of buffer
+   * @param[in] serial serial number returned by ReadSerial
+   */
+  MemoryAccess(uint8_t *data, int size, const std::vector<uint8_t> &serial = {})
+      : data_(data), read_only_(false), size_(size), serial_(serial) {}
+
+  /**
+   * @brief Constructor for a read only buffer, Write throws
+   *
+   * @param[in] data buffer, not owned, must outlive this MemoryAccess
+   * @param[in] size size of buffer
+   * @param[in] serial serial number returned by ReadSerial
+   */
+  MemoryAccess(const uint8_t *data, int size, const std::vector<uint8_t> &serial = {})
+      : data_(const_cast<uint8_t *>(data)), read_only_(true), size_(size), serial_(serial) {}
+
+  void Lock(bool exclusive) {}
+  void Unlock() {}
+
+  void Write(const std::vector<uint8_t> &buf, const int offset) {
+    if (read_only_) {
+      LOG(ERROR) << "Write to read only memory";
+      throw std::runtime_error("Device opened read only");
+    }
+    CheckRange(buf.size(), offset);
+    memcpy(data_ + offset, buf.data(), buf.size());
+  }
+
+  std::vector<uint8_t> Read(const int size, const int offset) {
+    CheckRange(size, offset);
+    return std::vector<uint8_t>(data_ + offset, data_ + offset + size);
+  }
+
+  void ReadInto(uint8_t *buf, const int size, const int offset) {
+    CheckRange(size, offset);
+    memcpy(buf, data_ + offset, size);
+  }
+
+  std::vector<uint8_t> ReadSerial() {
+    return serial_;
+  }
+
+  bool ClearOnlyProgramming() const {
+    return false;
+  }
+
+  bool Locked(const int size, const int offset) {
+    return false;
+  }
+
+ private:
+  void CheckRange(int size, int offset) const {
+    if (offset < 0 || size < 0 || offset > size_ - size) {
+      LOG(ERROR) << "Access of " << size << " bytes at " << offset << " outside of "
+                 << size_ << " byte buffer";
+      throw std::runtime_error("Access outside of device");
+    }
+  }
+
+  uint8_t *data_;
+  const bool read_only_;
+  const int size_;
+  const std::vector<uint8_t> serial_;
+};
+
+#endif  // MEMORYACCESS_H_
@@ -21,9 +21,11 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <stdexcept>
+#include "trace.h"
 #include "vector_operations.h"
 
-MTDAccess::MTDAccess(const std::string &device_name) : FlashAccess(device_name) {
+MTDAccess::MTDAccess(const std::string &device_name, bool read_only)
+    : FlashAccess(device_name, read_only) {
   DLOG(INFO) << "Initialising MTDAccess";
   if (ioctl(fd_, MEMGETINFO, &mtd_info_) < 0) {
     DLOG(ERROR) << "ioctl failed and returned error: " << strerror(errno);
@@ -37,6 +39,9 @@ MTDAccess::~MTDAccess() {
 }
 
 void MTDAccess::Write(const std::vector<uint8_t> &buf, const int offset) {
+  SelectNormalMode();
+  trace::Scope scope("write", "flash");
+  scope.Arg("size", buf.size()).Arg("offset", offset);
   int sector_size = mtd_info_.erasesize;
 
   /* read sector (note : it is assumed that all the device data will be on 1st sector) */
@@ -46,9 +51,13 @@ void MTDAccess::Write(const std::vector<uint8_t> &buf, const int offset) {
   erase_info_t ei;
   ei.length = mtd_info_.erasesize;
   ei.start = 0;
-  if (ioctl(fd_, MEMERASE, &ei) < 0) {
-    DLOG(ERROR) << "ioctl failed and returned error: " << strerror(errno);
-    throw std::runtime_error("mtd write: ioctl failed");
+  {
+    trace::Scope erase_scope("erase", "flash");
+    erase_scope.Arg("size", ei.length);
+    if (ioctl(fd_, MEMERASE, &ei) < 0) {
+      DLOG(ERROR) << "ioctl failed and returned error: " << strerror(errno);
+      throw std::runtime_error("mtd write: ioctl failed");
+    }
   }
   /* modify sector */
   vector_operations::replace(&read_buf, buf, offset);
@@ -66,7 +75,19 @@ void MTDAccess::Write(const std::vector<uint8_t> &buf, const int offset) {
   }
 }
 
+bool MTDAccess::ClearOnlyProgramming() const {
+  /* sector is erased before it is written */
+  return false;
+}
+
+bool MTDAccess::Locked(const int size, const int offset) {
+  return false;
+}
+
 std::vector<uint8_t> MTDAccess::Read(const int size, const int offset) {
+  SelectNormalMode();
+  trace::Scope scope("read", "flash");
+  scope.Arg("size", size).Arg("offset", offset);
   std::vector<uint8_t> buf(size);
   if (lseek(fd_, offset, SEEK_SET) < 0) {
     DLOG(ERROR) << "mtd read: lseek failed:" << strerror(errno);
@@ -81,3 +102,12 @@ std::vector<uint8_t> MTDAccess::Read(const int size, const int offset) {
   return buf;
 }
 
+void MTDAccess::SelectNormalMode() {
+  /* ReadSerial leaves the file in factory OTP mode, the partition itself is the normal one */
+  trace::Scope scope("otpselect", "flash");
+  scope.Arg("mode", MTD_FILE_MODE_NORMAL);
+  if (ioctl(fd_, MTDFILEMODE, MTD_FILE_MODE_NORMAL) < 0) {
+    DLOG(ERROR) << "ioctl failed and returned error: " << strerror(errno);
+    throw std::runtime_error("MTDAccess: ioctl failed");
+  }
+}
@@ -35,14 +35,21 @@ class MTDAccess final: public FlashAccess {
    * Creates an instance of MTDAccess
    *
    */
-  explicit MTDAccess(const std::string &device_name);
+  explicit MTDAccess(const std::string &device_name, bool read_only = false);
   ~MTDAccess();
 
   void Write(const std::vector<uint8_t> &buf, const int offset);
   std::vector<uint8_t> Read(const int size, const int offset);
+  bool ClearOnlyProgramming() const;
+  bool Locked(const int size, const int offset);
 
  private:
   mtd_info_t mtd_info_;
+
+  /**
+   * @brief Switch the open file back to the partition data, e.g after ReadSerial
+   */
+  void SelectNormalMode();
 };
 
 #endif  // MTDACCESS_H_
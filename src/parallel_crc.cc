@@ -0,0 +1,47 @@
+/**
+ * @file
+ * CRC-16 of large buffers on worker threads
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "parallel_crc.h"
+#include <algorithm>
+#include <vector>
+#include "crc16_ops.h"
+#include "parallel_for.h"
+
+static const size_t kCrcBlock = 1 << 20;
+
+uint16_t ParallelCrc16(const uint8_t *data, size_t size, int threads) {
+  size_t blocks = (size + kCrcBlock - 1) / kCrcBlock;
+  if (blocks < 2 || threads == 1) {
+    return crc16_block(0, data, size);
+  }
+
+  std::vector<uint16_t> crcs(blocks);
+  ParallelFor(blocks, threads, 1, [&](int worker, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      size_t offset = i * kCrcBlock;
+      crcs[i] = crc16_block(0, data + offset, std::min(kCrcBlock, size - offset));
+    }
+  });
+
+  uint16_t crc = crcs[0];
+  for (size_t i = 1; i < blocks; i++) {
+    size_t offset = i * kCrcBlock;
+    crc = crc16_combine(crc, crcs[i], std::min(kCrcBlock, size - offset));
+  }
+  return crc;
+}
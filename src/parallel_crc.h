@@ -0,0 +1,39 @@
+/**
+ * @file
+ * CRC-16 of large buffers on worker threads
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef PARALLELCRC_H_
+#define PARALLELCRC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief CRC-16 (as update_crc_16, initial value 0) of a large buffer
+ *
+ * The buffer is split into blocks whose CRCs are computed by ParallelFor workers and joined with
+ * crc16_combine, the result equals the sequential CRC. Small buffers are done on the calling
+ * thread.
+ *
+ * @param[in] data data
+ * @param[in] size number of bytes
+ * @param[in] threads number of worker threads, 0 for one per core
+ * returns CRC of data
+ */
+uint16_t ParallelCrc16(const uint8_t *data, size_t size, int threads);
+
+#endif  // PARALLELCRC_H_
@@ -0,0 +1,124 @@
+/**
+ * @file
+ * Work stealing parallel loop
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "parallel_for.h"
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/* range of items still owned by a worker, front is taken by the owner, back by thieves */
+struct WorkRange {
+  std::mutex mutex;
+  size_t begin;
+  size_t end;
+};
+
+bool TakeOwn(WorkRange *range, size_t chunk, size_t *begin, size_t *end) {
+  std::lock_guard<std::mutex> lock(range->mutex);
+  if (range->begin == range->end) {
+    return false;
+  }
+  *begin = range->begin;
+  *end = std::min(range->end, range->begin + chunk);
+  range->begin = *end;
+  return true;
+}
+
+bool Steal(WorkRange *range, size_t *begin, size_t *end) {
+  std::lock_guard<std::mutex> lock(range->mutex);
+  size_t left = range->end - range->begin;
+  if (left == 0) {
+    return false;
+  }
+  *end = range->end;
+  *begin = range->end - (left + 1) / 2;
+  range->end = *begin;
+  return true;
+}
+
+}  // namespace
+
+int DefaultThreads() {
+  int threads = std::thread::hardware_concurrency();
+  return threads > 0 ? threads : 1;
+}
+
+void ParallelFor(size_t count, int threads, size_t chunk,
+                 const std::function<void(int worker, size_t begin, size_t end)> &body) {
+  if (threads <= 0) {
+    threads = DefaultThreads();
+  }
+  chunk = std::max<size_t>(chunk, 1);
+  threads = std::max(1, static_cast<int>(std::min<size_t>(threads, (count + chunk - 1) / chunk)));
+
+  std::unique_ptr<WorkRange[]> ranges(new WorkRange[threads]);
+  for (int i = 0; i < threads; i++) {
+    ranges[i].begin = count * i / threads;
+    ranges[i].end = count * (i + 1) / threads;
+  }
+
+  std::mutex error_mutex;
+  std::exception_ptr error;
+  auto worker = [&](int id) {
+    try {
+      size_t begin, end;
+      while (true) {
+        if (TakeOwn(&ranges[id], chunk, &begin, &end)) {
+          body(id, begin, end);
+          continue;
+        }
+        /* own range is empty, steal into it from the first worker with work left */
+        bool stolen = false;
+        for (int i = 1; i < threads && !stolen; i++) {
+          WorkRange *victim = &ranges[(id + i) % threads];
+          if (Steal(victim, &begin, &end)) {
+            std::lock_guard<std::mutex> lock(ranges[id].mutex);
+            ranges[id].begin = begin;
+            ranges[id].end = end;
+            stolen = true;
+          }
+        }
+        if (!stolen) {
+          return;
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int i = 1; i < threads; i++) {
+    pool.push_back(std::thread(worker, i));
+  }
+  worker(0);
+  for (auto &thread : pool) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
@@ -0,0 +1,45 @@
+/**
+ * @file
+ * Work stealing parallel loop
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef PARALLELFOR_H_
+#define PARALLELFOR_H_
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * @brief Run body over [0, count) on worker threads with work stealing
+ *
+ * The index range is split evenly between the workers. A worker takes chunks from the front of
+ * its own range and, once it is empty, steals half of the remaining range of another worker, so
+ * uneven item costs (e.g. cold files) do not leave cores idle.
+ *
+ * @param[in] count number of items
+ * @param[in] threads number of worker threads, 0 for one per core
+ * @param[in] chunk number of items a worker takes from its own range at a time
+ * @param[in] body called with worker number and item range [begin, end)
+ */
+void ParallelFor(size_t count, int threads, size_t chunk,
+                 const std::function<void(int worker, size_t begin, size_t end)> &body);
+
+/**
+ * @brief Number of worker threads ParallelFor uses for threads == 0
+ */
+int DefaultThreads();
+
+#endif  // PARALLELFOR_H_
@@ -18,8 +18,13 @@
 
 #include "proddata.h"
 #include <glog/logging.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
 #include "device_data.h"
+#include "driver_params.h"
 #include "flash_access.h"
+#include "tx_power_lut.h"
 
 /**
  * Format string containing hexadecimal symbols
@@ -40,6 +45,21 @@ std::vector<uint8_t> FormatString(const std::string &data) {
   return buf;
 }
 
+static uint32_t ParseRecordKey(const std::string &key) {
+  size_t end = 0;
+  unsigned long value = 0;  // NOLINT(runtime/int)
+  try {
+    value = std::stoul(key, &end, 10);
+  } catch (std::logic_error &e) {
+    end = 0;
+  }
+  if (end == 0 || end != key.size() || value > UINT32_MAX) {
+    LOG(ERROR) << "Invalid record key: " << key;
+    throw std::runtime_error("Invalid record key: " + key);
+  }
+  return value;
+}
+
 Proddata::Proddata(std::unique_ptr<FlashAccess> flash_access) {
   DLOG(INFO) << "Initialising Proddata";
   device_data_ = std::unique_ptr<DeviceData>(new DeviceData(std::move(flash_access)));
@@ -49,6 +69,41 @@ Proddata::~Proddata() {
   LOG(INFO) << "Deinitialising Proddata";
 }
 
+void Proddata::EnableWriteLog(const std::string &path, int max_delay_ms) {
+  if (write_log_) {
+    LOG(ERROR) << "Write log already enabled";
+    throw std::runtime_error("Write log already enabled");
+  }
+  write_log_.reset(new WriteLog(path, device_data_->ReadField("SERIAL"), max_delay_ms));
+  device_data_->AddWriteHook(write_log_.get());
+}
+
+void Proddata::EnableMacIndex(const std::string &path) {
+  if (mac_index_) {
+    LOG(ERROR) << "MAC index already enabled";
+    throw std::runtime_error("MAC index already enabled");
+  }
+  mac_index_.reset(new MacIndex(path, device_data_->ReadField("SERIAL")));
+  device_data_->AddWriteHook(mac_index_.get());
+}
+
+void Proddata::EnableSpc(const std::string &path, const std::string &station) {
+  if (spc_monitor_) {
+    LOG(ERROR) << "SPC already enabled";
+    throw std::runtime_error("SPC already enabled");
+  }
+  spc_monitor_.reset(new SpcMonitor(path, station));
+  device_data_->AddWriteHook(spc_monitor_.get());
+}
+
+void Proddata::EnableRegisterCache() {
+  device_data_->EnableRegisterCache();
+}
+
+void Proddata::DropRegisterCache() {
+  device_data_->DropRegisterCache();
+}
+
 void Proddata::Write(const std::string &data) {
   LOG(INFO) << "Writing reg0 data and reg1 data";
   if (data.size() % 2 != 0) {
@@ -69,6 +124,36 @@ void Proddata::WriteField(const std::string &name, const std::string &data) {
   device_data_->WriteField(name, buf);
 }
 
+void Proddata::WriteFields(const std::map<std::string, std::string> &fields) {
+  std::map<std::string, std::vector<uint8_t>> values;
+  for (const auto &field : fields) {
+    if (field.second.size() % 2 != 0) {
+      LOG(ERROR) << "Invalid data given";
+      throw std::runtime_error("Invalid data given");
+    }
+    values[field.first] = FormatString(field.second);
+  }
+  device_data_->WriteFields(values);
+}
+
+int Proddata::UpgradeLayout(const std::string &register_number,
+                            const std::map<std::string, std::string> &fields) {
+  if (register_number != "0" && register_number != "1") {
+    LOG(ERROR) << "Invalid register: " << register_number;
+    throw std::runtime_error("Invalid register: " + register_number);
+  }
+  std::map<std::string, std::vector<uint8_t>> values;
+  for (const auto &field : fields) {
+    if (field.second.size() % 2 != 0) {
+      LOG(ERROR) << "Invalid data given";
+      throw std::runtime_error("Invalid data given");
+    }
+    values[field.first] = FormatString(field.second);
+  }
+  LOG(INFO) << "Upgrading layout of register " << register_number;
+  return device_data_->UpgradeLayout(std::stoi(register_number), values);
+}
+
 std::vector<uint8_t> Proddata::Read() {
   DLOG(INFO) << "Reading reg0 data and reg1 data";
   return device_data_->Read();
@@ -78,3 +163,63 @@ std::vector<uint8_t> Proddata::ReadField(const std::string &name) {
   DLOG(INFO) << "Reading data";
   return device_data_->ReadField(name);
 }
+
+ExportRecord Proddata::Export() {
+  static_assert(DeviceData::kImageRegisters * fields::kRegisterSize == ExportPack::kImageSize,
+                "export image must hold every register");
+  DLOG(INFO) << "Exporting data";
+  ExportRecord record;
+  record.serial = device_data_->ReadField("SERIAL");
+  record.image.resize(ExportPack::kImageSize);
+  record.locked = device_data_->ReadImage(record.image.data());
+  record.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  return record;
+}
+
+void Proddata::WriteRecord(const std::string &key, const std::string &data) {
+  if (data.size() % 2 != 0) {
+    LOG(ERROR) << "Invalid data given";
+    throw std::runtime_error("Invalid data given");
+  }
+  std::vector<uint8_t> buf = FormatString(data);
+  device_data_->WriteRecord(ParseRecordKey(key), buf);
+}
+
+std::vector<uint8_t> Proddata::ReadRecord(const std::string &key) {
+  DLOG(INFO) << "Reading record";
+  return device_data_->ReadRecord(ParseRecordKey(key));
+}
+
+std::map<uint32_t, std::vector<uint8_t>> Proddata::ReadRecords() {
+  DLOG(INFO) << "Reading all records";
+  std::map<uint32_t, std::vector<uint8_t>> records;
+  device_data_->ForEachRecord([&records](uint32_t key, const std::vector<uint8_t> &value) {
+    records[key] = value;
+  });
+  return records;
+}
+
+void Proddata::RunCalSweep(CalOrchestrator *orchestrator) {
+  LOG(INFO) << "Running calibration sweep of " << orchestrator->Sweep().Steps().size()
+            << (orchestrator->Concurrent() ? " concurrent steps" : " steps");
+  orchestrator->Run();
+  orchestrator->Commit(device_data_.get());
+}
+
+void Proddata::RunDcxoCal(DcxoCalibrator *calibrator) {
+  LOG(INFO) << "Running DCXO calibration";
+  calibrator->Search();
+  calibrator->Commit(device_data_.get());
+}
+
+std::string Proddata::ApplyCal(const std::string &path) {
+  std::string params = FormatDriverParams(device_data_->ReadRegisterFields(1));
+  WriteDriverParams(path, params);
+  return params;
+}
+
+void Proddata::WriteTxPowerLut(const std::string &path, int interpolation) {
+  TxPowerLut lut(device_data_->ReadRegisterFields(1), interpolation);
+  ::WriteTxPowerLut(path, lut.Serialize());
+}
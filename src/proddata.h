@@ -19,9 +19,26 @@
 #ifndef PRODDATA_H_
 #define PRODDATA_H_
 
+#include <map>
 #include <string>
 #include <vector>
+#include "cal_backend.h"
+#include "cal_orchestrator.h"
+#include "cal_sweep.h"
+#include "dcxo_cal.h"
 #include "device_data.h"
+#include "export_pack.h"
+#include "mac_index.h"
+#include "spc_monitor.h"
+#include "write_log.h"
+
+/**
+ * @brief Convert string of hexadecimal symbols (0-9 A-F) to raw data
+ *
+ * @param[in] data hex string
+ * returns vector containing raw data
+ */
+std::vector<uint8_t> FormatString(const std::string &data);
 
 /**
  * @brief Class to perform read/write of production data.
@@ -38,6 +55,45 @@ class Proddata {
   explicit Proddata(std::unique_ptr<FlashAccess> flash_access);
   ~Proddata();
 
+  /**
+   * @brief Log every following register write of this board to a write log
+   *
+   * Reads the serial number of the board once.
+   *
+   * @param[in] path write log file, shared with other proddata processes
+   * @param[in] max_delay_ms longest wait for other writers before syncing the log
+   */
+  void EnableWriteLog(const std::string &path, int max_delay_ms);
+
+  /**
+   * @brief Check MAC addresses of every following write against a MAC index
+   *
+   * Reads the serial number of the board once. A write giving this board a MAC address of
+   * another board fails before anything is programmed.
+   *
+   * @param[in] path MAC index file, shared with other proddata processes
+   */
+  void EnableMacIndex(const std::string &path);
+
+  /**
+   * @brief Chart every following write of register 1 calibration values, see SpcMonitor
+   *
+   * @param[in] path SPC state file, shared with other proddata processes
+   * @param[in] station name of this station
+   */
+  void EnableSpc(const std::string &path, const std::string &station);
+
+  /**
+   * @brief Keep registers 0 and 1 in memory between operations, see
+   *        DeviceData::EnableRegisterCache
+   */
+  void EnableRegisterCache();
+
+  /**
+   * @brief Forget registers and records kept in memory, see DeviceData::DropRegisterCache
+   */
+  void DropRegisterCache();
+
   /**
    * @brief Write production data
    *
@@ -52,6 +108,23 @@ class Proddata {
    */
   void WriteField(const std::string &name, const std::string &data);
 
+  /**
+   * @brief Write several data fields, each register is programmed once
+   *
+   * @param[in] fields map of field name to field value
+   */
+  void WriteFields(const std::map<std::string, std::string> &fields);
+
+  /**
+   * @brief Upgrade register layout to the next version in place
+   *
+   * @param[in] register_number register number, "0" or "1"
+   * @param[in] fields map of new field name to field value
+   * returns new register version
+   */
+  int UpgradeLayout(const std::string &register_number,
+                    const std::map<std::string, std::string> &fields);
+
   /**
    * @brief Read production data
    *
@@ -67,8 +140,74 @@ class Proddata {
    */
   std::vector<uint8_t> ReadField(const std::string& name);
 
+  /**
+   * @brief Snapshot of the board for fleet collection, see ExportPack
+   *
+   * returns serial number, raw registers 0 to 2 with their CRCs, OTP lock state and time
+   */
+  ExportRecord Export();
+
+  /**
+   * @brief Write record to the key/value store in register 2
+   *
+   * @param[in] key decimal record key
+   * @param[in] data record value
+   */
+  void WriteRecord(const std::string &key, const std::string &data);
+
+  /**
+   * @brief Read record from the key/value store in register 2
+   *
+   * @param[in] key decimal record key
+   * returns vector containing record value
+   */
+  std::vector<uint8_t> ReadRecord(const std::string &key);
+
+  /**
+   * @brief Read all records from the key/value store in register 2
+   *
+   * returns map of record key to value
+   */
+  std::map<uint32_t, std::vector<uint8_t>> ReadRecords();
+
+  /**
+   * @brief Run calibration sweep and write resulting power detector offsets to OTP
+   *
+   * @param[in] orchestrator calibration sweep to run, on one or several measurement paths
+   */
+  void RunCalSweep(CalOrchestrator *orchestrator);
+
+  /**
+   * @brief Search DCXO value and write it to OTP
+   *
+   * @param[in] calibrator DCXO calibrator to run
+   */
+  void RunDcxoCal(DcxoCalibrator *calibrator);
+
+  /**
+   * @brief Push calibration values of register 1 to the WiFi driver
+   *
+   * Register 1 is read once and every field of its layout is written to the driver in one
+   * batch, see FormatDriverParams().
+   *
+   * @param[in] path driver parameter file
+   * returns parameter text written
+   */
+  std::string ApplyCal(const std::string &path);
+
+  /**
+   * @brief Write per-channel TX power lookup table built from register 1 to a file
+   *
+   * @param[in] path blob file, see tx_power_lut_reader.h
+   * @param[in] interpolation TX_POWER_LUT_BAND_STEP or TX_POWER_LUT_LINEAR
+   */
+  void WriteTxPowerLut(const std::string &path, int interpolation);
+
  private:
   std::unique_ptr<DeviceData> device_data_;
+  std::unique_ptr<WriteLog> write_log_;
+  std::unique_ptr<MacIndex> mac_index_;
+  std::unique_ptr<SpcMonitor> spc_monitor_;
 };
 
 #endif   // PRODDATA_H_
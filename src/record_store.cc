@@ -0,0 +1,164 @@
+/**
+ * @file
+ * RecordStore class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "record_store.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include "crc16_ops.h"
+
+static const uint8_t kErased = 0xFF;
+static const int kMaxKeySize = 5;
+static const int kLengthSize = 1;
+static const int kCRCSize = 2;
+static const int kMaxValueSize = 0xFF;
+
+RecordStore::RecordStore(int capacity) : capacity_(capacity), area_(capacity, kErased), end_(0),
+                                         corrupted_(0) {
+}
+
+bool RecordStore::ParseHeader(int position, uint32_t *key, int *value_offset,
+                              int *value_size) const {
+  uint32_t result = 0;
+  int shift = 0;
+  int i = position;
+  for (;;) {
+    if (i >= capacity_ || i - position >= kMaxKeySize) {
+      return false;
+    }
+    uint8_t byte = area_[i++];
+    result |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    shift += 7;
+    if (!(byte & 0x80)) {
+      break;
+    }
+  }
+
+  if (i + kLengthSize > capacity_) {
+    return false;
+  }
+  *key = result;
+  *value_size = area_[i];
+  *value_offset = i + kLengthSize;
+  return *value_offset + *value_size + kCRCSize <= capacity_;
+}
+
+void RecordStore::Load(const std::vector<uint8_t> &area) {
+  int size = area.size();
+  if (size != capacity_) {
+    LOG(ERROR) << "Record area size error";
+    throw std::runtime_error("Record area size error");
+  }
+  area_ = area;
+  index_.clear();
+  corrupted_ = 0;
+
+  int position = 0;
+  while (position < capacity_) {
+    if (area_[position] == kErased &&
+        std::all_of(area_.begin() + position, area_.end(),
+                    [](uint8_t byte) { return byte == kErased; })) {
+      break;
+    }
+
+    uint32_t key;
+    int value_offset;
+    int value_size;
+    if (!ParseHeader(position, &key, &value_offset, &value_size)) {
+      /* torn or foreign data, nothing after this point can be used */
+      LOG(WARNING) << "Unreadable record at " << position;
+      position = capacity_;
+      break;
+    }
+
+    int crc_offset = value_offset + value_size;
+    uint16_t crc = crc16_block(0, area_.data() + position, crc_offset - position);
+    if (((crc >> 8) & 0xff) == area_[crc_offset] && (crc & 0xff) == area_[crc_offset + 1]) {
+      index_[key] = Entry{value_offset, value_size};
+    } else {
+      LOG(WARNING) << "Record CRC failed at " << position;
+      corrupted_++;
+    }
+    position = crc_offset + kCRCSize;
+  }
+  end_ = position;
+}
+
+int RecordStore::Append(uint32_t key, const std::vector<uint8_t> &value,
+                        std::vector<uint8_t> *record) {
+  int value_size = value.size();
+  if (value_size > kMaxValueSize) {
+    LOG(ERROR) << "Record value too long";
+    throw std::runtime_error("Record value too long");
+  }
+
+  record->clear();
+  uint32_t rest = key;
+  do {
+    uint8_t byte = rest & 0x7F;
+    rest >>= 7;
+    record->push_back(rest ? (byte | 0x80) : byte);
+  } while (rest);
+  record->push_back(value_size);
+  int value_position = record->size();
+  record->insert(record->end(), value.begin(), value.end());
+  uint16_t crc = crc16_block(0, record->data(), record->size());
+  record->push_back((crc >> 8) & 0xff);
+  record->push_back(crc & 0xff);
+
+  int record_size = record->size();
+  if (record_size > Free()) {
+    LOG(ERROR) << "No space left for record";
+    throw std::runtime_error("No space left for record");
+  }
+
+  int offset = end_;
+  std::copy(record->begin(), record->end(), area_.begin() + offset);
+  index_[key] = Entry{offset + value_position, value_size};
+  end_ += record_size;
+  return offset;
+}
+
+bool RecordStore::Get(uint32_t key, std::vector<uint8_t> *value) const {
+  const auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+  value->assign(area_.begin() + it->second.offset,
+                area_.begin() + it->second.offset + it->second.size);
+  return true;
+}
+
+void RecordStore::ForEach(
+    const std::function<void(uint32_t, const std::vector<uint8_t> &)> &fn) const {
+  std::map<uint32_t, Entry> ordered(index_.begin(), index_.end());
+  for (const auto &entry : ordered) {
+    std::vector<uint8_t> value(area_.begin() + entry.second.offset,
+                               area_.begin() + entry.second.offset + entry.second.size);
+    fn(entry.first, value);
+  }
+}
+
+int RecordStore::Free() const {
+  return capacity_ - end_;
+}
+
+int RecordStore::Corrupted() const {
+  return corrupted_;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file
+ * RecordStore class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef RECORDSTORE_H_
+#define RECORDSTORE_H_
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Append-only key/value record log kept in an OTP area
+ *
+ * Each record is stored as
+ * | key (LEB128 varint) | value length (1 byte) | value | CRC16 (2 bytes) |
+ * where the CRC covers key, length and value. Erased OTP reads 0xFF, so the log ends where
+ * only erased bytes remain. A record is never modified once programmed, a newer record with
+ * the same key supersedes the older one.
+ */
+class RecordStore {
+ public:
+  /**
+   * @brief Constructor
+   *
+   * Creates an empty (erased) store
+   *
+   * @param[in] capacity size of the OTP area in bytes
+   */
+  explicit RecordStore(int capacity);
+
+  /**
+   * @brief Rebuild the index from the raw content of the OTP area in a single pass
+   *
+   * @param[in] area raw content of the OTP area
+   */
+  void Load(const std::vector<uint8_t> &area);
+
+  /**
+   * @brief Append record to the log
+   *
+   * Only erased bytes after the end of the log are used, index is updated on success.
+   *
+   * @param[in] key record key
+   * @param[in] value record value
+   * @param[out] record encoded record to be programmed
+   * returns offset of the record within the area
+   */
+  int Append(uint32_t key, const std::vector<uint8_t> &value, std::vector<uint8_t> *record);
+
+  /**
+   * @brief Get latest value of a key
+   *
+   * @param[in] key record key
+   * @param[out] value latest value stored for key
+   * returns false if key is not present
+   */
+  bool Get(uint32_t key, std::vector<uint8_t> *value) const;
+
+  /**
+   * @brief Call fn with the latest value of every key, in key order
+   *
+   * @param[in] fn callback
+   */
+  void ForEach(const std::function<void(uint32_t, const std::vector<uint8_t> &)> &fn) const;
+
+  /**
+   * @brief Number of erased bytes left for new records
+   */
+  int Free() const;
+
+  /**
+   * @brief Number of records skipped while loading because of CRC failure
+   */
+  int Corrupted() const;
+
+ private:
+  struct Entry {
+    int offset;
+    int size;
+  };
+
+  const int capacity_;
+  std::vector<uint8_t> area_;
+  std::unordered_map<uint32_t, Entry> index_;
+  int end_;
+  int corrupted_;
+
+  /**
+   * @brief Parse record header at position
+   *
+   * @param[in] position offset of record in area
+   * @param[out] key decoded key
+   * @param[out] value_offset offset of the value in area
+   * @param[out] value_size size of the value
+   * returns false if header is truncated or record does not fit in the area
+   */
+  bool ParseHeader(int position, uint32_t *key, int *value_offset, int *value_size) const;
+};
+
+#endif  // RECORDSTORE_H_
@@ -0,0 +1,215 @@
+/**
+ * @file
+ * RX statistics sampler
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "rx_stats.h"
+#include <glog/logging.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+static const int kStatsBufferSize = 4096;
+
+static int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* find "<name>" at line start followed by '=' or ':' and parse the number after it */
+static bool FindValue(const char *text, const std::string &name, int64_t *value) {
+  size_t length = name.size();
+  for (const char *line = text; line && *line; line = strchr(line, '\n')) {
+    while (*line == '\n' || *line == ' ' || *line == '\t') {
+      line++;
+    }
+    if (strncmp(line, name.c_str(), length) != 0) {
+      continue;
+    }
+    const char *p = line + length;
+    while (*p == ' ' || *p == '\t') {
+      p++;
+    }
+    if (*p != '=' && *p != ':') {
+      continue;
+    }
+    char *end = NULL;
+    *value = strtoll(p + 1, &end, 10);
+    if (end != p + 1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+RxStatsSampler::RxStatsSampler(const std::string &path, int window, const RxCounterNames &names)
+    : names_(names), dropped_(0), running_(false), window_next_(0), window_count_(0),
+      has_last_(false), sum_pass_(0), sum_fail_(0), sum_rssi_(0), rssi_count_(0) {
+  DLOG(INFO) << "Initialising RxStatsSampler";
+  if (window <= 0) {
+    LOG(ERROR) << "Invalid window: " << window;
+    throw std::runtime_error("Invalid window: " + std::to_string(window));
+  }
+  window_.resize(window);
+  fd_ = open(path.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    LOG(ERROR) << "Can't open " << path << ": " << strerror(errno);
+    throw std::runtime_error("Can't open RX statistics: " + path);
+  }
+}
+
+RxStatsSampler::~RxStatsSampler() {
+  DLOG(INFO) << "Deinitialising RxStatsSampler";
+  Stop();
+  close(fd_);
+}
+
+void RxStatsSampler::Start(int rate) {
+  if (rate <= 0) {
+    LOG(ERROR) << "Invalid sample rate: " << rate;
+    throw std::runtime_error("Invalid sample rate: " + std::to_string(rate));
+  }
+  Stop();
+  running_ = true;
+  thread_ = std::thread(&RxStatsSampler::Run, this, rate);
+}
+
+void RxStatsSampler::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  stop_cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void RxStatsSampler::Run(int rate) {
+  const std::chrono::microseconds period(1000000 / rate);
+  auto next = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    lock.unlock();
+    if (!Poll()) {
+      LOG(WARNING) << "Reading RX statistics failed";
+    }
+    lock.lock();
+    next += period;
+    stop_cv_.wait_until(lock, next, [this] { return !running_; });
+  }
+}
+
+bool RxStatsSampler::Poll() {
+  char buf[kStatsBufferSize];
+  if (lseek(fd_, 0, SEEK_SET) < 0) {
+    DLOG(ERROR) << "rx stats: lseek failed: " << strerror(errno);
+    return false;
+  }
+  int size = 0;
+  int ret;
+  while (size < kStatsBufferSize - 1 &&
+         ((ret = read(fd_, buf + size, kStatsBufferSize - 1 - size)) > 0 ||
+          (ret < 0 && errno == EINTR))) {
+    if (ret > 0) {
+      size += ret;
+    }
+  }
+  buf[size] = '\0';
+
+  RxSample sample;
+  if (!ParseSample(buf, names_, &sample)) {
+    return false;
+  }
+  sample.time_us = NowMicros();
+  if (!ring_.Push(sample)) {
+    dropped_++;
+  }
+  return true;
+}
+
+bool RxStatsSampler::ParseSample(const char *text, const RxCounterNames &names,
+                                 RxSample *sample) {
+  int64_t pass, fail, rssi;
+  if (!FindValue(text, names.crc_pass, &pass) || !FindValue(text, names.crc_fail, &fail)) {
+    return false;
+  }
+  sample->crc_pass = static_cast<uint32_t>(pass);
+  sample->crc_fail = static_cast<uint32_t>(fail);
+  sample->has_rssi = FindValue(text, names.rssi, &rssi);
+  sample->rssi = sample->has_rssi ? static_cast<int32_t>(rssi) : 0;
+  return true;
+}
+
+void RxStatsSampler::Update(const RxSample &sample) {
+  if (!has_last_) {
+    has_last_ = true;
+    last_ = sample;
+    return;
+  }
+
+  Delta delta;
+  /* counters going backwards were cleared (clear_stats), count from zero */
+  delta.crc_pass = sample.crc_pass >= last_.crc_pass ? sample.crc_pass - last_.crc_pass
+                                                     : sample.crc_pass;
+  delta.crc_fail = sample.crc_fail >= last_.crc_fail ? sample.crc_fail - last_.crc_fail
+                                                     : sample.crc_fail;
+  delta.rssi = sample.rssi;
+  delta.has_rssi = sample.has_rssi;
+  last_ = sample;
+
+  /* evict oldest interval once the window is full */
+  Delta &slot = window_[window_next_];
+  if (window_count_ == window_.size()) {
+    sum_pass_ -= slot.crc_pass;
+    sum_fail_ -= slot.crc_fail;
+    if (slot.has_rssi) {
+      sum_rssi_ -= slot.rssi;
+      rssi_count_--;
+    }
+  } else {
+    window_count_++;
+  }
+  slot = delta;
+  window_next_ = (window_next_ + 1) % window_.size();
+
+  sum_pass_ += delta.crc_pass;
+  sum_fail_ += delta.crc_fail;
+  if (delta.has_rssi) {
+    sum_rssi_ += delta.rssi;
+    rssi_count_++;
+  }
+}
+
+RxAggregate RxStatsSampler::Aggregate() {
+  RxSample sample;
+  while (ring_.Pop(&sample)) {
+    Update(sample);
+  }
+
+  RxAggregate aggregate;
+  aggregate.samples = window_count_;
+  aggregate.frames = sum_pass_ + sum_fail_;
+  aggregate.errors = sum_fail_;
+  aggregate.per = aggregate.frames ? static_cast<double>(sum_fail_) / aggregate.frames : 0;
+  aggregate.rssi = rssi_count_ ? static_cast<double>(sum_rssi_) / rssi_count_ : 0;
+  aggregate.dropped = dropped_.load();
+  return aggregate;
+}
@@ -0,0 +1,209 @@
+/**
+ * @file
+ * RX statistics sampler
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef RXSTATS_H_
+#define RXSTATS_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer thread and one consumer thread
+ *
+ * @tparam T item type, copied in and out
+ * @tparam N capacity, power of 2
+ */
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "Ring capacity must be a power of 2");
+
+ public:
+  SpscRing() : head_(0), tail_(0) {}
+
+  /**
+   * @brief Queue item, producer side only
+   *
+   * returns false if the ring is full and item was not queued
+   */
+  bool Push(const T &item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == N) {
+      return false;
+    }
+    items_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Dequeue oldest item, consumer side only
+   *
+   * returns false if the ring is empty
+   */
+  bool Pop(T *item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *item = items_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  T items_[N];
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+};
+
+/**
+ * @brief Names of the driver statistics used by the sampler
+ */
+struct RxCounterNames {
+  std::string crc_pass = "ofdm_crc32_pass_cnt";
+  std::string crc_fail = "ofdm_crc32_fail_cnt";
+  std::string rssi = "rssi_avg";
+};
+
+/**
+ * @brief One poll of the driver statistics, counters are cumulative as reported by the driver
+ */
+struct RxSample {
+  int64_t time_us;
+  uint32_t crc_pass;
+  uint32_t crc_fail;
+  int32_t rssi;
+  bool has_rssi;
+};
+
+/**
+ * @brief Aggregates over the samples of the rolling window
+ */
+struct RxAggregate {
+  /** number of sample intervals in the window */
+  int samples;
+  /** frames received in the window, with or without CRC error */
+  uint64_t frames;
+  /** frames received with CRC error in the window */
+  uint64_t errors;
+  /** packet error rate, 0 if no frame was received */
+  double per;
+  /** mean RSSI of the samples in the window which reported one */
+  double rssi;
+  /** samples lost because the consumer did not keep up */
+  uint64_t dropped;
+};
+
+/**
+ * @brief Polls the WiFi driver RX statistics at a fixed rate from a background thread
+ *
+ * Samples are handed over through a lock-free ring and folded into rolling window sums by
+ * Aggregate(), so each sample costs one read of the statistics file and O(1) arithmetic.
+ */
+class RxStatsSampler {
+ public:
+  /**
+   * @brief Constructor
+   *
+   * @param[in] path statistics file e.g /proc/uccp420/phy_stats
+   * @param[in] window number of sample intervals kept in the rolling aggregates
+   * @param[in] names names of the statistics to use
+   */
+  RxStatsSampler(const std::string &path, int window,
+                 const RxCounterNames &names = RxCounterNames());
+  ~RxStatsSampler();
+
+  /**
+   * @brief Start polling from a background thread
+   *
+   * @param[in] rate polls per second
+   */
+  void Start(int rate);
+
+  /**
+   * @brief Stop background polling, queued samples stay available to Aggregate()
+   */
+  void Stop();
+
+  /**
+   * @brief Read statistics once and queue the sample, called by the polling thread
+   *
+   * returns false if the statistics could not be read or parsed
+   */
+  bool Poll();
+
+  /**
+   * @brief Fold queued samples into the rolling window and return its aggregates
+   *
+   * Must be called from one thread only.
+   * returns aggregates of the rolling window
+   */
+  RxAggregate Aggregate();
+
+  /**
+   * @brief Parse statistics text of "<name> = <value>" or "<name>: <value>" lines
+   *
+   * @param[in] text null terminated statistics text
+   * @param[in] names names of the statistics to use
+   * @param[out] sample receives counters, time is not set
+   * returns false if a counter is missing
+   */
+  static bool ParseSample(const char *text, const RxCounterNames &names, RxSample *sample);
+
+ private:
+  struct Delta {
+    uint32_t crc_pass;
+    uint32_t crc_fail;
+    int32_t rssi;
+    bool has_rssi;
+  };
+
+  static const size_t kRingSize = 1024;
+
+  const RxCounterNames names_;
+  int fd_;
+  SpscRing<RxSample, kRingSize> ring_;
+  std::atomic<uint64_t> dropped_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable stop_cv_;
+  bool running_;
+
+  /* consumer side state */
+  std::vector<Delta> window_;
+  size_t window_next_;
+  size_t window_count_;
+  bool has_last_;
+  RxSample last_;
+  uint64_t sum_pass_;
+  uint64_t sum_fail_;
+  int64_t sum_rssi_;
+  int rssi_count_;
+
+  void Run(int rate);
+  void Update(const RxSample &sample);
+};
+
+#endif  // RXSTATS_H_
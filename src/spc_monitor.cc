@@ -0,0 +1,362 @@
+/**
+ * @file
+ * SpcMonitor class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "spc_monitor.h"
+#include <glog/logging.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <stdexcept>
+#include "device_fields.h"
+#include "file_lock.h"
+
+static const uint8_t kMagic[] = {'P', 'S', 'P', 'C'};
+static const uint32_t kFormatVersion = 1;
+static const size_t kStationSize = 32;
+static const size_t kFieldSize = 16;
+
+struct SpcHeader {
+  uint8_t magic[4];
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t reserved;
+};
+
+/* chart of one station, layout version and field; sigma 0 while the baseline is not set */
+struct SpcRecord {
+  char station[kStationSize];
+  char field[kFieldSize];
+  int32_t version;
+  uint32_t ewma_alarm;
+  uint64_t count;
+  double mean;
+  double m2;
+  double target;
+  double sigma;
+  double ewma;
+  double cusum_high;
+  double cusum_low;
+  uint8_t reserved[8];
+};
+
+static_assert(sizeof(SpcRecord) == 128, "SPC record must be 128 bytes");
+
+static off_t RecordOffset(uint64_t number) {
+  return sizeof(SpcHeader) + number * sizeof(SpcRecord);
+}
+
+static void ReadFully(int fd, void *buf, size_t size, off_t offset) {
+  ssize_t ret;
+  while ((ret = pread(fd, buf, size, offset)) < 0 && errno == EINTR) {
+  }
+  if (ret != static_cast<ssize_t>(size)) {
+    LOG(ERROR) << "SPC state read failed: " << (ret < 0 ? strerror(errno) : "short read");
+    throw std::runtime_error("SPC state read failed");
+  }
+}
+
+static void WriteFully(int fd, const void *buf, size_t size, off_t offset) {
+  ssize_t ret;
+  while ((ret = pwrite(fd, buf, size, offset)) < 0 && errno == EINTR) {
+  }
+  if (ret != static_cast<ssize_t>(size)) {
+    LOG(ERROR) << "SPC state write failed: " << (ret < 0 ? strerror(errno) : "short write");
+    throw std::runtime_error("SPC state write failed");
+  }
+}
+
+/* number of records, after checking the header */
+static uint64_t RecordCount(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    LOG(ERROR) << "fstat failed: " << strerror(errno);
+    throw std::runtime_error("SPC state read failed");
+  }
+  SpcHeader header;
+  ReadFully(fd, &header, sizeof(header), 0);
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kFormatVersion ||
+      header.record_size != sizeof(SpcRecord)) {
+    LOG(ERROR) << "Not an SPC state file";
+    throw std::runtime_error("Not an SPC state file");
+  }
+  return (st.st_size - sizeof(SpcHeader)) / sizeof(SpcRecord);
+}
+
+const char *SpcAlarmName(SpcAlarm::Kind kind) {
+  switch (kind) {
+    case SpcAlarm::kEwma:
+      return "EWMA";
+    case SpcAlarm::kCusumHigh:
+      return "CUSUM high";
+    case SpcAlarm::kCusumLow:
+      return "CUSUM low";
+  }
+  return "invalid";
+}
+
+SpcMonitor::SpcMonitor(const std::string &path, const std::string &station,
+                       const SpcLimits &limits)
+    : path_(path), station_(station), limits_(limits), fd_(-1) {
+  DLOG(INFO) << "Initialising SpcMonitor";
+  if (station_.empty() || station_.size() >= kStationSize) {
+    LOG(ERROR) << "Invalid station name: " << station_;
+    throw std::runtime_error("Invalid station name: " + station_);
+  }
+  if (limits_.warmup < 2) {
+    LOG(ERROR) << "SPC warmup needs at least 2 samples";
+    throw std::runtime_error("SPC warmup needs at least 2 samples");
+  }
+
+  fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    LOG(ERROR) << "Can't open " << path_ << ": " << strerror(errno);
+    throw std::runtime_error("Can't open SPC state: " + path_);
+  }
+  try {
+    FileLock lock(fd_, LOCK_EX, "SPC state");
+    struct stat st;
+    if (fstat(fd_, &st) == 0 && st.st_size == 0) {
+      SpcHeader header = {};
+      memcpy(header.magic, kMagic, sizeof(kMagic));
+      header.version = kFormatVersion;
+      header.record_size = sizeof(SpcRecord);
+      WriteFully(fd_, &header, sizeof(header), 0);
+    }
+    RecordCount(fd_);
+  } catch (std::runtime_error &e) {
+    close(fd_);
+    throw;
+  }
+}
+
+SpcMonitor::~SpcMonitor() {
+  DLOG(INFO) << "Deinitialising SpcMonitor";
+  close(fd_);
+}
+
+void SpcMonitor::SetAlarmCallback(const std::function<void(const SpcAlarm &)> &callback) {
+  callback_ = callback;
+}
+
+uint64_t SpcMonitor::RecordNumber(int version, const std::string &field) {
+  const auto key = std::make_pair(version, field);
+  const auto it = records_.find(key);
+  if (it != records_.end()) {
+    return it->second;
+  }
+
+  /* another process of this station may have added the chart */
+  uint64_t count = RecordCount(fd_);
+  SpcRecord record;
+  for (uint64_t number = 0; number < count; number++) {
+    ReadFully(fd_, &record, sizeof(record), RecordOffset(number));
+    if (record.version == version && !strncmp(record.station, station_.c_str(), kStationSize) &&
+        !strncmp(record.field, field.c_str(), kFieldSize)) {
+      records_[key] = number;
+      return number;
+    }
+  }
+
+  memset(&record, 0, sizeof(record));
+  strncpy(record.station, station_.c_str(), kStationSize - 1);
+  strncpy(record.field, field.c_str(), kFieldSize - 1);
+  record.version = version;
+  WriteFully(fd_, &record, sizeof(record), RecordOffset(count));
+  records_[key] = count;
+  return count;
+}
+
+void SpcMonitor::ReadRecord(uint64_t number, SpcRecord *record) {
+  ReadFully(fd_, record, sizeof(*record), RecordOffset(number));
+}
+
+void SpcMonitor::WriteRecord(uint64_t number, const SpcRecord &record) {
+  WriteFully(fd_, &record, sizeof(record), RecordOffset(number));
+}
+
+void SpcMonitor::Update(SpcRecord *record, int value, std::vector<SpcAlarm> *alarms) {
+  /* Welford running mean and sum of squared deviations */
+  record->count++;
+  double delta = value - record->mean;
+  record->mean += delta / record->count;
+  record->m2 += delta * (value - record->mean);
+
+  if (record->sigma == 0) {
+    if (record->count >= static_cast<uint64_t>(limits_.warmup)) {
+      record->target = record->mean;
+      record->sigma = std::max(std::sqrt(record->m2 / (record->count - 1)), limits_.min_sigma);
+      record->ewma = record->target;
+    }
+    return;
+  }
+
+  SpcAlarm alarm;
+  alarm.station = station_;
+  alarm.version = record->version;
+  alarm.field = record->field;
+  alarm.sample = record->count;
+  alarm.value = value;
+  alarm.target = record->target;
+  alarm.sigma = record->sigma;
+
+  record->ewma = limits_.ewma_lambda * value + (1 - limits_.ewma_lambda) * record->ewma;
+  double ewma_limit = limits_.ewma_width * record->sigma *
+                      std::sqrt(limits_.ewma_lambda / (2 - limits_.ewma_lambda));
+  bool ewma_out = std::fabs(record->ewma - record->target) > ewma_limit;
+  if (ewma_out && !record->ewma_alarm) {
+    alarm.kind = SpcAlarm::kEwma;
+    alarm.statistic = record->ewma;
+    alarms->push_back(alarm);
+  }
+  record->ewma_alarm = ewma_out;
+
+  /* CUSUM in units of sigma, restarted after an alarm */
+  double z = (value - record->target) / record->sigma;
+  record->cusum_high = std::max(0.0, record->cusum_high + z - limits_.cusum_k);
+  record->cusum_low = std::max(0.0, record->cusum_low - z - limits_.cusum_k);
+  if (record->cusum_high > limits_.cusum_h) {
+    alarm.kind = SpcAlarm::kCusumHigh;
+    alarm.statistic = record->cusum_high;
+    alarms->push_back(alarm);
+    record->cusum_high = 0;
+  }
+  if (record->cusum_low > limits_.cusum_h) {
+    alarm.kind = SpcAlarm::kCusumLow;
+    alarm.statistic = record->cusum_low;
+    alarms->push_back(alarm);
+    record->cusum_low = 0;
+  }
+}
+
+void SpcMonitor::Raise(const SpcAlarm &alarm) {
+  std::ostringstream line;
+  line << time(NULL) << " " << alarm.station << " " << alarm.version << " " << alarm.field
+       << " " << SpcAlarmName(alarm.kind) << " sample " << alarm.sample << " value "
+       << alarm.value << " statistic " << alarm.statistic << " target " << alarm.target
+       << " sigma " << alarm.sigma << "\n";
+  LOG(WARNING) << "SPC alarm: " << line.str();
+
+  /* one write per line, appends of concurrent stations do not interleave */
+  std::string text = line.str();
+  int fd = open((path_ + ".alarms").c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0 || write(fd, text.data(), text.size()) != static_cast<ssize_t>(text.size())) {
+    LOG(ERROR) << "Writing SPC alarm failed: " << strerror(errno);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (callback_) {
+    callback_(alarm);
+  }
+}
+
+void SpcMonitor::Add(int version, const std::vector<std::pair<std::string, int>> &samples) {
+  std::vector<SpcAlarm> alarms;
+  {
+    FileLock lock(fd_, LOCK_EX, "SPC state");
+    for (const auto &sample : samples) {
+      uint64_t number = RecordNumber(version, sample.first);
+      SpcRecord record;
+      ReadRecord(number, &record);
+      Update(&record, sample.second, &alarms);
+      WriteRecord(number, record);
+    }
+  }
+  for (const auto &alarm : alarms) {
+    Raise(alarm);
+  }
+}
+
+void SpcMonitor::AfterWrite(int register_number, const std::vector<uint8_t> &old_data,
+                            const std::vector<uint8_t> &new_data,
+                            const std::set<std::string> &fields) {
+  const int kVersionOffset = fields::VERSION_REG1::kOffset - fields::RegisterBase(1);
+  if (register_number != 1 || new_data.size() <= static_cast<size_t>(kVersionOffset)) {
+    return;
+  }
+  int version = new_data[kVersionOffset];
+  const auto &layouts = DeviceLayouts::Layouts()[1];
+  const auto layout = layouts.find(version);
+  if (layout == layouts.end()) {
+    return;
+  }
+
+  /*
+   * calibration fields are the signed bytes after the version, every written one is a sample
+   * even if it kept its value
+   */
+  std::vector<std::pair<std::string, int>> samples;
+  for (const auto &name : fields) {
+    const auto field = layout->second.find(name);
+    if (field == layout->second.end()) {
+      continue;
+    }
+    size_t position = field->second.offset - fields::RegisterBase(1);
+    if (field->second.size != 1 || position <= static_cast<size_t>(kVersionOffset) ||
+        position >= new_data.size()) {
+      continue;
+    }
+    samples.push_back(std::make_pair(name, static_cast<int8_t>(new_data[position])));
+  }
+  if (!samples.empty()) {
+    Add(version, samples);
+  }
+}
+
+std::vector<SpcStats> SpcMonitor::Read(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG(ERROR) << "Can't open " << path << ": " << strerror(errno);
+    throw std::runtime_error("Can't open SPC state: " + path);
+  }
+  std::vector<SpcStats> charts;
+  try {
+    FileLock lock(fd, LOCK_SH, "SPC state");
+    uint64_t count = RecordCount(fd);
+    std::vector<SpcRecord> records(count);
+    if (count) {
+      ReadFully(fd, records.data(), count * sizeof(SpcRecord), RecordOffset(0));
+    }
+    for (const auto &record : records) {
+      SpcStats stats;
+      stats.station = std::string(record.station, strnlen(record.station, kStationSize));
+      stats.version = record.version;
+      stats.field = std::string(record.field, strnlen(record.field, kFieldSize));
+      stats.count = record.count;
+      stats.mean = record.mean;
+      stats.stddev = record.count > 1 ? std::sqrt(record.m2 / (record.count - 1)) : 0;
+      stats.target = record.target;
+      stats.sigma = record.sigma;
+      stats.ewma = record.ewma;
+      stats.cusum_high = record.cusum_high;
+      stats.cusum_low = record.cusum_low;
+      charts.push_back(stats);
+    }
+  } catch (std::runtime_error &e) {
+    close(fd);
+    throw;
+  }
+  close(fd);
+  return charts;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file
+ * SpcMonitor class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef SPCMONITOR_H_
+#define SPCMONITOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "device_data.h"
+
+struct SpcRecord;
+
+/**
+ * @brief Chart parameters of SpcMonitor, in units of the baseline standard deviation
+ */
+struct SpcLimits {
+  /** samples of a field used to estimate its baseline mean and standard deviation */
+  int warmup = 30;
+  /** EWMA weight of the newest sample */
+  double ewma_lambda = 0.2;
+  /** EWMA control limit width */
+  double ewma_width = 3;
+  /** CUSUM slack, shifts smaller than this are not accumulated */
+  double cusum_k = 0.5;
+  /** CUSUM decision interval */
+  double cusum_h = 5;
+  /** smallest baseline standard deviation, values are integers */
+  double min_sigma = 0.5;
+};
+
+/**
+ * @brief Alarm raised by SpcMonitor
+ */
+struct SpcAlarm {
+  enum Kind {
+    kEwma,
+    kCusumHigh,
+    kCusumLow,
+  };
+  std::string station;
+  int version;
+  std::string field;
+  Kind kind;
+  /** sample number of the field, counting from 1 */
+  uint64_t sample;
+  /** value of the sample raising the alarm */
+  int value;
+  /** EWMA or CUSUM sum raising the alarm */
+  double statistic;
+  /** baseline mean and standard deviation */
+  double target;
+  double sigma;
+};
+
+/**
+ * @brief Running statistics of one field, as kept by SpcMonitor
+ */
+struct SpcStats {
+  std::string station;
+  int version;
+  std::string field;
+  uint64_t count;
+  /** mean and standard deviation of all samples (Welford) */
+  double mean;
+  double stddev;
+  /** baseline mean and standard deviation, sigma is 0 during warmup */
+  double target;
+  double sigma;
+  double ewma;
+  double cusum_high;
+  double cusum_low;
+};
+
+/**
+ * @brief Online statistical process control of the register 1 calibration values
+ *
+ * As write hook, every written calibration field of register 1 (DCXO and PD offsets of the
+ * programmed layout) is a sample of the chart kept per station, layout version and field.
+ * Each chart holds O(1) state: Welford mean and variance of all samples, a baseline mean and
+ * standard deviation frozen after the warmup samples, an EWMA and a two-sided CUSUM of the
+ * samples against the baseline. An EWMA leaving its control limits and a CUSUM sum exceeding
+ * the decision interval raise an alarm; the CUSUM restarts after its alarm, the EWMA alarms
+ * again only after returning within limits.
+ *
+ * Charts are records of a state file shared by all stations of a host; a sample locks the
+ * file and reads and writes the record of its chart only, so one board costs a few system
+ * calls. Alarms go to a callback and are appended as lines to "<state file>.alarms".
+ */
+class SpcMonitor : public WriteHook {
+ public:
+  /**
+   * @brief Constructor, opens or creates the state file
+   *
+   * @param[in] path state file
+   * @param[in] station name of this station, up to 31 characters
+   * @param[in] limits chart parameters
+   */
+  SpcMonitor(const std::string &path, const std::string &station,
+             const SpcLimits &limits = SpcLimits());
+  ~SpcMonitor();
+
+  SpcMonitor(const SpcMonitor &) = delete;
+  SpcMonitor &operator=(const SpcMonitor &) = delete;
+
+  /**
+   * @brief Set function called for every alarm, in addition to the alarm file
+   */
+  void SetAlarmCallback(const std::function<void(const SpcAlarm &)> &callback);
+
+  /**
+   * @brief Add samples of this station
+   *
+   * @param[in] version register 1 layout version
+   * @param[in] samples field name and value pairs
+   */
+  void Add(int version, const std::vector<std::pair<std::string, int>> &samples);
+
+  /**
+   * @brief Add written calibration fields of register 1 as samples
+   */
+  void AfterWrite(int register_number, const std::vector<uint8_t> &old_data,
+                  const std::vector<uint8_t> &new_data, const std::set<std::string> &fields);
+
+  /**
+   * @brief Statistics of every chart of a state file, of all stations
+   *
+   * @param[in] path state file
+   */
+  static std::vector<SpcStats> Read(const std::string &path);
+
+ private:
+  /**
+   * @brief Record number of chart, appended to the file if it is new; file must be locked
+   */
+  uint64_t RecordNumber(int version, const std::string &field);
+  void ReadRecord(uint64_t number, SpcRecord *record);
+  void WriteRecord(uint64_t number, const SpcRecord &record);
+  void Update(SpcRecord *record, int value, std::vector<SpcAlarm> *alarms);
+  void Raise(const SpcAlarm &alarm);
+
+  const std::string path_;
+  const std::string station_;
+  const SpcLimits limits_;
+  int fd_;
+  /** record numbers of this station's charts by version and field */
+  std::map<std::pair<int, std::string>, uint64_t> records_;
+  std::function<void(const SpcAlarm &)> callback_;
+};
+
+/**
+ * @brief Human readable name of an alarm kind
+ */
+const char *SpcAlarmName(SpcAlarm::Kind kind);
+
+#endif  // SPCMONITOR_H_
@@ -0,0 +1,117 @@
+/**
+ * @file
+ * Chrome trace event recording
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "trace.h"
+#include <glog/logging.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace trace {
+
+namespace {
+
+const int kRingSize = 4096;
+
+struct ThreadBuffer {
+  int tid;
+  uint64_t recorded;
+  Event events[kRingSize];
+};
+
+std::mutex buffers_mutex;
+/* buffers outlive their threads so events of finished workers are still written */
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+thread_local ThreadBuffer *thread_buffer = NULL;
+
+ThreadBuffer *GetThreadBuffer() {
+  if (!thread_buffer) {
+    std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+    buffer->recorded = 0;
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffer->tid = buffers.size() + 1;
+    thread_buffer = buffer.get();
+    buffers.push_back(std::move(buffer));
+  }
+  return thread_buffer;
+}
+
+}  // namespace
+
+const int Event::kMaxArgs;
+std::atomic<bool> Tracer::enabled_(false);
+
+void Tracer::Enable() {
+  enabled_.store(true);
+}
+
+void Tracer::Disable() {
+  enabled_.store(false);
+}
+
+int64_t Tracer::NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::Record(const Event &event) {
+  ThreadBuffer *buffer = GetThreadBuffer();
+  buffer->events[buffer->recorded % kRingSize] = event;
+  buffer->recorded++;
+}
+
+bool Tracer::WriteJson(const std::string &path) {
+  std::ofstream out(path.c_str(), std::ios::trunc);
+  if (!out) {
+    LOG(ERROR) << "Can't write trace: " << path;
+    return false;
+  }
+
+  const int pid = getpid();
+  bool first = true;
+  out << "{\"traceEvents\":[";
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  for (const auto &buffer : buffers) {
+    uint64_t begin = buffer->recorded > kRingSize ? buffer->recorded - kRingSize : 0;
+    for (uint64_t i = begin; i < buffer->recorded; i++) {
+      const Event &event = buffer->events[i % kRingSize];
+      out << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\""
+          << event.category << "\",\"ph\":\"X\",\"ts\":" << event.start_us << ",\"dur\":"
+          << event.duration_us << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+          << ",\"args\":{";
+      for (int arg = 0; arg < event.arg_count; arg++) {
+        out << (arg ? "," : "") << "\"" << event.arg_names[arg] << "\":" << event.arg_values[arg];
+      }
+      out << "}}";
+      first = false;
+    }
+  }
+  out << "\n]}\n";
+  out.close();
+  if (!out) {
+    LOG(ERROR) << "Can't write trace: " << path;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace trace
@@ -0,0 +1,131 @@
+/**
+ * @file
+ * Chrome trace event recording
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace trace {
+
+/**
+ * @brief Complete ("X") trace event, names must be string literals
+ */
+struct Event {
+  static const int kMaxArgs = 3;
+
+  const char *name;
+  const char *category;
+  int64_t start_us;
+  int64_t duration_us;
+  const char *arg_names[kMaxArgs];
+  int64_t arg_values[kMaxArgs];
+  int arg_count;
+};
+
+/**
+ * @brief Process wide trace control
+ *
+ * Events are kept in a ring buffer per thread (oldest events are overwritten), so recording
+ * takes no lock. When tracing is disabled a trace point costs one relaxed atomic load.
+ */
+class Tracer {
+ public:
+  /**
+   * @brief Start recording events
+   */
+  static void Enable();
+
+  /**
+   * @brief Stop recording events, recorded events are kept
+   */
+  static void Disable();
+
+  static bool Enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Record event in the ring buffer of the calling thread
+   */
+  static void Record(const Event &event);
+
+  /**
+   * @brief Write recorded events of all threads as Chrome trace JSON (chrome://tracing, Perfetto)
+   *
+   * Must be called once traced threads are done.
+   * @param[in] path output file
+   * returns false if the file could not be written
+   */
+  static bool WriteJson(const std::string &path);
+
+  /**
+   * @brief Monotonic time in microseconds
+   */
+  static int64_t NowMicros();
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+/**
+ * @brief Records a complete event spanning the lifetime of the object
+ *
+ * e.g Scope scope("read", "flash"); scope.Arg("size", size);
+ */
+class Scope {
+ public:
+  Scope(const char *name, const char *category) {
+    event_.name = NULL;
+    if (Tracer::Enabled()) {
+      event_.name = name;
+      event_.category = category;
+      event_.arg_count = 0;
+      event_.start_us = Tracer::NowMicros();
+    }
+  }
+
+  ~Scope() {
+    if (event_.name) {
+      event_.duration_us = Tracer::NowMicros() - event_.start_us;
+      Tracer::Record(event_);
+    }
+  }
+
+  /**
+   * @brief Attach integer argument to the event, at most Event::kMaxArgs are kept
+   */
+  Scope &Arg(const char *name, int64_t value) {
+    if (event_.name && event_.arg_count < Event::kMaxArgs) {
+      event_.arg_names[event_.arg_count] = name;
+      event_.arg_values[event_.arg_count] = value;
+      event_.arg_count++;
+    }
+    return *this;
+  }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+ private:
+  Event event_;
+};
+
+}  // namespace trace
+
+#endif  // TRACE_H_
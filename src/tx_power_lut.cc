@@ -0,0 +1,129 @@
+/**
+ * @file
+ * Per-channel TX power lookup table
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include "tx_power_lut.h"
+#include <glog/logging.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Centre channel of every 5 GHz band, in channel order
+ */
+static std::vector<std::pair<int, int>> BandCentres() {
+  int first[kBandCount];
+  int last[kBandCount];
+  std::fill(first, first + kBandCount, -1);
+  for (int channel = 1; channel <= TxPowerLut::kMaxChannel; channel++) {
+    int band = ChannelBand(channel);
+    if (band < 0) {
+      continue;
+    }
+    if (first[band] < 0) {
+      first[band] = channel;
+    }
+    last[band] = channel;
+  }
+  std::vector<std::pair<int, int>> centres;
+  for (int band = kBand51; band < kBandCount; band++) {
+    centres.push_back(std::make_pair((first[band] + last[band]) / 2, band));
+  }
+  return centres;
+}
+
+TxPowerLut::TxPowerLut(const std::map<std::string, std::vector<uint8_t>> &reg1_fields,
+                       int interpolation)
+    : interpolation_(interpolation) {
+  if (interpolation != TX_POWER_LUT_BAND_STEP && interpolation != TX_POWER_LUT_LINEAR) {
+    LOG(ERROR) << "Invalid interpolation: " << interpolation;
+    throw std::runtime_error("Invalid interpolation");
+  }
+
+  const std::vector<std::pair<int, int>> centres = BandCentres();
+  for (int antenna = 1; antenna <= kCalAntennaCount; antenna++) {
+    int band_offset[kBandCount];
+    for (int band = 0; band < kBandCount; band++) {
+      const auto it = reg1_fields.find(PdOffsetField(antenna, band));
+      if (it == reg1_fields.end() || it->second.size() != 1) {
+        LOG(ERROR) << "Register 1 has no field " << PdOffsetField(antenna, band);
+        throw std::runtime_error("Register 1 has no power detector offsets");
+      }
+      band_offset[band] = static_cast<int8_t>(it->second[0]);
+    }
+
+    int8_t *offsets = offsets_[antenna - 1];
+    for (int channel = 0; channel <= kMaxChannel; channel++) {
+      int band = ChannelBand(channel);
+      if (band < 0) {
+        offsets[channel] = TX_POWER_LUT_NO_OFFSET;
+        continue;
+      }
+      offsets[channel] = band_offset[band];
+      if (interpolation == TX_POWER_LUT_BAND_STEP || band == kBand24 ||
+          channel <= centres.front().first || channel >= centres.back().first) {
+        continue;
+      }
+      size_t upper = 1;
+      while (centres[upper].first < channel) {
+        upper++;
+      }
+      const std::pair<int, int> &low = centres[upper - 1];
+      const std::pair<int, int> &high = centres[upper];
+      const int low_offset = band_offset[low.second];
+      const int high_offset = band_offset[high.second];
+      double fraction = static_cast<double>(channel - low.first) / (high.first - low.first);
+      offsets[channel] = std::lround(low_offset + fraction * (high_offset - low_offset));
+    }
+  }
+}
+
+std::vector<uint8_t> TxPowerLut::Serialize() const {
+  std::vector<uint8_t> blob(TX_POWER_LUT_HEADER_SIZE);
+  memcpy(blob.data(), TX_POWER_LUT_MAGIC, 4);
+  blob[4] = TX_POWER_LUT_VERSION;
+  blob[5] = kCalAntennaCount;
+  blob[6] = kMaxChannel + 1;
+  blob[7] = interpolation_;
+  const uint8_t *offsets = reinterpret_cast<const uint8_t *>(offsets_);
+  blob.insert(blob.end(), offsets, offsets + sizeof(offsets_));
+  return blob;
+}
+
+void WriteTxPowerLut(const std::string &path, const std::vector<uint8_t> &blob) {
+  /* write and rename, a driver loading the table never sees a partial one */
+  const std::string temp = path + "." + std::to_string(getpid());
+  {
+    std::ofstream file(temp, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(blob.data()), blob.size());
+    if (!file) {
+      LOG(ERROR) << "Can't write " << temp;
+      unlink(temp.c_str());
+      throw std::runtime_error("Can't write TX power table: " + path);
+    }
+  }
+  if (rename(temp.c_str(), path.c_str()) < 0) {
+    LOG(ERROR) << "Can't rename " << temp << " to " << path << ": " << strerror(errno);
+    unlink(temp.c_str());
+    throw std::runtime_error("Can't write TX power table: " + path);
+  }
+}
@@ -0,0 +1,85 @@
+/**
+ * @file
+ * Per-channel TX power lookup table
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef TXPOWERLUT_H_
+#define TXPOWERLUT_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "cal_params.h"
+#include "tx_power_lut_reader.h"
+
+/**
+ * @brief Power detector offsets of register 1 resolved per antenna and channel
+ *
+ * Register 1 stores one offset per antenna and band. The table maps every channel number up to
+ * 165 to its offset once, so the driver needs a single array load on a channel change instead
+ * of working out band and offset. The blob layout is described in tx_power_lut_reader.h.
+ */
+class TxPowerLut {
+ public:
+  /** highest channel number, the table is indexed 0 to kMaxChannel */
+  static const int kMaxChannel = 165;
+
+  /**
+   * @brief Build table from register 1 fields
+   *
+   * With TX_POWER_LUT_BAND_STEP every channel gets the offset of its band. With
+   * TX_POWER_LUT_LINEAR, 5 GHz channels between the centre channels of two bands get the
+   * offset linearly interpolated between those bands (rounded), channels outside the outermost
+   * centres and 2.4 GHz channels get their band offset.
+   *
+   * @param[in] reg1_fields register 1 fields as returned by DeviceData::ReadRegisterFields
+   * @param[in] interpolation TX_POWER_LUT_BAND_STEP or TX_POWER_LUT_LINEAR
+   */
+  TxPowerLut(const std::map<std::string, std::vector<uint8_t>> &reg1_fields, int interpolation);
+
+  /**
+   * @brief Power detector offset of antenna on channel
+   *
+   * @param[in] antenna antenna number (1, 2)
+   * @param[in] channel channel number (0 to kMaxChannel)
+   * returns offset, TX_POWER_LUT_NO_OFFSET if channel is not a valid WiFi channel
+   */
+  int8_t Offset(int antenna, int channel) const {
+    return offsets_[antenna - 1][channel];
+  }
+
+  /**
+   * @brief Serialise table as blob readable by tx_power_lut_reader.h
+   *
+   * returns blob
+   */
+  std::vector<uint8_t> Serialize() const;
+
+ private:
+  int interpolation_;
+  int8_t offsets_[kCalAntennaCount][kMaxChannel + 1];
+};
+
+/**
+ * @brief Write blob to file, replacing it atomically
+ *
+ * @param[in] path file to write
+ * @param[in] blob blob content
+ */
+void WriteTxPowerLut(const std::string &path, const std::vector<uint8_t> &blob);
+
+#endif  // TXPOWERLUT_H_
@@ -0,0 +1,98 @@
+/**
+ * @file
+ * C reader of TX power lookup table blobs
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef TXPOWERLUTREADER_H_
+#define TXPOWERLUTREADER_H_
+
+/*
+ * Blob written by "proddata txpower-lut", all fields single bytes:
+ *
+ *   magic "TXPL", version, antennas, channels, interpolation
+ *   offsets[antennas][channels]   signed power detector offset, indexed by channel number
+ *
+ * Channels that are not valid WiFi channels hold TX_POWER_LUT_NO_OFFSET. The header has no
+ * dependency on proddata, drivers can copy it.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TX_POWER_LUT_MAGIC "TXPL"
+#define TX_POWER_LUT_VERSION 1
+#define TX_POWER_LUT_HEADER_SIZE 8
+#define TX_POWER_LUT_NO_OFFSET (-128)
+
+/** interpolation byte: offset of the channel's band */
+#define TX_POWER_LUT_BAND_STEP 0
+/** interpolation byte: 5 GHz offsets linear between band centre channels */
+#define TX_POWER_LUT_LINEAR 1
+
+struct tx_power_lut {
+  int antennas;
+  int channels;
+  int interpolation;
+  const int8_t *offsets;
+};
+
+/**
+ * @brief Check blob header and size and set up lut to point into blob
+ *
+ * @param[out] lut table description, valid as long as blob is
+ * @param[in] blob blob content
+ * @param[in] size size of blob
+ * returns 0 on success, -1 if blob is not a TX power lookup table of a known version
+ */
+static inline int tx_power_lut_init(struct tx_power_lut *lut, const void *blob, size_t size) {
+  const uint8_t *bytes = (const uint8_t *)blob;
+  if (size < TX_POWER_LUT_HEADER_SIZE || memcmp(bytes, TX_POWER_LUT_MAGIC, 4) != 0 ||
+      bytes[4] != TX_POWER_LUT_VERSION) {
+    return -1;
+  }
+  lut->antennas = bytes[5];
+  lut->channels = bytes[6];
+  lut->interpolation = bytes[7];
+  if (size != TX_POWER_LUT_HEADER_SIZE + (size_t)lut->antennas * lut->channels) {
+    return -1;
+  }
+  lut->offsets = (const int8_t *)(bytes + TX_POWER_LUT_HEADER_SIZE);
+  return 0;
+}
+
+/**
+ * @brief Power detector offset of antenna on channel, a single load without checks
+ *
+ * @param[in] lut table set up by tx_power_lut_init
+ * @param[in] antenna antenna number, 1 to lut->antennas
+ * @param[in] channel channel number, below lut->channels
+ * returns offset, TX_POWER_LUT_NO_OFFSET if channel is not a valid WiFi channel
+ */
+static inline int8_t tx_power_lut_offset(const struct tx_power_lut *lut, int antenna,
+                                         int channel) {
+  return lut->offsets[(antenna - 1) * lut->channels + channel];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* TXPOWERLUTREADER_H_ */
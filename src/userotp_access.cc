@@ -22,8 +22,10 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <stdexcept>
+#include "trace.h"
 
-UserOTPAccess::UserOTPAccess(const std::string &device_name) : FlashAccess(device_name) {
+UserOTPAccess::UserOTPAccess(const std::string &device_name, bool read_only)
+    : FlashAccess(device_name, read_only) {
   DLOG(INFO) << "Initialising UserOTPAccess";
 }
 
@@ -33,6 +35,8 @@ UserOTPAccess::~UserOTPAccess() {
 
 void UserOTPAccess::Write(const std::vector<uint8_t> &buf, const int offset) {
   SelectUserOTP();
+  trace::Scope scope("write", "flash");
+  scope.Arg("size", buf.size()).Arg("offset", offset);
 
   if (lseek(fd_, offset, SEEK_SET) < 0) {
     DLOG(ERROR) << "user otp write: lseek failed: " << strerror(errno);
@@ -48,23 +52,31 @@ void UserOTPAccess::Write(const std::vector<uint8_t> &buf, const int offset) {
 
 std::vector<uint8_t> UserOTPAccess::Read(const int size, const int offset) {
   std::vector<uint8_t> buf(size);
+  ReadInto(buf.data(), size, offset);
+  return buf;
+}
+
+void UserOTPAccess::ReadInto(uint8_t *buf, const int size, const int offset) {
   SelectUserOTP();
+  trace::Scope scope("read", "flash");
+  scope.Arg("size", size).Arg("offset", offset);
 
   if (lseek(fd_, offset, SEEK_SET) < 0) {
     DLOG(ERROR) << "user otp read: lseek failed: " << strerror(errno);
     throw std::runtime_error("user otp read: lseek failed");
   }
 
-  int ret = read(fd_, buf.data(), buf.size());
+  int ret = read(fd_, buf, size);
   if (ret < 0) {
     DLOG(ERROR) << "user otp read failed:" << strerror(errno);
     throw std::runtime_error("user otp read failed");
   }
-  return buf;
 }
 
 void UserOTPAccess::SelectUserOTP() {
   int val = MTD_OTP_USER;
+  trace::Scope scope("otpselect", "flash");
+  scope.Arg("mode", val);
   if (ioctl(fd_, OTPSELECT, &val) < 0) {
     DLOG(ERROR) << "ioctl failed and returned error: " << strerror(errno);
     throw std::runtime_error("UserOTPAccess: ioctl failed");
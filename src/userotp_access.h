@@ -34,11 +34,12 @@ class UserOTPAccess final: public FlashAccess {
    * Creates an instance of UserOTPAccess
    *
    */
-  explicit UserOTPAccess(const std::string &device_name);
+  explicit UserOTPAccess(const std::string &device_name, bool read_only = false);
   ~UserOTPAccess();
 
   void Write(const std::vector<uint8_t> &buf, const int offset);
   std::vector<uint8_t> Read(const int size, const int offset);
+  void ReadInto(uint8_t *buf, const int size, const int offset);
 
  private:
   void SelectUserOTP();
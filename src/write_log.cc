@@ -0,0 +1,271 @@
+/**
+ * @file
+ * Append-only log of OTP register writes
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#include "write_log.h"
+#include <glog/logging.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include "crc16_ops.h"
+#include "file_lock.h"
+
+const int WriteLog::kDefaultMaxDelayMs;
+
+static const uint8_t kMagic[] = {'P', 'W'};
+static const uint8_t kFormatVersion = 1;
+/* magic, length, format version, register, timestamp */
+static const size_t kFixedHeaderSize = 2 + 2 + 1 + 1 + 8;
+static const size_t kCRCSize = 2;
+static const size_t kMinRecordSize = kFixedHeaderSize + 1 + 2 + 2 + kCRCSize;
+
+static void PutBE(uint64_t value, int bytes, std::vector<uint8_t> *out) {
+  for (int i = bytes - 1; i >= 0; i--) {
+    out->push_back((value >> (8 * i)) & 0xFF);
+  }
+}
+
+static uint64_t GetBE(const uint8_t *ptr, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value = (value << 8) | ptr[i];
+  }
+  return value;
+}
+
+std::vector<uint8_t> WriteLog::Encode(const WriteLogRecord &record) {
+  if (record.serial.size() > 0xFF || record.old_data.size() > 0xFFFF ||
+      record.new_data.size() > 0xFFFF) {
+    LOG(ERROR) << "Write log record too large";
+    throw std::runtime_error("Write log record too large");
+  }
+  size_t length = kMinRecordSize + record.serial.size() + record.old_data.size() +
+                  record.new_data.size();
+  if (length > 0xFFFF) {
+    LOG(ERROR) << "Write log record too large";
+    throw std::runtime_error("Write log record too large");
+  }
+  std::vector<uint8_t> out(kMagic, kMagic + sizeof(kMagic));
+  out.reserve(length);
+  PutBE(length, 2, &out);
+  out.push_back(kFormatVersion);
+  out.push_back(record.register_number);
+  PutBE(record.timestamp_us, 8, &out);
+  out.push_back(record.serial.size());
+  out.insert(out.end(), record.serial.begin(), record.serial.end());
+  PutBE(record.old_data.size(), 2, &out);
+  out.insert(out.end(), record.old_data.begin(), record.old_data.end());
+  PutBE(record.new_data.size(), 2, &out);
+  out.insert(out.end(), record.new_data.begin(), record.new_data.end());
+  PutBE(crc16_block(0, out.data(), out.size()), 2, &out);
+  return out;
+}
+
+bool WriteLog::Decode(const uint8_t *data, size_t size, WriteLogRecord *record, size_t *length) {
+  if (size < kFixedHeaderSize || memcmp(data, kMagic, sizeof(kMagic))) {
+    return false;
+  }
+  *length = GetBE(data + 2, 2);
+  if (*length < kMinRecordSize || *length > size ||
+      crc16_block(0, data, *length - kCRCSize) != GetBE(data + *length - kCRCSize, 2)) {
+    return false;
+  }
+
+  /* variable parts must add up to the length */
+  const uint8_t *end = data + *length - kCRCSize;
+  const uint8_t *ptr = data + kFixedHeaderSize;
+  size_t serial_size = *ptr++;
+  if (ptr + serial_size + 2 > end) {
+    return false;
+  }
+  const uint8_t *serial = ptr;
+  ptr += serial_size;
+  size_t old_size = GetBE(ptr, 2);
+  ptr += 2;
+  if (ptr + old_size + 2 > end) {
+    return false;
+  }
+  const uint8_t *old_data = ptr;
+  ptr += old_size;
+  size_t new_size = GetBE(ptr, 2);
+  ptr += 2;
+  if (ptr + new_size != end) {
+    return false;
+  }
+
+  if (record) {
+    record->register_number = data[5];
+    record->timestamp_us = GetBE(data + 6, 8);
+    record->serial.assign(serial, serial + serial_size);
+    record->old_data.assign(old_data, old_data + old_size);
+    record->new_data.assign(ptr, ptr + new_size);
+  }
+  return true;
+}
+
+static off_t FileSize(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    LOG(ERROR) << "fstat failed: " << strerror(errno);
+    throw std::runtime_error("Write log fstat failed");
+  }
+  return st.st_size;
+}
+
+WriteLog::WriteLog(const std::string &path, const std::vector<uint8_t> &serial, int max_delay_ms)
+    : path_(path), serial_(serial), max_delay_ms_(max_delay_ms), syncs_(0) {
+  fd_ = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (fd_ < 0) {
+    LOG(ERROR) << "Can't open " << path << ": " << strerror(errno);
+    throw std::runtime_error("Can't open write log: " + path);
+  }
+  sync_fd_ = open((path + ".sync").c_str(), O_RDWR | O_CREAT, 0644);
+  if (sync_fd_ < 0) {
+    LOG(ERROR) << "Can't open " << path << ".sync: " << strerror(errno);
+    close(fd_);
+    throw std::runtime_error("Can't open write log: " + path);
+  }
+}
+
+WriteLog::~WriteLog() {
+  close(sync_fd_);
+  close(fd_);
+}
+
+void WriteLog::Append(const WriteLogRecord &record) {
+  std::vector<uint8_t> data = Encode(record);
+  /* O_APPEND makes the single write atomic against other writers */
+  ssize_t ret;
+  do {
+    ret = write(fd_, data.data(), data.size());
+  } while (ret < 0 && errno == EINTR);
+  if (ret != static_cast<ssize_t>(data.size())) {
+    LOG(ERROR) << "Write log append failed: " << (ret < 0 ? strerror(errno) : "short write");
+    throw std::runtime_error("Write log append failed: " + path_);
+  }
+  /* file offset is now just after this record */
+  off_t end = lseek(fd_, 0, SEEK_CUR);
+  if (end < 0) {
+    LOG(ERROR) << "lseek failed: " << strerror(errno);
+    throw std::runtime_error("Write log append failed: " + path_);
+  }
+  Commit(end);
+}
+
+void WriteLog::Commit(off_t end) {
+  struct stat st;
+  if (fstat(fd_, &st) < 0) {
+    LOG(ERROR) << "fstat failed: " << strerror(errno);
+    throw std::runtime_error("Write log fstat failed");
+  }
+
+  FileLock lock(sync_fd_, LOCK_EX, "write log");
+  /* side file holds inode and synced size of the log, a replaced log starts over */
+  uint8_t synced[16] = {};
+  if (pread(sync_fd_, synced, sizeof(synced), 0) == sizeof(synced) &&
+      GetBE(synced, 8) == st.st_ino && GetBE(synced + 8, 8) >= static_cast<uint64_t>(end)) {
+    return;
+  }
+
+  /* leader, give writers still appending a chance to share the sync */
+  off_t size = FileSize(fd_);
+  for (int waited = 0; waited < max_delay_ms_; waited++) {
+    usleep(1000);
+    off_t grown = FileSize(fd_);
+    if (grown == size) {
+      break;
+    }
+    size = grown;
+  }
+
+  if (fdatasync(fd_) < 0) {
+    LOG(ERROR) << "fdatasync failed: " << strerror(errno);
+    throw std::runtime_error("Write log sync failed: " + path_);
+  }
+  syncs_++;
+  std::vector<uint8_t> state;
+  PutBE(st.st_ino, 8, &state);
+  PutBE(size, 8, &state);
+  if (pwrite(sync_fd_, state.data(), state.size(), 0) != static_cast<ssize_t>(state.size())) {
+    /* only costs other writers an extra sync */
+    LOG(WARNING) << "Updating " << path_ << ".sync failed";
+  }
+}
+
+void WriteLog::AfterWrite(int register_number, const std::vector<uint8_t> &old_data,
+                          const std::vector<uint8_t> &new_data,
+                          const std::set<std::string> &fields) {
+  WriteLogRecord record;
+  record.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  record.register_number = register_number;
+  record.serial = serial_;
+  record.old_data = old_data;
+  record.new_data = new_data;
+  Append(record);
+}
+
+WriteLogIndex::WriteLogIndex(const std::string &path) : file_(path), corrupted_(0) {
+  const uint8_t *data = file_.Data();
+  size_t size = file_.Size();
+  size_t offset = 0;
+  while (offset + kFixedHeaderSize <= size) {
+    size_t length = 0;
+    if (WriteLog::Decode(data + offset, size - offset, NULL, &length)) {
+      const uint8_t *serial = data + offset + kFixedHeaderSize;
+      index_[std::string(serial + 1, serial + 1 + *serial)].push_back(offset);
+      offsets_.push_back(offset);
+    } else if (!memcmp(data + offset, kMagic, sizeof(kMagic)) && length >= kMinRecordSize &&
+               offset + length <= size) {
+      /* complete record with bad content, skip it */
+      corrupted_++;
+    } else {
+      break;
+    }
+    offset += length;
+  }
+  if (offset < size) {
+    LOG(WARNING) << path << ": " << size - offset << " bytes of torn record at end ignored";
+  }
+}
+
+WriteLogRecord WriteLogIndex::RecordAt(size_t offset) const {
+  WriteLogRecord record;
+  size_t length;
+  WriteLog::Decode(file_.Data() + offset, file_.Size() - offset, &record, &length);
+  return record;
+}
+
+std::vector<WriteLogRecord> WriteLogIndex::Find(const std::vector<uint8_t> &serial) const {
+  std::vector<WriteLogRecord> records;
+  const auto it = index_.find(std::string(serial.begin(), serial.end()));
+  if (it != index_.end()) {
+    for (size_t offset : it->second) {
+      records.push_back(RecordAt(offset));
+    }
+  }
+  return records;
+}
+
+void WriteLogIndex::ForEach(const std::function<void(const WriteLogRecord &)> &fn) const {
+  for (size_t offset : offsets_) {
+    fn(RecordAt(offset));
+  }
+}
@@ -0,0 +1,176 @@
+/**
+ * @file
+ * Append-only log of OTP register writes
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#ifndef WRITELOG_H_
+#define WRITELOG_H_
+
+#include <sys/types.h>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "device_data.h"
+#include "mapped_file.h"
+
+/**
+ * @brief One logged register write
+ */
+struct WriteLogRecord {
+  /** microseconds since the epoch */
+  uint64_t timestamp_us;
+  int register_number;
+  std::vector<uint8_t> serial;
+  std::vector<uint8_t> old_data;
+  std::vector<uint8_t> new_data;
+};
+
+/**
+ * @brief Append-only binary log of every programmed register, shared by all writers of a host
+ *
+ * Each record is appended with a single O_APPEND write and is on disk when Append returns.
+ * fdatasync is group committed: writers queue on a lock of the "<log>.sync" side file, the
+ * first one syncs the log for everybody queued behind it and the side file tells the others
+ * their record is already covered. Before syncing, the leader waits while other writers keep
+ * appending, at most max_delay_ms, which bounds the extra latency of a write.
+ *
+ * Record format (big endian): "PW", total length (2), format version (1), register (1),
+ * timestamp (8), serial length (1) and serial, old length (2) and old data, new length (2)
+ * and new data, CRC-16 of all previous bytes (2).
+ */
+class WriteLog : public WriteHook {
+ public:
+  static const int kDefaultMaxDelayMs = 5;
+
+  /**
+   * @brief Constructor, opens or creates the log
+   *
+   * @param[in] path log file
+   * @param[in] serial serial number of the board written by this process
+   * @param[in] max_delay_ms longest wait for other writers before syncing
+   */
+  WriteLog(const std::string &path, const std::vector<uint8_t> &serial,
+           int max_delay_ms = kDefaultMaxDelayMs);
+  ~WriteLog();
+
+  WriteLog(const WriteLog &) = delete;
+  WriteLog &operator=(const WriteLog &) = delete;
+
+  /**
+   * @brief Append record and wait until it is on disk
+   *
+   * @param[in] record record to append
+   */
+  void Append(const WriteLogRecord &record);
+
+  /**
+   * @brief Log a programmed register with current time and the serial number of the board
+   */
+  void AfterWrite(int register_number, const std::vector<uint8_t> &old_data,
+                  const std::vector<uint8_t> &new_data, const std::set<std::string> &fields);
+
+  /**
+   * @brief Number of fdatasync done by this instance
+   */
+  int Syncs() const { return syncs_; }
+
+  /**
+   * @brief Encode record in log format
+   *
+   * @param[in] record record to encode
+   * returns encoded record
+   */
+  static std::vector<uint8_t> Encode(const WriteLogRecord &record);
+
+  /**
+   * @brief Decode record at start of data
+   *
+   * @param[in] data log data
+   * @param[in] size bytes available
+   * @param[out] record decoded record, may be NULL to only check the record
+   * @param[out] length length of the record, set whenever the header is complete
+   * returns false on truncated or corrupted record
+   */
+  static bool Decode(const uint8_t *data, size_t size, WriteLogRecord *record, size_t *length);
+
+ private:
+  /**
+   * @brief Wait until the log is on disk up to end, syncing it unless another writer did
+   *
+   * @param[in] end log offset just after the record
+   */
+  void Commit(off_t end);
+
+  const std::string path_;
+  const std::vector<uint8_t> serial_;
+  const int max_delay_ms_;
+  int fd_;
+  int sync_fd_;
+  int syncs_;
+};
+
+/**
+ * @brief Read-only view of a write log indexed by serial number
+ *
+ * The log is mapped and indexed in a single pass, records are decoded on lookup only. A torn
+ * record at the end (writer killed during append) ends the log.
+ */
+class WriteLogIndex {
+ public:
+  /**
+   * @brief Constructor, maps and indexes the log
+   *
+   * @param[in] path log file
+   */
+  explicit WriteLogIndex(const std::string &path);
+
+  /**
+   * @brief Records of one board in log order
+   *
+   * @param[in] serial serial number
+   * returns records, empty if the board was never written
+   */
+  std::vector<WriteLogRecord> Find(const std::vector<uint8_t> &serial) const;
+
+  /**
+   * @brief Call fn with every record in log order
+   *
+   * @param[in] fn callback
+   */
+  void ForEach(const std::function<void(const WriteLogRecord &)> &fn) const;
+
+  /**
+   * @brief Number of valid records
+   */
+  size_t Size() const { return offsets_.size(); }
+
+  /**
+   * @brief Number of records skipped because of CRC failure
+   */
+  int Corrupted() const { return corrupted_; }
+
+ private:
+  WriteLogRecord RecordAt(size_t offset) const;
+
+  MappedFile file_;
+  std::vector<size_t> offsets_;
+  std::unordered_map<std::string, std::vector<size_t>> index_;
+  int corrupted_;
+};
+
+#endif  // WRITELOG_H_
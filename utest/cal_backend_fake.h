@@ -0,0 +1,157 @@
+/**
+ * @file
+ * Simulated CalBackend
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef CALBACKEND_FAKE_H
+#define CALBACKEND_FAKE_H
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <utility>
+#include "cal_backend.h"
+
+/**
+ * @brief Counts measurements running at the same time on several simulated paths
+ */
+struct MeasureTracker {
+  MeasureTracker() : active(0), max_active(0) {}
+
+  /* simulated instrument time, overlapping with other paths */
+  void Measure(int delay_ms) {
+    int now = ++active;
+    int max = max_active;
+    while (now > max && !max_active.compare_exchange_weak(max, now)) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+    active--;
+  }
+
+  std::atomic<int> active;
+  std::atomic<int> max_active;
+};
+
+/**
+ * @brief Simulated radio whose power detector is off by a fixed error per antenna and band
+ */
+class FakeCalBackend : public CalBackend {
+ public:
+  FakeCalBackend() : tunes(0), pd_offset_sets(0), tx_power_sets(0), measurements(0),
+                     dcxo_zero(0), dcxo_slope(1), dcxo_cubic(0), dcxo_sets(0), tracker(NULL),
+                     measure_delay_ms(0), tx_power_(0), dcxo_(0) {}
+
+  void Tune(const CalParams &params) {
+    tunes++;
+    tuned_ = params;
+  }
+
+  void SetPdOffset(int antenna, int channel, int offset) {
+    pd_offset_sets++;
+  }
+
+  void SetTxPower(int power) {
+    tx_power_sets++;
+    tx_power_ = power;
+  }
+
+  double MeasureTxPower(const CalParams &params) {
+    measurements++;
+    if (tracker) {
+      tracker->Measure(measure_delay_ms);
+    }
+    /* with both chains on, the power meter of the measurement path picks the antenna */
+    return TxPowerAt(tuned_.num_spatial_streams == 1 ? tuned_.antenna : params.antenna);
+  }
+
+  /**
+   * @brief Power a meter on antenna reads for the current driver state, thread safe
+   */
+  double TxPowerAt(int antenna) const {
+    const auto it = pd_error.find(std::make_pair(antenna, ChannelBand(tuned_.channel)));
+    return tx_power_ - (it == pd_error.end() ? 0 : it->second);
+  }
+
+  void SetDcxo(int8_t value) {
+    dcxo_sets++;
+    dcxo_ = value;
+  }
+
+  double MeasureFrequencyOffset() {
+    return CrystalOffset(dcxo_);
+  }
+
+  /**
+   * @brief Simulated crystal: frequency offset pulled by DCXO value
+   */
+  double CrystalOffset(int dcxo) const {
+    double x = dcxo - dcxo_zero;
+    return dcxo_slope * x + dcxo_cubic * x * x * x;
+  }
+
+  /** simulated power detector error in dB per (antenna, band) */
+  std::map<std::pair<int, int>, double> pd_error;
+  int tunes;
+  int pd_offset_sets;
+  int tx_power_sets;
+  int measurements;
+  /** DCXO value of zero frequency offset */
+  double dcxo_zero;
+  double dcxo_slope;
+  double dcxo_cubic;
+  int dcxo_sets;
+  /** if set, measurements take measure_delay_ms and are tracked for overlap */
+  MeasureTracker *tracker;
+  int measure_delay_ms;
+
+ private:
+  CalParams tuned_;
+  int tx_power_;
+  int dcxo_;
+};
+
+/**
+ * @brief Simulated second measurement path: a power meter on the radio driven by another backend
+ */
+class FakeMeasurementPath : public CalBackend {
+ public:
+  FakeMeasurementPath(const FakeCalBackend *radio, MeasureTracker *tracker, int delay_ms)
+      : measurements(0), driver_calls(0), radio_(radio), tracker_(tracker),
+        delay_ms_(delay_ms) {}
+
+  void Tune(const CalParams &params) { driver_calls++; }
+  void SetPdOffset(int antenna, int channel, int offset) { driver_calls++; }
+  void SetTxPower(int power) { driver_calls++; }
+  void SetDcxo(int8_t value) { driver_calls++; }
+  double MeasureFrequencyOffset() { return 0; }
+
+  double MeasureTxPower(const CalParams &params) {
+    measurements++;
+    tracker_->Measure(delay_ms_);
+    return radio_->TxPowerAt(params.antenna);
+  }
+
+  int measurements;
+  /** calls that would change the radio, a measurement path must not make any */
+  int driver_calls;
+
+ private:
+  const FakeCalBackend *radio_;
+  MeasureTracker *tracker_;
+  int delay_ms_;
+};
+#endif
@@ -0,0 +1,109 @@
+/**
+ * @file
+ * In-memory FlashAccess counting device operations
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#ifndef FLASHACCESS_FAKE_H
+#define FLASHACCESS_FAKE_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include "flash_access.h"
+
+/**
+ * @brief Device operations counted by FakeFlashAccess
+ */
+struct FlashCounters {
+  /** ioctls, e.g OTPSELECT of the serial number read */
+  int ioctls = 0;
+  /** read calls, through Read() or ReadInto() */
+  int reads = 0;
+  /** program operations (Write() calls) */
+  int writes = 0;
+  int bytes_read = 0;
+  int bytes_written = 0;
+  /** buffers allocated to return read data */
+  int allocations = 0;
+};
+
+/**
+ * @brief In-memory OTP model counting every device operation
+ *
+ * Programming only clears bits by default, as on OTP.
+ */
+class FakeFlashAccess : public FlashAccess {
+ public:
+  explicit FakeFlashAccess(const std::vector<uint8_t> &content, bool clear_only = true)
+      : FlashAccess("/dev/null"), content(content), serial(8, 0x01), locked(false),
+        clear_only_(clear_only) {}
+
+  void Write(const std::vector<uint8_t> &buf, const int offset) {
+    CheckRange(buf.size(), offset);
+    counters.writes++;
+    counters.bytes_written += buf.size();
+    for (size_t i = 0; i < buf.size(); i++) {
+      content[offset + i] = clear_only_ ? content[offset + i] & buf[i] : buf[i];
+    }
+  }
+
+  std::vector<uint8_t> Read(const int size, const int offset) {
+    counters.allocations++;
+    std::vector<uint8_t> buf(size);
+    ReadInto(buf.data(), size, offset);
+    return buf;
+  }
+
+  void ReadInto(uint8_t *buf, const int size, const int offset) {
+    CheckRange(size, offset);
+    counters.reads++;
+    counters.bytes_read += size;
+    std::copy(content.begin() + offset, content.begin() + offset + size, buf);
+  }
+
+  std::vector<uint8_t> ReadSerial() {
+    counters.ioctls++;
+    counters.reads++;
+    counters.allocations++;
+    counters.bytes_read += serial.size();
+    return serial;
+  }
+
+  bool ClearOnlyProgramming() const {
+    return clear_only_;
+  }
+
+  bool Locked(const int size, const int offset) {
+    counters.ioctls++;
+    return locked;
+  }
+
+  /** device content */
+  std::vector<uint8_t> content;
+  std::vector<uint8_t> serial;
+  /** whether user OTP is locked */
+  bool locked;
+  FlashCounters counters;
+
+ private:
+  void CheckRange(int size, int offset) const {
+    if (offset < 0 || size < 0 || offset + size > static_cast<int>(content.size())) {
+      throw std::runtime_error("fake flash access out of range");
+    }
+  }
+
+  const bool clear_only_;
+};
+#endif
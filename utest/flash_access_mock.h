@@ -44,5 +44,15 @@ class MockFlashAccess : public FlashAccess {
    * @brief mock method for ReadSerial method of FlashAccess
    */
   MOCK_METHOD0(ReadSerial, std::vector<uint8_t>());
+
+  /**
+   * @brief mock method for ClearOnlyProgramming method of FlashAccess
+   */
+  MOCK_CONST_METHOD0(ClearOnlyProgramming, bool());
+
+  /**
+   * @brief mock method for Locked method of FlashAccess
+   */
+  MOCK_METHOD2(Locked, bool(const int, const int));
 };
 #endif
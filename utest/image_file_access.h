@@ -0,0 +1,67 @@
+/**
+ * @file
+ * FlashAccess over an OTP image file
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#ifndef IMAGE_FILE_ACCESS_H
+#define IMAGE_FILE_ACCESS_H
+
+#include <sched.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "flash_access.h"
+
+/**
+ * @brief FlashAccess over a regular file holding a raw OTP image
+ *
+ * Every instance has its own open file description, so instances lock against each other like
+ * separate processes do. A slow instance programs byte by byte, yielding in between, to widen
+ * the window in which an unlocked reader would see a half written register.
+ */
+class ImageFileAccess : public FlashAccess {
+ public:
+  explicit ImageFileAccess(const std::string &path, bool read_only = false, bool slow = false)
+      : FlashAccess(path, read_only), slow_(slow) {}
+
+  void Write(const std::vector<uint8_t> &buf, const int offset) {
+    int chunk = slow_ ? 1 : buf.size();
+    for (int i = 0; i < static_cast<int>(buf.size()); i += chunk) {
+      if (pwrite(fd_, buf.data() + i, chunk, offset + i) != chunk) {
+        throw std::runtime_error("image write failed");
+      }
+      if (slow_) {
+        sched_yield();
+      }
+    }
+  }
+
+  std::vector<uint8_t> Read(const int size, const int offset) {
+    std::vector<uint8_t> buf(size);
+    if (pread(fd_, buf.data(), size, offset) != size) {
+      throw std::runtime_error("image read failed");
+    }
+    return buf;
+  }
+
+  bool ClearOnlyProgramming() const {
+    return false;
+  }
+
+ private:
+  const bool slow_;
+};
+#endif
@@ -0,0 +1,67 @@
+/**
+ * @file
+ * Raw OTP image builder for tests
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#ifndef OTP_IMAGE_H
+#define OTP_IMAGE_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "device_fields.h"
+
+extern "C" {
+#include "lib_crc.h"
+}
+
+/* registers 0 to 2 as read by DeviceData::ReadImage */
+static const int kOtpImageSize = fields::kRegisterSize * 3;
+
+/**
+ * @brief Store CRC of register data (after the CRC field) at base of image
+ */
+inline void SetImageCRC(std::vector<uint8_t> *image, int base, int size) {
+  int16_t crc = 0;
+  for (int i = base + 2; i < base + size; i++) {
+    crc = update_crc_16(crc, (*image)[i]);
+  }
+  (*image)[base] = (crc >> 8) & 0xff;
+  (*image)[base + 1] = crc & 0xff;
+}
+
+/**
+ * @brief Raw OTP image with register 0 version 1, register 1 of given version and register 2
+ *        blank, all fields 0 except those in reg1_fields (register 1 offset relative to 256)
+ */
+inline std::vector<uint8_t> MakeImage(int reg1_version,
+                                      const std::vector<std::pair<int, uint8_t>> &reg1_fields =
+                                          std::vector<std::pair<int, uint8_t>>()) {
+  static const int reg1_size[] = {3, 4, 14};
+  std::vector<uint8_t> image(kOtpImageSize, 0xFF);
+  std::fill(image.begin(), image.begin() + 39, 0x00);
+  image[2] = 0x01;
+  SetImageCRC(&image, 0, 39);
+  std::fill(image.begin() + 256, image.begin() + 256 + reg1_size[reg1_version], 0x00);
+  image[258] = reg1_version;
+  for (const auto &field : reg1_fields) {
+    image[256 + field.first] = field.second;
+  }
+  SetImageCRC(&image, 256, reg1_size[reg1_version]);
+  return image;
+}
+
+#endif
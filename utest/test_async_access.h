@@ -0,0 +1,95 @@
+/**
+ * @file
+ * Testsuite for AsyncFlashAccess and AsyncDeviceData
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <future>
+#include <vector>
+#include "async_device_data.h"
+#include "async_flash_access.h"
+#include "flash_access_mock.h"
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Return;
+using ::testing::Throw;
+
+class AsyncAccessTestSuite : public CxxTest::TestSuite {
+ public:
+  AsyncAccessTestSuite() {
+    google::InitGoogleLogging("AsyncAccess utest");
+  }
+
+  ~AsyncAccessTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void TestOperationsRunInOrder() {
+    std::unique_ptr<FlashAccess> flash_access(new MockFlashAccess);
+    MockFlashAccess *flash_mock = static_cast<MockFlashAccess *>(flash_access.get());
+    AsyncFlashAccess async_access(std::move(flash_access));
+
+    std::vector<uint8_t> data(4, 0x5A);
+    std::vector<uint8_t> serial(8, 0x01);
+    {
+      InSequence sequence;
+      EXPECT_CALL(*flash_mock, Write(data, 256)).Times(1);
+      EXPECT_CALL(*flash_mock, Read(4, 256)).WillOnce(Return(data));
+      EXPECT_CALL(*flash_mock, ReadSerial()).WillOnce(Return(serial));
+    }
+
+    std::future<void> written = async_access.Write(data, 256);
+    std::future<std::vector<uint8_t>> read = async_access.Read(4, 256);
+    std::future<std::vector<uint8_t>> read_serial = async_access.ReadSerial();
+    TS_ASSERT_EQUALS(read_serial.get(), serial);
+    TS_ASSERT_EQUALS(read.get(), data);
+    written.get();
+  }
+
+  void TestErrorInFuture() {
+    std::unique_ptr<FlashAccess> flash_access(new MockFlashAccess);
+    MockFlashAccess *flash_mock = static_cast<MockFlashAccess *>(flash_access.get());
+    AsyncFlashAccess async_access(std::move(flash_access));
+
+    EXPECT_CALL(*flash_mock, Write(_, _))
+        .WillOnce(Throw(std::runtime_error("mtd write failed")));
+    std::future<void> written = async_access.Write(std::vector<uint8_t>(1, 0x00), 0);
+    TS_ASSERT_THROWS_EQUALS(written.get(), std::exception &e, e.what(), "mtd write failed");
+  }
+
+  void TestDeviceDataWriteField() {
+    std::unique_ptr<FlashAccess> flash_access(new MockFlashAccess);
+    MockFlashAccess *flash_mock = static_cast<MockFlashAccess *>(flash_access.get());
+    AsyncDeviceData device_data(std::move(flash_access));
+
+    unsigned char old_reg1_buf[] = {0x30, 0x40, 0x01, 0x11};
+    std::vector<uint8_t> old_reg1_data(old_reg1_buf, old_reg1_buf + 4);
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(3)
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(old_reg1_data));
+    EXPECT_CALL(*flash_mock, Write(_, 256)).Times(1);
+    std::future<void> written = device_data.WriteField("DCXO", std::vector<uint8_t>(1, 0x1A));
+    written.get();
+
+    std::future<void> invalid = device_data.WriteField("VERSION_REG1",
+                                                       std::vector<uint8_t>(1, 0x02));
+    TS_ASSERT_THROWS_EQUALS(invalid.get(), std::exception &e, e.what(),
+                            "Cannot modify register version");
+  }
+};
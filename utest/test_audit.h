@@ -0,0 +1,161 @@
+/**
+ * @file
+ * Testsuite for dump archive audit
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "audit.h"
+#include "otp_image.h"
+#include "parallel_for.h"
+
+class AuditTestSuite : public CxxTest::TestSuite {
+ private:
+  std::string dir;
+  std::vector<std::string> created;
+
+  void WriteFile(const std::string &path, const std::vector<uint8_t> &data) {
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    created.push_back(path);
+  }
+
+ public:
+  AuditTestSuite() {
+    google::InitGoogleLogging("Audit utest");
+  }
+
+  ~AuditTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    char name[] = "/tmp/auditXXXXXX";
+    dir = mkdtemp(name);
+    created.clear();
+  }
+
+  void tearDown() {
+    for (const auto &path : created) {
+      unlink(path.c_str());
+    }
+    rmdir(dir.c_str());
+  }
+
+  void TestParallelForCoversEveryIndexOnce() {
+    const size_t count = 10007;
+    std::vector<std::atomic<int>> seen(count);
+    for (auto &s : seen) {
+      s = 0;
+    }
+    ParallelFor(count, 4, 16, [&](int worker, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        seen[i]++;
+      }
+    });
+    for (size_t i = 0; i < count; i++) {
+      TS_ASSERT_EQUALS(seen[i], 1);
+    }
+  }
+
+  void TestParallelForRethrows() {
+    TS_ASSERT_THROWS_EQUALS(
+        ParallelFor(100, 2, 1, [](int worker, size_t begin, size_t end) {
+          if (begin == 42) {
+            throw std::runtime_error("item 42");
+          }
+        }), std::exception &e, e.what(), "item 42");
+  }
+
+  void TestCheckImage() {
+    std::vector<uint8_t> image = MakeImage(2);
+    DeviceData::ImageCheck check = DeviceData::CheckImage(image.data(), image.size());
+    TS_ASSERT_EQUALS(check.status[0], DeviceData::kRegisterValid);
+    TS_ASSERT_EQUALS(check.status[1], DeviceData::kRegisterValid);
+    TS_ASSERT_EQUALS(check.version[1], 2);
+
+    check = DeviceData::CheckImage(image.data(), 260);
+    TS_ASSERT_EQUALS(check.status[1], DeviceData::kRegisterTruncated);
+
+    image[300] = 0x00;
+    image[259] ^= 0x01;
+    check = DeviceData::CheckImage(image.data(), image.size());
+    TS_ASSERT_EQUALS(check.status[1], DeviceData::kRegisterCRCFailed);
+
+    image[258] = 0x07;
+    check = DeviceData::CheckImage(image.data(), image.size());
+    TS_ASSERT_EQUALS(check.status[1], DeviceData::kRegisterUnknownVersion);
+
+    std::vector<uint8_t> blank(DumpSet::kDumpSize, 0xFF);
+    check = DeviceData::CheckImage(blank.data(), blank.size());
+    TS_ASSERT_EQUALS(check.status[0], DeviceData::kRegisterBlank);
+    TS_ASSERT_EQUALS(check.status[1], DeviceData::kRegisterBlank);
+  }
+
+  void TestAuditDirectory() {
+    WriteFile(dir + "/a", MakeImage(1));
+    WriteFile(dir + "/b", MakeImage(2));
+    std::vector<uint8_t> corrupted = MakeImage(2);
+    corrupted[5] ^= 0x10;
+    WriteFile(dir + "/c", corrupted);
+
+    DumpSet dumps(dir);
+    TS_ASSERT_EQUALS(dumps.Count(), 3u);
+    AuditReport report = Audit(dumps, 2);
+    TS_ASSERT_EQUALS(report.dumps, 3u);
+    TS_ASSERT_EQUALS(report.status[0][DeviceData::kRegisterValid], 2u);
+    TS_ASSERT_EQUALS(report.status[0][DeviceData::kRegisterCRCFailed], 1u);
+    TS_ASSERT_EQUALS(report.versions[1][1], 1u);
+    TS_ASSERT_EQUALS(report.versions[1][2], 2u);
+    TS_ASSERT_EQUALS(report.problem_count, 1u);
+    TS_ASSERT_EQUALS(report.problems[0], "c: register 0 CRC failed");
+  }
+
+  void TestAuditPackfile() {
+    std::vector<uint8_t> pack;
+    for (int i = 0; i < 1000; i++) {
+      std::vector<uint8_t> image = MakeImage(i % 3);
+      pack.insert(pack.end(), image.begin(), image.end());
+    }
+    /* unit 500 has an unknown register 1 version */
+    pack[500 * DumpSet::kDumpSize + 258] = 0x09;
+    std::string path = dir + "/units.pack";
+    WriteFile(path, pack);
+
+    AuditReport report = Audit(DumpSet(path), 0);
+    TS_ASSERT_EQUALS(report.dumps, 1000u);
+    TS_ASSERT_EQUALS(report.status[0][DeviceData::kRegisterValid], 1000u);
+    TS_ASSERT_EQUALS(report.status[1][DeviceData::kRegisterValid], 999u);
+    TS_ASSERT_EQUALS(report.status[1][DeviceData::kRegisterUnknownVersion], 1u);
+    TS_ASSERT_EQUALS(report.versions[1][0] + report.versions[1][1] + report.versions[1][2], 999u);
+    TS_ASSERT_EQUALS(report.problems[0], path + "#500: register 1 unknown version");
+  }
+
+  void TestInvalidPackfile() {
+    std::string path = dir + "/short.pack";
+    WriteFile(path, std::vector<uint8_t>(100, 0x00));
+    TS_ASSERT_THROWS_EQUALS(DumpSet dumps(path), std::exception &e, e.what(),
+                            "Invalid packfile: " + path);
+  }
+};
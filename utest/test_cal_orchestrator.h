@@ -0,0 +1,205 @@
+/**
+ * @file
+ * Unit tests for CalOrchestrator class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "cal_backend_fake.h"
+#include "cal_orchestrator.h"
+#include "flash_access_mock.h"
+#include "otp_image.h"
+
+using ::testing::_;
+using ::testing::Return;
+
+/* measurement path whose instrument fails */
+class FailingPath : public FakeMeasurementPath {
+ public:
+  FailingPath(const FakeCalBackend *radio, MeasureTracker *tracker)
+      : FakeMeasurementPath(radio, tracker, 0) {}
+
+  double MeasureTxPower(const CalParams &params) {
+    throw std::runtime_error("power meter 2 failed");
+  }
+};
+
+class CalOrchestratorTestSuite : public CxxTest::TestSuite {
+ private:
+  SweepPlan plan;
+  MeasureTracker *tracker;
+  FakeCalBackend *backend;
+  FakeMeasurementPath *path2;
+
+ public:
+  CalOrchestratorTestSuite() {
+    google::InitGoogleLogging("CalOrchestrator utest");
+  }
+
+  ~CalOrchestratorTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    plan = SweepPlan();
+    plan.antennas = {1, 2};
+    plan.channels = {1, 6, 36, 40};
+    plan.tx_powers = {10, 15, 20};
+    tracker = new MeasureTracker;
+    backend = new FakeCalBackend;
+    backend->tracker = tracker;
+    backend->measure_delay_ms = 2;
+    path2 = new FakeMeasurementPath(backend, tracker, 2);
+  }
+
+  void tearDown() {
+    delete path2;
+    delete backend;
+    delete tracker;
+  }
+
+  void TestConcurrentStepsCoverBothAntennas() {
+    CalOrchestrator orchestrator(plan, {backend, path2});
+    TS_ASSERT(orchestrator.Concurrent());
+    TS_ASSERT_EQUALS(orchestrator.Sweep().Steps().size(), 12u);
+    TS_ASSERT_EQUALS(orchestrator.Sweep().Retunes(), 4);
+
+    orchestrator.Run();
+    TS_ASSERT_EQUALS(backend->tunes, 4);
+    TS_ASSERT_EQUALS(backend->pd_offset_sets, 8);
+    TS_ASSERT_EQUALS(backend->tx_power_sets, 12);
+    TS_ASSERT_EQUALS(backend->measurements, 12);
+    TS_ASSERT_EQUALS(path2->measurements, 12);
+    TS_ASSERT_EQUALS(path2->driver_calls, 0);
+    TS_ASSERT_EQUALS(tracker->max_active, 2);
+
+    const std::vector<CalMeasurement> &measurements = orchestrator.Measurements();
+    TS_ASSERT_EQUALS(measurements.size(), 24u);
+    TS_ASSERT_EQUALS(measurements[0].params.antenna, 1);
+    TS_ASSERT_EQUALS(measurements[1].params.antenna, 2);
+    TS_ASSERT_EQUALS(measurements[1].params.channel, measurements[0].params.channel);
+    TS_ASSERT_EQUALS(measurements[1].params.tx_power, measurements[0].params.tx_power);
+  }
+
+  void TestConcurrentOffsetsMatchSerial() {
+    backend->pd_error[std::make_pair(1, kBand24)] = 2;
+    backend->pd_error[std::make_pair(1, kBand51)] = -3;
+    backend->pd_error[std::make_pair(2, kBand24)] = 1;
+    backend->pd_error[std::make_pair(2, kBand51)] = 5;
+
+    CalOrchestrator concurrent(plan, {backend, path2});
+    concurrent.Run();
+    CalOrchestrator serial(plan, {backend});
+    TS_ASSERT(!serial.Concurrent());
+    serial.Run();
+
+    std::map<std::string, std::vector<uint8_t>> offsets = concurrent.PdOffsets();
+    TS_ASSERT_EQUALS(offsets, serial.PdOffsets());
+    TS_ASSERT_EQUALS(offsets.size(), 4u);
+    TS_ASSERT_EQUALS(static_cast<int8_t>(offsets["PD_A1_B51"][0]), -3);
+    TS_ASSERT_EQUALS(static_cast<int8_t>(offsets["PD_A2_B51"][0]), 5);
+  }
+
+  void TestSerialFallback() {
+    CalOrchestrator orchestrator(plan, {backend});
+    TS_ASSERT(!orchestrator.Concurrent());
+    TS_ASSERT_EQUALS(orchestrator.Sweep().Steps().size(), 24u);
+    orchestrator.Run();
+    TS_ASSERT_EQUALS(backend->tunes, 8);
+    TS_ASSERT_EQUALS(backend->measurements, 24);
+    TS_ASSERT_EQUALS(tracker->max_active, 1);
+    TS_ASSERT_EQUALS(orchestrator.Measurements().size(), 24u);
+
+    /* a single antenna needs no second path */
+    plan.antennas = {2};
+    CalOrchestrator single(plan, {backend, path2});
+    TS_ASSERT(!single.Concurrent());
+  }
+
+  void TestInvalidPaths() {
+    TS_ASSERT_THROWS_EQUALS(CalOrchestrator orchestrator(plan, {}), std::exception &e,
+                            e.what(), std::string("No measurement path"));
+    plan.antennas = {1, 1};
+    TS_ASSERT_THROWS_EQUALS(CalOrchestrator orchestrator(plan, {backend, path2}),
+                            std::exception &e, e.what(), std::string("Antenna listed twice: 1"));
+    plan.antennas = {1, 3};
+    TS_ASSERT_THROWS_EQUALS(CalOrchestrator orchestrator(plan, {backend, path2}),
+                            std::exception &e, e.what(), std::string("Invalid antenna: 3"));
+  }
+
+  void TestMeasurementErrorStopsRun() {
+    FailingPath failing(backend, tracker);
+    CalOrchestrator orchestrator(plan, {backend, &failing});
+    TS_ASSERT_THROWS_EQUALS(orchestrator.Run(), std::exception &e, e.what(),
+                            std::string("power meter 2 failed"));
+    TS_ASSERT_EQUALS(backend->tx_power_sets, 1);
+  }
+
+  void TestCommitSingleWrite() {
+    std::unique_ptr<FlashAccess> flash_access(new MockFlashAccess);
+    MockFlashAccess *flash_mock = static_cast<MockFlashAccess *>(flash_access.get());
+    DeviceData device_data(std::move(flash_access));
+
+    std::vector<uint8_t> reg1_data(14, 0x00);
+    reg1_data[2] = 0x02;
+    SetImageCRC(&reg1_data, 0, reg1_data.size());
+
+    backend->pd_error[std::make_pair(1, kBand51)] = -3;
+    backend->pd_error[std::make_pair(2, kBand24)] = 4;
+    CalOrchestrator orchestrator(plan, {backend, path2});
+    orchestrator.Run();
+
+    std::vector<uint8_t> new_reg1_data(14, 0x00);
+    new_reg1_data[2] = 0x02;
+    new_reg1_data[5] = 0xFD;
+    new_reg1_data[9] = 0x04;
+    SetImageCRC(&new_reg1_data, 0, new_reg1_data.size());
+
+    /* offsets of both antennas, register 1 is read and programmed once */
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(3)
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x02)))
+        .WillOnce(Return(reg1_data));
+    EXPECT_CALL(*flash_mock, Write(new_reg1_data, 256)).Times(1);
+    orchestrator.Commit(&device_data);
+  }
+
+  void TestConcurrentCommands() {
+    /* measurement paths run their commands from separate threads */
+    auto run = [](const std::string &text, int *matches) {
+      for (int i = 0; i < 20; i++) {
+        std::string output;
+        RunCommand({"/bin/echo", text}, &output);
+        *matches += output == text + "\n";
+      }
+    };
+    int matches1 = 0;
+    int matches2 = 0;
+    std::thread path1(run, "antenna 1", &matches1);
+    std::thread path2(run, "antenna 2", &matches2);
+    path1.join();
+    path2.join();
+    TS_ASSERT_EQUALS(matches1, 20);
+    TS_ASSERT_EQUALS(matches2, 20);
+  }
+};
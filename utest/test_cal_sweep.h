@@ -0,0 +1,154 @@
+/**
+ * @file
+ * Testsuite for CalSweep
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <vector>
+#include "cal_backend_fake.h"
+#include "cal_sweep.h"
+#include "flash_access_mock.h"
+
+extern "C" {
+#include "lib_crc.h"
+}
+
+using ::testing::_;
+using ::testing::Return;
+
+class CalSweepTestSuite : public CxxTest::TestSuite {
+ private:
+  SweepPlan plan;
+  FakeCalBackend *backend;
+
+  static void AddCRC(std::vector<uint8_t> *data) {
+    int16_t crc = 0;
+    for (auto it = data->begin(); it != data->end(); ++it) {
+      crc = update_crc_16(crc, *it);
+    }
+    data->insert(data->begin(), crc & 0xff);
+    data->insert(data->begin(), (crc >> 8) & 0xff);
+  }
+
+ public:
+  CalSweepTestSuite() {
+    google::InitGoogleLogging("CalSweep utest");
+  }
+
+  ~CalSweepTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    plan = SweepPlan();
+    plan.antennas = {1, 2};
+    plan.channels = {1, 6, 36, 40};
+    plan.tx_powers = {10, 15, 20};
+    backend = new FakeCalBackend;
+  }
+
+  void tearDown() {
+    delete backend;
+  }
+
+  void TestStepsOrderedForMinimalRetunes() {
+    CalSweep sweep(plan);
+    TS_ASSERT_EQUALS(sweep.Steps().size(), 24u);
+    TS_ASSERT_EQUALS(sweep.Retunes(), 8);
+
+    sweep.Run(backend);
+    TS_ASSERT_EQUALS(backend->tunes, 8);
+    TS_ASSERT_EQUALS(backend->pd_offset_sets, 8);
+    TS_ASSERT_EQUALS(backend->tx_power_sets, 24);
+    TS_ASSERT_EQUALS(backend->measurements, 24);
+  }
+
+  void TestRetuneNotNeededForPowerOnly() {
+    plan.antennas = {1};
+    plan.channels = {6};
+    CalSweep sweep(plan);
+    TS_ASSERT_EQUALS(sweep.Retunes(), 1);
+    TS_ASSERT(sweep.Steps()[0].retune);
+    TS_ASSERT(!sweep.Steps()[1].retune);
+  }
+
+  void TestInvalidStandardSkipped() {
+    /* data rate 11 is 11b which only exists on 2.4G */
+    plan.data_rates = {11};
+    CalSweep sweep(plan);
+    TS_ASSERT_EQUALS(sweep.Steps().size(), 12u);
+  }
+
+  void TestInvalidPlan() {
+    plan.channels = {15};
+    TS_ASSERT_THROWS_EQUALS(CalSweep sweep(plan), std::exception &e, e.what(),
+                            "Invalid channel: 15");
+    plan.channels = {1};
+    plan.antennas = {3};
+    TS_ASSERT_THROWS_EQUALS(CalSweep sweep(plan), std::exception &e, e.what(),
+                            "Invalid antenna: 3");
+    plan.antennas = {1};
+    plan.tx_powers.clear();
+    TS_ASSERT_THROWS_EQUALS(CalSweep sweep(plan), std::exception &e, e.what(),
+                            "Sweep has no tx powers");
+  }
+
+  void TestPdOffsets() {
+    backend->pd_error[std::make_pair(1, kBand24)] = 2;
+    backend->pd_error[std::make_pair(1, kBand51)] = -3;
+    backend->pd_error[std::make_pair(2, kBand24)] = 0;
+    backend->pd_error[std::make_pair(2, kBand51)] = 5;
+
+    CalSweep sweep(plan);
+    sweep.Run(backend);
+    std::map<std::string, std::vector<uint8_t>> offsets = sweep.PdOffsets();
+    TS_ASSERT_EQUALS(offsets.size(), 4u);
+    TS_ASSERT_EQUALS(static_cast<int8_t>(offsets["PD_A1_B24"][0]), 2);
+    TS_ASSERT_EQUALS(static_cast<int8_t>(offsets["PD_A1_B51"][0]), -3);
+    TS_ASSERT_EQUALS(static_cast<int8_t>(offsets["PD_A2_B24"][0]), 0);
+    TS_ASSERT_EQUALS(static_cast<int8_t>(offsets["PD_A2_B51"][0]), 5);
+  }
+
+  void TestCommitSingleWrite() {
+    std::unique_ptr<FlashAccess> flash_access(new MockFlashAccess);
+    MockFlashAccess *flash_mock = static_cast<MockFlashAccess *>(flash_access.get());
+    DeviceData device_data(std::move(flash_access));
+
+    std::vector<uint8_t> reg1_data(12, 0x00);
+    reg1_data[0] = 0x02;
+    AddCRC(&reg1_data);
+
+    backend->pd_error[std::make_pair(1, kBand51)] = -3;
+    backend->pd_error[std::make_pair(2, kBand24)] = 4;
+    CalSweep sweep(plan);
+    sweep.Run(backend);
+
+    std::vector<uint8_t> new_reg1_data(12, 0x00);
+    new_reg1_data[0] = 0x02;
+    new_reg1_data[3] = 0xFD;
+    new_reg1_data[7] = 0x04;
+    AddCRC(&new_reg1_data);
+
+    /* register 0 is left untouched, register 1 is read and programmed once */
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(3)
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x02)))
+        .WillOnce(Return(reg1_data));
+    EXPECT_CALL(*flash_mock, Write(new_reg1_data, 256)).Times(1);
+    sweep.Commit(&device_data);
+  }
+};
@@ -0,0 +1,110 @@
+/**
+ * @file
+ * Unit tests for CRC-16 delta update and combine
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include "crc16_ops.h"
+#include "parallel_crc.h"
+extern "C" {
+#include "lib_crc.h"
+}
+
+/* reference: byte by byte over the whole buffer */
+static unsigned short FullCrc(const std::vector<uint8_t> &data) {
+  unsigned short crc = 0;
+  for (uint8_t byte : data) {
+    crc = update_crc_16(crc, byte);
+  }
+  return crc;
+}
+
+static std::vector<uint8_t> RandomData(size_t size) {
+  std::vector<uint8_t> data(size);
+  for (auto &byte : data) {
+    byte = rand() & 0xff;
+  }
+  return data;
+}
+
+class Crc16TestSuite : public CxxTest::TestSuite {
+ public:
+  void setUp() {
+    srand(46);
+  }
+
+  void TestBlock() {
+    std::vector<uint8_t> data = RandomData(300);
+    TS_ASSERT_EQUALS(crc16_block(0, data.data(), data.size()), FullCrc(data));
+    /* known value of CRC-16/ARC */
+    const unsigned char check[] = "123456789";
+    TS_ASSERT_EQUALS(crc16_block(0, check, 9), 0xBB3D);
+  }
+
+  void TestShift() {
+    for (size_t len : {0, 1, 2, 7, 254, 1000, 65537}) {
+      std::vector<uint8_t> data = RandomData(20);
+      unsigned short crc = FullCrc(data);
+      data.resize(data.size() + len, 0);
+      TS_ASSERT_EQUALS(crc16_shift(crc, len), FullCrc(data));
+    }
+  }
+
+  void TestCombine() {
+    for (size_t len2 : {0, 1, 3, 256, 4097}) {
+      std::vector<uint8_t> a = RandomData(37);
+      std::vector<uint8_t> b = RandomData(len2);
+      std::vector<uint8_t> ab(a);
+      ab.insert(ab.end(), b.begin(), b.end());
+      TS_ASSERT_EQUALS(crc16_combine(FullCrc(a), FullCrc(b), b.size()), FullCrc(ab));
+    }
+  }
+
+  void TestUpdate() {
+    std::vector<uint8_t> data = RandomData(254);
+    unsigned short crc = FullCrc(data);
+    /* replace ranges at start, middle and end, one after the other */
+    for (auto range : std::vector<std::pair<size_t, size_t>>{{0, 1}, {1, 6}, {100, 12},
+                                                             {253, 1}, {0, 254}}) {
+      std::vector<uint8_t> new_bytes = RandomData(range.second);
+      crc = crc16_update(crc, data.size(), range.first, data.data() + range.first,
+                         new_bytes.data(), new_bytes.size());
+      std::copy(new_bytes.begin(), new_bytes.end(), data.begin() + range.first);
+      TS_ASSERT_EQUALS(crc, FullCrc(data));
+    }
+  }
+
+  void TestUpdateUnchanged() {
+    std::vector<uint8_t> data = RandomData(12);
+    unsigned short crc = FullCrc(data);
+    TS_ASSERT_EQUALS(crc16_update(crc, data.size(), 4, data.data() + 4, data.data() + 4, 6), crc);
+  }
+
+  void TestParallel() {
+    /* sizes around the block size and a last partial block */
+    for (size_t size : {0u, 100u, (1u << 20) + 1, 5u << 20, (7u << 20) - 3}) {
+      std::vector<uint8_t> data = RandomData(size);
+      unsigned short crc = FullCrc(data);
+      TS_ASSERT_EQUALS(ParallelCrc16(data.data(), data.size(), 0), crc);
+      TS_ASSERT_EQUALS(ParallelCrc16(data.data(), data.size(), 3), crc);
+      TS_ASSERT_EQUALS(ParallelCrc16(data.data(), data.size(), 1), crc);
+    }
+  }
+};
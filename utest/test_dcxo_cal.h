@@ -0,0 +1,121 @@
+/**
+ * @file
+ * Testsuite for DcxoCalibrator
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <cmath>
+#include <vector>
+#include "cal_backend_fake.h"
+#include "dcxo_cal.h"
+#include "flash_access_mock.h"
+
+using ::testing::_;
+using ::testing::Return;
+
+class DcxoCalibratorTestSuite : public CxxTest::TestSuite {
+ private:
+  FakeCalBackend *backend;
+
+  /* exhaustive search over all values, what a linear sweep would find */
+  int BruteForce() {
+    int best = -128;
+    for (int value = -128; value <= 127; value++) {
+      if (std::fabs(backend->CrystalOffset(value)) < std::fabs(backend->CrystalOffset(best))) {
+        best = value;
+      }
+    }
+    return best;
+  }
+
+ public:
+  DcxoCalibratorTestSuite() {
+    google::InitGoogleLogging("DcxoCalibrator utest");
+  }
+
+  ~DcxoCalibratorTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    backend = new FakeCalBackend;
+  }
+
+  void tearDown() {
+    delete backend;
+  }
+
+  void TestLinearCrystal() {
+    backend->dcxo_zero = -40.3;
+    backend->dcxo_slope = 35;
+    DcxoCalibrator calibrator(backend);
+    TS_ASSERT_EQUALS(calibrator.Search(), BruteForce());
+    TS_ASSERT_LESS_THAN_EQUALS(calibrator.Measurements(), 5);
+    TS_ASSERT_EQUALS(backend->dcxo_sets, calibrator.Measurements());
+  }
+
+  void TestNonLinearCrystal() {
+    /* pulling curve with negative slope and strong cubic term */
+    const double zeros[] = {-120.6, -3.5, 17.6, 90.2};
+    for (double zero : zeros) {
+      backend->dcxo_zero = zero;
+      backend->dcxo_slope = -20;
+      backend->dcxo_cubic = -0.004;
+      DcxoCalibrator calibrator(backend);
+      TS_ASSERT_EQUALS(calibrator.Search(), BruteForce());
+      TS_ASSERT_LESS_THAN_EQUALS(calibrator.Measurements(), 8);
+    }
+  }
+
+  void TestOutOfRange() {
+    backend->dcxo_zero = 300;
+    DcxoCalibrator calibrator(backend);
+    TS_ASSERT_EQUALS(calibrator.Search(), 127);
+    TS_ASSERT_EQUALS(calibrator.Measurements(), 2);
+  }
+
+  void TestTolerance() {
+    backend->dcxo_zero = 10.2;
+    backend->dcxo_slope = 1;
+    DcxoCalibrator calibrator(backend, 1.0);
+    int8_t value = calibrator.Search();
+    TS_ASSERT_LESS_THAN_EQUALS(std::fabs(backend->CrystalOffset(value)), 1.0);
+    TS_ASSERT_LESS_THAN_EQUALS(calibrator.Measurements(), 3);
+  }
+
+  void TestCommitSingleWriteField() {
+    std::unique_ptr<FlashAccess> flash_access(new MockFlashAccess);
+    MockFlashAccess *flash_mock = static_cast<MockFlashAccess *>(flash_access.get());
+    DeviceData device_data(std::move(flash_access));
+
+    backend->dcxo_zero = -10;
+    DcxoCalibrator calibrator(backend);
+    TS_ASSERT_THROWS_EQUALS(calibrator.Commit(&device_data), std::exception &e, e.what(),
+                            "DCXO search has not been run");
+    calibrator.Search();
+
+    /* DCXO -10 (0xF6) replaces 0x11, CRC updated */
+    unsigned char old_reg1_buf[] = {0x30, 0x40, 0x01, 0x11};
+    std::vector<uint8_t> old_reg1_data(old_reg1_buf, old_reg1_buf + 4);
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(3)
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(old_reg1_data));
+    EXPECT_CALL(*flash_mock, Write(_, 256)).Times(1);
+    calibrator.Commit(&device_data);
+  }
+};
@@ -18,12 +18,19 @@
 
 #include <cxxtest/TestSuite.h>
 #include <glog/logging.h>
+#include <map>
+#include <string>
 #include <vector>
 #include "flash_access_mock.h"
 #include "device_data.h"
 
+extern "C" {
+#include "lib_crc.h"
+}
+
 using ::testing::_;
 using ::testing::Return;
+using ::testing::SaveArg;
 
 class DeviceDataTestSuite : public CxxTest::TestSuite {
  private:
@@ -31,6 +38,15 @@ class DeviceDataTestSuite : public CxxTest::TestSuite {
   MockFlashAccess *flash_mock;
   DeviceData *device_data;
 
+  static void AddCRC(std::vector<uint8_t> *data) {
+    int16_t crc = 0;
+    for (auto it = data->begin(); it != data->end(); ++it) {
+      crc = update_crc_16(crc, *it);
+    }
+    data->insert(data->begin(), crc & 0xff);
+    data->insert(data->begin(), (crc >> 8) & 0xff);
+  }
+
  public:
   DeviceDataTestSuite() {
     google::InitGoogleLogging("DeviceData utest");
@@ -265,4 +281,287 @@ class DeviceDataTestSuite : public CxxTest::TestSuite {
     EXPECT_CALL(*flash_mock, ReadSerial()).Times(1).WillOnce(Return(serial));
     TS_ASSERT_EQUALS(device_data->ReadField("SERIAL"), serial);
   }
+
+  void TestGetTypedField() {
+    std::vector<uint8_t> reg0_version_(1, 0x01);
+    std::vector<uint8_t> reg1_version_(1, 0x01);
+
+    unsigned char reg0_buf[] = {0x7e, 0x6e, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11, 0x11,
+                               0x11, 0x11, 0x11, 0x11, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x33,
+                               0x33, 0x33, 0x33, 0x33, 0x33, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44,
+                               0x55, 0x55, 0x55, 0x55, 0x55, 0x55};
+    /* DCXO value 0xF6 is -10 as signed char */
+    std::vector<uint8_t> reg1_data = {0x00, 0x00, 0x01, 0xF6};
+    int16_t crc = 0;
+    for (auto it = reg1_data.begin() + 2; it != reg1_data.end(); ++it) {
+      crc = update_crc_16(crc, *it);
+    }
+    reg1_data[0] = (crc >> 8) & 0xff;
+    reg1_data[1] = crc & 0xff;
+
+    std::vector<uint8_t> reg0_data(reg0_buf, reg0_buf + 39);
+
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(2)
+        .WillOnce(Return(reg0_version_))
+        .WillOnce(Return(reg0_data));
+    fields::MacAddress mac1 = {{0x11, 0x11, 0x11, 0x11, 0x11, 0x11}};
+    TS_ASSERT(device_data->Get<fields::MAC_1>() == mac1);
+
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(2)
+        .WillOnce(Return(reg1_version_))
+        .WillOnce(Return(reg1_data));
+    TS_ASSERT_EQUALS(device_data->Get<fields::DCXO>(), -10);
+  }
+
+  void TestGetTypedFieldNotInVersion() {
+    /* PD offsets are only defined from register1 version 2 */
+    std::vector<uint8_t> reg1_version_(1, 0x01);
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(1)
+        .WillOnce(Return(reg1_version_));
+
+    TS_ASSERT_THROWS_EQUALS(device_data->Get<fields::PD_A1_B24>(),
+                            std::exception &e, e.what(), "No valid reg version");
+  }
+
+  void TestLayoutSizesMatchLayouts() {
+    for (int reg = 0; reg < 2; reg++) {
+      for (int version = 0; version < fields::kLayoutVersions; version++) {
+        const auto it = DeviceLayouts::Layouts()[reg].find(version);
+        int size = 0;
+        if (it != DeviceLayouts::Layouts()[reg].end()) {
+          for (const auto &field : it->second) {
+            size += field.second.size;
+          }
+        }
+        TS_ASSERT_EQUALS(fields::LayoutSize(reg, version), size);
+      }
+      TS_ASSERT_EQUALS(DeviceLayouts::Layouts()[reg].count(fields::kLayoutVersions), 0u);
+    }
+  }
+
+  void TestGetTypedFieldCRCFailure() {
+    std::vector<uint8_t> reg1_version_(1, 0x01);
+    std::vector<uint8_t> reg1_data = {0x22, 0x22, 0x01, 0x11};
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(2)
+        .WillOnce(Return(reg1_version_))
+        .WillOnce(Return(reg1_data));
+
+    TS_ASSERT_THROWS_EQUALS(device_data->Get<fields::DCXO>(),
+                            std::exception &e, e.what(), "Data corrupted:CRC failed");
+  }
+
+  void TestSetTypedField() {
+    std::vector<uint8_t> reg0_version_(1, 0x01);
+    std::vector<uint8_t> reg1_version_(1, 0x01);
+    unsigned char old_reg1_buf[] = {0x5d, 0x15, 0x01, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+                                    0x18, 0x19, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27,
+                                    0x28, 0x29};
+    std::vector<uint8_t> old_reg1_data(old_reg1_buf, old_reg1_buf + sizeof(old_reg1_buf));
+    unsigned char new_reg1_buf[] = {0x78, 0xb3, 0x01, 0x1A, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+                                    0x18, 0x19, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27,
+                                    0x28, 0x29};
+    std::vector<uint8_t> new_reg1_data(new_reg1_buf, new_reg1_buf + sizeof(new_reg1_buf));
+
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(3)
+        .WillOnce(Return(reg0_version_))
+        .WillOnce(Return(reg1_version_))
+        .WillOnce(Return(old_reg1_data));
+    EXPECT_CALL(*flash_mock, Write(new_reg1_data, _)).Times(1);
+    device_data->Set<fields::DCXO>(0x1A);
+  }
+
+  void TestWriteFieldsOneWritePerRegister() {
+    std::vector<uint8_t> reg0_data(37, 0x00);
+    reg0_data[0] = 0x01;
+    std::vector<uint8_t> reg1_data(12, 0x00);
+    reg1_data[0] = 0x02;
+    std::vector<uint8_t> new_reg0_data(reg0_data);
+    new_reg0_data[1] = 0xAA;
+    new_reg0_data[6] = 0xBB;
+    std::vector<uint8_t> new_reg1_data(reg1_data);
+    new_reg1_data[1] = 0x0A;
+    new_reg1_data[2] = 0xFE;
+    new_reg1_data[11] = 0x03;
+    AddCRC(&reg0_data);
+    AddCRC(&reg1_data);
+    AddCRC(&new_reg0_data);
+    AddCRC(&new_reg1_data);
+
+    std::map<std::string, std::vector<uint8_t>> values;
+    values["MAC_0"] = {0xAA, 0x00, 0x00, 0x00, 0x00, 0xBB};
+    values["DCXO"] = {0x0A};
+    values["PD_A1_B24"] = {0xFE};
+    values["PD_A2_B54"] = {0x03};
+
+    /* versions are read once, each register is read and written once */
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(4)
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x02)))
+        .WillOnce(Return(reg0_data))
+        .WillOnce(Return(reg1_data));
+    EXPECT_CALL(*flash_mock, Write(new_reg0_data, 0)).Times(1);
+    EXPECT_CALL(*flash_mock, Write(new_reg1_data, 256)).Times(1);
+    device_data->WriteFields(values);
+  }
+
+  void TestWriteFieldsKeepsWrongCRC() {
+    std::vector<uint8_t> reg1_data(12, 0x00);
+    reg1_data[0] = 0x02;
+    std::vector<uint8_t> new_reg1_data(reg1_data);
+    new_reg1_data[1] = 0x0A;
+    AddCRC(&reg1_data);
+    AddCRC(&new_reg1_data);
+    /* a stored CRC not matching the data keeps its mismatch, the register stays corrupted */
+    reg1_data[1] ^= 0x5A;
+    new_reg1_data[1] ^= 0x5A;
+
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(3)
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x02)))
+        .WillOnce(Return(reg1_data));
+    EXPECT_CALL(*flash_mock, Write(new_reg1_data, 256)).Times(1);
+    device_data->WriteField("DCXO", {0x0A});
+  }
+
+  void TestWriteFieldsValidatedBeforeWrite() {
+    std::map<std::string, std::vector<uint8_t>> values;
+    values["DCXO"] = {0x0A};
+    values["MAC_0"] = {0xAA};
+
+    /* MAC_0 size is wrong, so no register is read or written */
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(2)
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x02)));
+    EXPECT_CALL(*flash_mock, Write(_, _)).Times(0);
+    TS_ASSERT_THROWS_EQUALS(device_data->WriteFields(values),
+                            std::exception &e, e.what(), "Invalid field size");
+
+    values["MAC_0"] = {0xAA, 0x00, 0x00, 0x00, 0x00, 0xBB};
+    values["VERSION_REG1"] = {0x03};
+    TS_ASSERT_THROWS_EQUALS(device_data->WriteFields(values),
+                            std::exception &e, e.what(), "Cannot modify register version");
+  }
+
+  void TestUpgradeLayoutRefusedOnOTP() {
+    /* register 1 version 1 with DCXO 0x11, version 2 fields still erased */
+    std::vector<uint8_t> reg1_data = {0x01, 0x11};
+    AddCRC(&reg1_data);
+    reg1_data.insert(reg1_data.end(), 10, 0xFF);
+
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(3)
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(reg1_data));
+    EXPECT_CALL(*flash_mock, ClearOnlyProgramming()).WillOnce(Return(true));
+    EXPECT_CALL(*flash_mock, Write(_, _)).Times(0);
+    std::map<std::string, std::vector<uint8_t>> new_fields;
+    TS_ASSERT_THROWS_ASSERT(device_data->UpgradeLayout(1, new_fields), std::exception &e,
+                            TS_ASSERT(std::string(e.what()).find("Upgrade needs bits set") == 0));
+  }
+
+  void TestUpgradeLayoutProgramsChangedBytes() {
+    std::vector<uint8_t> reg1_data = {0x01, 0x11};
+    AddCRC(&reg1_data);
+    reg1_data.insert(reg1_data.end(), 10, 0xFF);
+
+    /* version 2 with PD_A1_B51 -3, other new fields 0 */
+    std::vector<uint8_t> new_reg1_data(12, 0x00);
+    new_reg1_data[0] = 0x02;
+    new_reg1_data[1] = 0x11;
+    new_reg1_data[3] = 0xFD;
+    AddCRC(&new_reg1_data);
+
+    std::map<std::string, std::vector<uint8_t>> new_fields;
+    new_fields["PD_A1_B51"] = {0xFD};
+
+    /* the one unchanged byte (DCXO) is inside a run, so a single program of the register */
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(3)
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(reg1_data));
+    EXPECT_CALL(*flash_mock, ClearOnlyProgramming()).WillOnce(Return(false));
+    EXPECT_CALL(*flash_mock, Write(new_reg1_data, 256)).Times(1);
+    TS_ASSERT_EQUALS(device_data->UpgradeLayout(1, new_fields), 2);
+  }
+
+  void TestUpgradeLayoutUnchangedTail() {
+    std::vector<uint8_t> reg1_data = {0x01, 0x11};
+    AddCRC(&reg1_data);
+    reg1_data.insert(reg1_data.end(), 10, 0xFF);
+
+    /* new fields keep their erased value, only CRC and version change */
+    std::map<std::string, std::vector<uint8_t>> new_fields;
+    const char *names[] = {"PD_A1_B24", "PD_A1_B51", "PD_A1_B52", "PD_A1_B53", "PD_A1_B54",
+                           "PD_A2_B24", "PD_A2_B51", "PD_A2_B52", "PD_A2_B53", "PD_A2_B54"};
+    for (const char *name : names) {
+      new_fields[name] = {0xFF};
+    }
+    std::vector<uint8_t> new_reg1_data = {0x02, 0x11};
+    new_reg1_data.insert(new_reg1_data.end(), 10, 0xFF);
+    AddCRC(&new_reg1_data);
+
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(3)
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(reg1_data));
+    EXPECT_CALL(*flash_mock, ClearOnlyProgramming()).WillOnce(Return(false));
+    EXPECT_CALL(*flash_mock, Write(std::vector<uint8_t>(new_reg1_data.begin(),
+                                                        new_reg1_data.begin() + 3), 256))
+        .Times(1);
+    TS_ASSERT_EQUALS(device_data->UpgradeLayout(1, new_fields), 2);
+  }
+
+  void TestUpgradeLayoutInvalid() {
+    EXPECT_CALL(*flash_mock, Read(_, _)).Times(4)
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x02)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)))
+        .WillOnce(Return(std::vector<uint8_t>(1, 0x01)));
+    std::map<std::string, std::vector<uint8_t>> new_fields;
+    TS_ASSERT_THROWS_EQUALS(device_data->UpgradeLayout(1, new_fields), std::exception &e,
+                            e.what(), "No layout version 3 for register 1");
+    new_fields["DCXO"] = {0x00};
+    TS_ASSERT_THROWS_EQUALS(device_data->UpgradeLayout(1, new_fields), std::exception &e,
+                            e.what(), "Not a new field of version 2: DCXO");
+  }
+
+  void TestWriteRecord() {
+    std::vector<uint8_t> erased(256, 0xFF);
+    std::vector<uint8_t> value = {0x12, 0x34};
+    EXPECT_CALL(*flash_mock, Read(256, 512)).Times(1).WillOnce(Return(erased));
+    EXPECT_CALL(*flash_mock, Read(6, 512)).Times(1).WillOnce(Return(erased));
+    EXPECT_CALL(*flash_mock, Write(_, 512)).Times(1);
+    device_data->WriteRecord(1, value);
+
+    /* index is kept, second record is appended right after the first one */
+    EXPECT_CALL(*flash_mock, Read(5, 518)).Times(1).WillOnce(Return(erased));
+    EXPECT_CALL(*flash_mock, Write(_, 518)).Times(1);
+    device_data->WriteRecord(1, std::vector<uint8_t>{0x56});
+    TS_ASSERT_EQUALS(device_data->ReadRecord(1), std::vector<uint8_t>{0x56});
+  }
+
+  void TestWriteRecordAfterOtherWriter() {
+    std::vector<uint8_t> erased(256, 0xFF);
+    EXPECT_CALL(*flash_mock, Read(256, 512)).Times(1).WillOnce(Return(erased));
+    EXPECT_CALL(*flash_mock, Read(6, 512)).Times(1).WillOnce(Return(erased));
+    std::vector<uint8_t> first;
+    EXPECT_CALL(*flash_mock, Write(_, 512)).WillOnce(SaveArg<0>(&first));
+    device_data->WriteRecord(1, {0x12, 0x34});
+
+    /* another process appended a record, the index is reloaded before programming */
+    std::vector<uint8_t> area(erased);
+    std::copy(first.begin(), first.end(), area.begin());
+    std::copy(first.begin(), first.end(), area.begin() + first.size());
+    EXPECT_CALL(*flash_mock, Read(5, 518)).WillOnce(Return(std::vector<uint8_t>(5, 0x00)));
+    EXPECT_CALL(*flash_mock, Read(256, 512)).WillOnce(Return(area));
+    EXPECT_CALL(*flash_mock, Write(_, 524)).Times(1);
+    device_data->WriteRecord(2, {0x56});
+  }
+
+  void TestReadRecordMissing() {
+    std::vector<uint8_t> erased(256, 0xFF);
+    EXPECT_CALL(*flash_mock, Read(256, 512)).Times(1).WillOnce(Return(erased));
+    TS_ASSERT_THROWS_EQUALS(device_data->ReadRecord(9),
+                            std::exception &e, e.what(), "No record for key: 9");
+  }
 };
@@ -0,0 +1,140 @@
+/**
+ * @file
+ * Unit tests for device discovery
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "device_discovery.h"
+
+class DeviceDiscoveryTestSuite : public CxxTest::TestSuite {
+ public:
+  DeviceDiscoveryTestSuite() {
+    google::InitGoogleLogging("DeviceDiscovery utest");
+  }
+
+  ~DeviceDiscoveryTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    char root[] = "/tmp/proddata_root_XXXXXX";
+    root_ = mkdtemp(root);
+    for (const char *dir : {"/proc", "/sys", "/sys/class", "/sys/class/mtd", "/dev"}) {
+      mkdir((root_ + dir).c_str(), 0755);
+    }
+    proc_mtd_.clear();
+    probes_.clear();
+    otp_.clear();
+  }
+
+  void tearDown() {
+    TS_ASSERT_EQUALS(system(("rm -rf " + root_).c_str()), 0);
+  }
+
+  void WriteFile(const std::string &path, const std::string &content) {
+    std::ofstream(root_ + path) << content;
+  }
+
+  /* fake MTD partition: /proc/mtd line, sysfs attributes and device node */
+  void AddPartition(int index, const std::string &name, const std::string &type, bool writable) {
+    std::string sys = "/sys/class/mtd/mtd" + std::to_string(index);
+    mkdir((root_ + sys).c_str(), 0755);
+    WriteFile(sys + "/type", type + "\n");
+    WriteFile(sys + "/flags", writable ? "0xc00\n" : "0x800\n");
+    WriteFile(sys + "/name", name + "\n");
+    WriteFile("/dev/mtd" + std::to_string(index), "");
+    proc_mtd_ += "mtd" + std::to_string(index) + ": 00100000 00010000 \"" + name + "\"\n";
+    WriteFile("/proc/mtd", "dev:    size   erasesize  name\n" + proc_mtd_);
+  }
+
+  DiscoveredDevice Discover() {
+    DeviceDiscovery discovery(root_, root_ + "/cache", [this](const std::string &device) {
+      probes_.push_back(device);
+      return otp_[device];
+    });
+    return discovery.Discover();
+  }
+
+  void TestWritableUserOTP() {
+    AddPartition(0, "uboot", "nor", false);
+    AddPartition(1, "firmware", "nor", true);
+    AddPartition(2, "ubi", "nand", true);
+    otp_[root_ + "/dev/mtd0"] = {{0, 768, false}};
+    otp_[root_ + "/dev/mtd1"] = {{0, 256, false}, {256, 256, false}, {512, 256, false}};
+
+    DiscoveredDevice device = Discover();
+    TS_ASSERT_EQUALS(device.path, root_ + "/dev/mtd1");
+    TS_ASSERT_EQUALS(device.backend, DiscoveredDevice::kUserOTP);
+    /* read only and NAND devices are not probed */
+    TS_ASSERT_EQUALS(probes_, std::vector<std::string>{root_ + "/dev/mtd1"});
+  }
+
+  void TestCachedResult() {
+    AddPartition(0, "firmware", "nor", true);
+    otp_[root_ + "/dev/mtd0"] = {{0, 768, false}};
+    Discover();
+    probes_.clear();
+
+    DiscoveredDevice device = Discover();
+    TS_ASSERT_EQUALS(device.path, root_ + "/dev/mtd0");
+    TS_ASSERT_EQUALS(device.backend, DiscoveredDevice::kUserOTP);
+    TS_ASSERT(probes_.empty());
+  }
+
+  void TestCacheInvalidatedByLayoutChange() {
+    AddPartition(0, "firmware", "nor", true);
+    otp_[root_ + "/dev/mtd0"] = {{0, 768, false}};
+    Discover();
+
+    /* board came up with an extra partition first */
+    proc_mtd_.clear();
+    AddPartition(3, "spare", "nor", true);
+    AddPartition(0, "firmware", "nor", true);
+    otp_[root_ + "/dev/mtd3"] = {{0, 1024, false}};
+    probes_.clear();
+    TS_ASSERT_EQUALS(Discover().path, root_ + "/dev/mtd3");
+    TS_ASSERT_EQUALS(probes_.size(), 1u);
+  }
+
+  void TestPartitionFallback() {
+    AddPartition(0, "firmware", "nor", true);
+    AddPartition(1, "proddata", "nor", true);
+    otp_[root_ + "/dev/mtd0"] = {{0, 256, false}};
+
+    DiscoveredDevice device = Discover();
+    TS_ASSERT_EQUALS(device.path, root_ + "/dev/mtd1");
+    TS_ASSERT_EQUALS(device.backend, DiscoveredDevice::kMTD);
+  }
+
+  void TestNoDevice() {
+    AddPartition(0, "firmware", "nor", true);
+    TS_ASSERT_THROWS_EQUALS(Discover(), std::exception &e, e.what(),
+                            "No production data device found");
+  }
+
+ private:
+  std::string root_;
+  std::string proc_mtd_;
+  std::vector<std::string> probes_;
+  std::map<std::string, std::vector<OtpRegion>> otp_;
+};
@@ -0,0 +1,155 @@
+/**
+ * @file
+ * Unit tests for device locking
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "device_data.h"
+#include "image_file_access.h"
+#include "otp_image.h"
+
+class DeviceLockTestSuite : public CxxTest::TestSuite {
+ public:
+  DeviceLockTestSuite() {
+    google::InitGoogleLogging("DeviceLock utest");
+  }
+
+  ~DeviceLockTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    char path[] = "/tmp/proddata_lock_XXXXXX";
+    int fd = mkstemp(path);
+    TS_ASSERT(fd >= 0);
+    std::vector<uint8_t> image = MakeImage(2);
+    TS_ASSERT_EQUALS(write(fd, image.data(), image.size()), static_cast<ssize_t>(image.size()));
+    close(fd);
+    path_ = path;
+  }
+
+  void tearDown() {
+    unlink(path_.c_str());
+  }
+
+  /* whether a lock of the given kind can be taken right now through a separate descriptor */
+  bool CanLock(bool exclusive) {
+    int fd = open(path_.c_str(), O_RDWR);
+    struct flock lock = {};
+    lock.l_type = exclusive ? F_WRLCK : F_RDLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_len = 1;
+    bool locked = fcntl(fd, F_OFD_SETLK, &lock) == 0;
+    close(fd);
+    return locked;
+  }
+
+  void TestSharedLock() {
+    ImageFileAccess access(path_);
+    access.Lock(false);
+    TS_ASSERT(CanLock(false));
+    TS_ASSERT(!CanLock(true));
+    access.Unlock();
+    TS_ASSERT(CanLock(true));
+  }
+
+  void TestExclusiveLockNests() {
+    ImageFileAccess access(path_);
+    {
+      FlashAccess::Guard outer(&access, true);
+      {
+        FlashAccess::Guard inner(&access, false);
+      }
+      TS_ASSERT(!CanLock(false));
+    }
+    TS_ASSERT(CanLock(true));
+  }
+
+  void TestSharedLockUpgradeRefused() {
+    ImageFileAccess access(path_);
+    FlashAccess::Guard guard(&access, false);
+    TS_ASSERT_THROWS_EQUALS(access.Lock(true), std::exception &e, e.what(),
+                            "Cannot upgrade shared device lock to exclusive");
+    TS_ASSERT(CanLock(false));
+  }
+
+  void TestReadOnlyAccess() {
+    DeviceData device_data(std::unique_ptr<FlashAccess>(new ImageFileAccess(path_, true)));
+    TS_ASSERT_EQUALS(device_data.ReadField("DCXO"), std::vector<uint8_t>{0x00});
+    TS_ASSERT_THROWS_EQUALS(device_data.WriteField("DCXO", {0x05}), std::exception &e, e.what(),
+                            "Locking device failed");
+    TS_ASSERT(CanLock(true));
+  }
+
+  void TestReadersAgainstWriter() {
+    const int kReaders = 8;
+    const int kWrites = 50;
+    std::atomic<bool> done(false);
+    std::atomic<int> reads(0);
+    std::atomic<int> torn(0);
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kReaders; i++) {
+      readers.emplace_back([this, &done, &reads, &torn]() {
+        DeviceData device_data(std::unique_ptr<FlashAccess>(new ImageFileAccess(path_, true)));
+        while (!done) {
+          try {
+            std::vector<uint8_t> data = device_data.Read();
+            /* fields of one write always change together */
+            if (!std::equal(data.end() - 10, data.end(), data.end() - 11)) {
+              torn++;
+            }
+          } catch (std::runtime_error &e) {
+            torn++;
+          }
+          reads++;
+        }
+      });
+    }
+
+    DeviceData writer(std::unique_ptr<FlashAccess>(new ImageFileAccess(path_, false, true)));
+    const char *names[] = {"DCXO", "PD_A1_B24", "PD_A1_B51", "PD_A1_B52", "PD_A1_B53",
+                           "PD_A1_B54", "PD_A2_B24", "PD_A2_B51", "PD_A2_B52", "PD_A2_B53",
+                           "PD_A2_B54"};
+    for (int i = 0; i < kWrites; i++) {
+      std::map<std::string, std::vector<uint8_t>> values;
+      for (const char *name : names) {
+        values[name] = {static_cast<uint8_t>(i % 2 ? 0x5A : 0x00)};
+      }
+      writer.WriteFields(values);
+    }
+    done = true;
+    for (auto &reader : readers) {
+      reader.join();
+    }
+
+    TS_ASSERT(reads > 0);
+    TS_ASSERT_EQUALS(torn, 0);
+  }
+
+ private:
+  std::string path_;
+};
@@ -0,0 +1,85 @@
+/**
+ * @file
+ * Unit tests for driver calibration parameters
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <unistd.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "device_data.h"
+#include "driver_params.h"
+#include "flash_access_fake.h"
+#include "otp_image.h"
+
+class DriverParamsTestSuite : public CxxTest::TestSuite {
+ public:
+  DriverParamsTestSuite() {
+    google::InitGoogleLogging("DriverParams utest");
+  }
+
+  ~DriverParamsTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void TestFormat() {
+    std::map<std::string, std::vector<uint8_t>> fields = {
+      {"CRC_REG1", {0x12, 0x34}}, {"VERSION_REG1", {0x02}}, {"DCXO", {0xFD}},
+      {"PD_A1_B24", {0x02}}, {"LUT", {0x0A, 0xFF}}};
+    TS_ASSERT_EQUALS(FormatDriverParams(fields), "dcxo=-3\nlut=0AFF\npd_a1_b24=2\n");
+  }
+
+  void TestApplyRegister1() {
+    FakeFlashAccess *fake = new FakeFlashAccess(MakeImage(2, {{3, 0x0A}, {4, 0xFE}}));
+    DeviceData device_data((std::unique_ptr<FlashAccess>(fake)));
+    std::string params = FormatDriverParams(device_data.ReadRegisterFields(1));
+    /* whole register in a single device read */
+    TS_ASSERT_EQUALS(fake->counters.reads, 1);
+
+    char path[] = "/tmp/proddata_params_XXXXXX";
+    close(mkstemp(path));
+    WriteDriverParams(path, params);
+    std::stringstream written;
+    written << std::ifstream(path).rdbuf();
+    unlink(path);
+    TS_ASSERT_EQUALS(written.str(), "dcxo=10\npd_a1_b24=-2\npd_a1_b51=0\npd_a1_b52=0\n"
+                     "pd_a1_b53=0\npd_a1_b54=0\npd_a2_b24=0\npd_a2_b51=0\npd_a2_b52=0\n"
+                     "pd_a2_b53=0\npd_a2_b54=0\n");
+  }
+
+  void TestActiveLayoutOnly() {
+    DeviceData device_data(std::unique_ptr<FlashAccess>(new FakeFlashAccess(MakeImage(1))));
+    TS_ASSERT_EQUALS(FormatDriverParams(device_data.ReadRegisterFields(1)), "dcxo=0\n");
+  }
+
+  void TestCorruptRegister() {
+    std::vector<uint8_t> image = MakeImage(2);
+    image[259] = 0x01;
+    DeviceData device_data(std::unique_ptr<FlashAccess>(new FakeFlashAccess(image)));
+    TS_ASSERT_THROWS_EQUALS(device_data.ReadRegisterFields(1), std::exception &e, e.what(),
+                            "Data corrupted:CRC failed");
+  }
+
+  void TestWriteFailure() {
+    TS_ASSERT_THROWS_EQUALS(WriteDriverParams("/nonexistent/params", "dcxo=0\n"),
+                            std::exception &e, e.what(),
+                            "Can't open driver parameters: /nonexistent/params");
+  }
+};
@@ -0,0 +1,240 @@
+/**
+ * @file
+ * Unit tests for ExportPack
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "device_data.h"
+#include "dump_set.h"
+#include "export_pack.h"
+#include "flash_access_fake.h"
+#include "otp_image.h"
+
+class ExportPackTestSuite : public CxxTest::TestSuite {
+ public:
+  ExportPackTestSuite() {
+    google::InitGoogleLogging("ExportPack utest");
+  }
+
+  ~ExportPackTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    char path[] = "/tmp/proddata_export_XXXXXX";
+    close(mkstemp(path));
+    path_ = path;
+    created_.clear();
+  }
+
+  void tearDown() {
+    unlink(path_.c_str());
+    unlink((path_ + ".pack").c_str());
+    for (const auto &path : created_) {
+      unlink(path.c_str());
+    }
+  }
+
+  ExportRecord Record(uint8_t serial, uint64_t timestamp_us, uint8_t dcxo = 0) {
+    ExportRecord record;
+    record.timestamp_us = timestamp_us;
+    record.serial = std::vector<uint8_t>(8, serial);
+    record.locked = 0x03;
+    record.image = MakeImage(2, {{3, dcxo}});
+    return record;
+  }
+
+  void WriteFile(const std::string &path, const std::vector<uint8_t> &data,
+                 bool append = false) {
+    std::ofstream file(path.c_str(), std::ios::binary | (append ? std::ios::app
+                                                                : std::ios::trunc));
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    if (path != path_) {
+      created_.push_back(path);
+    }
+  }
+
+  void TestEncodeDecode() {
+    ExportRecord record = Record(0x42, 1476789012345678ull, 0xFE);
+    std::vector<uint8_t> data = ExportPack::Encode(record);
+    TS_ASSERT_EQUALS(data.size(), static_cast<size_t>(ExportPack::kRecordSize));
+    TS_ASSERT_EQUALS(std::string(data.begin(), data.begin() + 4), "PDXR");
+
+    ExportRecord decoded;
+    TS_ASSERT(ExportPack::Decode(data.data(), data.size(), &decoded));
+    TS_ASSERT_EQUALS(decoded.timestamp_us, record.timestamp_us);
+    TS_ASSERT_EQUALS(decoded.serial, record.serial);
+    TS_ASSERT_EQUALS(decoded.locked, record.locked);
+    TS_ASSERT_EQUALS(decoded.image, record.image);
+
+    /* registers are stored with their CRCs, as on the device */
+    TS_ASSERT(std::equal(record.image.begin(), record.image.end(),
+                         data.begin() + ExportPack::kHeaderSize));
+  }
+
+  void TestDecodeRejectsCorruption() {
+    std::vector<uint8_t> data = ExportPack::Encode(Record(1, 1));
+    TS_ASSERT(!ExportPack::Decode(data.data(), data.size() - 1, NULL));
+    for (size_t offset : {0, 12, 21, 37, 62, 64 + 259, 831}) {
+      std::vector<uint8_t> corrupted = data;
+      corrupted[offset] ^= 0x10;
+      TS_ASSERT(!ExportPack::Decode(corrupted.data(), corrupted.size(), NULL));
+    }
+  }
+
+  void TestEncodeRejectsInvalid() {
+    ExportRecord record = Record(1, 1);
+    record.serial.resize(ExportPack::kMaxSerialSize + 1);
+    TS_ASSERT_THROWS_EQUALS(ExportPack::Encode(record), std::exception &e,
+                            std::string(e.what()), "Invalid export record");
+    record = Record(1, 1);
+    record.image.pop_back();
+    TS_ASSERT_THROWS_EQUALS(ExportPack::Encode(record), std::exception &e,
+                            std::string(e.what()), "Invalid export record");
+  }
+
+  void TestBuildAndFind() {
+    /* two collectors, boards in any order, board 2 exported twice, garbage in between */
+    std::string first = path_ + ".1";
+    std::string second = path_ + ".2";
+    WriteFile(first, ExportPack::Encode(Record(3, 30)));
+    WriteFile(first, ExportPack::Encode(Record(2, 25)), true);
+    WriteFile(first, std::vector<uint8_t>{'P', 'D', 'X', 'R', 0, 0, 0}, true);
+    WriteFile(first, ExportPack::Encode(Record(1, 10)), true);
+    WriteFile(second, ExportPack::Encode(Record(2, 20, 5)));
+
+    ExportPack::BuildStats stats = ExportPack::Build({first, second}, path_ + ".pack", 2);
+    TS_ASSERT_EQUALS(stats.records, 4u);
+    TS_ASSERT_EQUALS(stats.skipped_bytes, 7u);
+
+    ExportPack pack(path_ + ".pack");
+    TS_ASSERT_EQUALS(pack.Count(), 4u);
+    /* index order: serial, then timestamp */
+    TS_ASSERT_EQUALS(pack.Serial(0), std::vector<uint8_t>(8, 1));
+    TS_ASSERT_EQUALS(pack.Serial(3), std::vector<uint8_t>(8, 3));
+
+    std::vector<size_t> found = pack.Find(std::vector<uint8_t>(8, 2));
+    TS_ASSERT_EQUALS(found.size(), 2u);
+    ExportRecord record;
+    TS_ASSERT(pack.Get(found[0], &record));
+    TS_ASSERT_EQUALS(record.timestamp_us, 20u);
+    TS_ASSERT_EQUALS(record.image[256 + 3], 5);
+    TS_ASSERT(pack.Get(found[1], &record));
+    TS_ASSERT_EQUALS(record.timestamp_us, 25u);
+    TS_ASSERT(pack.Find(std::vector<uint8_t>(8, 4)).empty());
+    TS_ASSERT(pack.Find(std::vector<uint8_t>(7, 2)).empty());
+    TS_ASSERT(pack.Verify(2).empty());
+  }
+
+  void TestMergePackfiles() {
+    WriteFile(path_, ExportPack::Encode(Record(1, 10)));
+    ExportPack::Build({path_}, path_ + ".pack", 1);
+    std::string more = path_ + ".more";
+    WriteFile(more, ExportPack::Encode(Record(2, 20)));
+    std::string merged = path_ + ".merged";
+    created_.push_back(merged);
+    ExportPack::BuildStats stats = ExportPack::Build({path_ + ".pack", more}, merged, 1);
+    TS_ASSERT_EQUALS(stats.records, 2u);
+    TS_ASSERT_EQUALS(stats.skipped_bytes, 0u);
+    TS_ASSERT_EQUALS(ExportPack(merged).Count(), 2u);
+  }
+
+  void TestVerifyFindsCorruptedRecord() {
+    std::vector<uint8_t> data;
+    for (int i = 0; i < 100; i++) {
+      std::vector<uint8_t> record = ExportPack::Encode(Record(i, i));
+      data.insert(data.end(), record.begin(), record.end());
+    }
+    WriteFile(path_, data);
+    ExportPack::Build({path_}, path_ + ".pack", 2);
+
+    /* flip a register byte of record 42, records start after the 32 byte header */
+    size_t offset;
+    {
+      ExportPack pack(path_ + ".pack");
+      offset = pack.Record(42) - pack.Record(0);
+    }
+    std::fstream file((path_ + ".pack").c_str(), std::ios::binary | std::ios::in |
+                      std::ios::out);
+    file.seekp(32 + offset + ExportPack::kHeaderSize + 300);
+    file.put(0x55);
+    file.close();
+
+    ExportPack pack(path_ + ".pack");
+    std::vector<size_t> corrupted = pack.Verify(3);
+    TS_ASSERT_EQUALS(corrupted, std::vector<size_t>{42});
+    TS_ASSERT(!pack.Get(42, NULL));
+  }
+
+  void TestInvalidPackfile() {
+    WriteFile(path_, ExportPack::Encode(Record(1, 10)));
+    TS_ASSERT_THROWS_EQUALS(ExportPack pack(path_), std::exception &e, std::string(e.what()),
+                            "Invalid packfile: " + path_);
+
+    /* index corrupted */
+    ExportPack::Build({path_}, path_ + ".pack", 1);
+    std::fstream file((path_ + ".pack").c_str(), std::ios::binary | std::ios::in |
+                      std::ios::out);
+    file.seekp(32 + ExportPack::kRecordSize + 3);
+    file.put(0x55);
+    file.close();
+    TS_ASSERT_THROWS_EQUALS(ExportPack pack(path_ + ".pack"), std::exception &e,
+                            std::string(e.what()), "Invalid packfile: " + path_ + ".pack");
+  }
+
+  void TestDumpSetReadsPackfile() {
+    std::vector<uint8_t> data;
+    for (int i = 0; i < 3; i++) {
+      std::vector<uint8_t> record = ExportPack::Encode(Record(i, i, i));
+      data.insert(data.end(), record.begin(), record.end());
+    }
+    WriteFile(path_, data);
+    ExportPack::Build({path_}, path_ + ".pack", 1);
+
+    DumpSet dumps(path_ + ".pack");
+    TS_ASSERT_EQUALS(dumps.Count(), 3u);
+    TS_ASSERT_EQUALS(dumps.Name(1), path_ + ".pack#1:0101010101010101");
+    uint8_t buf[DumpSet::kDumpSize];
+    const uint8_t *dump = NULL;
+    TS_ASSERT_EQUALS(dumps.Get(2, buf, &dump), DumpSet::kDumpSize);
+    std::vector<uint8_t> image = MakeImage(2, {{3, 2}});
+    TS_ASSERT(std::equal(image.begin(), image.end(), dump));
+  }
+
+  void TestReadImage() {
+    std::vector<uint8_t> image = MakeImage(2, {{3, 7}});
+    FakeFlashAccess *fake = new FakeFlashAccess(image);
+    DeviceData device_data((std::unique_ptr<FlashAccess>(fake)));
+    std::vector<uint8_t> buf(ExportPack::kImageSize);
+    TS_ASSERT_EQUALS(device_data.ReadImage(buf.data()), 0);
+    TS_ASSERT_EQUALS(buf, image);
+
+    fake->locked = true;
+    TS_ASSERT_EQUALS(device_data.ReadImage(buf.data()), 0x07);
+  }
+
+ private:
+  std::string path_;
+  std::vector<std::string> created_;
+};
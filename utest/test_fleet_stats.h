@@ -0,0 +1,119 @@
+/**
+ * @file
+ * Testsuite for FleetStats
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "fleet_stats.h"
+#include "otp_image.h"
+
+class FleetStatsTestSuite : public CxxTest::TestSuite {
+ private:
+  std::string path;
+
+  void WritePack(const std::vector<std::vector<uint8_t>> &images) {
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    for (const auto &image : images) {
+      file.write(reinterpret_cast<const char *>(image.data()), image.size());
+    }
+  }
+
+  static const FieldHistogram &Field(const FleetGroup &group, const std::string &name) {
+    for (const auto &field : group.fields) {
+      if (field.name == name) {
+        return field;
+      }
+    }
+    throw std::runtime_error("no field " + name);
+  }
+
+ public:
+  FleetStatsTestSuite() {
+    google::InitGoogleLogging("FleetStats utest");
+  }
+
+  ~FleetStatsTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    char name[] = "/tmp/fleetXXXXXX";
+    int fd = mkstemp(name);
+    close(fd);
+    path = name;
+  }
+
+  void tearDown() {
+    unlink(path.c_str());
+  }
+
+  void TestHistogramStatistics() {
+    FieldHistogram histogram;
+    memset(histogram.bins, 0, sizeof(histogram.bins));
+    /* values -2, 0, 0, 4 */
+    histogram.bins[126] = 1;
+    histogram.bins[128] = 2;
+    histogram.bins[132] = 1;
+    TS_ASSERT_EQUALS(histogram.Count(), 4u);
+    TS_ASSERT_DELTA(histogram.Mean(), 0.5, 1e-9);
+    TS_ASSERT_DELTA(histogram.Variance(), 4.75, 1e-9);
+    TS_ASSERT_EQUALS(histogram.Percentile(0), -2);
+    TS_ASSERT_EQUALS(histogram.Percentile(50), 0);
+    TS_ASSERT_EQUALS(histogram.Percentile(100), 4);
+  }
+
+  void TestGroupsByLotAndVersion() {
+    std::vector<std::vector<uint8_t>> images;
+    /* more units than one batch, DCXO i % 21 - 10 and PD_A1_B24 -3 on version 2 */
+    for (int i = 0; i < 10000; i++) {
+      images.push_back(MakeImage(2, {{3, static_cast<uint8_t>(i % 21 - 10)}, {4, 0xFD}}));
+    }
+    images.push_back(MakeImage(1, {{3, 0x05}}));
+    std::vector<uint8_t> corrupted = MakeImage(1);
+    corrupted[259] ^= 0x01;
+    images.push_back(corrupted);
+    WritePack(images);
+
+    FleetStats stats;
+    stats.Add("lot1", DumpSet(path), 3);
+    stats.Add("lot2", DumpSet(path), 1);
+    TS_ASSERT_EQUALS(stats.Groups().size(), 4u);
+    TS_ASSERT_EQUALS(stats.Skipped(), 2u);
+
+    const FleetGroup &v2 = stats.Groups().at(std::make_pair(std::string("lot1"), 2));
+    TS_ASSERT_EQUALS(v2.units, 10000u);
+    /* DCXO and the ten PD offsets */
+    TS_ASSERT_EQUALS(v2.fields.size(), 11u);
+    const FieldHistogram &dcxo = Field(v2, "DCXO");
+    TS_ASSERT_EQUALS(dcxo.Percentile(0), -10);
+    TS_ASSERT_EQUALS(dcxo.Percentile(100), 10);
+    TS_ASSERT_DELTA(dcxo.Mean(), 0, 0.01);
+    TS_ASSERT_EQUALS(Field(v2, "PD_A1_B24").Percentile(50), -3);
+    TS_ASSERT_DELTA(Field(v2, "PD_A1_B24").Variance(), 0, 1e-9);
+
+    const FleetGroup &v1 = stats.Groups().at(std::make_pair(std::string("lot2"), 1));
+    TS_ASSERT_EQUALS(v1.units, 1u);
+    TS_ASSERT_EQUALS(v1.fields.size(), 1u);
+    TS_ASSERT_EQUALS(Field(v1, "DCXO").Percentile(50), 5);
+  }
+};
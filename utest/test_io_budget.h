@@ -0,0 +1,191 @@
+/**
+ * @file
+ * I/O budget tests of DeviceData operations
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "device_data.h"
+#include "flash_access_fake.h"
+#include "otp_image.h"
+
+/*
+ * Device operations allowed per DeviceData operation. Raising a budget must be a deliberate
+ * change, every extra operation costs a syscall (and an OTPSELECT ioctl) on the target.
+ */
+static const int kVersionReads = 2;
+static const int kReadReads = kVersionReads + 2;
+static const int kReadFieldReads = kVersionReads + 1;
+static const int kGetReads = 2;
+static const int kWritePrograms = 2;
+static const int kWriteFieldReads = kVersionReads + 1;
+static const int kWriteFieldPrograms = 1;
+static const int kUpgradeReads = kVersionReads + 1;
+static const int kUpgradePrograms = 1;
+
+class IoBudgetTestSuite : public CxxTest::TestSuite {
+ public:
+  IoBudgetTestSuite() {
+    google::InitGoogleLogging("IoBudget utest");
+  }
+
+  ~IoBudgetTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  /* DeviceData over a fake holding image, fake is owned by the returned DeviceData */
+  std::unique_ptr<DeviceData> Open(const std::vector<uint8_t> &image, bool clear_only = true) {
+    fake_ = new FakeFlashAccess(image, clear_only);
+    return std::unique_ptr<DeviceData>(new DeviceData(std::unique_ptr<FlashAccess>(fake_)));
+  }
+
+  void TestReadBudget() {
+    std::unique_ptr<DeviceData> device_data = Open(MakeImage(2));
+    device_data->Read();
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.reads, kReadReads);
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.bytes_read, kVersionReads + 39 + 14);
+    TS_ASSERT_EQUALS(fake_->counters.writes, 0);
+    TS_ASSERT_EQUALS(fake_->counters.ioctls, 0);
+  }
+
+  void TestReadFieldBudget() {
+    std::unique_ptr<DeviceData> device_data = Open(MakeImage(2, {{3, 0x07}}));
+    TS_ASSERT_EQUALS(device_data->ReadField("DCXO"), std::vector<uint8_t>{0x07});
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.reads, kReadFieldReads);
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.bytes_read, kVersionReads + 14);
+    TS_ASSERT_EQUALS(fake_->counters.writes, 0);
+  }
+
+  void TestGetBudget() {
+    std::unique_ptr<DeviceData> device_data = Open(MakeImage(2, {{3, 0xFD}}));
+    TS_ASSERT_EQUALS(device_data->Get<fields::DCXO>(), -3);
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.reads, kGetReads);
+    TS_ASSERT_EQUALS(fake_->counters.allocations, 0);
+  }
+
+  void TestReadSerialBudget() {
+    std::unique_ptr<DeviceData> device_data = Open(MakeImage(2));
+    TS_ASSERT_EQUALS(device_data->ReadField("SERIAL"), fake_->serial);
+    TS_ASSERT_EQUALS(fake_->counters.ioctls, 1);
+    TS_ASSERT_EQUALS(fake_->counters.reads, 1);
+  }
+
+  void TestWriteBudget() {
+    std::vector<uint8_t> image = MakeImage(2, {{3, 0x0A}});
+    std::vector<uint8_t> data(image.begin() + 2, image.begin() + 39);
+    data.insert(data.end(), image.begin() + 258, image.begin() + 270);
+    std::unique_ptr<DeviceData> device_data = Open(std::vector<uint8_t>(image.size(), 0xFF));
+    device_data->Write(data);
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.writes, kWritePrograms);
+    TS_ASSERT_EQUALS(fake_->counters.bytes_written, 39 + 14);
+    TS_ASSERT_EQUALS(fake_->counters.reads, 0);
+    TS_ASSERT_EQUALS(fake_->content, image);
+  }
+
+  void TestWriteFieldBudget() {
+    std::unique_ptr<DeviceData> device_data = Open(MakeImage(2), false);
+    device_data->WriteField("DCXO", {0x05});
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.reads, kWriteFieldReads);
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.writes, kWriteFieldPrograms);
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.bytes_written, 14);
+    TS_ASSERT_EQUALS(fake_->content, MakeImage(2, {{3, 0x05}}));
+  }
+
+  void TestWriteFieldsBudget() {
+    std::unique_ptr<DeviceData> device_data = Open(MakeImage(2), false);
+    std::map<std::string, std::vector<uint8_t>> values;
+    for (const auto &field : DeviceData::Layouts()[1].at(2)) {
+      if (field.first != "CRC_REG1" && field.first != "VERSION_REG1") {
+        values[field.first] = {0x01};
+      }
+    }
+    device_data->WriteFields(values);
+    /* all fields of one register cost as much as a single one */
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.reads, kWriteFieldReads);
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.writes, kWriteFieldPrograms);
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.bytes_written, 14);
+  }
+
+  void TestUpgradeLayoutBudget() {
+    std::unique_ptr<DeviceData> device_data = Open(MakeImage(1), false);
+    TS_ASSERT_EQUALS(device_data->UpgradeLayout(1, {{"PD_A1_B24", {0xFE}}}), 2);
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.reads, kUpgradeReads);
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.writes, kUpgradePrograms);
+    TS_ASSERT_LESS_THAN_EQUALS(fake_->counters.bytes_written, 14);
+    TS_ASSERT_EQUALS(fake_->content, MakeImage(2, {{4, 0xFE}}));
+  }
+
+  void TestRecordBudget() {
+    std::unique_ptr<DeviceData> device_data = Open(MakeImage(2));
+    device_data->WriteRecord(1, {0x12, 0x34});
+    /* record area is loaded once, every append checks its target bytes */
+    TS_ASSERT_EQUALS(fake_->counters.reads, 2);
+    TS_ASSERT_EQUALS(fake_->counters.writes, 1);
+
+    fake_->counters = FlashCounters();
+    device_data->WriteRecord(2, {0x56});
+    TS_ASSERT_EQUALS(fake_->counters.reads, 1);
+    TS_ASSERT_EQUALS(fake_->counters.writes, 1);
+
+    fake_->counters = FlashCounters();
+    TS_ASSERT_EQUALS(device_data->ReadRecord(1), (std::vector<uint8_t>{0x12, 0x34}));
+    TS_ASSERT_EQUALS(fake_->counters.reads, 0);
+  }
+
+  void TestRegisterCache() {
+    std::unique_ptr<DeviceData> device_data = Open(MakeImage(2, {{3, 0x07}}), false);
+    device_data->EnableRegisterCache();
+    device_data->Read();
+    /* registers 0 and 1 with a single read */
+    TS_ASSERT_EQUALS(fake_->counters.reads, 1);
+
+    fake_->counters = FlashCounters();
+    device_data->Read();
+    TS_ASSERT_EQUALS(device_data->ReadField("DCXO"), std::vector<uint8_t>{0x07});
+    TS_ASSERT_EQUALS(device_data->Get<fields::DCXO>(), 7);
+    device_data->ReadRegisterFields(1);
+    TS_ASSERT_EQUALS(fake_->counters.reads, 0);
+
+    /* programming drops the copy, the next read sees the programmed content */
+    device_data->WriteField("DCXO", {0x05});
+    TS_ASSERT_EQUALS(fake_->counters.writes, kWriteFieldPrograms);
+    fake_->counters = FlashCounters();
+    TS_ASSERT_EQUALS(device_data->ReadField("DCXO"), std::vector<uint8_t>{0x05});
+    TS_ASSERT_EQUALS(fake_->counters.reads, 1);
+
+    /* a dropped copy is loaded again by the next read */
+    device_data->DropRegisterCache();
+    fake_->counters = FlashCounters();
+    device_data->Read();
+    device_data->Read();
+    TS_ASSERT_EQUALS(fake_->counters.reads, 1);
+
+    /* the record index is dropped too and sees records appended by another process */
+    TS_ASSERT_THROWS_ANYTHING(device_data->ReadRecord(1));
+    FakeFlashAccess *fake = fake_;
+    std::unique_ptr<DeviceData> other = Open(fake->content);
+    other->WriteRecord(1, {0x12, 0x34});
+    fake->content = fake_->content;
+    device_data->DropRegisterCache();
+    TS_ASSERT_EQUALS(device_data->ReadRecord(1), (std::vector<uint8_t>{0x12, 0x34}));
+  }
+
+ private:
+  FakeFlashAccess *fake_;
+};
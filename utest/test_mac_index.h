@@ -0,0 +1,233 @@
+/**
+ * @file
+ * Unit tests for MacIndex
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "device_data.h"
+#include "flash_access_fake.h"
+#include "mac_index.h"
+#include "otp_image.h"
+
+class MacIndexTestSuite : public CxxTest::TestSuite {
+ public:
+  MacIndexTestSuite() {
+    google::InitGoogleLogging("MacIndex utest");
+  }
+
+  ~MacIndexTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    char path[] = "/tmp/proddata_macs_XXXXXX";
+    close(mkstemp(path));
+    path_ = path;
+    unlink(path_.c_str());
+  }
+
+  void tearDown() {
+    unlink(path_.c_str());
+    unlink((path_ + ".lock").c_str());
+    unlink((path_ + ".txt").c_str());
+  }
+
+  std::vector<uint8_t> Mac(uint32_t n) {
+    return {0x00, 0x19, 0xF5, static_cast<uint8_t>(n >> 16), static_cast<uint8_t>(n >> 8),
+            static_cast<uint8_t>(n)};
+  }
+
+  std::vector<uint8_t> Serial(uint8_t n) {
+    return std::vector<uint8_t>(8, n);
+  }
+
+  void TestReserveAndFind() {
+    MacIndex index(path_, Serial(1));
+    TS_ASSERT(!index.Find(Mac(1), NULL));
+    index.Reserve({Mac(1), Mac(2)});
+    std::vector<uint8_t> serial;
+    TS_ASSERT(index.Find(Mac(1), &serial));
+    TS_ASSERT_EQUALS(serial, Serial(1));
+    TS_ASSERT(index.Find(Mac(2), NULL));
+    TS_ASSERT(!index.Find(Mac(3), NULL));
+    TS_ASSERT_EQUALS(index.Size(), 2u);
+
+    /* same board again is fine */
+    index.Reserve({Mac(2)});
+    TS_ASSERT_EQUALS(index.Size(), 2u);
+  }
+
+  void TestDuplicateRejected() {
+    MacIndex board1(path_, Serial(1));
+    board1.Reserve({Mac(1)});
+    MacIndex board2(path_, Serial(2));
+    TS_ASSERT_THROWS_EQUALS(board2.Reserve({Mac(5), Mac(1)}), std::exception &e,
+                            std::string(e.what()), "Duplicate MAC address");
+    /* nothing of the refused request is recorded */
+    TS_ASSERT(!board2.Find(Mac(5), NULL));
+    TS_ASSERT_THROWS_EQUALS(board2.Reserve({Mac(6), Mac(6)}), std::exception &e,
+                            std::string(e.what()), "Duplicate MAC address");
+    TS_ASSERT_EQUALS(board2.Size(), 1u);
+  }
+
+  void TestGrowSeenByOtherInstance() {
+    MacIndex writer(path_, Serial(1));
+    MacIndex reader(path_, Serial(2));
+    TS_ASSERT(!reader.Find(Mac(0), NULL));
+    const uint32_t kMacs = 5000;
+    for (uint32_t i = 0; i < kMacs; i += 10) {
+      std::vector<std::vector<uint8_t>> macs;
+      for (uint32_t j = i; j < i + 10; j++) {
+        macs.push_back(Mac(j));
+      }
+      writer.Reserve(macs);
+    }
+    /* reader still maps the first file and must follow the rebuilt one */
+    TS_ASSERT_EQUALS(reader.Size(), kMacs);
+    for (uint32_t i = 0; i < kMacs; i++) {
+      TS_ASSERT(reader.Find(Mac(i), NULL));
+    }
+    TS_ASSERT(!reader.Find(Mac(kMacs), NULL));
+    TS_ASSERT_THROWS_EQUALS(reader.Reserve({Mac(1234)}), std::exception &e,
+                            std::string(e.what()), "Duplicate MAC address");
+  }
+
+  void TestBulkLoad() {
+    {
+      MacIndex index(path_, Serial(1));
+      index.Reserve({Mac(1)});
+    }
+    std::ofstream file(path_ + ".txt");
+    file << "00:19:F5:00:00:01 0101010101010101\n"   /* existing, same board */
+         << "0019F5000002 0202020202020202\n"
+         << "00-19-F5-00-00-03\n"
+         << "\n"
+         << "0019F5000001 0303030303030303\n"        /* conflict */
+         << "0019F500000\n"                           /* invalid */
+         << "0019F5000004 0404";
+    file.close();
+
+    MacIndex index(path_, std::vector<uint8_t>());
+    MacIndex::LoadStats stats = index.BulkLoad(path_ + ".txt");
+    TS_ASSERT_EQUALS(stats.added, 3u);
+    TS_ASSERT_EQUALS(stats.existing, 1u);
+    TS_ASSERT_EQUALS(stats.conflicts, 1u);
+    TS_ASSERT_EQUALS(stats.invalid, 1u);
+
+    std::vector<uint8_t> serial;
+    TS_ASSERT(index.Find(Mac(1), &serial));
+    TS_ASSERT_EQUALS(serial, Serial(1));
+    TS_ASSERT(index.Find(Mac(2), &serial));
+    TS_ASSERT_EQUALS(serial, Serial(2));
+    TS_ASSERT(index.Find(Mac(3), &serial));
+    TS_ASSERT(serial.empty());
+    TS_ASSERT(index.Find(Mac(4), &serial));
+    TS_ASSERT_EQUALS(serial, std::vector<uint8_t>({0x04, 0x04}));
+  }
+
+  void TestBulkLoadLarge() {
+    const uint32_t kMacs = 200000;
+    {
+      std::ofstream file(path_ + ".txt");
+      char line[32];
+      for (uint32_t i = 0; i < kMacs; i++) {
+        snprintf(line, sizeof(line), "0019F5%06X\n", i);
+        file << line;
+      }
+    }
+    MacIndex index(path_, Serial(9));
+    MacIndex::LoadStats stats = index.BulkLoad(path_ + ".txt");
+    TS_ASSERT_EQUALS(stats.added, kMacs);
+    TS_ASSERT_EQUALS(index.Size(), kMacs);
+    TS_ASSERT(index.Find(Mac(kMacs - 1), NULL));
+    TS_ASSERT(!index.Find(Mac(kMacs), NULL));
+  }
+
+  void TestWriteHook() {
+    FakeFlashAccess *fake1 = new FakeFlashAccess(MakeImage(2), false);
+    DeviceData board1((std::unique_ptr<FlashAccess>(fake1)));
+    MacIndex index1(path_, fake1->serial);
+    board1.AddWriteHook(&index1);
+    board1.WriteField("MAC_0", Mac(1));
+    board1.WriteField("MAC_1", Mac(2));
+    /* rewriting the same board with its own addresses is fine */
+    board1.WriteField("MAC_0", Mac(1));
+
+    FakeFlashAccess *fake2 = new FakeFlashAccess(MakeImage(2), false);
+    fake2->serial = Serial(2);
+    DeviceData board2((std::unique_ptr<FlashAccess>(fake2)));
+    MacIndex index2(path_, fake2->serial);
+    board2.AddWriteHook(&index2);
+    int writes = fake2->counters.writes;
+    TS_ASSERT_THROWS_EQUALS(board2.WriteField("MAC_3", Mac(2)), std::exception &e,
+                            std::string(e.what()), "Duplicate MAC address");
+    TS_ASSERT_EQUALS(fake2->counters.writes, writes);
+    board2.WriteField("MAC_3", Mac(3));
+    TS_ASSERT_EQUALS(index2.Size(), 3u);
+  }
+
+  void TestConcurrentStations() {
+    /* every station claims its own range and MAC 0, exactly one of them gets MAC 0 */
+    const int kStations = 4;
+    const uint32_t kMacs = 300;
+    { MacIndex index(path_, Serial(0)); }
+    std::vector<pid_t> pids;
+    for (int station = 1; station <= kStations; station++) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        int claimed = 0;
+        try {
+          MacIndex index(path_, Serial(station));
+          for (uint32_t i = 1; i <= kMacs; i++) {
+            index.Reserve({Mac(station * 1000 + i)});
+          }
+          try {
+            index.Reserve({Mac(0)});
+            claimed = 1;
+          } catch (std::runtime_error &e) {
+          }
+        } catch (std::exception &e) {
+          _exit(2);
+        }
+        _exit(claimed);
+      }
+      pids.push_back(pid);
+    }
+    int claimed = 0;
+    for (pid_t pid : pids) {
+      int status;
+      waitpid(pid, &status, 0);
+      TS_ASSERT(WIFEXITED(status));
+      TS_ASSERT_LESS_THAN(WEXITSTATUS(status), 2);
+      claimed += WEXITSTATUS(status);
+    }
+    TS_ASSERT_EQUALS(claimed, 1);
+    MacIndex index(path_, Serial(0));
+    TS_ASSERT_EQUALS(index.Size(), kStations * kMacs + 1);
+  }
+
+ private:
+  std::string path_;
+};
@@ -0,0 +1,179 @@
+/**
+ * @file
+ * Unit tests for ManifestValidator class
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <string>
+#include <vector>
+#include "manifest_validator.h"
+
+/* register 0 version 1 with six MACs, register 1 version 2 with DCXO 05 and PD offsets FE */
+static const char kReg0[] = "01" "0019F5000001" "0019F5000002" "0019F5000003" "0019F5000004"
+                            "0019F5000005" "0019F5000006";
+static const char kReg1[] = "02" "05" "FEFEFEFEFEFEFEFEFEFE";
+
+class ManifestValidatorTestSuite : public CxxTest::TestSuite {
+ public:
+  ManifestValidatorTestSuite() {
+    google::InitGoogleLogging("ManifestValidator utest");
+  }
+
+  ~ManifestValidatorTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  static ManifestReport Validate(const ManifestValidator &validator, const std::string &text,
+                                 int threads = 1) {
+    return validator.Validate(text.data(), text.size(), threads);
+  }
+
+  void TestHexPrefixLength() {
+    std::string hex = "0123456789abcdefABCDEF0123456789abcdef";
+    TS_ASSERT_EQUALS(HexPrefixLength(hex.data(), hex.size()), hex.size());
+    /* every position, inside and after the 16 character blocks */
+    for (size_t i = 0; i < hex.size(); i++) {
+      for (char bad : {'g', 'G', '/', ':', '@', '`', ' ', '\xE1'}) {
+        std::string text = hex;
+        text[i] = bad;
+        TS_ASSERT_EQUALS(HexPrefixLength(text.data(), text.size()), i);
+      }
+    }
+    TS_ASSERT_EQUALS(HexPrefixLength(hex.data(), 0), 0u);
+  }
+
+  void TestValidManifest() {
+    ManifestValidator validator;
+    std::string row = std::string(kReg0) + kReg1;
+    ManifestReport report = Validate(validator, row + "\n# comment\n\n" + row + "\r\n" + row);
+    TS_ASSERT_EQUALS(report.rows, 3u);
+    TS_ASSERT_EQUALS(report.invalid_rows, 0u);
+    TS_ASSERT_EQUALS(report.problem_count, 0u);
+    /* register 1 version 1 has DCXO only */
+    report = Validate(validator, std::string(kReg0) + "0105\n");
+    TS_ASSERT_EQUALS(report.problem_count, 0u);
+  }
+
+  void TestFormatProblems() {
+    ManifestValidator validator;
+    std::string reg0 = kReg0;
+    std::string reg1 = kReg1;
+    std::string text = reg0 + reg1.substr(0, 5) + "x" + reg1.substr(6) + "\n" +
+                       reg0 + reg1 + "0\n" +
+                       "07" + reg0.substr(2) + reg1 + "\n" +
+                       reg0 + "09" + reg1.substr(2) + "\n" +
+                       reg0 + reg1 + "00\n" +
+                       reg0 + "\n";
+    ManifestReport report = Validate(validator, text);
+    TS_ASSERT_EQUALS(report.rows, 6u);
+    TS_ASSERT_EQUALS(report.invalid_rows, 6u);
+    TS_ASSERT_EQUALS(report.problems.size(), 6u);
+    TS_ASSERT_EQUALS(report.problems[0].line, 1u);
+    TS_ASSERT_EQUALS(report.problems[0].column, reg0.size() + 6);
+    TS_ASSERT_EQUALS(report.problems[0].message, "invalid hex digit 'x'");
+    TS_ASSERT_EQUALS(report.problems[1].line, 2u);
+    TS_ASSERT_EQUALS(report.problems[1].column, 0u);
+    TS_ASSERT_EQUALS(report.problems[2].column, 1u);
+    TS_ASSERT_EQUALS(report.problems[2].message, "unknown VERSION_REG0 7");
+    TS_ASSERT_EQUALS(report.problems[3].column, reg0.size() + 1);
+    TS_ASSERT_EQUALS(report.problems[3].message, "unknown VERSION_REG1 9");
+    TS_ASSERT_EQUALS(report.problems[4].message,
+                     "size 50 bytes, expected 49 for VERSION_REG0 1 and VERSION_REG1 2");
+    TS_ASSERT_EQUALS(report.problems[5].line, 6u);
+  }
+
+  void TestFieldRules() {
+    ManifestValidator validator;
+    validator.SetRange("DCXO", -6, 6);
+    validator.SetRange("PD_A2_B54", -2, 2);
+    validator.AddOui({0x00, 0x19, 0xF5});
+    std::string reg0 = kReg0;
+    std::string reg1 = kReg1;
+    std::string multicast = reg0;
+    multicast.replace(14, 2, "01");
+    std::string zero = reg0;
+    zero.replace(26, 12, "000000000000");
+    std::string other_oui = reg0;
+    other_oui.replace(62, 2, "04");
+    std::string text = reg0 + reg1 + "\n" +
+                       multicast + reg1 + "\n" +
+                       zero + reg1 + "\n" +
+                       other_oui + reg1 + "\n" +
+                       reg0 + "0205FEFEFEFEFEFEFEFEFE03\n";
+    text.replace(reg0.size() + 2, 2, "F8");
+    ManifestReport report = Validate(validator, text);
+    TS_ASSERT_EQUALS(report.rows, 5u);
+    TS_ASSERT_EQUALS(report.invalid_rows, 5u);
+    TS_ASSERT_EQUALS(report.problems.size(), 5u);
+    TS_ASSERT_EQUALS(report.problems[0].line, 1u);
+    TS_ASSERT_EQUALS(report.problems[0].column, reg0.size() + 3);
+    TS_ASSERT_EQUALS(report.problems[0].message, "DCXO -8 outside -6 to 6");
+    TS_ASSERT_EQUALS(report.problems[1].line, 2u);
+    TS_ASSERT_EQUALS(report.problems[1].column, 15u);
+    TS_ASSERT_EQUALS(report.problems[1].message, "MAC_1 01:19:F5:00:00:02 is not unicast");
+    TS_ASSERT_EQUALS(report.problems[2].message, "MAC_2 00:00:00:00:00:00 is all zero");
+    TS_ASSERT_EQUALS(report.problems[3].column, 63u);
+    TS_ASSERT_EQUALS(report.problems[3].message, "MAC_5 04:19:F5:00:00:06 has no allowed OUI");
+    TS_ASSERT_EQUALS(report.problems[4].line, 5u);
+    TS_ASSERT_EQUALS(report.problems[4].message, "PD_A2_B54 3 outside -2 to 2");
+  }
+
+  void TestInvalidRules() {
+    ManifestValidator validator;
+    TS_ASSERT_THROWS_EQUALS(validator.SetRange("MAC_0", 0, 1), std::exception &e, e.what(),
+                            std::string("No range constraint for field: MAC_0"));
+    TS_ASSERT_THROWS_EQUALS(validator.SetRange("VERSION_REG1", 0, 1), std::exception &e,
+                            e.what(), std::string("No range constraint for field: VERSION_REG1"));
+    TS_ASSERT_THROWS_EQUALS(validator.SetRange("DCXO", 4, -4), std::exception &e, e.what(),
+                            std::string("Invalid range of DCXO"));
+    TS_ASSERT_THROWS_EQUALS(validator.AddOui({0x00, 0x19}), std::exception &e, e.what(),
+                            std::string("Invalid OUI"));
+  }
+
+  void TestChunkedLineNumbers() {
+    /* several chunks of 1 MiB, problems on lines crossing and right after chunk boundaries */
+    ManifestValidator validator;
+    std::string row = std::string(kReg0) + kReg1 + "\n";
+    std::string bad = std::string(kReg0) + "02" + "0X" + std::string(kReg1).substr(4) + "\n";
+    std::string text;
+    std::vector<uint64_t> bad_lines;
+    uint64_t line = 0;
+    while (text.size() < (3 << 20) + 1000) {
+      line++;
+      size_t chunk_offset = text.size() % (1 << 20);
+      if (line % 7919 == 0 || chunk_offset > (1 << 20) - row.size() ||
+          chunk_offset < row.size()) {
+        text += bad;
+        bad_lines.push_back(line);
+      } else {
+        text += row;
+      }
+    }
+    ManifestReport single = Validate(validator, text, 1);
+    ManifestReport parallel = Validate(validator, text, 4);
+    TS_ASSERT_EQUALS(single.rows, line);
+    TS_ASSERT_EQUALS(parallel.rows, line);
+    TS_ASSERT_EQUALS(parallel.invalid_rows, bad_lines.size());
+    TS_ASSERT_EQUALS(parallel.problem_count, bad_lines.size());
+    TS_ASSERT_EQUALS(parallel.problems.size(), bad_lines.size());
+    for (size_t i = 0; i < parallel.problems.size(); i++) {
+      TS_ASSERT_EQUALS(parallel.problems[i].line, bad_lines[i]);
+      TS_ASSERT_EQUALS(parallel.problems[i].line, single.problems[i].line);
+      TS_ASSERT_EQUALS(parallel.problems[i].column, std::string(kReg0).size() + 4);
+    }
+  }
+};
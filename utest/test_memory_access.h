@@ -0,0 +1,92 @@
+/**
+ * @file
+ * Unit tests for DeviceData over MemoryAccess
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "device_data.h"
+#include "memory_access.h"
+#include "otp_image.h"
+
+class MemoryAccessTestSuite : public CxxTest::TestSuite {
+ public:
+  MemoryAccessTestSuite() {
+    google::InitGoogleLogging("MemoryAccess utest");
+  }
+
+  ~MemoryAccessTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void TestReadImage() {
+    std::vector<uint8_t> image = MakeImage(2, {{3, 0xFD}, {4, 0x11}});
+    const std::vector<uint8_t> &const_image = image;
+    BasicDeviceData<MemoryAccess> device_data(std::unique_ptr<MemoryAccess>(
+        new MemoryAccess(const_image.data(), const_image.size())));
+    TS_ASSERT_EQUALS(device_data.Get<fields::DCXO>(), -3);
+    TS_ASSERT_EQUALS(device_data.ReadField("PD_A1_B24"), std::vector<uint8_t>{0x11});
+    std::vector<uint8_t> data = device_data.Read();
+    TS_ASSERT_EQUALS(data.size(), 37u + 12u);
+    TS_ASSERT_EQUALS(data[37], 0x02);
+    TS_ASSERT_EQUALS(data[38], 0xFD);
+  }
+
+  void TestWriteFieldsUpdatesBuffer() {
+    std::vector<uint8_t> image = MakeImage(2);
+    BasicDeviceData<MemoryAccess> device_data(std::unique_ptr<MemoryAccess>(
+        new MemoryAccess(image.data(), image.size())));
+    device_data.Set<fields::DCXO>(5);
+    TS_ASSERT_EQUALS(image[259], 0x05);
+    TS_ASSERT_EQUALS(DeviceLayouts::CheckImage(image.data(), image.size()).status[1],
+                     DeviceLayouts::kRegisterValid);
+
+    /* a second instance over the same buffer sees the write */
+    BasicDeviceData<MemoryAccess> reader(std::unique_ptr<MemoryAccess>(
+        new MemoryAccess(image.data(), image.size())));
+    TS_ASSERT_EQUALS(reader.Get<fields::DCXO>(), 5);
+  }
+
+  void TestSerial() {
+    std::vector<uint8_t> image = MakeImage(2);
+    std::vector<uint8_t> serial(8, 0x01);
+    BasicDeviceData<MemoryAccess> device_data(std::unique_ptr<MemoryAccess>(
+        new MemoryAccess(image.data(), image.size(), serial)));
+    TS_ASSERT_EQUALS(device_data.ReadField("SERIAL"), serial);
+  }
+
+  void TestWriteReadOnly() {
+    const std::vector<uint8_t> image = MakeImage(2);
+    BasicDeviceData<MemoryAccess> device_data(std::unique_ptr<MemoryAccess>(
+        new MemoryAccess(image.data(), image.size())));
+    TS_ASSERT_THROWS_EQUALS(device_data.Set<fields::DCXO>(5), std::exception &e,
+                            std::string(e.what()), "Device opened read only");
+  }
+
+  void TestAccessOutsideBuffer() {
+    std::vector<uint8_t> image = MakeImage(2);
+    MemoryAccess access(image.data(), 300);
+    TS_ASSERT_THROWS_EQUALS(access.Read(45, 256), std::exception &e, std::string(e.what()),
+                            "Access outside of device");
+    TS_ASSERT_THROWS_EQUALS(access.Write({0x00}, -1), std::exception &e,
+                            std::string(e.what()), "Access outside of device");
+    TS_ASSERT_EQUALS(access.Read(44, 256).size(), 44u);
+  }
+};
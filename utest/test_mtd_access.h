@@ -0,0 +1,155 @@
+/**
+ * @file
+ * Unit tests for MTDAccess
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <fcntl.h>
+#include <mtd/mtd-user.h>
+#include <stdarg.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "device_data.h"
+#include "mtd_access.h"
+
+/*
+ * Emulated MTD character device: like mtdchar, OTPSELECT and MTDFILEMODE switch the area the
+ * descriptor reads and writes, here by pointing it to the factory OTP or the partition file.
+ * MEMERASE erases the partition whatever the mode.
+ */
+struct FakeMtd {
+  int partition_fd;
+  int factory_fd;
+  int mode;
+  bool erased_in_otp_mode;
+};
+static const int kFakeEraseSize = 4096;
+static FakeMtd fake_mtd = {-1, -1, MTD_OTP_OFF, false};
+
+extern "C" int ioctl(int fd, unsigned long request, ...) __THROW {  // NOLINT(runtime/int)
+  va_list args;
+  va_start(args, request);
+  unsigned long arg = va_arg(args, unsigned long);  // NOLINT(runtime/int)
+  va_end(args);
+  if (request == MEMGETINFO) {
+    mtd_info_t *info = reinterpret_cast<mtd_info_t *>(arg);
+    memset(info, 0, sizeof(*info));
+    info->size = kFakeEraseSize;
+    info->erasesize = kFakeEraseSize;
+    fake_mtd.partition_fd = dup(fd);
+    return 0;
+  } else if (request == OTPSELECT) {
+    fake_mtd.mode = *reinterpret_cast<int *>(arg);
+    return dup2(fake_mtd.mode == MTD_OTP_OFF ? fake_mtd.partition_fd : fake_mtd.factory_fd,
+                fd) < 0 ? -1 : 0;
+  } else if (request == MTDFILEMODE && static_cast<int>(arg) == MTD_FILE_MODE_NORMAL) {
+    fake_mtd.mode = MTD_OTP_OFF;
+    return dup2(fake_mtd.partition_fd, fd) < 0 ? -1 : 0;
+  } else if (request == MEMERASE) {
+    erase_info_t *erase = reinterpret_cast<erase_info_t *>(arg);
+    fake_mtd.erased_in_otp_mode |= fake_mtd.mode != MTD_OTP_OFF;
+    std::vector<uint8_t> erased(erase->length, 0xFF);
+    return pwrite(fake_mtd.partition_fd, erased.data(), erased.size(), erase->start) < 0 ? -1 : 0;
+  }
+  errno = ENOTTY;
+  return -1;
+}
+
+class MTDAccessTestSuite : public CxxTest::TestSuite {
+ public:
+  MTDAccessTestSuite() {
+    google::InitGoogleLogging("MTDAccess utest");
+  }
+
+  ~MTDAccessTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    partition_ = MakeFile("/tmp/proddata_mtd_XXXXXX", std::vector<uint8_t>(kFakeEraseSize, 0x11));
+    factory_ = MakeFile("/tmp/proddata_factory_XXXXXX", std::vector<uint8_t>(64, 0x5A));
+    fake_mtd.factory_fd = open(factory_.c_str(), O_RDONLY);
+    fake_mtd.mode = MTD_OTP_OFF;
+    fake_mtd.erased_in_otp_mode = false;
+  }
+
+  void tearDown() {
+    close(fake_mtd.factory_fd);
+    close(fake_mtd.partition_fd);
+    fake_mtd.partition_fd = -1;
+    unlink(partition_.c_str());
+    unlink(factory_.c_str());
+  }
+
+  void TestReadAfterSerial() {
+    MTDAccess access(partition_);
+    TS_ASSERT_EQUALS(access.ReadSerial(), std::vector<uint8_t>(8, 0x5A));
+    /* the serial number leaves the descriptor in factory OTP mode, data is read from the
+     * partition nevertheless */
+    TS_ASSERT_EQUALS(access.Read(8, 256), std::vector<uint8_t>(8, 0x11));
+  }
+
+  void TestWriteAfterSerial() {
+    MTDAccess access(partition_);
+    access.ReadSerial();
+    access.Write({0xAB, 0xCD}, 258);
+    TS_ASSERT(!fake_mtd.erased_in_otp_mode);
+
+    std::vector<uint8_t> expected(kFakeEraseSize, 0x11);
+    expected[258] = 0xAB;
+    expected[259] = 0xCD;
+    TS_ASSERT_EQUALS(ReadFile(partition_), expected);
+    TS_ASSERT_EQUALS(ReadFile(factory_), std::vector<uint8_t>(64, 0x5A));
+  }
+
+  void TestImageAfterSerial() {
+    /* export reads the serial number first, the image must still come from the partition */
+    DeviceData device_data(std::unique_ptr<FlashAccess>(new MTDAccess(partition_)));
+    TS_ASSERT_EQUALS(device_data.ReadField("SERIAL"), std::vector<uint8_t>(8, 0x5A));
+    std::vector<uint8_t> image(DeviceData::kImageRegisters * fields::kRegisterSize);
+    TS_ASSERT_EQUALS(device_data.ReadImage(image.data()), 0);
+    TS_ASSERT_EQUALS(image, std::vector<uint8_t>(image.size(), 0x11));
+  }
+
+ private:
+  std::string partition_;
+  std::string factory_;
+
+  static std::string MakeFile(const char *pattern, const std::vector<uint8_t> &content) {
+    std::vector<char> path(pattern, pattern + strlen(pattern) + 1);
+    int fd = mkstemp(path.data());
+    TS_ASSERT(fd >= 0);
+    TS_ASSERT_EQUALS(write(fd, content.data(), content.size()),
+                     static_cast<ssize_t>(content.size()));
+    close(fd);
+    return path.data();
+  }
+
+  static std::vector<uint8_t> ReadFile(const std::string &path) {
+    std::vector<uint8_t> content(kFakeEraseSize);
+    int fd = open(path.c_str(), O_RDONLY);
+    ssize_t size = read(fd, content.data(), content.size());
+    close(fd);
+    content.resize(size < 0 ? 0 : size);
+    return content;
+  }
+};
@@ -0,0 +1,141 @@
+/**
+ * @file
+ * Testsuite for RecordStore
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <vector>
+#include "record_store.h"
+
+class RecordStoreTestSuite : public CxxTest::TestSuite {
+ private:
+  RecordStore *store;
+
+ public:
+  RecordStoreTestSuite() {
+    google::InitGoogleLogging("RecordStore utest");
+  }
+
+  ~RecordStoreTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    store = new RecordStore(256);
+  }
+
+  void tearDown() {
+    delete store;
+  }
+
+  void TestAppendAndGet() {
+    std::vector<uint8_t> record;
+    std::vector<uint8_t> value = {0x01, 0x02, 0x03};
+    TS_ASSERT_EQUALS(store->Append(5, value, &record), 0);
+
+    /* key, length, value, crc */
+    TS_ASSERT_EQUALS(record.size(), 7u);
+    TS_ASSERT_EQUALS(record[0], 0x05);
+    TS_ASSERT_EQUALS(record[1], 0x03);
+
+    std::vector<uint8_t> read;
+    TS_ASSERT(store->Get(5, &read));
+    TS_ASSERT_EQUALS(read, value);
+    TS_ASSERT(!store->Get(6, &read));
+    TS_ASSERT_EQUALS(store->Free(), 256 - 7);
+  }
+
+  void TestVarintKey() {
+    std::vector<uint8_t> record;
+    std::vector<uint8_t> value = {0xAA};
+    store->Append(300, value, &record);
+    TS_ASSERT_EQUALS(record[0], 0xAC);
+    TS_ASSERT_EQUALS(record[1], 0x02);
+
+    std::vector<uint8_t> read;
+    TS_ASSERT(store->Get(300, &read));
+    TS_ASSERT_EQUALS(read, value);
+  }
+
+  void TestSupersedeOnlyProgramsErasedBytes() {
+    std::vector<uint8_t> area(256, 0xFF);
+    std::vector<uint8_t> record;
+    int first = store->Append(1, std::vector<uint8_t>{0x10}, &record);
+    std::copy(record.begin(), record.end(), area.begin() + first);
+    int second = store->Append(1, std::vector<uint8_t>{0x20, 0x21}, &record);
+    TS_ASSERT_LESS_THAN_EQUALS(first + 5, second);
+    std::copy(record.begin(), record.end(), area.begin() + second);
+
+    RecordStore loaded(256);
+    loaded.Load(area);
+    std::vector<uint8_t> read;
+    TS_ASSERT(loaded.Get(1, &read));
+    TS_ASSERT_EQUALS(read, (std::vector<uint8_t>{0x20, 0x21}));
+    TS_ASSERT_EQUALS(loaded.Free(), store->Free());
+  }
+
+  void TestLoadSkipsCorruptedRecord() {
+    std::vector<uint8_t> area(256, 0xFF);
+    std::vector<uint8_t> record;
+    int offset = store->Append(1, std::vector<uint8_t>{0x10}, &record);
+    std::copy(record.begin(), record.end(), area.begin() + offset);
+    area[offset + 2] = 0x00;
+    offset = store->Append(2, std::vector<uint8_t>{0x20}, &record);
+    std::copy(record.begin(), record.end(), area.begin() + offset);
+
+    RecordStore loaded(256);
+    loaded.Load(area);
+    std::vector<uint8_t> read;
+    TS_ASSERT(!loaded.Get(1, &read));
+    TS_ASSERT(loaded.Get(2, &read));
+    TS_ASSERT_EQUALS(loaded.Corrupted(), 1);
+  }
+
+  void TestLoadTruncatedRecordFillsStore() {
+    std::vector<uint8_t> area(256, 0xFF);
+    /* length byte not programmed, record runs past the end of the area */
+    area[0] = 0x01;
+
+    RecordStore loaded(256);
+    loaded.Load(area);
+    TS_ASSERT_EQUALS(loaded.Free(), 0);
+  }
+
+  void TestForEachInKeyOrder() {
+    std::vector<uint8_t> record;
+    store->Append(7, std::vector<uint8_t>{0x07}, &record);
+    store->Append(3, std::vector<uint8_t>{0x03}, &record);
+    store->Append(7, std::vector<uint8_t>{0x08}, &record);
+
+    std::vector<uint32_t> keys;
+    std::vector<uint8_t> values;
+    store->ForEach([&](uint32_t key, const std::vector<uint8_t> &value) {
+      keys.push_back(key);
+      values.push_back(value[0]);
+    });
+    TS_ASSERT_EQUALS(keys, (std::vector<uint32_t>{3, 7}));
+    TS_ASSERT_EQUALS(values, (std::vector<uint8_t>{0x03, 0x08}));
+  }
+
+  void TestAppendNoSpace() {
+    std::vector<uint8_t> record;
+    std::vector<uint8_t> value(250, 0x00);
+    store->Append(1, value, &record);
+    TS_ASSERT_THROWS_EQUALS(store->Append(2, value, &record),
+                            std::exception &e, e.what(), "No space left for record");
+  }
+};
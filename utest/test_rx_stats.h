@@ -0,0 +1,147 @@
+/**
+ * @file
+ * Testsuite for RxStatsSampler
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "rx_stats.h"
+
+class RxStatsSamplerTestSuite : public CxxTest::TestSuite {
+ private:
+  std::string path;
+
+  /* stand-in for the driver statistics file */
+  void WriteStats(int pass, int fail, int rssi) {
+    std::ofstream stats(path.c_str(), std::ios::trunc);
+    stats << "ofdm_crc32_pass_cnt = " << pass << "\n"
+          << "ofdm_crc32_fail_cnt = " << fail << "\n"
+          << "rssi_avg = " << rssi << "\n";
+  }
+
+ public:
+  RxStatsSamplerTestSuite() {
+    google::InitGoogleLogging("RxStatsSampler utest");
+  }
+
+  ~RxStatsSamplerTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    char name[] = "/tmp/rx_statsXXXXXX";
+    int fd = mkstemp(name);
+    close(fd);
+    path = name;
+  }
+
+  void tearDown() {
+    unlink(path.c_str());
+  }
+
+  void TestSpscRing() {
+    SpscRing<int, 4> ring;
+    int item;
+    TS_ASSERT(!ring.Pop(&item));
+    for (int i = 0; i < 4; i++) {
+      TS_ASSERT(ring.Push(i));
+    }
+    TS_ASSERT(!ring.Push(4));
+    TS_ASSERT(ring.Pop(&item));
+    TS_ASSERT_EQUALS(item, 0);
+    TS_ASSERT(ring.Push(4));
+    for (int i = 1; i <= 4; i++) {
+      TS_ASSERT(ring.Pop(&item));
+      TS_ASSERT_EQUALS(item, i);
+    }
+    TS_ASSERT(!ring.Pop(&item));
+  }
+
+  void TestParseSample() {
+    RxCounterNames names;
+    RxSample sample;
+    TS_ASSERT(RxStatsSampler::ParseSample(
+        "ed_cnt = 3\n  ofdm_crc32_pass_cnt: 120\nofdm_crc32_fail_cnt = 7\n", names, &sample));
+    TS_ASSERT_EQUALS(sample.crc_pass, 120u);
+    TS_ASSERT_EQUALS(sample.crc_fail, 7u);
+    TS_ASSERT(!sample.has_rssi);
+    TS_ASSERT(!RxStatsSampler::ParseSample("ofdm_crc32_pass_cnt = 1\n", names, &sample));
+    TS_ASSERT(!RxStatsSampler::ParseSample("ofdm_crc32_pass_cnt_x = 1\nofdm_crc32_fail_cnt = 2",
+                                           names, &sample));
+  }
+
+  void TestRollingAggregate() {
+    RxStatsSampler sampler(path, 2);
+    WriteStats(0, 0, -50);
+    TS_ASSERT(sampler.Poll());
+    WriteStats(90, 10, -52);
+    TS_ASSERT(sampler.Poll());
+    WriteStats(180, 20, -54);
+    TS_ASSERT(sampler.Poll());
+
+    RxAggregate aggregate = sampler.Aggregate();
+    TS_ASSERT_EQUALS(aggregate.samples, 2);
+    TS_ASSERT_EQUALS(aggregate.frames, 200u);
+    TS_ASSERT_EQUALS(aggregate.errors, 20u);
+    TS_ASSERT_DELTA(aggregate.per, 0.1, 1e-9);
+    TS_ASSERT_DELTA(aggregate.rssi, -53, 1e-9);
+
+    /* oldest interval leaves the window */
+    WriteStats(280, 20, -60);
+    TS_ASSERT(sampler.Poll());
+    aggregate = sampler.Aggregate();
+    TS_ASSERT_EQUALS(aggregate.samples, 2);
+    TS_ASSERT_EQUALS(aggregate.frames, 200u);
+    TS_ASSERT_EQUALS(aggregate.errors, 10u);
+    TS_ASSERT_DELTA(aggregate.rssi, -57, 1e-9);
+  }
+
+  void TestClearedCounters() {
+    RxStatsSampler sampler(path, 4);
+    WriteStats(500, 50, -40);
+    TS_ASSERT(sampler.Poll());
+    WriteStats(30, 10, -40);
+    TS_ASSERT(sampler.Poll());
+    RxAggregate aggregate = sampler.Aggregate();
+    TS_ASSERT_EQUALS(aggregate.frames, 40u);
+    TS_ASSERT_EQUALS(aggregate.errors, 10u);
+  }
+
+  void TestBackgroundPolling() {
+    WriteStats(100, 1, -45);
+    RxStatsSampler sampler(path, 1000);
+    sampler.Start(200);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    sampler.Stop();
+    RxAggregate aggregate = sampler.Aggregate();
+    TS_ASSERT_LESS_THAN(0, aggregate.samples);
+    TS_ASSERT_EQUALS(aggregate.frames, 0u);
+    TS_ASSERT_EQUALS(aggregate.dropped, 0u);
+  }
+
+  void TestInvalidFile() {
+    TS_ASSERT_THROWS_EQUALS(RxStatsSampler sampler("/nonexistent/phy_stats", 1),
+                            std::exception &e, e.what(),
+                            "Can't open RX statistics: /nonexistent/phy_stats");
+  }
+};
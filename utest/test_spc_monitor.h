@@ -0,0 +1,253 @@
+/**
+ * @file
+ * Unit tests for SpcMonitor
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <unistd.h>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "device_data.h"
+#include "flash_access_fake.h"
+#include "otp_image.h"
+#include "spc_monitor.h"
+
+class SpcMonitorTestSuite : public CxxTest::TestSuite {
+ public:
+  SpcMonitorTestSuite() {
+    google::InitGoogleLogging("SpcMonitor utest");
+  }
+
+  ~SpcMonitorTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    char path[] = "/tmp/proddata_spc_XXXXXX";
+    close(mkstemp(path));
+    path_ = path;
+    unlink(path_.c_str());
+    alarms_.clear();
+  }
+
+  void tearDown() {
+    unlink(path_.c_str());
+    unlink((path_ + ".alarms").c_str());
+  }
+
+  /* collects alarms of monitor */
+  void Collect(SpcMonitor *monitor) {
+    monitor->SetAlarmCallback([this](const SpcAlarm &alarm) { alarms_.push_back(alarm); });
+  }
+
+  /* in control process: repeating -1, 0, 1 */
+  void AddStable(SpcMonitor *monitor, int samples, int offset = 0) {
+    for (int i = 0; i < samples; i++) {
+      monitor->Add(2, {{"DCXO", i % 3 - 1 + offset}});
+    }
+  }
+
+  int CountAlarms(SpcAlarm::Kind kind) {
+    int count = 0;
+    for (const auto &alarm : alarms_) {
+      count += alarm.kind == kind;
+    }
+    return count;
+  }
+
+  void TestWelford() {
+    SpcMonitor monitor(path_, "station1");
+    Collect(&monitor);
+    double sum = 0;
+    for (int i = 1; i <= 40; i++) {
+      monitor.Add(2, {{"DCXO", i}});
+      sum += i;
+    }
+    double mean = sum / 40;
+    double squares = 0;
+    for (int i = 1; i <= 40; i++) {
+      squares += (i - mean) * (i - mean);
+    }
+
+    std::vector<SpcStats> charts = SpcMonitor::Read(path_);
+    TS_ASSERT_EQUALS(charts.size(), 1u);
+    TS_ASSERT_EQUALS(charts[0].station, "station1");
+    TS_ASSERT_EQUALS(charts[0].version, 2);
+    TS_ASSERT_EQUALS(charts[0].field, "DCXO");
+    TS_ASSERT_EQUALS(charts[0].count, 40u);
+    TS_ASSERT_DELTA(charts[0].mean, mean, 1e-9);
+    TS_ASSERT_DELTA(charts[0].stddev, std::sqrt(squares / 39), 1e-9);
+    /* baseline of the 30 warmup samples 1..30 */
+    TS_ASSERT_DELTA(charts[0].target, 15.5, 1e-9);
+  }
+
+  void TestStableProcess() {
+    SpcMonitor monitor(path_, "station1");
+    Collect(&monitor);
+    AddStable(&monitor, 600);
+    TS_ASSERT(alarms_.empty());
+
+    std::vector<SpcStats> charts = SpcMonitor::Read(path_);
+    TS_ASSERT_EQUALS(charts.size(), 1u);
+    TS_ASSERT_DELTA(charts[0].target, 0, 0.05);
+    TS_ASSERT_DELTA(charts[0].sigma, std::sqrt(20.0 / 29), 1e-9);
+  }
+
+  void TestNoAlarmDuringWarmup() {
+    SpcMonitor monitor(path_, "station1");
+    Collect(&monitor);
+    for (int i = 0; i < 29; i++) {
+      monitor.Add(2, {{"DCXO", i % 2 ? 20 : -20}});
+    }
+    TS_ASSERT(alarms_.empty());
+    TS_ASSERT_EQUALS(SpcMonitor::Read(path_)[0].sigma, 0);
+  }
+
+  void TestCusumSmallShift() {
+    SpcMonitor monitor(path_, "station1");
+    Collect(&monitor);
+    AddStable(&monitor, 30);
+    /* mean shifts by less than one sigma: 0, 1, 1 repeating */
+    for (int i = 0; i < 60 && alarms_.empty(); i++) {
+      monitor.Add(2, {{"DCXO", i % 3 ? 1 : 0}});
+    }
+    TS_ASSERT(!alarms_.empty());
+    TS_ASSERT_EQUALS(alarms_[0].kind, SpcAlarm::kCusumHigh);
+    TS_ASSERT_EQUALS(alarms_[0].field, "DCXO");
+    TS_ASSERT_EQUALS(alarms_[0].station, "station1");
+    TS_ASSERT_EQUALS(CountAlarms(SpcAlarm::kCusumLow), 0);
+  }
+
+  void TestEwmaEdgeTriggered() {
+    SpcMonitor monitor(path_, "station1");
+    Collect(&monitor);
+    AddStable(&monitor, 30);
+    AddStable(&monitor, 60, -4);
+    TS_ASSERT_EQUALS(CountAlarms(SpcAlarm::kEwma), 1);
+    TS_ASSERT_EQUALS(CountAlarms(SpcAlarm::kCusumHigh), 0);
+    /* the CUSUM restarts after every alarm */
+    TS_ASSERT_LESS_THAN(1, CountAlarms(SpcAlarm::kCusumLow));
+
+    /* back in control, then out again */
+    AddStable(&monitor, 60);
+    TS_ASSERT_EQUALS(CountAlarms(SpcAlarm::kEwma), 1);
+    AddStable(&monitor, 30, 4);
+    TS_ASSERT_EQUALS(CountAlarms(SpcAlarm::kEwma), 2);
+    TS_ASSERT_LESS_THAN(0, CountAlarms(SpcAlarm::kCusumHigh));
+  }
+
+  void TestAlarmFile() {
+    SpcMonitor monitor(path_, "station1");
+    Collect(&monitor);
+    AddStable(&monitor, 30);
+    AddStable(&monitor, 30, 4);
+    TS_ASSERT(!alarms_.empty());
+
+    std::ifstream file(path_ + ".alarms");
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(file, line)) {
+      TS_ASSERT_DIFFERS(line.find(" station1 2 DCXO "), std::string::npos);
+      lines++;
+    }
+    TS_ASSERT_EQUALS(lines, alarms_.size());
+  }
+
+  void TestWriteHook() {
+    FakeFlashAccess *fake = new FakeFlashAccess(MakeImage(2), false);
+    DeviceData board((std::unique_ptr<FlashAccess>(fake)));
+    SpcMonitor monitor(path_, "station1");
+    board.AddWriteHook(&monitor);
+
+    board.WriteFields({{"DCXO", {0x05}}, {"PD_A1_B24", {0xFE}}});
+    std::vector<SpcStats> charts = SpcMonitor::Read(path_);
+    TS_ASSERT_EQUALS(charts.size(), 2u);
+    for (const auto &chart : charts) {
+      TS_ASSERT_EQUALS(chart.version, 2);
+      TS_ASSERT_EQUALS(chart.count, 1u);
+      TS_ASSERT_EQUALS(chart.mean, chart.field == "DCXO" ? 5 : -2);
+    }
+
+    /* written fields are samples even if unchanged, other fields and registers are not */
+    board.WriteFields({{"DCXO", {0x05}}});
+    board.WriteField("MAC_0", {0x00, 0x19, 0xF5, 0x00, 0x00, 0x01});
+    charts = SpcMonitor::Read(path_);
+    TS_ASSERT_EQUALS(charts.size(), 2u);
+    for (const auto &chart : charts) {
+      TS_ASSERT_EQUALS(chart.count, chart.field == "DCXO" ? 2u : 1u);
+      TS_ASSERT_EQUALS(chart.mean, chart.field == "DCXO" ? 5 : -2);
+    }
+  }
+
+  void TestStationsAndVersions() {
+    SpcMonitor station1(path_, "station1");
+    SpcMonitor station2(path_, "station2");
+    SpcMonitor station1_again(path_, "station1");
+    station1.Add(2, {{"DCXO", 1}});
+    station2.Add(2, {{"DCXO", 2}});
+    station1_again.Add(2, {{"DCXO", 3}});
+    station1.Add(1, {{"DCXO", 4}});
+
+    std::vector<SpcStats> charts = SpcMonitor::Read(path_);
+    TS_ASSERT_EQUALS(charts.size(), 3u);
+    for (const auto &chart : charts) {
+      if (chart.station == "station2") {
+        TS_ASSERT_EQUALS(chart.count, 1u);
+        TS_ASSERT_EQUALS(chart.mean, 2);
+      } else if (chart.version == 2) {
+        /* both monitors of station1 share its chart */
+        TS_ASSERT_EQUALS(chart.count, 2u);
+        TS_ASSERT_EQUALS(chart.mean, 2);
+      } else {
+        TS_ASSERT_EQUALS(chart.count, 1u);
+        TS_ASSERT_EQUALS(chart.mean, 4);
+      }
+    }
+  }
+
+  void TestInvalid() {
+    TS_ASSERT_THROWS_EQUALS(SpcMonitor(path_, ""), std::exception &e, std::string(e.what()),
+                            "Invalid station name: ");
+    TS_ASSERT_THROWS_EQUALS(SpcMonitor::Read(path_), std::exception &e, std::string(e.what()),
+                            "Can't open SPC state: " + path_);
+    std::ofstream(path_) << "not a state file, long enough for a header";
+    TS_ASSERT_THROWS_EQUALS(SpcMonitor(path_, "station1"), std::exception &e,
+                            std::string(e.what()), "Not an SPC state file");
+  }
+
+  void TestSampleCost() {
+    SpcMonitor monitor(path_, "station1");
+    Collect(&monitor);
+    const int kSamples = 2000;
+    auto start = std::chrono::steady_clock::now();
+    AddStable(&monitor, kSamples);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    /* a few system calls per sample, far below a millisecond */
+    TS_ASSERT_LESS_THAN(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(),
+                        kSamples * 1000);
+    TS_ASSERT_EQUALS(SpcMonitor::Read(path_)[0].count, static_cast<uint64_t>(kSamples));
+  }
+
+ private:
+  std::string path_;
+  std::vector<SpcAlarm> alarms_;
+};
@@ -0,0 +1,114 @@
+/**
+ * @file
+ * Testsuite for trace events
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "trace.h"
+
+class TraceTestSuite : public CxxTest::TestSuite {
+ private:
+  std::string path;
+
+  std::string ReadTrace() {
+    TS_ASSERT(trace::Tracer::WriteJson(path));
+    std::ifstream in(path.c_str());
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+  }
+
+  static int Occurrences(const std::string &text, const std::string &pattern) {
+    int count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + 1)) {
+      count++;
+    }
+    return count;
+  }
+
+ public:
+  TraceTestSuite() {
+    google::InitGoogleLogging("Trace utest");
+  }
+
+  ~TraceTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    char name[] = "/tmp/traceXXXXXX";
+    int fd = mkstemp(name);
+    close(fd);
+    path = name;
+  }
+
+  void tearDown() {
+    trace::Tracer::Disable();
+    unlink(path.c_str());
+  }
+
+  void TestDisabledRecordsNothing() {
+    {
+      trace::Scope scope("disabled", "test");
+      scope.Arg("size", 1);
+    }
+    TS_ASSERT_EQUALS(Occurrences(ReadTrace(), "\"disabled\""), 0);
+  }
+
+  void TestEventsPerThread() {
+    trace::Tracer::Enable();
+    {
+      trace::Scope scope("outer", "test");
+      scope.Arg("size", 256).Arg("offset", 512);
+      trace::Scope inner("inner", "test");
+    }
+    std::thread worker([] { trace::Scope scope("worker", "test"); });
+    worker.join();
+
+    std::string json = ReadTrace();
+    TS_ASSERT_EQUALS(json.compare(0, 15, "{\"traceEvents\":"), 0);
+    TS_ASSERT_EQUALS(Occurrences(json, "\"name\":\"outer\",\"cat\":\"test\",\"ph\":\"X\""), 1);
+    TS_ASSERT_EQUALS(Occurrences(json, "\"args\":{\"size\":256,\"offset\":512}"), 1);
+    TS_ASSERT_EQUALS(Occurrences(json, "\"inner\""), 1);
+    TS_ASSERT_EQUALS(Occurrences(json, "\"worker\""), 1);
+    TS_ASSERT_EQUALS(Occurrences(json, "\"tid\":1,"), 2);
+    TS_ASSERT_EQUALS(Occurrences(json, "\"tid\":2,"), 1);
+  }
+
+  void TestRingKeepsLatestEvents() {
+    trace::Tracer::Enable();
+    std::thread worker([] {
+      for (int i = 0; i < 5000; i++) {
+        trace::Scope scope("ring", "test");
+        scope.Arg("i", i);
+      }
+    });
+    worker.join();
+
+    std::string json = ReadTrace();
+    TS_ASSERT_EQUALS(Occurrences(json, "\"ring\""), 4096);
+    TS_ASSERT_EQUALS(Occurrences(json, "\"i\":4999}"), 1);
+    TS_ASSERT_EQUALS(Occurrences(json, "\"i\":903}"), 0);
+  }
+};
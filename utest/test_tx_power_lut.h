@@ -0,0 +1,151 @@
+/**
+ * @file
+ * Unit tests for TxPowerLut
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cal_params.h"
+#include "tx_power_lut.h"
+#include "tx_power_lut_reader.h"
+
+class TxPowerLutTestSuite : public CxxTest::TestSuite {
+ public:
+  TxPowerLutTestSuite() {
+    google::InitGoogleLogging("TxPowerLut utest");
+  }
+
+  ~TxPowerLutTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  /* register 1 version 2 fields, antenna 1 offsets 1, 10, 20, 30, 40 and antenna 2 negated */
+  std::map<std::string, std::vector<uint8_t>> Reg1Fields() {
+    static const int offsets[kBandCount] = {1, 10, 20, 30, 40};
+    std::map<std::string, std::vector<uint8_t>> fields;
+    fields["CRC_REG1"] = {0x12, 0x34};
+    fields["VERSION_REG1"] = {0x02};
+    fields["DCXO"] = {0x00};
+    for (int band = 0; band < kBandCount; band++) {
+      fields[PdOffsetField(1, band)] = {static_cast<uint8_t>(offsets[band])};
+      fields[PdOffsetField(2, band)] = {static_cast<uint8_t>(-offsets[band])};
+    }
+    return fields;
+  }
+
+  void TestBandStep() {
+    TxPowerLut lut(Reg1Fields(), TX_POWER_LUT_BAND_STEP);
+    TS_ASSERT_EQUALS(lut.Offset(1, 1), 1);
+    TS_ASSERT_EQUALS(lut.Offset(1, 14), 1);
+    TS_ASSERT_EQUALS(lut.Offset(1, 36), 10);
+    TS_ASSERT_EQUALS(lut.Offset(1, 48), 10);
+    TS_ASSERT_EQUALS(lut.Offset(1, 52), 20);
+    TS_ASSERT_EQUALS(lut.Offset(1, 100), 30);
+    TS_ASSERT_EQUALS(lut.Offset(1, 165), 40);
+    TS_ASSERT_EQUALS(lut.Offset(2, 36), -10);
+    TS_ASSERT_EQUALS(lut.Offset(2, 165), -40);
+  }
+
+  void TestInvalidChannels() {
+    TxPowerLut lut(Reg1Fields(), TX_POWER_LUT_LINEAR);
+    TS_ASSERT_EQUALS(lut.Offset(1, 0), TX_POWER_LUT_NO_OFFSET);
+    TS_ASSERT_EQUALS(lut.Offset(1, 15), TX_POWER_LUT_NO_OFFSET);
+    TS_ASSERT_EQUALS(lut.Offset(1, 37), TX_POWER_LUT_NO_OFFSET);
+    TS_ASSERT_EQUALS(lut.Offset(2, 68), TX_POWER_LUT_NO_OFFSET);
+    TS_ASSERT_EQUALS(lut.Offset(2, 150), TX_POWER_LUT_NO_OFFSET);
+  }
+
+  void TestLinear() {
+    TxPowerLut lut(Reg1Fields(), TX_POWER_LUT_LINEAR);
+    /* 2.4 GHz and channels outside the outermost band centres (42, 157) keep the band offset */
+    TS_ASSERT_EQUALS(lut.Offset(1, 6), 1);
+    TS_ASSERT_EQUALS(lut.Offset(1, 36), 10);
+    TS_ASSERT_EQUALS(lut.Offset(1, 40), 10);
+    TS_ASSERT_EQUALS(lut.Offset(1, 161), 40);
+    /* between centres 42 and 58 */
+    TS_ASSERT_EQUALS(lut.Offset(1, 44), 11);
+    TS_ASSERT_EQUALS(lut.Offset(1, 52), 16);
+    TS_ASSERT_EQUALS(lut.Offset(2, 52), -16);
+    /* between centres 58 and 122 */
+    TS_ASSERT_EQUALS(lut.Offset(1, 100), 27);
+    /* between centres 122 and 157 */
+    TS_ASSERT_EQUALS(lut.Offset(1, 149), 38);
+  }
+
+  void TestMissingPdOffsets() {
+    std::map<std::string, std::vector<uint8_t>> fields = Reg1Fields();
+    fields.erase("PD_A2_B53");
+    TS_ASSERT_THROWS_EQUALS(TxPowerLut(fields, TX_POWER_LUT_BAND_STEP), std::exception &e,
+                            std::string(e.what()), "Register 1 has no power detector offsets");
+  }
+
+  void TestInvalidInterpolation() {
+    TS_ASSERT_THROWS_EQUALS(TxPowerLut(Reg1Fields(), 2), std::exception &e,
+                            std::string(e.what()), "Invalid interpolation");
+  }
+
+  void TestReaderRoundTrip() {
+    TxPowerLut lut(Reg1Fields(), TX_POWER_LUT_LINEAR);
+    std::vector<uint8_t> blob = lut.Serialize();
+    TS_ASSERT_EQUALS(blob.size(), TX_POWER_LUT_HEADER_SIZE + 2u * 166u);
+
+    struct tx_power_lut reader;
+    TS_ASSERT_EQUALS(tx_power_lut_init(&reader, blob.data(), blob.size()), 0);
+    TS_ASSERT_EQUALS(reader.antennas, 2);
+    TS_ASSERT_EQUALS(reader.channels, 166);
+    TS_ASSERT_EQUALS(reader.interpolation, TX_POWER_LUT_LINEAR);
+    for (int antenna = 1; antenna <= 2; antenna++) {
+      for (int channel = 0; channel <= TxPowerLut::kMaxChannel; channel++) {
+        TS_ASSERT_EQUALS(tx_power_lut_offset(&reader, antenna, channel),
+                         lut.Offset(antenna, channel));
+      }
+    }
+  }
+
+  void TestReaderRejectsBadBlob() {
+    std::vector<uint8_t> blob = TxPowerLut(Reg1Fields(), TX_POWER_LUT_BAND_STEP).Serialize();
+    struct tx_power_lut reader;
+    TS_ASSERT_EQUALS(tx_power_lut_init(&reader, blob.data(), blob.size() - 1), -1);
+    TS_ASSERT_EQUALS(tx_power_lut_init(&reader, blob.data(), 4), -1);
+    blob[4] = TX_POWER_LUT_VERSION + 1;
+    TS_ASSERT_EQUALS(tx_power_lut_init(&reader, blob.data(), blob.size()), -1);
+    blob[4] = TX_POWER_LUT_VERSION;
+    blob[0] = 'X';
+    TS_ASSERT_EQUALS(tx_power_lut_init(&reader, blob.data(), blob.size()), -1);
+  }
+
+  void TestWriteFile() {
+    char path[] = "/tmp/txpower_lut_XXXXXX";
+    int fd = mkstemp(path);
+    TS_ASSERT(fd >= 0);
+    close(fd);
+    std::vector<uint8_t> blob = TxPowerLut(Reg1Fields(), TX_POWER_LUT_BAND_STEP).Serialize();
+    WriteTxPowerLut(path, blob);
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> content((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+    TS_ASSERT_EQUALS(content, blob);
+    unlink(path);
+  }
+};
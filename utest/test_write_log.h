@@ -0,0 +1,167 @@
+/**
+ * @file
+ * Unit tests for the write log
+ *
+ * @author Imagination Technologies
+ *
+ * @copyright <b>Copyright 2016 by Imagination Technologies Limited and/or its affiliated group companies.</b>
+ *      All rights reserved.  No part of this software, either
+ *      material or conceptual may be copied or distributed,
+ *      transmitted, transcribed, stored in a retrieval system
+ *      or translated into any human or computer language in any
+ *      form by any means, electronic, mechanical, manual or
+ *      other-wise, or disclosed to the third parties without the
+ *      express written permission of Imagination Technologies
+ *      Limited, Home Park Estate, Kings Langley, Hertfordshire,
+ *      WD4 8LZ, U.K.
+ */
+#include <cxxtest/TestSuite.h>
+#include <glog/logging.h>
+#include <unistd.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "device_data.h"
+#include "flash_access_fake.h"
+#include "otp_image.h"
+#include "write_log.h"
+
+class WriteLogTestSuite : public CxxTest::TestSuite {
+ public:
+  WriteLogTestSuite() {
+    google::InitGoogleLogging("WriteLog utest");
+  }
+
+  ~WriteLogTestSuite() {
+    google::ShutdownGoogleLogging();
+  }
+
+  void setUp() {
+    char path[] = "/tmp/proddata_log_XXXXXX";
+    close(mkstemp(path));
+    path_ = path;
+  }
+
+  void tearDown() {
+    unlink(path_.c_str());
+    unlink((path_ + ".sync").c_str());
+  }
+
+  WriteLogRecord Record(uint8_t serial, int register_number, uint8_t value) {
+    WriteLogRecord record;
+    record.timestamp_us = 1000 + value;
+    record.register_number = register_number;
+    record.serial = std::vector<uint8_t>(8, serial);
+    record.old_data = std::vector<uint8_t>(14, 0xFF);
+    record.new_data = std::vector<uint8_t>(14, value);
+    return record;
+  }
+
+  void TestEncodeDecode() {
+    WriteLogRecord record = Record(0x01, 1, 0x5A);
+    std::vector<uint8_t> data = WriteLog::Encode(record);
+    WriteLogRecord decoded;
+    size_t length = 0;
+    TS_ASSERT(WriteLog::Decode(data.data(), data.size(), &decoded, &length));
+    TS_ASSERT_EQUALS(length, data.size());
+    TS_ASSERT_EQUALS(decoded.timestamp_us, record.timestamp_us);
+    TS_ASSERT_EQUALS(decoded.register_number, 1);
+    TS_ASSERT_EQUALS(decoded.serial, record.serial);
+    TS_ASSERT_EQUALS(decoded.old_data, record.old_data);
+    TS_ASSERT_EQUALS(decoded.new_data, record.new_data);
+
+    data[20] ^= 0x01;
+    TS_ASSERT(!WriteLog::Decode(data.data(), data.size(), &decoded, &length));
+    TS_ASSERT(!WriteLog::Decode(data.data(), data.size() - 1, &decoded, &length));
+  }
+
+  void TestIndexBySerial() {
+    {
+      WriteLog log(path_, {}, 0);
+      log.Append(Record(0x01, 0, 0x10));
+      log.Append(Record(0x02, 1, 0x20));
+      log.Append(Record(0x01, 1, 0x30));
+    }
+    WriteLogIndex index(path_);
+    TS_ASSERT_EQUALS(index.Size(), 3u);
+    std::vector<WriteLogRecord> records = index.Find(std::vector<uint8_t>(8, 0x01));
+    TS_ASSERT_EQUALS(records.size(), 2u);
+    TS_ASSERT_EQUALS(records[0].new_data[0], 0x10);
+    TS_ASSERT_EQUALS(records[1].new_data[0], 0x30);
+    TS_ASSERT(index.Find(std::vector<uint8_t>(8, 0x03)).empty());
+  }
+
+  void TestTornAndCorruptedRecords() {
+    std::vector<uint8_t> good = WriteLog::Encode(Record(0x01, 1, 0x10));
+    std::vector<uint8_t> corrupted = WriteLog::Encode(Record(0x02, 1, 0x20));
+    corrupted[30] ^= 0xFF;
+    std::vector<uint8_t> torn = WriteLog::Encode(Record(0x03, 1, 0x30));
+    std::ofstream file(path_, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(good.data()), good.size());
+    file.write(reinterpret_cast<const char *>(corrupted.data()), corrupted.size());
+    file.write(reinterpret_cast<const char *>(good.data()), good.size());
+    file.write(reinterpret_cast<const char *>(torn.data()), torn.size() / 2);
+    file.close();
+
+    WriteLogIndex index(path_);
+    TS_ASSERT_EQUALS(index.Size(), 2u);
+    TS_ASSERT_EQUALS(index.Corrupted(), 1);
+    TS_ASSERT(index.Find(std::vector<uint8_t>(8, 0x03)).empty());
+  }
+
+  void TestDeviceDataWrites() {
+    FakeFlashAccess *fake = new FakeFlashAccess(MakeImage(2), false);
+    DeviceData device_data((std::unique_ptr<FlashAccess>(fake)));
+    WriteLog log(path_, fake->serial, 0);
+    device_data.AddWriteHook(&log);
+    std::vector<uint8_t> old_data(fake->content.begin() + 256, fake->content.begin() + 270);
+    device_data.WriteField("DCXO", {0x05});
+
+    WriteLogIndex index(path_);
+    std::vector<WriteLogRecord> records = index.Find(fake->serial);
+    TS_ASSERT_EQUALS(records.size(), 1u);
+    TS_ASSERT_EQUALS(records[0].register_number, 1);
+    TS_ASSERT_EQUALS(records[0].old_data, old_data);
+    TS_ASSERT_EQUALS(records[0].new_data, std::vector<uint8_t>(fake->content.begin() + 256,
+                                                               fake->content.begin() + 270));
+    TS_ASSERT_EQUALS(log.Syncs(), 1);
+  }
+
+  void TestConcurrentWritersShareSyncs() {
+    const int kWriters = 8;
+    const int kRecords = 20;
+    std::vector<int> syncs(kWriters);
+    std::vector<std::thread> writers;
+    for (int i = 0; i < kWriters; i++) {
+      writers.emplace_back([this, i, &syncs]() {
+        WriteLog log(path_, std::vector<uint8_t>(8, i), 2);
+        for (int j = 0; j < kRecords; j++) {
+          log.Append(Record(i, 1, j));
+        }
+        syncs[i] = log.Syncs();
+      });
+    }
+    int total_syncs = 0;
+    for (int i = 0; i < kWriters; i++) {
+      writers[i].join();
+      total_syncs += syncs[i];
+    }
+
+    WriteLogIndex index(path_);
+    TS_ASSERT_EQUALS(index.Size(), static_cast<size_t>(kWriters * kRecords));
+    TS_ASSERT_EQUALS(index.Corrupted(), 0);
+    for (int i = 0; i < kWriters; i++) {
+      std::vector<WriteLogRecord> records = index.Find(std::vector<uint8_t>(8, i));
+      TS_ASSERT_EQUALS(records.size(), static_cast<size_t>(kRecords));
+      for (int j = 0; j < static_cast<int>(records.size()); j++) {
+        TS_ASSERT_EQUALS(records[j].new_data[0], j);
+      }
+    }
+    TS_ASSERT_LESS_THAN(total_syncs, kWriters * kRecords);
+  }
+
+ private:
+  std::string path_;
+};